@@ -207,17 +207,20 @@ async function handleMonitorMessage(data) {
                 failed: !results
             })
         } else if (data.type === "brightness") {
-            setBrightness(data.brightness, data.id)
+            setBrightness(data.brightness, data.id, data.percent)
         }  else if (data.type === "sdr") {
-            setSDRBrightness(data.brightness, data.id)
+            setSDRBrightness(data.brightness, data.id, data.duration)
         } else if (data.type === "gamma") {
             setGammaBrightness(data.brightness, data.id)
         } else if (data.type === "settings") {
             const changedMonitors = changedFeatureMonitorIds(settings, data.settings || {})
             const hadSoftwareBrightness = (settings?.useSoftwareBrightnessFallback ? true : false)
+            const hadDDCIsolation = settings?.isolateDDC
             settings = data.settings
             invalidateFeatureSnapshots(changedMonitors)
 
+            if (hadDDCIsolation !== settings?.isolateDDC) applyDDCIsolation();
+
             if (hadSoftwareBrightness && !settings?.useSoftwareBrightnessFallback) restoreSoftwareBrightness();
 
             // Overrides
@@ -226,6 +229,9 @@ async function handleMonitorMessage(data) {
             if (settings?.disableWMI) wmiFailed = true;
             if (settings?.disableWin32) win32Failed = true;
 
+            // Remaps and the high-level setting feed the transfer functions
+            updateBrightnessTransfers()
+
         } else if (data.type === "ddcBrightnessVCPs") {
             const changedMonitors = changedFeatureMonitorIds(
                 { userDDCBrightnessVCPs: ddcBrightnessVCPs },
@@ -255,7 +261,12 @@ async function handleMonitorMessage(data) {
                         }
                     }
                 }
+                updateBrightnessTransfers()
             }
+        } else if (data.type === "displayTopologyChanged") {
+            handleDisplayTopologyChanged()
+        } else if (data.type === "displayPowerState") {
+            setDisplayPowerState(data.on)
         } else if (data.type === "localization") {
             localization = data.localization
         } else if (data.type === "vcp") {
@@ -395,18 +406,74 @@ function ddcSentinelEnd() {
     } catch (e) { }
 }
 
+// With DDC/CI isolated in a worker process, a driver crash comes back as an
+// error instead of killing us. Record the same evidence the sentinel would
+// have left behind.
+function recordDDCWorkerCrash(stage, monitor, e) {
+    if (e?.workerCrashed) {
+        console.log(`\x1b[41mDDC/CI worker crashed during ${stage}.\x1b[0m`, monitor, e.win32Code)
+        unstableDDC.downgraded = { time: Date.now(), stage, monitor }
+        if (monitor) {
+            unstableDDC[monitor] = { time: Date.now(), stage }
+        }
+        writeUnstableDDC()
+    }
+}
+
 function withDDCSentinel(stage, monitor, operation) {
     ddcSentinelStart(stage, monitor)
+    let isAsync = false
     try {
-        return operation()
+        const result = operation()
+        if (typeof result?.then === "function") {
+            // Scheduled refreshes and queued commands run on native threads;
+            // keep the sentinel up until they settle.
+            isAsync = true
+            return result.catch(e => {
+                recordDDCWorkerCrash(stage, monitor, e)
+                throw e
+            }).finally(ddcSentinelEnd)
+        }
+        return result
+    } catch (e) {
+        recordDDCWorkerCrash(stage, monitor, e)
+        throw e
     } finally {
         // A native crash never reaches this point, leaving evidence for the
         // next worker. Ordinary JavaScript/native errors do, so don't treat
         // them as crashes on the next startup.
-        ddcSentinelEnd()
+        if (!isAsync) ddcSentinelEnd()
+    }
+}
+
+// DDC/CI refreshes go through the native scheduler, so a topology change
+// that arrives mid-probe can abandon the stale refresh instead of waiting
+// for it. The caller then gets the replacement refresh's results.
+const ddcTopologySettleMs = 1000
+let ddcRefreshesPending = 0
+let lastDDCRefreshMethod = "accurate"
+
+async function scheduleDDCRefresh(ddcciMethod) {
+    ddcRefreshesPending++
+    lastDDCRefreshMethod = ddcciMethod
+    try {
+        const result = await ddcci.scheduleRefresh(ddcciMethod, true, !settings.disableHighLevel, 0)
+        if (result.generation < result.latestGeneration) {
+            console.log(`DDC/CI refresh #${result.generation} already superseded by #${result.latestGeneration}.`)
+        }
+        return result.monitors
+    } finally {
+        ddcRefreshesPending--
     }
 }
 
+function handleDisplayTopologyChanged() {
+    if (ddcRefreshesPending === 0 || !ddcci?.scheduleRefresh) return;
+    ddcci.scheduleRefresh(lastDDCRefreshMethod, true, !settings.disableHighLevel, ddcTopologySettleMs).catch(e => {
+        console.log("Couldn't reschedule DDC/CI refresh:", e)
+    })
+}
+
 // A graceful exit mid-operation isn't crash evidence.
 process.on('exit', ddcSentinelEnd)
 
@@ -524,10 +591,8 @@ refreshMonitors = async (fullRefresh = false, ddcciType = "default", alwaysSendU
             try {
                 if (settings?.getDDCBrightnessUpdates) {
                     if(!getDDCCI()) {
-                        ddcci._refresh(
-                            (shouldEnrichCapabilities() ? "fast" : determineDDCCIMethod()),
-                            true,
-                            !settings.disableHighLevel
+                        await scheduleDDCRefresh(
+                            (shouldEnrichCapabilities() ? "fast" : determineDDCCIMethod())
                         )
                     }
                     for (const hwid2 in monitors) {
@@ -550,12 +615,8 @@ refreshMonitors = async (fullRefresh = false, ddcciType = "default", alwaysSendU
                     console.log(`getBrightnessInternal() Total: ${(startTime - process.hrtime.bigint()) / BigInt(-1000000)}ms`)
 
                     if (wmiBrightness) {
-                        updateDisplay(monitors, wmiBrightness.hwid[2], wmiBrightness)
-
-                        // If Win32 doesn't find the internal display, hide it.
-                        if (settings?.hideClosedLid && Object.keys(monitorsWin32).indexOf(wmiBrightness.hwid[2]) < 0) {
-                            updateDisplay(monitors, wmiBrightness.hwid[2], { type: "none" })
-                        }
+                        applyInternalBrightness(monitors, wmiBrightness)
+                        watchInternalBrightness()
                     }
                 } catch (e) {
                     console.log("\x1b[41m" + "getBrightnessInternal() failed!" + "\x1b[0m", e)
@@ -586,9 +647,10 @@ refreshMonitors = async (fullRefresh = false, ddcciType = "default", alwaysSendU
 
             // Hide internal
             if (settings?.hideClosedLid) {
-                const wmiMonitor = Object.values(monitors).find(mon => mon.type === "wmi")
-                if (wmiMonitor && !monitorsWin32[wmiMonitor.hwid[2]]) {
-                    updateDisplay(monitors, wmiMonitor.hwid[2], { type: "none" })
+                for (const wmiMonitor of Object.values(monitors).filter(mon => mon.type === "wmi")) {
+                    if (!monitorsWin32[wmiMonitor.hwid[2]]) {
+                        updateDisplay(monitors, wmiMonitor.hwid[2], { type: "none" })
+                    }
                 }
             }
 
@@ -625,11 +687,14 @@ async function readKnownBrightness() {
         console.log("\x1b[41mgetKnownBrightnessDDC() failed!\x1b[0m", e)
     }
 
-    // Internal display brightness (native WMI preferred, WMIC fallback)
-    if (canUseInternalBrightness()) {
+    // Internal display brightness (native WMI preferred, WMIC fallback).
+    // While brightness events are coming in, the known level is current.
+    if (canUseInternalBrightness() && !watchingInternalBrightness()) {
         try {
             const wmiBrightness = await getBrightnessInternal()
-            if (wmiBrightness) updateDisplay(monitors, wmiBrightness.hwid[2], wmiBrightness)
+            for (const panel of (wmiBrightness || [])) {
+                updateDisplay(monitors, panel.hwid[2], panel)
+            }
         } catch (e) {
             console.log("\x1b[41mgetKnownBrightnessInternal() failed!\x1b[0m", e)
         }
@@ -699,8 +764,8 @@ async function enrichMonitorCapabilities() {
             if (!id || monitorReports[id] || unstableDDC[id]) continue
 
             try {
-                const reportRaw = withDDCSentinel("capabilities", id, () =>
-                    ddcci.getCapabilitiesRaw(id)
+                const reportRaw = await withDDCSentinel("capabilities", id, () =>
+                    ddcci.getCapabilitiesRawAsync(id)
                 )
                 if (reportRaw) {
                     monitorReportsRaw[id] = reportRaw
@@ -835,11 +900,10 @@ getAllMonitors = async (ddcciMethod = "default", coreOnly = false) => {
             ddcciInfo.brightnessRaw = ddcciInfo.brightnessValues[0]
             ddcciInfo.brightnessMax = ddcciInfo.brightnessValues[1]
 
-            // Get normalization info
+            // Get normalization info. Remaps are applied to writes by the
+            // native brightness transfer function, not to reads.
             ddcciInfo = applyRemap(ddcciInfo)
-
-            // Unnormalize brightness
-            ddcciInfo.brightness = normalizeBrightness(ddcciInfo.brightnessRaw, true, ddcciInfo.min, ddcciInfo.max)
+            ddcciInfo.brightness = ddcciInfo.brightnessRaw
             updateDisplay(foundMonitors, hwid2, ddcciInfo)
         }
         console.log(`getFeaturesDDC() Total: ${(startTime - process.hrtime.bigint()) / BigInt(-1000000)}ms`)
@@ -865,14 +929,7 @@ getAllMonitors = async (ddcciMethod = "default", coreOnly = false) => {
             const wmiBrightness = await getBrightnessInternal()
             console.log(`getBrightnessInternal() Total: ${(startTime - process.hrtime.bigint()) / BigInt(-1000000)}ms`)
 
-            if (wmiBrightness) {
-                updateDisplay(foundMonitors, wmiBrightness.hwid[2], wmiBrightness)
-
-                // If Win32 doesn't find the internal display, hide it.
-                if (settings?.hideClosedLid && Object.keys(monitorsWin32).indexOf(wmiBrightness.hwid[2]) < 0) {
-                    updateDisplay(foundMonitors, wmiBrightness.hwid[2], { type: "none" })
-                }
-            }
+            if (wmiBrightness) applyInternalBrightness(foundMonitors, wmiBrightness);
         } catch (e) {
             console.log("\x1b[41m" + "getBrightnessInternal() failed!" + "\x1b[0m", e)
         }
@@ -906,9 +963,10 @@ getAllMonitors = async (ddcciMethod = "default", coreOnly = false) => {
 
     // Hide internal
     if (settings?.hideClosedLid) {
-        const wmiMonitor = Object.values(foundMonitors).find(mon => mon.type === "wmi")
-        if (wmiMonitor && !monitorsWin32[wmiMonitor.hwid[2]]) {
-            updateDisplay(foundMonitors, wmiMonitor.hwid[2], { type: "none" })
+        for (const wmiMonitor of Object.values(foundMonitors).filter(mon => mon.type === "wmi")) {
+            if (!monitorsWin32[wmiMonitor.hwid[2]]) {
+                updateDisplay(foundMonitors, wmiMonitor.hwid[2], { type: "none" })
+            }
         }
     }
 
@@ -924,6 +982,8 @@ getAllMonitors = async (ddcciMethod = "default", coreOnly = false) => {
         console.log("\x1b[41m" + "Fixing names failed!" + "\x1b[0m", e)
     }
 
+    updateBrightnessTransfers(foundMonitors)
+
     console.log(`getAllMonitors() total: ${(fullStartTime - process.hrtime.bigint()) / BigInt(-1000000)}ms`)
     try {
         console.log(`Monitors found: ${Object.keys(foundMonitors)}`)
@@ -1134,9 +1194,33 @@ setStudioDisplayBrightness = async (serial, brightness) => {
     return false
 }
 
+// HDR state comes from the same display target query as getMonitorsWin32,
+// re-reading only the SDR white levels, which change without a display
+// change. Before Windows 11 24H2 the query can't tell HDR from SDR with Auto
+// Color Management, so windows-hdr's own DXGI-checked sweep is used there.
+async function getHDRDisplayList() {
+    const { targets } = await w32disp.queryDisplayTargets({ refreshWhiteLevels: true })
+    const displays = []
+    for (const target of targets) {
+        const color = target.advancedColor
+        if (!target.devicePath || !color || target.sdrWhiteLevel === null) continue
+        if (color.activeColorMode === null) return hdr.getDisplays();
+        displays.push({
+            name: target.name,
+            path: target.devicePath.split("#{")[0],
+            nits: Math.floor(target.sdrWhiteLevel * 80 / 1000),
+            hdrSupported: color.hdrSupported,
+            hdrEnabled: color.hdrUserEnabled,
+            hdrActive: color.activeColorMode === "hdr",
+            bits: color.bitsPerColorChannel
+        })
+    }
+    return displays
+}
+
 getHDRDisplays = async (monitors) => {
     try {
-        const displays = hdr.getDisplays()
+        const displays = await getHDRDisplayList()
         lastHDR = displays
         for(const display of displays) {
             const hwid = display.path.split("#")
@@ -1205,6 +1289,7 @@ getMonitorsInternal = async () => {
 // so latching it without a fallback would trade a fast write path for nothing.
 let bridgeBrightnessFailures = 0
 const BRIDGE_BRIGHTNESS_FAILURE_LIMIT = 3
+// Resolves to every internal panel the preferred WMI method can read, or false.
 getBrightnessInternal = async () => {
     if (canUseWmiBridgeNow()) {
         const brightness = await getBrightnessWMI()
@@ -1223,29 +1308,76 @@ getBrightnessInternal = async () => {
         }
     }
     if (!wmicUnavailable) {
-        return await getBrightnessWMIC()
+        const brightness = await getBrightnessWMIC()
+        return (brightness ? [brightness] : false)
     }
     return false
 }
 
+function applyInternalBrightness(monitorList, panels) {
+    for (const panel of panels) {
+        updateDisplay(monitorList, panel.hwid[2], panel)
+
+        // If Win32 doesn't find the internal display, hide it.
+        if (settings?.hideClosedLid && Object.keys(monitorsWin32).indexOf(panel.hwid[2]) < 0) {
+            updateDisplay(monitorList, panel.hwid[2], { type: "none" })
+        }
+    }
+}
+
+// Windows raises WmiMonitorBrightnessEvent whenever the internal panel's level
+// changes, whether from brightness keys, battery saver or adaptive brightness.
+// Subscribing keeps the known level current without reading it back.
+let internalBrightnessEvents = false
+async function watchInternalBrightness() {
+    if (internalBrightnessEvents || !canUseWmiBridgeNow()) return
+    internalBrightnessEvents = true
+    internalBrightnessEvents = await wmibridge.onBrightnessChange(handleInternalBrightnessEvent)
+    if (!internalBrightnessEvents) console.log("Couldn't subscribe to internal brightness events.")
+}
+
+function watchingInternalBrightness() {
+    return internalBrightnessEvents === true && canUseWmiBridgeNow()
+}
+
+function handleInternalBrightnessEvent(event) {
+    try {
+        if (!monitors || !canUseWmiBridgeNow() || !event?.InstanceName) return
+        const hwid = readInstanceName(event.InstanceName)
+        const monitor = monitors[hwid[2].split("_")[0]]
+        if (monitor?.type !== "wmi") return
+        monitor.brightness = event.Brightness
+        monitor.brightnessRaw = event.Brightness
+        process.send({
+            type: "internalBrightnessChanged",
+            id: monitor.id,
+            brightness: event.Brightness
+        })
+    } catch (e) {
+        console.log("handleInternalBrightnessEvent failed:", e)
+    }
+}
+
 let wmiFailed = false
 getMonitorsWMI = () => {
     return new Promise(async (resolve, reject) => {
         const foundMonitors = {}
         try {
-            const timeout = setTimeout(() => { wmiFailed = true; console.log("getMonitorsWMI Timed out."); reject({}) }, 4000)
-            const wmiMonitors = await wmibridge.getMonitors();
+            // wmi-bridge gives up on its own after 4s, so this can't hang.
+            const wmiMonitors = await wmibridge.getMonitors(4000);
 
             if (wmiMonitors.failed) {
                 // Something went wrong
-                console.log("\x1b[41m" + "Recieved FAILED response from getMonitors()" + "\x1b[0m")
+                if (wmiMonitors.timedOut) {
+                    console.log("getMonitorsWMI Timed out.")
+                } else {
+                    console.log("\x1b[41m" + "Recieved FAILED response from getMonitors()" + "\x1b[0m")
+                }
                 // The bridge is the primary source for the internal display, so a hard
-                // failure here must flip wmiFailed. Otherwise the WMIC fallback is never
-                // reached, since the 4s timeout above can't fire during the blocking
-                // native call. getBrightnessWMI() deliberately does NOT do this: a failed
-                // response there is normal on desktops with no internal panel.
+                // failure or a timeout here must flip wmiFailed. Otherwise the WMIC
+                // fallback is never reached. getBrightnessWMI() deliberately does NOT do
+                // this: a failed response there is normal on desktops with no internal panel.
                 wmiFailed = true
-                clearTimeout(timeout)
                 resolve(foundMonitors)
             } else {
                 // Sort through results
@@ -1270,7 +1402,6 @@ getMonitorsWMI = () => {
 
                     foundMonitors[hwid[2]] = wmiInfo
                 }
-                clearTimeout(timeout)
             }
         } catch (e) {
             console.log(`getMonitorsWMI: Failed to get all monitors.`)
@@ -1287,19 +1418,12 @@ getMonitorsWin32 = () => {
     return new Promise(async (resolve, reject) => {
         try {
             const timeout = setTimeout(() => { win32Failed = true; console.log("getMonitorsWin32 Timed out."); reject({}) }, 4000)
-            let displays = []
-            const displayConfig = await w32disp.extractDisplayConfig()
-
-            // Filter results
-            for (const display of displayConfig) {
-                // Must be an active display
-                if(display.inUse) {
-                    displays.push(display)
-                }
-            }
+            // Only active displays are described, names and modes included
+            const { targets } = await w32disp.queryDisplayTargets()
 
             // Prepare results
-            for (const monitor of displays) {
+            for (const monitor of targets) {
+                if (!monitor.sourceMode || !monitor.devicePath) continue;
                 const hwid = monitor.devicePath.split("#")
                 hwid[2] = hwid[2].split("_")[0]
 
@@ -1308,12 +1432,12 @@ getMonitorsWin32 = () => {
                     key: hwid[2],
                     connector: monitor.outputTechnology,
                     hwid: hwid,
-                    sourceID: monitor.sourceConfigId?.id,
+                    sourceID: monitor.sourceId,
                     scaling: monitor.scaling,
                     bounds: monitor.sourceMode
                 }
-                if (monitor.displayName?.length > 0) {
-                    win32Info.name = monitor.displayName;
+                if (monitor.name?.length > 0) {
+                    win32Info.name = monitor.name;
                 }
 
                 foundDisplays[hwid[2]] = win32Info
@@ -1347,8 +1471,8 @@ getFeaturesDDC = (ddcciMethod = "accurate", coreOnly = false) => {
             await wait(10)
 
             // Sometimes the handles returned are NULL, so we should try again.
-            let tmpDdcciMonitors = withDDCSentinel("refresh", false, () =>
-                ddcci.getAllMonitors(ddcciMethod, true, !settings.disableHighLevel)
+            let tmpDdcciMonitors = await withDDCSentinel("refresh", false, () =>
+                scheduleDDCRefresh(ddcciMethod)
             )
             if(tmpDdcciMonitors) {
                 let doRetry = false
@@ -1361,8 +1485,8 @@ getFeaturesDDC = (ddcciMethod = "accurate", coreOnly = false) => {
                 if(doRetry) {
                     console.log(`DDC/CI results contain a null handle (${doRetry?.deviceKey}). Trying again.`)
                     await wait(200)
-                    tmpDdcciMonitors = withDDCSentinel("refresh", false, () =>
-                        ddcci.getAllMonitors(ddcciMethod, true, !settings.disableHighLevel)
+                    tmpDdcciMonitors = await withDDCSentinel("refresh", false, () =>
+                        scheduleDDCRefresh(ddcciMethod)
                     )
                     for(const monitor of tmpDdcciMonitors) {
                         if(monitor.handleIsValid === false) {
@@ -1444,8 +1568,8 @@ checkMonitorFeatures = async (monitor, skipCache = false, ddcciMethod = "accurat
             if(unstableDDC[monitor]) {
                 console.log(`Skipping capabilities report for ${monitor} due to crash evidence from a previous session.`)
             } else if(ddcciMethod === "accurate" && !monitorReports[monitor]) {
-                const reportRaw = withDDCSentinel("capabilities", monitor, () =>
-                    ddcci.getCapabilitiesRaw(monitor)
+                const reportRaw = await withDDCSentinel("capabilities", monitor, () =>
+                    ddcci.getCapabilitiesRawAsync(monitor)
                 )
                 if(shouldAbort()) return {}
                 if(reportRaw) {
@@ -1531,34 +1655,36 @@ getBrightnessWMI = () => {
     // Request WMI monitors.
     return new Promise(async (resolve, reject) => {
         try {
-            const timeout = setTimeout(() => { console.log("getBrightnessWMI Timed out."); reject(false) }, 4000)
-            const monitor = await wmibridge.getBrightness();
-            if (monitor.failed) {
+            // Every internal panel, in one pass
+            const panels = await wmibridge.getBrightnessAll(4000);
+            if (panels.failed) {
                 // Something went wrong
-                clearTimeout(timeout)
+                if (panels.timedOut) console.log("getBrightnessWMI Timed out.");
                 resolve(false)
             } else {
-                let hwid = readInstanceName(monitor.InstanceName)
-                hwid[2] = hwid[2].split("_")[0]
-
-                let wmiInfo = {
-                    id: `\\\\?\\${hwid[0]}#${hwid[1]}#${hwid[2]}`,
-                    brightness: monitor.Brightness,
-                    hwid: hwid,
-                    min: 0,
-                    max: 100,
-                    type: 'wmi',
-                }
-
-                // Get normalization info
-                wmiInfo = applyRemap(wmiInfo)
+                const found = []
+                for (const instanceName in panels) {
+                    const monitor = panels[instanceName]
+                    let hwid = readInstanceName(monitor.InstanceName)
+                    hwid[2] = hwid[2].split("_")[0]
 
-                // Unnormalize brightness
-                wmiInfo.brightnessRaw = monitor.Brightness
-                wmiInfo.brightness = normalizeBrightness(wmiInfo.brightness, true, wmiInfo.min, wmiInfo.max)
-                clearTimeout(timeout)
+                    let wmiInfo = {
+                        id: monitor.MonitorId,
+                        brightness: monitor.Brightness,
+                        brightnessLevels: monitor.Levels,
+                        wmiInstance: monitor.InstanceName,
+                        hwid: hwid,
+                        min: 0,
+                        max: 100,
+                        type: 'wmi',
+                    }
 
-                resolve(wmiInfo)
+                    // Get normalization info
+                    wmiInfo = applyRemap(wmiInfo)
+                    wmiInfo.brightnessRaw = monitor.Brightness
+                    found.push(wmiInfo)
+                }
+                resolve(found.length ? found : false)
             }
         } catch (e) {
             console.log(e)
@@ -1609,8 +1735,6 @@ getBrightnessDDC = (monitorObj, includeFeatures = true, reportReadFailure = fals
 
             // Get normalization info
             monitor = applyRemap(monitor)
-            // Unnormalize brightness
-            monitor.brightness = normalizeBrightness(monitor.brightness, true, monitor.min, monitor.max)
 
             // Get custom DDC/CI features
             const settingsFeatures = settings?.monitorFeatures?.[monitor.hwid[1]]
@@ -1659,55 +1783,63 @@ updateDisplay = (monitors, hwid2, info = {}) => {
     return true
 }
 
-function setSDRBrightness(brightness, id) {
+function setSDRBrightness(brightness, id, duration = 0) {
     if(settings.disableHDR) return false;
     try {
         console.log("sdr", brightness, id)
-        return hdr.setSDRBrightness(id, (brightness * 0.01 * 400) + 80)
+        const nits = (brightness * 0.01 * 400) + 80
+        // Brightness transitions hand the whole fade to the native ramp
+        if(duration > 0) return hdr.rampSDRBrightness(id, nits, duration, "linear");
+        return hdr.setSDRBrightness(id, nits)
     } catch(e) {
         console.log(`Couldn't update SDR brightness! [${id}]`, e);
         return false
     }
 }
 
-function setBrightness(brightness, id) {
+// Update tracked brightness values
+function trackBrightness(monitor, brightness) {
+    const brightnessRaw = monitor.type === "software"
+        ? Math.max(SOFTWARE_BRIGHTNESS_MIN, parseInt(brightness))
+        : parseInt(brightness)
+    monitor.brightness = brightnessRaw * (100 / (monitor.brightnessMax || 100))
+    monitor.brightnessRaw = brightnessRaw
+    if(monitor.brightnessValues) monitor.brightnessValues[0] = brightnessRaw;
+}
+
+// `percent` is the slider level before remaps. DDC/CI displays with a
+// compiled transfer function use it directly; `brightness` is the already
+// remapped raw value used by every other path.
+function setBrightness(brightness, id, percent) {
     try {
         if (id) {
             let monitor = Object.values(monitors).find(mon => mon.id?.indexOf(id) >= 0)
             if(monitor) {
-                // Check if user has set a custom brightness VCP code for this monitor
-                const hasCustomBrightnessVCP = monitor.hwid && ddcBrightnessVCPs[monitor.hwid[1]]
-                if (monitor.type == "studio-display") {
+                const transferId = monitor.hwid?.join("#")
+                if (monitor.type == "ddcci" && percent !== undefined && brightnessTransferIds.has(transferId)) {
+                    setBrightnessPercent(transferId, percent).then(raw => {
+                        if (raw !== false) trackBrightness(monitor, raw)
+                    })
+                    return
+                } else if (monitor.type == "studio-display") {
                     setStudioDisplayBrightness(monitor.serial, brightness)
                 } else if (monitor.type === "software") {
                     if (setSoftwareBrightness(monitor, brightness) === false) {
                         console.log(`Couldn't set software brightness for monitor ${monitor.id}`)
                         return false
                     }
-                } else if(!settings.disableHighLevel && monitor.highLevelSupported?.brightness && !hasCustomBrightnessVCP) {
+                } else if (monitor.type == "wmi") {
+                    setInternalBrightness(monitor, brightness)
+                    return
+                } else if(usesHighLevelBrightness(monitor)) {
                     setHighLevelBrightness(monitor.hwid.join("#"), brightness)
                 } else {
                     setVCP(monitor.hwid.join("#"), monitor.brightnessType, brightness)
                 }
-                // Update tracked brightness values
-                const brightnessRaw = monitor.type === "software"
-                    ? Math.max(SOFTWARE_BRIGHTNESS_MIN, parseInt(brightness))
-                    : parseInt(brightness)
-                monitor.brightness = brightnessRaw * (100 / (monitor.brightnessMax || 100))
-                monitor.brightnessRaw = brightnessRaw
-                if(monitor.brightnessValues) monitor.brightnessValues[0] = brightnessRaw;
+                trackBrightness(monitor, brightness)
             }
         } else {
-            let monitor = Object.values(monitors).find(mon => mon.type == "wmi")
-            monitor.brightness = brightness
-            monitor.brightnessRaw = brightness
-            if (canUseWmiBridgeNow()) {
-                // Set brightness via native WMI
-                wmibridge.setBrightness(brightness);
-            } else {
-                // If native WMI is unavailable, fall back to old method
-                exec(`powershell.exe -NoProfile (Get-WmiObject -Namespace root\\wmi -Class WmiMonitorBrightnessMethods).wmisetbrightness(0, ${brightness})`)
-            }
+            setInternalBrightness(Object.values(monitors).find(mon => mon.type == "wmi"), brightness)
         }
     } catch (e) {
         console.log(`Couldn't update brightness! [${id}]`);
@@ -1716,6 +1848,18 @@ function setBrightness(brightness, id) {
     }
 }
 
+function setInternalBrightness(monitor, brightness) {
+    monitor.brightness = brightness
+    monitor.brightnessRaw = brightness
+    if (canUseWmiBridgeNow()) {
+        // Set brightness via native WMI, on this panel only
+        wmibridge.setBrightnessFor(monitor.wmiInstance || monitor.id, brightness);
+    } else {
+        // If native WMI is unavailable, fall back to old method
+        exec(`powershell.exe -NoProfile (Get-WmiObject -Namespace root\\wmi -Class WmiMonitorBrightnessMethods).wmisetbrightness(0, ${brightness})`)
+    }
+}
+
 let vcpCache = {}
 async function checkVCPIfEnabled(monitor, code, setting, skipCache = false) {
     const vcpString = vcpStr(code)
@@ -1770,7 +1914,7 @@ async function checkVCP(monitor, code, skipCacheWrite = false, useCachedOnError
     const vcpString = vcpStr(code)
     if(!code || code == "0x0") return false;
     try {
-        let result = ddcci._getVCP(monitor, parseInt(vcpString))
+        let result = await ddcci.getVCPAsync(monitor, parseInt(vcpString))
         if (code === 96) return ddcci.getMonitorInputs(monitor)
         if (!skipCacheWrite) {
             if (!vcpCache[monitor]) vcpCache[monitor] = {};
@@ -1796,7 +1940,8 @@ async function setVCP(monitor, code, value) {
     if(busyLevel > 0) while(busyLevel > 0) { await wait(100) } // Wait until no longer busy
     try {
         const vcpString = vcpStr(code)
-        let result = ddcci._setVCP(monitor, code, (value * 1))
+        let result = await ddcci.setVCPAsync(monitor, code, (value * 1))
+        if (code == 0xD6 && value == 1) scheduleParkedWriteResume()
         if (vcpCache[monitor]?.["vcp_" + vcpString]) {
             vcpCache[monitor]["vcp_" + vcpString][0] = (value * 1)
         }
@@ -1816,7 +1961,7 @@ async function setVCP(monitor, code, value) {
 
 async function getHighLevelBrightness(monitor) {   
     try {
-        let result = ddcci._getHighLevelBrightness(monitor)
+        let result = await ddcci._getHighLevelBrightnessAsync(monitor)
         return result
     } catch (e) {
         console.log(e)
@@ -1824,10 +1969,20 @@ async function getHighLevelBrightness(monitor) {
     }
 }
 
+async function setBrightnessPercent(monitor, percent) {
+    if(busyLevel > 0) while(busyLevel > 0) { await wait(100) } // Wait until no longer busy
+    try {
+        return await ddcci.setBrightnessPercentAsync(monitor, percent)
+    } catch (e) {
+        console.log(`Error setting brightness for ${monitor}. Reason: ${classifyDDCError(e)}`)
+        return false
+    }
+}
+
 async function setHighLevelBrightness(monitor, value) {
     if(busyLevel > 0) while(busyLevel > 0) { await wait(100) } // Wait until no longer busy   
     try {
-        let result = ddcci._setHighLevelBrightness(monitor, value)
+        let result = await ddcci._setHighLevelBrightnessAsync(monitor, value)
         return result
     } catch (e) {
         console.log(e)
@@ -1835,51 +1990,68 @@ async function setHighLevelBrightness(monitor, value) {
     }
 }
 
-function normalizeBrightness(brightness, unnormalize = false, min = 0, max = 100) {
-    return brightness // Disabled because it wasn't working
-    // Clean this up later
-    // Really
-    // Do it
-    let level = brightness
-    if (level > 100) level = 100;
-    if (level < 0) level = 0;
-    if (min > 0 || max < 100) {
-        let out = level
-        if (!unnormalize) {
-            // Normalize
-            out = (min + ((level / 100) * (max - min)))
-        } else {
-            // Unnormalize
-            out = ((level - min) * (100 / (max - min)))
-        }
-        if (out > 100) out = 100;
-        if (out < 0) out = 0;
-
-        return Math.round(out)
-    } else {
-        return level
-    }
-}
-
-
-
-function applyRemap(monitor) {
+// Finds the user's remap for a display, preferring one keyed by its ID over
+// the older name-based entries.
+function findRemap(monitor) {
+    let found = false
     if (settings.remaps) {
         for (let remapName in settings.remaps) {
             if (remapName == monitor.name || remapName == monitor.id) {
-                let remap = settings.remaps[remapName]
-                monitor.min = remap.min
-                monitor.max = remap.max
+                found = settings.remaps[remapName]
                 // Stop if using new scheme
-                if (remapName == monitor.id) return monitor;
+                if (remapName == monitor.id) break;
             }
         }
     }
+    return found
+}
+
+function applyRemap(monitor) {
+    const remap = findRemap(monitor)
+    if (remap) {
+        monitor.min = remap.min
+        monitor.max = remap.max
+    }
     if (typeof monitor.min === "undefined") monitor.min = 0;
     if (typeof monitor.max === "undefined") monitor.max = 100;
     return monitor
 }
 
+function usesHighLevelBrightness(monitor) {
+    const hasCustomBrightnessVCP = monitor.hwid && ddcBrightnessVCPs[monitor.hwid[1]]
+    return !settings.disableHighLevel && monitor.highLevelSupported?.brightness && !hasCustomBrightnessVCP
+}
+
+// Compiles each DDC/CI display's remap, calibration, brightness VCP code and
+// raw range into node-ddcci. Brightness writes are then a table lookup in
+// native code instead of per-call math and rule lookups here.
+const brightnessTransferIds = new Set()
+function updateBrightnessTransfers(monitorList = monitors) {
+    if (!ddcci?._setBrightnessTransfer || !monitorList) return;
+    try {
+        ddcci._clearBrightnessTransfer()
+        brightnessTransferIds.clear()
+        for (const hwid2 in monitorList) {
+            const monitor = monitorList[hwid2]
+            if (monitor.type !== "ddcci" || !monitor.brightnessType || !monitor.hwid?.length) continue;
+            const id = monitor.hwid.join("#")
+            const remap = findRemap(monitor)
+            ddcci._setBrightnessTransfer(id, {
+                vcpCode: parseInt(monitor.brightnessType),
+                highLevel: !!usesHighLevelBrightness(monitor),
+                maxValue: monitor.brightnessMax || 100,
+                min: remap?.min ?? 0,
+                max: remap?.max ?? 100,
+                calibration: remap?.calibration || [],
+                curve: remap?.curve || "linear"
+            })
+            brightnessTransferIds.add(id)
+        }
+    } catch (e) {
+        console.log("Couldn't update brightness transfer functions", e)
+    }
+}
+
 
 function readInstanceName(insName) {
     return (insName ? insName.replace(/&amp;/g, '&').split("\\") : undefined)
@@ -1903,6 +2075,7 @@ function getDDCCI() {
         ddcci = require("@hensm/ddcci");
         // Level 2 (verbose) in dev; level 1 (errors/warnings) otherwise, captured to the session log
         ddcci._setLogLevel(isDev ? 2 : 1);
+        applyDDCIsolation();
         return true;
     } catch (e) {
         console.log('Couldn\'t start DDC/CI', e);
@@ -1910,6 +2083,49 @@ function getDDCCI() {
     }
 }
 
+// node-ddcci parks writes to sleeping monitors. Once displays are back on,
+// check a few times while they finish waking, then stop.
+const PARKED_WRITE_RESUME_DELAYS = [1000, 3000, 6000, 12000]
+let parkedWriteResumeTimeouts = []
+function scheduleParkedWriteResume() {
+    parkedWriteResumeTimeouts.forEach(timeout => clearTimeout(timeout))
+    parkedWriteResumeTimeouts = PARKED_WRITE_RESUME_DELAYS.map(delay => setTimeout(async () => {
+        if (busyLevel > 0) return;
+        try {
+            const { replayed, pending } = await ddcci.resumeParkedWrites()
+            if (replayed) console.log(`Replayed ${replayed} parked DDC/CI write(s).`)
+            if (!pending) parkedWriteResumeTimeouts.forEach(timeout => clearTimeout(timeout))
+        } catch (e) {
+            console.log("Couldn't resume parked DDC/CI writes", e)
+        }
+    }, delay))
+}
+
+function setDisplayPowerState(on) {
+    if (!ddcci?.setDisplayPowerState) return;
+    try {
+        ddcci.setDisplayPowerState(on)
+        if (on) scheduleParkedWriteResume()
+    } catch (e) {
+        console.log("Couldn't update display power state", e)
+    }
+}
+
+// Runs DDC/CI calls in node-ddcci's worker process unless disabled, so a
+// crashing monitor driver only restarts the worker.
+async function applyDDCIsolation() {
+    if (!ddcci?.useWorkerProcess) return;
+    const wanted = settings?.isolateDDC !== false
+    try {
+        const active = await ddcci.useWorkerProcess(wanted)
+        if (wanted && !active) {
+            console.log("Couldn't start DDC/CI worker process. Using in-process DDC/CI.")
+        }
+    } catch (e) {
+        console.log("Couldn't change DDC/CI worker mode", e)
+    }
+}
+
 let wmicUnavailable = false 
 let wmi = false
 // WMIC.exe lives in the Wbem folder under System32. It is absent on Windows 11
@@ -2030,10 +2246,7 @@ const getBrightnessWMIC = async () => {
 
                         // Get normalization info
                         wmiInfo = applyRemap(wmiInfo)
-
-                        // Unnormalize brightness
                         wmiInfo.brightnessRaw = wmiInfo.brightness
-                        wmiInfo.brightness = normalizeBrightness(wmiInfo.brightness, true, wmiInfo.min, wmiInfo.max)
 
                         resolve(wmiInfo)
                     }
@@ -2111,9 +2324,9 @@ testDDCCIMethods = async () => {
         getDDCCI()
 
         let startTime = process.hrtime.bigint()
-        const accurateResults = withDDCSentinel("method-test", false, () =>
-            ddcci.getAllMonitors("accurate", false)
-        )
+        const accurateResults = (await withDDCSentinel("method-test", false, () =>
+            ddcci.scheduleRefresh("accurate", false, true, 0)
+        )).monitors
         const accurateIDs = []
         const accurateFeatures = []
         for(const monitor of accurateResults) {
@@ -2131,9 +2344,9 @@ testDDCCIMethods = async () => {
         ddcci._clearDisplayCache()
     
         startTime = process.hrtime.bigint()
-        const fastResults = withDDCSentinel("method-test", false, () =>
-            ddcci.getAllMonitors("fast", false)
-        )
+        const fastResults = (await withDDCSentinel("method-test", false, () =>
+            ddcci.scheduleRefresh("fast", false, true, 0)
+        )).monitors
         const fastIDs = []
         const fastFeatures = []
         for(const monitor of fastResults) {
@@ -229,7 +229,9 @@ Flag to show brightness levels in the panel
     getVersionValue,
     lerp,
     parseTime,
-    getCalibratedValue
+    getCalibratedValue,
+    perceptualToLinear,
+    linearToPerceptual
 }
 
 
@@ -368,4 +370,35 @@ function getCalibratedValue(value, calibrationPoints = [], reverse = false) {
         // Fallback
         return value;
     }
-}
\ No newline at end of file
+}
+
+/**
+ * Treats a slider value (0–100) as perceived lightness (CIE L*) and returns
+ * the matching relative luminance, so equal slider steps look like equal
+ * brightness steps. Same as perceptualToLinear() in node-ddcci.
+ *
+ * @param {number} lightness - Perceived lightness (0–100).
+ * @returns {number} - Relative luminance (0–100).
+ */
+function perceptualToLinear(lightness) {
+    lightness = Math.max(0, Math.min(100, lightness));
+    if (lightness > 8) {
+        return 100 * Math.pow((lightness + 16) / 116, 3);
+    }
+    return 100 * lightness / 903.3;
+}
+
+/**
+ * Inverse of perceptualToLinear().
+ *
+ * @param {number} luminance - Relative luminance (0–100).
+ * @returns {number} - Perceived lightness (0–100).
+ */
+function linearToPerceptual(luminance) {
+    luminance = Math.max(0, Math.min(100, luminance));
+    const y = luminance / 100;
+    if (y > 216 / 24389) {
+        return 116 * Math.cbrt(y) - 16;
+    }
+    return 903.3 * y;
+}
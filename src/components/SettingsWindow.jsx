@@ -489,6 +489,12 @@ export default class SettingsWindow extends PureComponent {
                                     </div>
                                 </div>
                             } />
+                            <SettingsChild title={T.t("SETTINGS_MONITORS_PERCEPTUAL_CURVE_TITLE")} description={T.t("SETTINGS_MONITORS_PERCEPTUAL_CURVE_DESC")} input={
+                                <div className="inputToggle-generic">
+                                    <input onChange={(e) => this.curveChanged(monitor.id, e.target.checked)} checked={remap.curve === "perceptual"} data-checked={remap.curve === "perceptual"} type="checkbox" />
+                                    <div className="text">{(remap.curve === "perceptual" ? T.t("GENERIC_ON") : T.t("GENERIC_OFF"))}</div>
+                                </div>
+                            } />
                             <SettingsChild content={
                                 <div className="calibration-points-menu">
                                     { this.getMonitorCalibration(monitor.id) }
@@ -505,6 +511,17 @@ export default class SettingsWindow extends PureComponent {
         }
     }
 
+    curveChanged = (monitorID, perceptual) => {
+        const remaps = Object.assign({}, this.state.remaps)
+        remaps[monitorID] = Object.assign({
+            min: 0,
+            max: 100,
+            calibration: []
+        }, remaps[monitorID], { curve: (perceptual ? "perceptual" : "linear") })
+        this.setState({ remaps })
+        window.sendSettings({ remaps })
+    }
+
     getMonitorCalibration = (monitorID) => {
         const pointsElems = []
 
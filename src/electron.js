@@ -80,7 +80,7 @@ const { fork, exec } = require('child_process');
 const { VerticalRefreshRateContext, addDisplayChangeListener } = require("win32-displayconfig");
 const refreshCtx = new VerticalRefreshRateContext();
 
-const {WindowUtils, BrightnessKeys, MediaStatus, PowerEvents, AppStartup} = require("tt-windows-utils")
+const {WindowUtils, EventHub, MediaStatus, AppStartup} = require("tt-windows-utils")
 const setWindowPos = () => { }
 const AccentColors = require("windows-accent-colors")
 const Acrylic = require("acrylic")
@@ -628,6 +628,7 @@ const nativeBrightnessAccelerators = {
   down: "BrightnessDown"
 }
 let nativeBrightnessKeysRegistered = false
+let stopNativeBrightnessKeys = false
 let nativeHotkeyRecording = false
 let nativeBrightnessKey = false
 let nativeBrightnessKeyRepeatDelay = false
@@ -679,13 +680,128 @@ function handleNativeBrightnessKey(key) {
   }, 400)
 }
 
+// Display-change and power-setting notifications arrive through the shared
+// native event hub instead of the panel's own window procedure. Each type is
+// only subscribed while the settings want it, so the hub doesn't deliver
+// events that would just be dropped.
+let windowEventsActive = false
+let stopDisplayChangeEvents = false
+let stopPowerSettingEvents = false
+
+function startWindowEvents() {
+  windowEventsActive = true
+  applyWindowEvents()
+}
+
+function applyWindowEvents() {
+  const wantDisplayChange = windowEventsActive && settings.useWmDisplayChangeEvent && !settings.disablePowerNotifications
+  if(wantDisplayChange && !stopDisplayChangeEvents) {
+    stopDisplayChangeEvents = EventHub.on("displayChange", event => {
+      if(event.name !== "WM_DISPLAYCHANGE") return false;
+      handleMetricsChange("wm_displaychange")
+    })
+  } else if(!wantDisplayChange && stopDisplayChangeEvents) {
+    stopDisplayChangeEvents()
+    stopDisplayChangeEvents = false
+  }
+
+  const wantPowerSettings = windowEventsActive && !settings.disablePowerNotifications
+  if(wantPowerSettings && !stopPowerSettingEvents) {
+    stopPowerSettingEvents = EventHub.on("powerSetting", handlePowerSetting)
+  } else if(!wantPowerSettings && stopPowerSettingEvents) {
+    stopPowerSettingEvents()
+    stopPowerSettingEvents = false
+  }
+}
+
+function stopWindowEvents() {
+  windowEventsActive = false
+  applyWindowEvents()
+}
+
+// PBT_POWERSETTINGCHANGE
+function handlePowerSetting(setting) {
+  if(settings.disablePowerNotifications) return false;
+
+  if(setting.name !== "" || setting.guid) {
+    console.log(`Event: ${setting.name || setting.guid} (${setting.data})`)
+  }
+
+  if(setting.name === "GUID_SESSION_USER_PRESENCE") {
+    if(!settings.useGuidPresenceEvent) return false;
+    if(setting.data === 2) {
+      // Idle
+      if(!isWindowsUserIdle) {
+        console.log("Displays have gone to sleep.")
+
+        // If we were about to do a hardware event, stop.
+        if (handleChangeTimeout1) clearTimeout(handleChangeTimeout1);
+        if (handleChangeTimeout2) clearTimeout(handleChangeTimeout2);
+        //if(!isUserIdle) startIdleCheckShort();
+      }
+      isWindowsUserIdle = true
+    } else if(setting.data === 0) {
+      // Active
+      if(isWindowsUserIdle) {
+        isWindowsUserIdle = false
+        console.log("Displays have woken up.")
+        recentlyWokeUp = true
+        handleMetricsChange("GUID_SESSION_USER_PRESENCE")
+        if(!resumeRecoveryInProgress) clearRecentlyWokeUpLater()
+      }
+    }
+  } else if(setting.name === "GUID_CONSOLE_DISPLAY_STATE") {
+    // 0 = off, 1 = on, 2 = dimmed. node-ddcci parks writes while off.
+    monitorsThread.send({
+      type: "displayPowerState",
+      on: setting.data !== 0
+    })
+  } else if(setting.name === "GUID_VIDEO_POWERDOWN_TIMEOUT") {
+    // "Turn off my screen after"
+  } else if(setting.name === "GUID_STANDBY_TIMEOUT") {
+    // "Make my device sleep after"
+  } else if(setting.name === "GUID_VIDEO_CURRENT_MONITOR_BRIGHTNESS") {
+    // Internal display brightness change
+    if(!settings.useGuidBrightnessEvent) return false;
+    if(!ignoreBrightnessEvent) {
+      for(const hwid2 in monitors) {
+        const monitor = monitors[hwid2]
+        if(monitor.type === "wmi") {
+          const normalized = normalizeBrightness(setting.data, true, monitor.min, monitor.max, monitor.calibration, monitor.curve)
+          monitor.brightness = normalized
+          monitor.brightnessRaw = setting.data
+        }
+        sendToAllWindows('monitors-updated', monitors)
+      }
+    }
+  }
+}
+
+// The monitor thread forwards WmiMonitorBrightnessEvent for the internal
+// panel, so changes made outside the app show up straight away.
+monitorsEventEmitter.on("internalBrightnessChanged", data => {
+  if(ignoreBrightnessEvent) return;
+  const monitor = Object.values(monitors).find(monitor => monitor.id === data.id)
+  if(monitor?.type !== "wmi") return;
+  monitor.brightness = normalizeBrightness(data.brightness, true, monitor.min, monitor.max, monitor.calibration, monitor.curve)
+  monitor.brightnessRaw = data.brightness
+  sendToAllWindows('monitors-updated', monitors)
+})
+
+function unregisterNativeBrightnessKeys() {
+  if(stopNativeBrightnessKeys) stopNativeBrightnessKeys();
+  stopNativeBrightnessKeys = false
+  nativeBrightnessKeysRegistered = false
+}
+
 function applyNativeBrightnessKeys() {
   try {
     stopNativeBrightnessKeyRepeat()
-    BrightnessKeys.unregister()
-    nativeBrightnessKeysRegistered = false
+    unregisterNativeBrightnessKeys()
     if(mainWindow) {
-      nativeBrightnessKeysRegistered = BrightnessKeys.register(getMainWindowHandle())
+      // WM_INPUT: HID Consumer Control brightness increment/decrement reports.
+      stopNativeBrightnessKeys = EventHub.on("brightnessKey", event => handleNativeBrightnessKey(event.name))
+      nativeBrightnessKeysRegistered = !!stopNativeBrightnessKeys
       console.log(`Native brightness keys: ${nativeBrightnessKeysRegistered ? "enabled" : "unavailable"}`)
     }
   } catch(e) {
@@ -915,6 +1031,7 @@ const defaultSettings = {
   disableWMI: false,
   disableWin32: false,
   disableHDR: false,
+  isolateDDC: true,
   useSoftwareBrightnessFallback: false,
   useWin32Event: true,
   useElectronEvents: true,
@@ -1357,6 +1474,10 @@ function processSettings(newSettings = {}, sendUpdate = true) {
       shouldRefreshMonitors = true
     }
 
+    if (newSettings.useWmDisplayChangeEvent !== undefined || newSettings.disablePowerNotifications !== undefined) {
+      applyWindowEvents()
+    }
+
     if (newSettings.gammaAsMainSliderDisplays !== undefined
       || newSettings.extendMinimumDisplays !== undefined
       || newSettings.extendMinimumBreakpoints !== undefined) {
@@ -1367,8 +1488,8 @@ function processSettings(newSettings = {}, sendUpdate = true) {
     if (settings.profiles) {
       rebuildTray = true
       if(settings.profiles?.length > 0) {
-        if(!focusTrackingID) startFocusTracking();
-      } else if(focusTrackingID) {
+        if(!focusTracking) startFocusTracking();
+      } else if(focusTracking) {
         stopFocusTracking()
       }
     }
@@ -2020,6 +2141,7 @@ function applyRemap(monitor) {
         monitor.min = remap.min
         monitor.max = remap.max
         monitor.calibration = remap.calibration
+        monitor.curve = remap.curve || "linear"
         // Stop if using new scheme
         if (remapName == monitor.id) return monitor;
       }
@@ -2654,7 +2776,7 @@ function commitRefreshedMonitors(newMonitors, oldMonitors = {}) {
   for (let id in newMonitors) {
     const monitor = newMonitors[id]
     restoreGammaAfterReset(monitor, oldMonitors[id])
-    monitor.brightness = normalizeBrightness(monitor.brightness, true, monitor.min, monitor.max, monitor.calibration)
+    monitor.brightness = normalizeBrightness(monitor.brightness, true, monitor.min, monitor.max, monitor.calibration, monitor.curve)
 
     // Replace DDC/CI brightness with SDR
     if(settings.sdrAsMainSliderDisplays?.[monitor.key] && monitor.hdr === "active") {
@@ -2665,7 +2787,7 @@ function commitRefreshedMonitors(newMonitors, oldMonitors = {}) {
     if(usesGammaSlider(monitor)) {
       monitor.min = GAMMA_BRIGHTNESS_MIN
       monitor.max = 100
-      monitor.brightness = normalizeBrightness(monitor.gammaBrightness, true, monitor.min, monitor.max, monitor.calibration)
+      monitor.brightness = normalizeBrightness(monitor.gammaBrightness, true, monitor.min, monitor.max, monitor.calibration, monitor.curve)
       monitor.brightnessRaw = monitor.gammaBrightness
     }
 
@@ -2976,7 +3098,7 @@ function applyLinkedFeatures(monitor, newLevel, useCap = true) {
   }
 }
 
-function updateBrightness(index, newLevel, useCap = true, vcpValue = "brightness", clearTransition = true) {
+function updateBrightness(index, newLevel, useCap = true, vcpValue = "brightness", clearTransition = true, sdrDuration = 0) {
   if(isWindowsUserIdle) return false; // Skip if displays are off
   try {
     let level = newLevel
@@ -3049,7 +3171,7 @@ function updateBrightness(index, newLevel, useCap = true, vcpValue = "brightness
         : GAMMA_BRIGHTNESS_MIN + (level * (100 - GAMMA_BRIGHTNESS_MIN) / breakpoint)))
     }
 
-    const normalized = normalizeBrightness(hardwareLevel, false, (useCap ? monitor.min : 0), (useCap ? monitor.max : 100), (useCap ? monitor.calibration : []))
+    const normalized = normalizeBrightness(hardwareLevel, false, (useCap ? monitor.min : 0), (useCap ? monitor.max : 100), (useCap ? monitor.calibration : []), (useCap ? monitor.curve : "linear"))
 
     // Moving within the extended range leaves hardware where it already is
     const skipHardware = (extendedMinimum && monitor.brightnessRaw === normalized)
@@ -3058,7 +3180,8 @@ function updateBrightness(index, newLevel, useCap = true, vcpValue = "brightness
       monitorsThread.send({
         type: "sdr",
         brightness: level,
-        id: monitor.id
+        id: monitor.id,
+        duration: sdrDuration
       })
       monitor.sdrLevel = level
       if(settings.sdrAsMainSliderDisplays?.[monitor.key]) {
@@ -3088,9 +3211,12 @@ function updateBrightness(index, newLevel, useCap = true, vcpValue = "brightness
         monitor.brightness = level
         monitor.brightnessRaw = normalized
         if (!skipHardware) {
+          // Monitors.js maps `percent` through the display's native
+          // transfer function, which already includes the remap.
           monitorsThread.send({
             type: "brightness",
             brightness: normalized * ((monitor.brightnessMax || 100) / 100),
+            percent: (useCap ? hardwareLevel : undefined),
             id: monitor.id
           })
         }
@@ -3158,7 +3284,8 @@ function updateBrightness(index, newLevel, useCap = true, vcpValue = "brightness
       if (!skipHardware) {
         monitorsThread.send({
           type: "brightness",
-          brightness: normalized
+          brightness: normalized,
+          id: monitor.id
         })
       }
       if(ignoreBrightnessEventTimeout) clearTimeout(ignoreBrightnessEventTimeout);
@@ -3217,14 +3344,20 @@ function updateAllBrightness(brightness, mode = "offset") {
 }
 
 
-function normalizeBrightness(brightness, normalize = false, min = 0, max = 100, calibrationPoints = []) {
+function normalizeBrightness(brightness, normalize = false, min = 0, max = 100, calibrationPoints = [], curve = "linear") {
   // normalize = true when recieving from Monitors.js
   // normalize = false when sending to Monitors.js
 
-  const points = calibrationPoints.slice()
+  const points = (calibrationPoints || []).slice()
   if(min > 0) points.push({ input: 0, output: min })
   if(max < 100) points.push({ input: 100, output: max })
 
+  // A perceptual curve applies before the remap and calibration, as in
+  // node-ddcci's transfer tables.
+  if(curve === "perceptual") {
+    if(normalize) return Utils.linearToPerceptual(Utils.getCalibratedValue(brightness, points, true));
+    return Utils.getCalibratedValue(Utils.perceptualToLinear(brightness), points, false)
+  }
   return Utils.getCalibratedValue(brightness, points, normalize)
   
   let level = brightness
@@ -3269,6 +3402,29 @@ function transitionBrightness(level, eventMonitors = [], stepSpeed = 1) {
   }
 
   const step = (stepSpeed * stepSpeedMult)
+  const interval = settings.updateInterval * transitionIntervalMult
+
+  const getTarget = monitor => {
+    let normalized = level * 1
+    if (settings.adjustmentTimeIndividualDisplays) {
+      // If using individual monitor settings
+      normalized = (eventMonitors[monitor.id] >= 0 ? eventMonitors[monitor.id] : level)
+    }
+    return normalized
+  }
+
+  // Displays driven by their SDR level get the whole transition as one
+  // native ramp, over the time the stepped transition would have taken.
+  const nativeRamps = new Set()
+  for (let key in monitors) {
+    const monitor = monitors[key]
+    if (monitor.hdr !== "active" || !settings.sdrAsMainSliderDisplays?.[monitor.key]) continue
+    const target = getTarget(monitor)
+    const duration = Math.ceil(Math.abs(target - monitor.brightness) / step) * interval
+    updateBrightness(monitor.id, target, undefined, undefined, false, duration)
+    nativeRamps.add(monitor.id)
+  }
+  if (nativeRamps.size) sendToAllWindows('monitors-updated', monitors);
 
   currentTransition = setInterval(() => {
     if (recentlyWokeUp || isWindowsUserIdle) clearInterval(currentTransition);
@@ -3276,19 +3432,12 @@ function transitionBrightness(level, eventMonitors = [], stepSpeed = 1) {
     for (let key in monitors) {
       const monitor = monitors[key]
 
-      let normalized = level * 1
-      if (settings.adjustmentTimeIndividualDisplays) {
-        // If using individual monitor settings
-        normalized = (eventMonitors[monitor.id] >= 0 ? eventMonitors[monitor.id] : level)
+      if (nativeRamps.has(monitor.id)) {
+        numDone++
+        continue
       }
 
-      if (settings.remaps) {
-        for (let remapName in settings.remaps) {
-          if (remapName == monitor.name) {
-            normalized = normalized
-          }
-        }
-      }
+      const normalized = getTarget(monitor)
       if (monitor.brightness < normalized + (step + 1) && monitor.brightness > normalized - (step + 1)) {
         updateBrightness(monitor.id, normalized, undefined, undefined, false)
         numDone++
@@ -3296,12 +3445,12 @@ function transitionBrightness(level, eventMonitors = [], stepSpeed = 1) {
         updateBrightness(monitor.id, (monitor.brightness < normalized ? monitor.brightness + step : monitor.brightness - step), undefined, undefined, false)
       }
       sendToAllWindows('monitors-updated', monitors)
-      if (numDone === Object.keys(monitors).length) {
-        clearInterval(currentTransition);
-        currentTransition = null
-      }
     }
-  }, settings.updateInterval * transitionIntervalMult)
+    if (numDone === Object.keys(monitors).length) {
+      clearInterval(currentTransition);
+      currentTransition = null
+    }
+  }, interval)
 }
 
 function transitionlessBrightness(level, eventMonitors = []) {
@@ -3637,9 +3786,8 @@ function createPanel(toggleOnLoad = false, isRefreshing = false, showOnLoad = tr
 
   mainWindow.on("closed", () => {
     console.log("~~~~~ MAIN WINDOW CLOSED ~~~~~~")
-    PowerEvents.unregisterPowerSettingNotifications()
-    BrightnessKeys.unregister()
-    nativeBrightnessKeysRegistered = false
+    stopWindowEvents()
+    unregisterNativeBrightnessKeys()
     stopNativeBrightnessKeyRepeat()
     mainWindow = null
   });
@@ -3702,74 +3850,6 @@ function createPanel(toggleOnLoad = false, isRefreshing = false, showOnLoad = tr
     } catch (e) { }
   })
 
-  mainWindow.hookWindowMessage(126, (wParam, lParam) => {
-    if(settings.useWmDisplayChangeEvent && !settings.disablePowerNotifications) handleMetricsChange("wm_displaychange")
-  })
-
-  // WM_INPUT: HID Consumer Control brightness increment/decrement reports.
-  mainWindow.hookWindowMessage(0x00FF, (wParam, lParam) => {
-    try {
-      handleNativeBrightnessKey(BrightnessKeys.getKey(lParam.readBigUInt64LE(0)))
-    } catch(e) {
-      console.log("Couldn't process native brightness key:", e)
-    }
-  })
-
-  // WM_POWERBROADCAST
-  mainWindow.hookWindowMessage(0x218, (wParam, lParam) => {
-    if(settings.disablePowerNotifications) return false;
-    if(wParam.readUInt32LE() !== 32787) return false;
-    // PBT_POWERSETTINGCHANGE
-
-    const setting = PowerEvents.getPowerSetting(lParam.readBigUInt64LE(0))
-    if(setting.name !== "" || setting.guid) {
-      console.log(`Event: ${setting.name || setting.guid} (${setting.data})`)
-    }
-
-    if(setting.name === "GUID_SESSION_USER_PRESENCE") {
-      if(!settings.useGuidPresenceEvent) return false;
-      if(setting.data === 2) {
-        // Idle
-        if(!isWindowsUserIdle) {
-          console.log("Displays have gone to sleep.")
-
-          // If we were about to do a hardware event, stop.
-          if (handleChangeTimeout1) clearTimeout(handleChangeTimeout1);
-          if (handleChangeTimeout2) clearTimeout(handleChangeTimeout2);
-          //if(!isUserIdle) startIdleCheckShort();
-        }
-        isWindowsUserIdle = true
-      } else if(setting.data === 0) {
-        // Active
-        if(isWindowsUserIdle) {
-          isWindowsUserIdle = false
-          console.log("Displays have woken up.")
-          recentlyWokeUp = true
-          handleMetricsChange("GUID_SESSION_USER_PRESENCE")
-          if(!resumeRecoveryInProgress) clearRecentlyWokeUpLater()
-        }
-      }
-    } else if(setting.name === "GUID_VIDEO_POWERDOWN_TIMEOUT") {
-      // "Turn off my screen after"
-    } else if(setting.name === "GUID_STANDBY_TIMEOUT") {
-      // "Make my device sleep after"
-    } else if(setting.name === "GUID_VIDEO_CURRENT_MONITOR_BRIGHTNESS") {
-      // Internal display brightness change
-      if(!settings.useGuidBrightnessEvent) return false;
-      if(!ignoreBrightnessEvent) {
-        for(const hwid2 in monitors) {
-          const monitor = monitors[hwid2]
-          if(monitor.type === "wmi") {
-            const normalized = normalizeBrightness(setting.data, true, monitor.min, monitor.max, monitor.calibration)
-            monitor.brightness = normalized
-            monitor.brightnessRaw = setting.data
-          }
-          sendToAllWindows('monitors-updated', monitors)
-        }
-      }
-    }
-  })
-
   // WM_SYSCOMMAND
   mainWindow.hookWindowMessage(0x0112, (wParam, lParam) => {
     if(!settings.useScMonitorPowerEvent || settings.disablePowerNotifications) return false;
@@ -3783,7 +3863,7 @@ function createPanel(toggleOnLoad = false, isRefreshing = false, showOnLoad = tr
     }
   })
 
-  if(!settings.disablePowerNotifications) PowerEvents.registerPowerSettingNotifications(getMainWindowHandle())
+  startWindowEvents()
   applyNativeBrightnessKeys()
 
 }
@@ -3988,11 +4068,25 @@ const ignoreAppList = [
 ]
 const windowHistory = []
 let preProfileBrightness = {}
-let focusTrackingID = 0
+let focusTracking = false
+
+// Foreground and title changes come from the shared native event hub. The
+// window details are only looked up once an event actually arrives.
+function getActiveWindowInfo() {
+  try {
+    return ActiveWindow.getActiveWindow()
+  } catch(e) {
+    return null
+  }
+}
+
 function startFocusTracking() {
-  if(focusTrackingID) return false; // Already tracking
+  if(focusTracking) return false; // Already tracking
 
-  focusTrackingID = ActiveWindow.subscribe(async window => {
+  // Title changes can arrive in bursts; each lookup reads the window icon.
+  EventHub.setThrottle("foreground", 250)
+  focusTracking = EventHub.on("foreground", async () => {
+    const window = getActiveWindowInfo()
     if (!window) return false;
     if (settings.profiles?.length == 0) return false;
 
@@ -4040,15 +4134,19 @@ function startFocusTracking() {
     }
     currentProfile = profile
   })
+  if(!focusTracking) {
+    console.log("Couldn't start focus tracking.")
+    return false
+  }
 
-  console.log(`Starting focus tracking... (#${focusTrackingID})`)
+  console.log("Starting focus tracking...")
 }
 
 function stopFocusTracking() {
-  if (focusTrackingID) {
+  if (focusTracking) {
     console.log("Stopping focus tracking...")
-    ActiveWindow.unsubscribe(focusTrackingID)
-    focusTrackingID = 0
+    focusTracking()
+    focusTracking = false
   }
 }
 
@@ -4115,6 +4213,7 @@ let currentPanelTime = 0
 let startPanelTime = process.hrtime.bigint()
 let lastPanelTime = process.hrtime.bigint()
 let primaryRefreshRate = 59.97
+refreshCtx.findVerticalRefreshRateForDisplayPoint(0, 0).then(rate => { if (rate) primaryRefreshRate = rate })
 let primaryDPI = 1
 let mainWindowHandle
 let easeOutQuad = t => 1 + (--t) * t * t * t * t
@@ -4227,7 +4326,8 @@ async function startPanelAnimation() {
 
     // Get refresh rate of primary display
     // This allows the animation to play no more than the refresh rate
-    primaryRefreshRate = await refreshCtx.findVerticalRefreshRateForDisplayPoint(0, 0)
+    // Keep the last known rate if the display geometry isn't available yet
+    primaryRefreshRate = refreshCtx.findVerticalRefreshRateForDisplayPointSync(0, 0) ?? primaryRefreshRate
 
     // Start animation interval after a short delay
     // This avoids jank from React updating the DOM
@@ -4371,9 +4471,8 @@ app.on("activate", () => {
 
 app.on('quit', () => {
   try {
-    PowerEvents.unregisterPowerSettingNotifications()
-    BrightnessKeys.unregister()
-    nativeBrightnessKeysRegistered = false
+    stopWindowEvents()
+    unregisterNativeBrightnessKeys()
     stopNativeBrightnessKeyRepeat()
     tray.destroy()
   } catch (e) {
@@ -5016,7 +5115,12 @@ function addEventListeners() {
   systemPreferences.on('color-changed', () => { if(!settings.disableThemeChanges) handleAccentChange(); })
   nativeTheme.on('updated', () => { if(!settings.disableThemeChanges) handleAccentChange(); })
 
-  addDisplayChangeListener(() => { if(settings.useWin32Event) handleMonitorChange("win32") })
+  addDisplayChangeListener((err, conf, changes) => {
+    // An empty change list means Windows signalled a change that didn't
+    // touch any active display.
+    if (Array.isArray(changes) && changes.length === 0) return;
+    if(settings.useWin32Event) handleMonitorChange("win32")
+  })
   screen.addListener("display-added", () => { if(settings.useElectronEvents) handleMonitorChange("display-added") })
   screen.addListener("display-removed", () => { if(settings.useElectronEvents) handleMonitorChange("display-removed") })
   screen.addListener("display-metrics-changed", () => { if(settings.useElectronEvents) handleMetricsChange("display-metrics-changed") })
@@ -5067,6 +5171,12 @@ function handleMonitorChange(t, e, d) {
 
   console.log("Hardware change detected.")
 
+  // Let a DDC/CI refresh that is still probing the old topology give up now,
+  // rather than after the restore delay below.
+  if (monitorsThreadReal?.connected && monitorsThreadReady) {
+    monitorsThreadReal.send({ type: "displayTopologyChanged" })
+  }
+
   const block = blockBadDisplays("handleMonitorChange")
 
   // Defer actions for a moment just in case of repeat events
@@ -5606,10 +5716,10 @@ function applyCurrentAdjustmentEvent(force = false, instant = true) {
                   monitor.brightness = monitor.sdrLevel
                 }
                 if (usesGammaSlider(monitor)) {
-                  monitor.brightness = normalizeBrightness(monitor.gammaBrightness, true, monitor.min, monitor.max, monitor.calibration)
+                  monitor.brightness = normalizeBrightness(monitor.gammaBrightness, true, monitor.min, monitor.max, monitor.calibration, monitor.curve)
                 }
                 if (usesExtendedMinimum(monitor)) {
-                  monitor.brightness = getExtendedMinimumLevel(monitor, normalizeBrightness(monitor.brightness, true, monitor.min, monitor.max, monitor.calibration))
+                  monitor.brightness = getExtendedMinimumLevel(monitor, normalizeBrightness(monitor.brightness, true, monitor.min, monitor.max, monitor.calibration, monitor.curve))
                 }
               }
               applyAdjustment(new Set(Object.keys(knownBrightness)))
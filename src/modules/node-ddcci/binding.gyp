@@ -11,5 +11,21 @@
             }
         }
       , "libraries": [ "dxva2.lib" ]
+    }, {
+        "target_name": "ddcci_worker"
+      , "type": "executable"
+      , "variables": { "win_delay_load_hook": "false" }
+      , "sources": [ "./ddcci.cc", "./ddcci-worker.cc" ]
+      , "defines": [ "DDCCI_WORKER" ]
+      , "cflags_cc": [ "-std=c++17" ]
+      , "msvs_settings": {
+            "VCCLCompilerTool": {
+                "ExceptionHandling": 1
+            },
+            "VCLinkerTool": {
+                "SubSystem": 1
+            }
+        }
+      , "libraries": [ "dxva2.lib" ]
     }]
-}
\ No newline at end of file
+}
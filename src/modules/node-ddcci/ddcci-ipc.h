@@ -0,0 +1,116 @@
+#pragma once
+
+// Shared-memory command ring between the ddcci addon and ddcci_worker.exe.
+//
+// The addon creates a file mapping holding one `ddcipc::Ring` and two
+// auto-reset events. Commands are written into the slot at `head`, the
+// request event wakes the worker, and the worker marks the slot complete and
+// sets the response event. The addon also waits on the worker's process
+// handle, so a crash inside a monitor driver surfaces as a failed command
+// instead of taking the host process down with it.
+
+#include "windows.h"
+
+#include <cstdint>
+#include <string>
+
+namespace ddcipc {
+
+const uint32_t kMagic = 0x57434444; // "DDCW"
+const uint32_t kVersion = 3;
+const uint32_t kSlotCount = 8;
+const uint32_t kPayloadSize = 64 * 1024;
+
+enum Command : uint32_t {
+    CMD_NONE = 0,
+    CMD_REFRESH,
+    CMD_CLEAR_DISPLAY_CACHE,
+    CMD_GET_ALL_MONITORS,
+    CMD_GET_VCP,
+    CMD_SET_VCP,
+    CMD_GET_CAPABILITIES,
+    CMD_SAVE_CURRENT_SETTINGS,
+    CMD_GET_HIGH_LEVEL_BRIGHTNESS,
+    CMD_SET_HIGH_LEVEL_BRIGHTNESS,
+    CMD_GET_HIGH_LEVEL_CONTRAST,
+    CMD_SET_HIGH_LEVEL_CONTRAST,
+    CMD_SET_LOG_LEVEL,
+    CMD_SHUTDOWN,
+    CMD_GET_CAPABILITIES_TIMING
+};
+
+enum SlotState : LONG {
+    SLOT_FREE = 0,
+    SLOT_SUBMITTED,
+    SLOT_RUNNING,
+    SLOT_DONE
+};
+
+// Outcome of a command, shared by the in-process and worker paths.
+enum Status : uint32_t {
+    STATUS_OK = 0,
+    STATUS_NOT_FOUND,
+    STATUS_FAILED,
+    STATUS_INVALID,
+    STATUS_WORKER_LOST,
+    // A scheduled refresh stopped because a newer one was requested.
+    STATUS_SUPERSEDED
+};
+
+struct Slot {
+    volatile LONG state;
+    uint32_t sequence;
+    uint32_t command;
+    uint32_t status;
+    uint32_t errorCode;
+    uint32_t args[4];
+    uint32_t values[4];
+    // Monitor name or refresh method on the way in, text results on the way
+    // out. Not null-terminated; `payloadLength` is authoritative.
+    uint32_t payloadLength;
+    char payload[kPayloadSize];
+};
+
+struct Ring {
+    uint32_t magic;
+    uint32_t version;
+    // Next slot the addon will submit into, and next slot the worker will
+    // consume. Both only ever increase; the slot index is `n % kSlotCount`.
+    volatile LONG head;
+    volatile LONG tail;
+    // Newest refresh generation the addon has scheduled. A CMD_REFRESH that
+    // carries an older generation in args[2] stops at its next probe.
+    volatile LONG refreshGeneration;
+    Slot slots[kSlotCount];
+};
+
+// Record/field separators for the monitor list sent back by
+// CMD_GET_ALL_MONITORS. Neither can appear in a device path or a
+// capabilities string.
+const char kRecordSeparator = '\x1e';
+const char kFieldSeparator = '\x1f';
+
+} // namespace ddcipc
+
+// Result of a DDC/CI command, whether it ran in this process or in
+// ddcci_worker.exe.
+struct DdcResult {
+    uint32_t status = ddcipc::STATUS_OK;
+    DWORD errorCode = ERROR_SUCCESS;
+    DWORD values[3] = { 0, 0, 0 };
+    std::string text;
+    // Set by the addon when a write was held back for a sleeping monitor.
+    // Never crosses the process boundary.
+    bool parked = false;
+};
+
+// Implemented in ddcci.cc. `target` is the monitor ID for monitor commands
+// and the validation method for CMD_REFRESH.
+DdcResult
+runDdcCommand(uint32_t command,
+              const std::string& target,
+              const uint32_t args[4]);
+
+// Where runDdcCommand() reads the newest scheduled refresh generation from.
+// The worker points it at `Ring::refreshGeneration`.
+extern volatile LONG* refreshGenerationSource;
@@ -0,0 +1,113 @@
+// ddcci_worker.exe
+//
+// Runs DDC/CI commands on behalf of the ddcci addon, so a monitor driver that
+// crashes or hangs only takes this process down. Started by the addon as:
+//
+//   ddcci_worker.exe <channel name> <parent PID>
+//
+// The channel name identifies the shared ring and its events (see
+// ddcci-ipc.h). The worker exits on CMD_SHUTDOWN, or when the parent goes
+// away without sending it.
+
+#include "ddcci-ipc.h"
+
+#include <algorithm>
+#include <string>
+
+namespace {
+
+// Runs every submitted slot between `tail` and `head`. Returns false once a
+// shutdown was requested.
+bool
+drainRing(ddcipc::Ring* ring, HANDLE responseEvent)
+{
+    while (ring->tail != ring->head) {
+        ddcipc::Slot& slot = ring->slots[ring->tail % ddcipc::kSlotCount];
+        if (slot.state != ddcipc::SLOT_SUBMITTED) {
+            break;
+        }
+        InterlockedExchange(&slot.state, ddcipc::SLOT_RUNNING);
+
+        bool keepRunning = slot.command != ddcipc::CMD_SHUTDOWN;
+        if (keepRunning) {
+            std::string target(slot.payload,
+                               (std::min)(slot.payloadLength,
+                                          ddcipc::kPayloadSize));
+            DdcResult result = runDdcCommand(slot.command, target, slot.args);
+
+            if (result.text.size() > ddcipc::kPayloadSize) {
+                result.status = ddcipc::STATUS_FAILED;
+                result.errorCode = ERROR_INSUFFICIENT_BUFFER;
+                result.text.clear();
+            }
+            slot.status = result.status;
+            slot.errorCode = result.errorCode;
+            for (int i = 0; i < 3; i++) {
+                slot.values[i] = result.values[i];
+            }
+            slot.payloadLength = static_cast<uint32_t>(result.text.size());
+            memcpy(slot.payload, result.text.data(), result.text.size());
+        }
+
+        InterlockedExchange(&slot.state, ddcipc::SLOT_DONE);
+        InterlockedIncrement(&ring->tail);
+        SetEvent(responseEvent);
+
+        if (!keepRunning) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int
+wmain(int argc, wchar_t** argv)
+{
+    if (argc < 3) {
+        return ERROR_INVALID_PARAMETER;
+    }
+
+    const std::wstring channelName = argv[1];
+    const DWORD parentPid = static_cast<DWORD>(_wtoi(argv[2]));
+
+    HANDLE parent = OpenProcess(SYNCHRONIZE, FALSE, parentPid);
+    HANDLE mapping =
+      OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, channelName.c_str());
+    HANDLE requestEvent = OpenEventW(
+      SYNCHRONIZE, FALSE, (channelName + L"-request").c_str());
+    HANDLE responseEvent = OpenEventW(
+      EVENT_MODIFY_STATE, FALSE, (channelName + L"-response").c_str());
+    if (parent == NULL || mapping == NULL || requestEvent == NULL
+        || responseEvent == NULL) {
+        return GetLastError();
+    }
+
+    auto ring = static_cast<ddcipc::Ring*>(
+      MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(ddcipc::Ring)));
+    if (ring == nullptr) {
+        return GetLastError();
+    }
+    if (ring->magic != ddcipc::kMagic || ring->version != ddcipc::kVersion) {
+        return ERROR_REVISION_MISMATCH;
+    }
+    refreshGenerationSource = &ring->refreshGeneration;
+
+    // Slots posted before we opened the events are picked up by the first
+    // drain.
+    HANDLE waitHandles[2] = { requestEvent, parent };
+    while (drainRing(ring, responseEvent)) {
+        DWORD wait = WaitForMultipleObjects(2, waitHandles, FALSE, INFINITE);
+        if (wait != WAIT_OBJECT_0) {
+            break;
+        }
+    }
+
+    UnmapViewOfFile(ring);
+    CloseHandle(responseEvent);
+    CloseHandle(requestEvent);
+    CloseHandle(mapping);
+    CloseHandle(parent);
+    return 0;
+}
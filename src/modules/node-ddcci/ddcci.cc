@@ -1,4 +1,9 @@
+#ifndef DDCCI_WORKER
+#define NAPI_VERSION 4
 #include <napi.h>
+#endif
+
+#include "ddcci-ipc.h"
 
 #include "HighLevelMonitorConfigurationAPI.h"
 #include "LowLevelMonitorConfigurationAPI.h"
@@ -18,6 +23,13 @@
 #include <algorithm>
 #include <cstdint>
 #include <memory>
+#include <cmath>
+#include <array>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <functional>
 
 struct Monitor {
     HMONITOR handle;
@@ -99,7 +111,8 @@ applyCapabilitiesResult(PhysicalMonitor* monitor,
     }
 }
 
-int logLevel = 0;
+// Read by the refresh scheduler thread while the JS thread may set it.
+std::atomic<int> logLevel{0};
 
 // `handles` owns every physical-monitor handle. `physicalMonitorHandles`
 // stores metadata only and must never destroy its copy of a handle.
@@ -134,12 +147,36 @@ d(std::string s)
     }
 }
 
+struct CapabilitiesAttempt {
+    const char* phase; // "length" or "reply"
+    double ms;
+    bool ok;
+    DWORD errorCode;
+};
+
+struct CapabilitiesTiming {
+    bool lengthCached = false;
+    DWORD length = 0;
+    double totalMs = 0;
+    std::vector<CapabilitiesAttempt> attempts;
+};
+
+// DDC/CI has no length query, so Windows reads the entire capabilities string
+// to answer GetCapabilitiesStringLength, and again for the reply. Keeping the
+// length by deviceKey across attempts and refreshes means a later fetch, or a
+// retry after a failed reply, only repeats the read that failed.
+std::map<std::string, DWORD> capabilitiesLengths;
+std::map<std::string, CapabilitiesTiming> capabilitiesTimings;
+
 void
 clearMonitorData()
 {
     if (!handles.empty()) {
         for (auto const& handle : handles) {
-            DestroyPhysicalMonitor(handle.second);
+            // Entries mirrored from the worker process carry no handle.
+            if (handle.second != NULL) {
+                DestroyPhysicalMonitor(handle.second);
+            }
         }
         handles.clear();
     }
@@ -149,6 +186,8 @@ clearMonitorData()
     if (!capabilities.empty()) {
         capabilities.clear();
     }
+    capabilitiesLengths.clear();
+    capabilitiesTimings.clear();
 }
 
 void
@@ -162,7 +201,7 @@ cleanMonitorHandles(std::map<std::string, HANDLE> newHandles)
                 break;
             }
         }
-        if (!found) {
+        if (!found && handle.second != NULL) {
             DestroyPhysicalMonitor(handle.second);
         }
     }
@@ -248,17 +287,25 @@ tryDdcCiOperation(F operation, DWORD& errorCode)
     return FALSE;
 }
 
-// Throws a JS error carrying the Win32 error code, so callers can
+#ifndef DDCCI_WORKER
+// Builds a JS error carrying the Win32 error code, so callers can
 // classify failures without parsing localized message strings.
-void
-throwDdcCiError(Napi::Env env, const std::string& message, DWORD errorCode)
+Napi::Error
+makeDdcCiError(Napi::Env env, const std::string& message, DWORD errorCode)
 {
     Napi::Error error =
       Napi::Error::New(env, message + "\n" + getLastErrorString(errorCode));
     error.Set("win32Code",
               Napi::Number::New(env, static_cast<double>(errorCode)));
-    throw error;
+    return error;
+}
+
+void
+throwDdcCiError(Napi::Env env, const std::string& message, DWORD errorCode)
+{
+    throw makeDdcCiError(env, message, errorCode);
 }
+#endif
 
 std::string
 getPhysicalMonitorName(HMONITOR handle)
@@ -519,7 +566,7 @@ getHighLevelCapabilities(HANDLE handle) {
 }
 
 std::string
-getCapabilitiesString(HANDLE handle)
+getCapabilitiesString(HANDLE handle, const std::string& cacheKey = "")
 {
     DWORD cchStringLength = 0;
     BOOL bSuccess = 0;
@@ -531,7 +578,33 @@ getCapabilitiesString(HANDLE handle)
         return "";
     }
 
-    if(handle != NULL) {
+    CapabilitiesTiming timing;
+    const auto started = std::chrono::steady_clock::now();
+    auto recordAttempt = [&](const char* phase,
+                             std::chrono::steady_clock::time_point start,
+                             BOOL ok) {
+        std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+        timing.attempts.push_back(
+          { phase, elapsed.count(), ok == 1, ok == 1 ? 0 : GetLastError() });
+    };
+    auto finish = [&]() {
+        std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - started;
+        timing.totalMs = elapsed.count();
+        timing.length = cchStringLength;
+        if (!cacheKey.empty()) {
+            capabilitiesTimings[cacheKey] = timing;
+        }
+    };
+
+    auto cachedLength = cacheKey.empty() ? capabilitiesLengths.end()
+                                         : capabilitiesLengths.find(cacheKey);
+    if (cachedLength != capabilitiesLengths.end()) {
+        cchStringLength = cachedLength->second;
+        timing.lengthCached = true;
+        d("== cLength (cached): " + std::to_string(cchStringLength));
+    } else {
         // Get the capabilities string length.
         // Checking the capabilities string is, apparently, very flaky.
         // So if it fails, we should try again.
@@ -542,20 +615,30 @@ getCapabilitiesString(HANDLE handle)
                 std::this_thread::sleep_for(std::chrono::milliseconds(100));
             }
             attempt++;
+            auto attemptStart = std::chrono::steady_clock::now();
             bSuccess = GetCapabilitiesStringLength(handle,
               &cchStringLength);
+            recordAttempt("length", attemptStart, bSuccess);
             d("== cLength attempt #" + std::to_string(attempt) + ": " + std::to_string(bSuccess));
         }
 
         if (bSuccess != 1) {
             d("Couldn't get capabilities length!");
+            finish();
             return ""; // Does not respond to DDC/CI
         }
+
+        // Kept even if the reply below fails, so the retry only repeats the
+        // reply read.
+        if (!cacheKey.empty()) {
+            capabilitiesLengths[cacheKey] = cchStringLength;
+        }
     }
 
     d("== cLength: " + std::to_string(cchStringLength));
 
     if (cchStringLength == 0) {
+        finish();
         return "";
     }
 
@@ -571,25 +654,51 @@ getCapabilitiesString(HANDLE handle)
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
         attempt++;
+        auto attemptStart = std::chrono::steady_clock::now();
         bSuccess = CapabilitiesRequestAndCapabilitiesReply(
           handle, capabilitiesBuffer.data(), cchStringLength);
+        recordAttempt("reply", attemptStart, bSuccess);
         d("== cString attempt #" + std::to_string(attempt) + ": " + std::to_string(bSuccess));
     }
 
     if (bSuccess != 1) {
         d("Couldn't get capabilities string!");
+        finish();
         return ""; // Does not respond to DDC/CI
     }
 
+    finish();
+
     returnString = std::string(capabilitiesBuffer.data());
 
     return returnString;
 }
 
+// Serializes the timing of the last capabilities fetch for CMD_GET_CAPABILITIES_TIMING:
+// a header record (lengthCached, length, totalMs) followed by one record per
+// attempt (phase, ms, ok, errorCode).
+std::string
+serializeCapabilitiesTiming(const CapabilitiesTiming& timing)
+{
+    const char fs = ddcipc::kFieldSeparator;
+    std::string out = std::string(timing.lengthCached ? "1" : "0") + fs
+                      + std::to_string(timing.length) + fs
+                      + std::to_string(timing.totalMs);
+    for (auto const& attempt : timing.attempts) {
+        out += ddcipc::kRecordSeparator;
+        out += std::string(attempt.phase) + fs + std::to_string(attempt.ms) + fs
+               + (attempt.ok ? "1" : "0") + fs
+               + std::to_string(attempt.errorCode);
+    }
+    return out;
+}
+
 // Test if HANDLE has a working DDC/CI connection.
 // Returns "invalid", "ok", or a capabilities string.
 std::string
-getPhysicalHandleResults(HANDLE handle, std::string validationMethod)
+getPhysicalHandleResults(HANDLE handle,
+                         std::string validationMethod,
+                         const std::string& cacheKey = "")
 {
     if (validationMethod == "no-validation")
         return "ok";
@@ -598,7 +707,7 @@ getPhysicalHandleResults(HANDLE handle, std::string validationMethod)
 
     // Accurate method: Check capabilities string
     if (validationMethod == "accurate") {
-        std::string result = getCapabilitiesString(handle);
+        std::string result = getCapabilitiesString(handle, cacheKey);
         if(result == "") {
             return "invalid";
         }
@@ -637,6 +746,29 @@ getPhysicalHandleResults(HANDLE handle, std::string validationMethod)
     return "ok";
 }
 
+// Refresh cancellation
+//
+// A scheduled refresh carries its generation. Probing one monitor can take
+// seconds, so between probes the refresh compares its generation with the
+// newest one requested and gives up if it has been superseded, leaving the
+// previous maps in place.
+
+struct RefreshSuperseded {};
+
+volatile LONG localRefreshGeneration = 0;
+volatile LONG* refreshGenerationSource = &localRefreshGeneration;
+// Generation of the refresh in progress, or 0 if it can't be cancelled.
+LONG activeRefreshGeneration = 0;
+
+void
+throwIfRefreshSuperseded()
+{
+    if (activeRefreshGeneration != 0
+        && *refreshGenerationSource > activeRefreshGeneration) {
+        throw RefreshSuperseded();
+    }
+}
+
 // Old method of detecting DDC/CI handles
 void
 populateHandlesMapLegacy()
@@ -777,6 +909,8 @@ populateHandlesMapNormal(std::string validationMethod, bool usePreviousResults,
              * and only include ones that work.
              */
 
+            throwIfRefreshSuperseded();
+
             std::string fullMonitorName =
               monitor.monitorName + "\\" + "Monitor" + std::to_string(i);
 
@@ -944,6 +1078,8 @@ populateHandlesMapNormal(std::string validationMethod, bool usePreviousResults,
                 p("-- -- High Level: Supported");
             }
 
+            throwIfRefreshSuperseded();
+
             // Test DDC/CI
             bool saveCapabilities = false;
             if (newMonitor.ddcciSupported == false) {
@@ -957,7 +1093,7 @@ populateHandlesMapNormal(std::string validationMethod, bool usePreviousResults,
                     }
 
                     // Check results using requested method
-                    std::string validationMethodResult = getPhysicalHandleResults(newMonitor.handle, validationMethod);
+                    std::string validationMethodResult = getPhysicalHandleResults(newMonitor.handle, validationMethod, newMonitor.deviceKey);
 
                     if(validationMethodResult != "invalid") {
                         result = validationMethodResult;
@@ -1041,56 +1177,54 @@ populateHandlesMap(std::string validationMethod, bool usePreviousResults, bool c
             return populateHandlesMapNormal(validationMethod, usePreviousResults, checkHighLevel);
 
         return populateHandlesMapNormal("fast", usePreviousResults, checkHighLevel);
+    } catch (const RefreshSuperseded&) {
+        throw;
     } catch (...) {
         p("populateHandlesMap: refresh failed. Keeping previous monitor data.");
     }
 }
 
-Napi::Value
-refresh(const Napi::CallbackInfo& info)
+// Command dispatch
+//
+// Every hardware access goes through runDdcCommand(), which works on the
+// monitor maps of the process it runs in. The addon either calls it directly
+// or forwards the command to ddcci_worker.exe, so the N-API functions below
+// behave the same in both modes.
+
+// Flattens `handles` and `physicalMonitorHandles` for CMD_GET_ALL_MONITORS.
+// The first record lists the `handles` keys; each following record is one
+// PhysicalMonitor.
+std::string
+serializeMonitors()
 {
-    Napi::Env env = info.Env();
+    const char fs = ddcipc::kFieldSeparator;
+    std::string out;
 
-    if (info.Length() < 2) {
-        throw Napi::TypeError::New(env, "Not enough arguments");
-    }
-    if (!info[0].IsString() || !info[1].IsBoolean() || !info[2].IsBoolean()) {
-        throw Napi::TypeError::New(env, "Invalid arguments");
+    for (auto const& handle : handles) {
+        out += handle.first;
+        out += fs;
     }
 
-    try {
-        populateHandlesMap(info[0].As<Napi::String>().Utf8Value(), info[1].As<Napi::Boolean>().ToBoolean(), info[2].As<Napi::Boolean>().ToBoolean());
-    } catch (...) {
-        throw Napi::Error::New(env, "Error refreshing DDC/CI displays!");
+    for (auto const& entry : physicalMonitorHandles) {
+        const PhysicalMonitor& monitor = entry.second;
+        out += ddcipc::kRecordSeparator;
+        out += entry.first + fs + monitor.name + fs + monitor.fullName + fs
+               + monitor.physicalName + fs + monitor.result + fs
+               + monitor.deviceKey + fs + monitor.deviceID + fs;
+        out += monitor.ddcciSupported ? '1' : '0';
+        out += monitor.hlCapabilities.brightnessOK ? '1' : '0';
+        out += monitor.hlCapabilities.contrastOK ? '1' : '0';
+        out += monitor.handleIsValid ? '1' : '0';
     }
 
-    return env.Undefined();
-}
-
-void
-clearDisplayCache(const Napi::CallbackInfo& info)
-{
-    if (!physicalMonitorHandles.empty()) {
-        physicalMonitorHandles.clear();
-    }
-    if (!capabilities.empty()) {
-        capabilities.clear();
-    }
+    return out;
 }
 
-Napi::String
-getNAPICapabilitiesString(const Napi::CallbackInfo& info)
+DdcResult
+getCapabilitiesResult(const std::string& monitorName)
 {
-    Napi::Env env = info.Env();
-
-    if (info.Length() < 1) {
-        throw Napi::TypeError::New(env, "Not enough arguments");
-    }
-    if (!info[0].IsString()) {
-        throw Napi::TypeError::New(env, "Invalid arguments");
-    }
+    DdcResult result;
 
-    std::string monitorName = info[0].As<Napi::String>().Utf8Value();
     PhysicalMonitor* physicalMonitor = findPhysicalMonitor(monitorName);
     const std::string cacheKey = (physicalMonitor != nullptr
       && !physicalMonitor->deviceKey.empty())
@@ -1101,7 +1235,8 @@ getNAPICapabilitiesString(const Napi::CallbackInfo& info)
     auto found = capabilities.find(cacheKey);
     if (found != capabilities.end()) {
         applyCapabilitiesResult(physicalMonitor, found->second);
-        return Napi::String::New(env, found->second);
+        result.text = found->second;
+        return result;
     }
 
     // Find requested monitor.
@@ -1110,14 +1245,15 @@ getNAPICapabilitiesString(const Napi::CallbackInfo& info)
         it = handles.find(monitorName);
     }
     if (it == handles.end()) {
-        throw Napi::Error::New(env, "Monitor not found");
+        result.status = ddcipc::STATUS_NOT_FOUND;
+        return result;
     }
 
-    std::string returnString = getCapabilitiesString(it->second);
+    std::string returnString = getCapabilitiesString(it->second, cacheKey);
 
-    if(returnString == "") {
-        throw Napi::Error::New(
-          env, "Monitor not responding."); // Does not respond to DDC/CI
+    if (returnString == "") {
+        result.status = ddcipc::STATUS_FAILED; // Does not respond to DDC/CI
+        return result;
     }
 
     // A capabilities request can be performed after a fast discovery pass.
@@ -1128,229 +1264,1864 @@ getNAPICapabilitiesString(const Napi::CallbackInfo& info)
         capabilities[cacheKey] = returnString;
     }
 
-    return Napi::String::New(env, returnString);
+    result.text = returnString;
+    return result;
 }
 
-
-Napi::Array
-getMonitorList(const Napi::CallbackInfo& info)
+DdcResult
+runDdcCommand(uint32_t command,
+              const std::string& target,
+              const uint32_t args[4])
 {
-    Napi::Env env = info.Env();
-    Napi::Array ret = Napi::Array::New(env, handles.size());
-
-    int i = 0;
-    for (auto const& handle : handles) {
-        ret.Set(i++, handle.first);
+    DdcResult result;
+
+    switch (command) {
+        case ddcipc::CMD_REFRESH:
+            activeRefreshGeneration = static_cast<LONG>(args[2]);
+            try {
+                populateHandlesMap(target, args[0] != 0, args[1] != 0);
+            } catch (const RefreshSuperseded&) {
+                p("Refresh #" + std::to_string(args[2]) + " superseded.");
+                result.status = ddcipc::STATUS_SUPERSEDED;
+            } catch (...) {
+                result.status = ddcipc::STATUS_FAILED;
+            }
+            activeRefreshGeneration = 0;
+            return result;
+        case ddcipc::CMD_CLEAR_DISPLAY_CACHE:
+            physicalMonitorHandles.clear();
+            capabilities.clear();
+            capabilitiesLengths.clear();
+            capabilitiesTimings.clear();
+            return result;
+        case ddcipc::CMD_GET_ALL_MONITORS:
+            result.text = serializeMonitors();
+            return result;
+        case ddcipc::CMD_GET_CAPABILITIES:
+            return getCapabilitiesResult(target);
+        case ddcipc::CMD_GET_CAPABILITIES_TIMING: {
+            PhysicalMonitor* monitor = findPhysicalMonitor(target);
+            auto timing = capabilitiesTimings.find(
+              monitor != nullptr && !monitor->deviceKey.empty()
+                ? monitor->deviceKey
+                : target);
+            if (timing == capabilitiesTimings.end()) {
+                result.status = ddcipc::STATUS_NOT_FOUND;
+            } else {
+                result.text = serializeCapabilitiesTiming(timing->second);
+            }
+            return result;
+        }
+        case ddcipc::CMD_SET_LOG_LEVEL:
+            logLevel = static_cast<int>(args[0]);
+            return result;
+        default:
+            break;
     }
 
-    return ret;
-}
-
-Napi::Array
-getAllMonitors(const Napi::CallbackInfo& info)
-{
-    napi_env env = info.Env();
-    Napi::Array monitors = Napi::Array::New(env);
-
-    int i = 0;
-    for (auto const& handle : physicalMonitorHandles) {
-        Napi::Object monitor = Napi::Object::New(env);
-        monitor.Set("ddcciSupported",
-                    Napi::Boolean::New(env, handle.second.ddcciSupported));
-        monitor.Set("hlBrightnessSupported",
-                    Napi::Boolean::New(env, handle.second.hlCapabilities.brightnessOK));
-        monitor.Set("hlContrastSupported",
-                    Napi::Boolean::New(env, handle.second.hlCapabilities.contrastOK));
-        monitor.Set("handleIsValid",
-                    Napi::Boolean::New(env, handle.second.handleIsValid));
-        monitor.Set("name", Napi::String::New(env, handle.second.name));
-        monitor.Set("fullName", Napi::String::New(env, handle.second.fullName));
-        monitor.Set("physicalName", Napi::String::New(env, handle.second.physicalName));
-        monitor.Set("result", Napi::String::New(env, handle.second.result));
-        monitor.Set("deviceKey",
-                    Napi::String::New(env, handle.second.deviceKey));
-        monitor.Set("deviceID", Napi::String::New(env, handle.second.deviceID));
+    auto it = handles.find(target);
+    if (it == handles.end()) {
+        result.status = ddcipc::STATUS_NOT_FOUND;
+        return result;
+    }
+    HANDLE handle = it->second;
 
-        monitors.Set(i++, monitor);
+    BOOL ok = TRUE;
+    switch (command) {
+        case ddcipc::CMD_GET_VCP:
+            ok = tryDdcCiOperation(
+              [&]() {
+                  return GetVCPFeatureAndVCPFeatureReply(
+                    handle,
+                    static_cast<BYTE>(args[0]),
+                    NULL,
+                    &result.values[0],
+                    &result.values[1]);
+              },
+              result.errorCode);
+            break;
+        case ddcipc::CMD_SET_VCP:
+            ok = tryDdcCiOperation(
+              [&]() {
+                  return SetVCPFeature(
+                    handle, static_cast<BYTE>(args[0]), args[1]);
+              },
+              result.errorCode);
+            break;
+        case ddcipc::CMD_SAVE_CURRENT_SETTINGS:
+            // Reported as a boolean rather than an error, as before.
+            result.values[0] = SaveCurrentSettings(handle);
+            break;
+        case ddcipc::CMD_GET_HIGH_LEVEL_BRIGHTNESS:
+            ok = tryDdcCiOperation(
+              [&]() {
+                  return GetMonitorBrightness(handle,
+                                              &result.values[2],
+                                              &result.values[0],
+                                              &result.values[1]);
+              },
+              result.errorCode);
+            break;
+        case ddcipc::CMD_SET_HIGH_LEVEL_BRIGHTNESS:
+            ok = tryDdcCiOperation(
+              [&]() { return SetMonitorBrightness(handle, args[0]); },
+              result.errorCode);
+            break;
+        case ddcipc::CMD_GET_HIGH_LEVEL_CONTRAST:
+            ok = tryDdcCiOperation(
+              [&]() {
+                  return GetMonitorContrast(handle,
+                                            &result.values[2],
+                                            &result.values[0],
+                                            &result.values[1]);
+              },
+              result.errorCode);
+            break;
+        case ddcipc::CMD_SET_HIGH_LEVEL_CONTRAST:
+            ok = tryDdcCiOperation(
+              [&]() { return SetMonitorContrast(handle, args[0]); },
+              result.errorCode);
+            break;
+        default:
+            result.status = ddcipc::STATUS_INVALID;
+            return result;
     }
 
-    return monitors;
+    if (!ok) {
+        result.status = ddcipc::STATUS_FAILED;
+    }
+    return result;
 }
 
+#ifndef DDCCI_WORKER
 
-Napi::Value
-setVCP(const Napi::CallbackInfo& info)
-{
-    Napi::Env env = info.Env();
+// Serializes access to the monitor maps, the worker client and the power
+// state between the JS thread, the command queue thread and the refresh
+// scheduler thread. Every N-API function that touches them takes it first.
+std::recursive_mutex ddcMutex;
 
-    if (info.Length() < 3) {
-        throw Napi::TypeError::New(env, "Not enough arguments");
-    }
-    if (!info[0].IsString() || !info[1].IsNumber() || !info[2].IsNumber()) {
-        throw Napi::TypeError::New(env, "Invalid arguments");
-    }
+// Set, under ddcMutex, while the refresh scheduler or the command queue talks
+// to the hardware without holding ddcMutex. Until it is cleared that thread
+// owns the monitor maps and the worker channel, so exports don't wait on a
+// call that can take seconds: writes are held and queued once it finishes,
+// other synchronous hardware access fails with ERROR_BUSY, and the monitor
+// lists come from monitorsBeforeWork. Queued commands and refreshes wait on
+// hardwareIdle instead.
+bool hardwareBusy = false;
+std::condition_variable_any hardwareIdle;
+std::string monitorsBeforeWork;
 
-    std::string monitorName = info[0].As<Napi::String>().Utf8Value();
-    BYTE vcpCode = static_cast<BYTE>(info[1].As<Napi::Number>().Int32Value());
-    DWORD newValue =
-      static_cast<DWORD>(info[2].As<Napi::Number>().Int32Value());
+// The lock a queued command or scheduled refresh holds ddcMutex through, on
+// that thread only. withHardware() lets go of it for the call itself.
+thread_local std::unique_lock<std::recursive_mutex>* backgroundLock = nullptr;
 
-    auto it = handles.find(monitorName);
-    if (it == handles.end()) {
-        throw Napi::Error::New(env, "Monitor not found");
+void
+beginBackgroundWork();
+void
+endBackgroundWork();
+
+// Runs a hardware call. On a background thread it runs without ddcMutex,
+// with the hardware marked busy; on the JS thread it runs under the lock the
+// export already holds.
+template <typename Call>
+DdcResult
+withHardware(Call call)
+{
+    std::unique_lock<std::recursive_mutex>* lock = backgroundLock;
+    if (lock == nullptr) {
+        return call();
     }
 
-    DWORD errorCode = ERROR_SUCCESS;
-    BOOL ok = tryDdcCiOperation(
-      [&]() { return SetVCPFeature(it->second, vcpCode, newValue); },
-      errorCode);
-    if (!ok) {
-        throwDdcCiError(env, "Failed to set VCP code value", errorCode);
+    // Calls nested in `call` run directly.
+    beginBackgroundWork();
+    backgroundLock = nullptr;
+    lock->unlock();
+    DdcResult result;
+    try {
+        result = call();
+    } catch (...) {
+        lock->lock();
+        backgroundLock = lock;
+        endBackgroundWork();
+        throw;
     }
-
-    return env.Undefined();
+    lock->lock();
+    backgroundLock = lock;
+    endBackgroundWork();
+    return result;
 }
 
-Napi::Value
-getVCP(const Napi::CallbackInfo& info)
+// Blocks until no background thread is using the hardware. `lock` must hold
+// ddcMutex exactly once.
+void
+waitForHardwareIdle(std::unique_lock<std::recursive_mutex>& lock)
 {
-    Napi::Env env = info.Env();
+    hardwareIdle.wait(lock, []() { return !hardwareBusy; });
+}
 
-    if (info.Length() < 2) {
-        throw Napi::TypeError::New(env, "Not enough arguments");
-    }
-    if (!info[0].IsString() || !info[1].IsNumber()) {
-        throw Napi::TypeError::New(env, "Invalid arguments");
+// Makes the calling thread a background owner of `lock` for its lifetime.
+struct BackgroundWorkScope {
+    explicit BackgroundWorkScope(std::unique_lock<std::recursive_mutex>& lock)
+    {
+        backgroundLock = &lock;
     }
+    ~BackgroundWorkScope() { backgroundLock = nullptr; }
+};
 
-    std::string monitorName = info[0].As<Napi::String>().Utf8Value();
-    BYTE vcpCode = static_cast<BYTE>(info[1].As<Napi::Number>().Int32Value());
+// Worker process client
+//
+// With worker mode enabled, every command runs in ddcci_worker.exe, which
+// sits next to ddcci.node. A monitor driver that crashes or hangs inside a
+// DDC/CI call then only takes the worker down. The client notices through
+// the process handle (or a timeout), reports the command as failed, and
+// respawns the worker on the next call, replaying the last refresh so its
+// handles are available again.
+
+const DWORD kWorkerCommandTimeoutMs = 15000;
+const DWORD kWorkerRefreshTimeoutMs = 60000;
+// Synchronous calls wait on the JS thread, so they give a hung worker less
+// time. The command queue and refresh scheduler use the longer timeouts.
+const DWORD kWorkerJsCommandTimeoutMs = 5000;
+const DWORD kWorkerJsRefreshTimeoutMs = 20000;
+const DWORD kWorkerShutdownTimeoutMs = 500;
+// How long the env cleanup hook waits for the command queue and refresh
+// scheduler threads before leaving them behind.
+const DWORD kBackgroundStopTimeoutMs = 1000;
+
+struct RefreshRequest {
+    bool valid = false;
+    std::string method;
+    uint32_t args[4] = { 0, 0, 0, 0 };
+};
 
-    auto it = handles.find(monitorName);
-    if (it == handles.end()) {
-        throw Napi::Error::New(env, "Monitor not found");
+// Last refresh requested from JS, replayed whenever a new backend (a fresh
+// worker, or the in-process maps after leaving worker mode) takes over.
+RefreshRequest lastRefresh;
+
+std::wstring
+getWorkerExecutablePath()
+{
+    HMODULE module = NULL;
+    if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS
+                              | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                            reinterpret_cast<LPCWSTR>(&getWorkerExecutablePath),
+                            &module)) {
+        return L"";
+    }
+
+    std::vector<wchar_t> buffer(MAX_PATH);
+    while (true) {
+        DWORD length = GetModuleFileNameW(
+          module, buffer.data(), static_cast<DWORD>(buffer.size()));
+        if (length == 0) {
+            return L"";
+        }
+        if (length < buffer.size()) {
+            break;
+        }
+        buffer.resize(buffer.size() * 2);
     }
 
-    DWORD currentValue;
-    DWORD maxValue;
-    DWORD errorCode = ERROR_SUCCESS;
-    BOOL ok = tryDdcCiOperation(
-      [&]() {
-          return GetVCPFeatureAndVCPFeatureReply(
-            it->second, vcpCode, NULL, &currentValue, &maxValue);
-      },
-      errorCode);
-    if (!ok) {
-        throwDdcCiError(env, "Failed to get VCP code value", errorCode);
+    std::wstring path(buffer.data());
+    size_t separator = path.find_last_of(L"\\/");
+    if (separator == std::wstring::npos) {
+        return L"";
     }
+    return path.substr(0, separator + 1) + L"ddcci_worker.exe";
+}
 
-    Napi::Array ret = Napi::Array::New(env, 2);
-    ret.Set((uint32_t)0, static_cast<double>(currentValue));
-    ret.Set((uint32_t)1, static_cast<double>(maxValue));
+// Set in Init().
+std::thread::id jsThreadId;
 
-    return ret;
+DWORD
+workerTimeoutMs(uint32_t command)
+{
+    const bool onJsThread = std::this_thread::get_id() == jsThreadId;
+    if (command == ddcipc::CMD_REFRESH) {
+        return onJsThread ? kWorkerJsRefreshTimeoutMs : kWorkerRefreshTimeoutMs;
+    }
+    return onJsThread ? kWorkerJsCommandTimeoutMs : kWorkerCommandTimeoutMs;
 }
 
-Napi::Boolean
-saveCurrentSettings(const Napi::CallbackInfo& info)
+class DdcWorkerClient
 {
-    Napi::Env env = info.Env();
-
-    if (info.Length() < 1) {
-        throw Napi::TypeError::New(env, "Not enough arguments");
-    }
-    if (!info[0].IsString()) {
-        throw Napi::TypeError::New(env, "Invalid arguments");
+  public:
+    bool enabled = false;
+    // Read by getWorkerStatus() while a background thread may be using the
+    // worker.
+    std::atomic<uint32_t> restarts{ 0 };
+    std::atomic<uint32_t> crashes{ 0 };
+    std::atomic<DWORD> lastExitCode{ 0 };
+    std::atomic<DWORD> processId{ 0 };
+
+    bool running() const { return process != NULL; }
+
+    DWORD pid() const { return process != NULL ? GetProcessId(process) : 0; }
+
+    bool start(DWORD& errorCode)
+    {
+        if (process != NULL) {
+            return true;
+        }
+        if (!createChannel(errorCode) || !spawn(errorCode)) {
+            close();
+            return false;
+        }
+        if (recovering) {
+            restarts++;
+            recovering = false;
+        }
+        p("DDC/CI worker started. PID: " + std::to_string(pid()));
+
+        uint32_t logArgs[4] = { static_cast<uint32_t>(logLevel), 0, 0, 0 };
+        submit(ddcipc::CMD_SET_LOG_LEVEL,
+               "",
+               logArgs,
+               workerTimeoutMs(ddcipc::CMD_SET_LOG_LEVEL));
+        if (process != NULL && lastRefresh.valid) {
+            submit(ddcipc::CMD_REFRESH,
+                   lastRefresh.method,
+                   lastRefresh.args,
+                   workerTimeoutMs(ddcipc::CMD_REFRESH));
+        }
+        if (process == NULL) {
+            errorCode = lastExitCode;
+            return false;
+        }
+        return true;
     }
 
-    std::string monitorName = info[0].As<Napi::String>().Utf8Value();
+    void stop()
+    {
+        if (process != NULL) {
+            uint32_t args[4] = { 0, 0, 0, 0 };
+            post(ddcipc::CMD_SHUTDOWN, "", args);
+            if (WaitForSingleObject(process, kWorkerShutdownTimeoutMs)
+                != WAIT_OBJECT_0) {
+                TerminateProcess(process, ERROR_PROCESS_ABORTED);
+            }
+        }
+        close();
+    }
 
-    auto it = handles.find(monitorName);
-    if (it == handles.end()) {
-        throw Napi::Error::New(env, "Monitor not found");
+    // Lets a refresh running in the worker see that it has been superseded.
+    // Called without the DDC lock, while another thread may be waiting on
+    // the worker.
+    void publishRefreshGeneration(LONG generation)
+    {
+        std::lock_guard<std::mutex> lock(ringMutex);
+        if (ring != nullptr) {
+            InterlockedExchange(&ring->refreshGeneration, generation);
+        }
     }
 
+    DdcResult call(uint32_t command,
+                   const std::string& target,
+                   const uint32_t args[4])
+    {
+        DdcResult result;
+        DWORD errorCode = ERROR_SUCCESS;
+        if (!start(errorCode)) {
+            result.status = ddcipc::STATUS_WORKER_LOST;
+            result.errorCode = errorCode;
+            return result;
+        }
+        return submit(command, target, args, workerTimeoutMs(command));
+    }
+
+  private:
+    HANDLE mapping = NULL;
+    HANDLE requestEvent = NULL;
+    HANDLE responseEvent = NULL;
+    HANDLE process = NULL;
+    HANDLE job = NULL;
+    ddcipc::Ring* ring = nullptr;
+    std::wstring channelName;
+    uint32_t sequence = 0;
+    bool recovering = false;
+    // Guards `ring` against publishRefreshGeneration() while it is mapped or
+    // unmapped.
+    std::mutex ringMutex;
+
+    bool createChannel(DWORD& errorCode)
+    {
+        static uint32_t channelCounter = 0;
+        channelName = L"Local\\node-ddcci-"
+                      + std::to_wstring(GetCurrentProcessId()) + L"-"
+                      + std::to_wstring(++channelCounter);
+
+        mapping = CreateFileMappingW(INVALID_HANDLE_VALUE,
+                                     NULL,
+                                     PAGE_READWRITE,
+                                     0,
+                                     sizeof(ddcipc::Ring),
+                                     channelName.c_str());
+        if (mapping == NULL) {
+            errorCode = GetLastError();
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(ringMutex);
+            ring = static_cast<ddcipc::Ring*>(MapViewOfFile(
+              mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(ddcipc::Ring)));
+        }
+        requestEvent =
+          CreateEventW(NULL, FALSE, FALSE, (channelName + L"-request").c_str());
+        responseEvent =
+          CreateEventW(NULL, FALSE, FALSE, (channelName + L"-response").c_str());
+        if (ring == nullptr || requestEvent == NULL || responseEvent == NULL) {
+            errorCode = GetLastError();
+            return false;
+        }
 
-    BOOL bSuccess = 0;
-    bSuccess = SaveCurrentSettings(it->second);
+        // The mapping is zero-filled, so every slot starts out SLOT_FREE.
+        ring->version = ddcipc::kVersion;
+        ring->head = 0;
+        ring->tail = 0;
+        ring->refreshGeneration = localRefreshGeneration;
+        InterlockedExchange(reinterpret_cast<volatile LONG*>(&ring->magic),
+                            static_cast<LONG>(ddcipc::kMagic));
+        return true;
+    }
+
+    bool spawn(DWORD& errorCode)
+    {
+        std::wstring path = getWorkerExecutablePath();
+        if (path.empty()
+            || GetFileAttributesW(path.c_str()) == INVALID_FILE_ATTRIBUTES) {
+            errorCode = ERROR_FILE_NOT_FOUND;
+            return false;
+        }
 
-    return Napi::Boolean::New(env, bSuccess);
-}
+        std::wstring commandLine = L"\"" + path + L"\" " + channelName + L" "
+                                   + std::to_wstring(GetCurrentProcessId());
+
+        STARTUPINFOW startupInfo = {};
+        startupInfo.cb = sizeof(startupInfo);
+        PROCESS_INFORMATION processInfo = {};
+        if (!CreateProcessW(path.c_str(),
+                            &commandLine[0],
+                            NULL,
+                            NULL,
+                            FALSE,
+                            CREATE_NO_WINDOW | CREATE_SUSPENDED,
+                            NULL,
+                            NULL,
+                            &startupInfo,
+                            &processInfo)) {
+            errorCode = GetLastError();
+            return false;
+        }
 
-Napi::Value
-getHighLevelBrightness(const Napi::CallbackInfo& info)
-{
-    Napi::Env env = info.Env();
+        // Tie the worker's lifetime to ours. If the job can't be created
+        // (e.g. nested job restrictions), the worker still exits when it
+        // sees the parent process handle signal.
+        job = CreateJobObjectW(NULL, NULL);
+        if (job != NULL) {
+            JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits = {};
+            limits.BasicLimitInformation.LimitFlags =
+              JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+            if (!SetInformationJobObject(job,
+                                         JobObjectExtendedLimitInformation,
+                                         &limits,
+                                         sizeof(limits))
+                || !AssignProcessToJobObject(job, processInfo.hProcess)) {
+                CloseHandle(job);
+                job = NULL;
+            }
+        }
 
-    if (info.Length() < 1) {
-        throw Napi::TypeError::New(env, "Not enough arguments");
-    }
-    if (!info[0].IsString()) {
-        throw Napi::TypeError::New(env, "Invalid arguments");
+        ResumeThread(processInfo.hThread);
+        CloseHandle(processInfo.hThread);
+        process = processInfo.hProcess;
+        processId = processInfo.dwProcessId;
+        return true;
+    }
+
+    void close()
+    {
+        processId = 0;
+        {
+            std::lock_guard<std::mutex> lock(ringMutex);
+            if (ring != nullptr) {
+                UnmapViewOfFile(ring);
+                ring = nullptr;
+            }
+        }
+        for (HANDLE* handle :
+             { &mapping, &requestEvent, &responseEvent, &process, &job }) {
+            if (*handle != NULL) {
+                CloseHandle(*handle);
+                *handle = NULL;
+            }
+        }
     }
 
-    std::string monitorName = info[0].As<Napi::String>().Utf8Value();
+    // Writes a command into the next slot and wakes the worker. Returns the
+    // slot, or nullptr if the ring is full.
+    ddcipc::Slot* post(uint32_t command,
+                       const std::string& target,
+                       const uint32_t args[4])
+    {
+        if (ring == nullptr
+            || ring->head - ring->tail >= static_cast<LONG>(ddcipc::kSlotCount)) {
+            return nullptr;
+        }
 
-    auto it = handles.find(monitorName);
-    if (it == handles.end()) {
-        throw Napi::Error::New(env, "Monitor not found");
-    }
+        ddcipc::Slot& slot = ring->slots[ring->head % ddcipc::kSlotCount];
+        slot.sequence = ++sequence;
+        slot.command = command;
+        slot.status = ddcipc::STATUS_OK;
+        slot.errorCode = ERROR_SUCCESS;
+        for (int i = 0; i < 4; i++) {
+            slot.args[i] = args[i];
+            slot.values[i] = 0;
+        }
+        slot.payloadLength = static_cast<uint32_t>(
+          (std::min)(target.size(), static_cast<size_t>(ddcipc::kPayloadSize)));
+        memcpy(slot.payload, target.data(), slot.payloadLength);
+
+        InterlockedExchange(&slot.state, ddcipc::SLOT_SUBMITTED);
+        InterlockedIncrement(&ring->head);
+        SetEvent(requestEvent);
+        return &slot;
+    }
+
+    // Records why the worker went away and releases it. The next call()
+    // spawns a replacement.
+    void lost(DWORD exitCode)
+    {
+        if (WaitForSingleObject(process, 0) != WAIT_OBJECT_0) {
+            TerminateProcess(process, exitCode);
+        }
+        crashes++;
+        recovering = true;
+        lastExitCode = exitCode;
+        p("DDC/CI worker lost. Code: " + std::to_string(exitCode));
+        close();
+    }
+
+    DdcResult submit(uint32_t command,
+                     const std::string& target,
+                     const uint32_t args[4],
+                     DWORD timeoutMs)
+    {
+        DdcResult result;
+        result.status = ddcipc::STATUS_WORKER_LOST;
+
+        ddcipc::Slot* slot = post(command, target, args);
+        if (slot == nullptr) {
+            result.errorCode = ERROR_BUSY;
+            return result;
+        }
 
-    DWORD minValue;
-    DWORD currentValue;
-    DWORD maxValue;
-    DWORD errorCode = ERROR_SUCCESS;
-    BOOL ok = tryDdcCiOperation(
-      [&]() {
-          return GetMonitorBrightness(
-            it->second, &minValue, &currentValue, &maxValue);
-      },
-      errorCode);
-    if (!ok) {
-        throwDdcCiError(env, "Failed to get high level brightness", errorCode);
-    }
+        const uint32_t expected = slot->sequence;
+        const ULONGLONG deadline = GetTickCount64() + timeoutMs;
+        HANDLE waitHandles[2] = { responseEvent, process };
+
+        while (slot->state != ddcipc::SLOT_DONE) {
+            ULONGLONG now = GetTickCount64();
+            DWORD remaining =
+              now >= deadline ? 0 : static_cast<DWORD>(deadline - now);
+            DWORD wait =
+              WaitForMultipleObjects(2, waitHandles, FALSE, remaining);
+            if (wait == WAIT_OBJECT_0) {
+                continue;
+            }
+            if (slot->state == ddcipc::SLOT_DONE) {
+                break;
+            }
 
-    Napi::Array ret = Napi::Array::New(env, 3);
-    ret.Set((uint32_t)0, static_cast<double>(currentValue));
-    ret.Set((uint32_t)1, static_cast<double>(maxValue));
-    ret.Set((uint32_t)2, static_cast<double>(minValue));
+            DWORD exitCode = WAIT_TIMEOUT;
+            if (wait == WAIT_OBJECT_0 + 1) {
+                GetExitCodeProcess(process, &exitCode);
+            }
+            result.errorCode = exitCode;
+            lost(exitCode);
+            return result;
+        }
 
-    return ret;
-}
+        if (slot->sequence != expected) {
+            result.errorCode = ERROR_INVALID_DATA;
+            lost(ERROR_INVALID_DATA);
+            return result;
+        }
 
-Napi::Value
-setHighLevelBrightness(const Napi::CallbackInfo& info)
-{
+        result.status = slot->status;
+        result.errorCode = slot->errorCode;
+        for (int i = 0; i < 3; i++) {
+            result.values[i] = slot->values[i];
+        }
+        result.text.assign(slot->payload, slot->payloadLength);
+        InterlockedExchange(&slot->state, ddcipc::SLOT_FREE);
+        return result;
+    }
+};
+
+DdcWorkerClient ddcWorker;
+
+// Parses a serializeMonitors() snapshot. Handles stay in the process that
+// took the snapshot, so the parsed entries carry NULL and are only used for
+// lookups.
+bool
+parseMonitorSnapshot(const std::string& text,
+                     std::map<std::string, HANDLE>& handleKeys,
+                     std::map<std::string, PhysicalMonitor>& monitors)
+{
+    std::vector<std::string> records;
+    std::istringstream recordStream(text);
+    std::string record;
+    while (std::getline(recordStream, record, ddcipc::kRecordSeparator)) {
+        records.push_back(record);
+    }
+    if (records.empty()) {
+        return false;
+    }
+
+    std::istringstream keyStream(records[0]);
+    std::string key;
+    while (std::getline(keyStream, key, ddcipc::kFieldSeparator)) {
+        if (!key.empty()) {
+            handleKeys.insert({ key, NULL });
+        }
+    }
+
+    for (size_t i = 1; i < records.size(); i++) {
+        std::vector<std::string> fields;
+        std::istringstream fieldStream(records[i]);
+        std::string field;
+        while (std::getline(fieldStream, field, ddcipc::kFieldSeparator)) {
+            fields.push_back(field);
+        }
+        if (fields.size() < 8 || fields[7].size() < 4) {
+            continue;
+        }
+
+        PhysicalMonitor monitor;
+        monitor.handle = NULL;
+        monitor.name = fields[1];
+        monitor.fullName = fields[2];
+        monitor.physicalName = fields[3];
+        monitor.result = fields[4];
+        monitor.deviceKey = fields[5];
+        monitor.deviceID = fields[6];
+        monitor.ddcciSupported = fields[7][0] == '1';
+        monitor.hlCapabilities.brightnessOK = fields[7][1] == '1';
+        monitor.hlCapabilities.contrastOK = fields[7][2] == '1';
+        monitor.handleIsValid = fields[7][3] == '1';
+        monitors.insert({ fields[0], monitor });
+    }
+    return true;
+}
+
+DdcResult
+fetchWorkerMonitors()
+{
+    uint32_t args[4] = { 0, 0, 0, 0 };
+    return ddcWorker.call(ddcipc::CMD_GET_ALL_MONITORS, "", args);
+}
+
+// Replaces the local maps with the worker's view, as returned by
+// fetchWorkerMonitors().
+void
+applyWorkerMonitors(const DdcResult& result)
+{
+    if (result.status != ddcipc::STATUS_OK) {
+        return;
+    }
+
+    clearMonitorData();
+
+    if (!parseMonitorSnapshot(result.text, handles, physicalMonitorHandles)) {
+        return;
+    }
+
+    for (auto const& entry : physicalMonitorHandles) {
+        const PhysicalMonitor& monitor = entry.second;
+        if (monitor.result != "ok" && monitor.result != "invalid"
+            && !monitor.result.empty() && !monitor.deviceKey.empty()) {
+            capabilities[monitor.deviceKey] = monitor.result;
+        }
+    }
+}
+
+void
+mirrorWorkerMonitors()
+{
+    applyWorkerMonitors(withHardware(fetchWorkerMonitors));
+}
+
+DdcResult
+dispatchDdcCommand(uint32_t command,
+                   const std::string& target,
+                   const uint32_t args[4])
+{
+    return withHardware([&]() {
+        if (ddcWorker.enabled) {
+            return ddcWorker.call(command, target, args);
+        }
+        return runDdcCommand(command, target, args);
+    });
+}
+
+// Monitor power state
+//
+// A write to a monitor in DPMS standby only fails after the full retry cycle,
+// and the app then retries it again after wake. Instead, each monitor's power
+// state is tracked from VCP 0xD6 traffic and the OS display state. Writes to
+// a sleeping monitor are parked, keeping only the latest value per code, and
+// replayed once the monitor reports that it is on.
+
+const BYTE kPowerModeVcp = 0xD6;
+const DWORD kPowerModeOn = 1;
+// Minimum time between 0xD6 probes of a monitor that is waking up.
+const ULONGLONG kWakeProbeIntervalMs = 1000;
+// Once this long has passed since the OS reported displays on and since the
+// monitor went into standby, stop waiting for a monitor whose 0xD6 probe
+// keeps failing and replay its writes anyway.
+const ULONGLONG kWakeTimeoutMs = 30000;
+
+enum class PowerState { Unknown, On, Standby };
+
+struct MonitorPower {
+    PowerState state = PowerState::Unknown;
+    ULONGLONG lastProbe = 0;
+    ULONGLONG standbySince = 0;
+    // Latest parked write per code, keyed by parkedWriteKey().
+    std::map<uint32_t, std::pair<uint32_t, std::array<uint32_t, 4>>> parked;
+};
+
+// Keyed by monitorPowerKey(), so every alias of a monitor shares one entry.
+std::map<std::string, MonitorPower> monitorPower;
+bool displaysOn = true;
+ULONGLONG displaysOnSince = 0;
+uint32_t parkedWriteCount = 0;
+uint32_t replayedWriteCount = 0;
+
+// The canonical ID of a monitor: its device key if the monitor is known,
+// whichever of its IDs `target` is.
+std::string
+monitorPowerKey(const std::string& target)
+{
+    PhysicalMonitor* monitor = findPhysicalMonitor(target);
+    if (monitor == nullptr || monitor->deviceKey.empty()) {
+        return target;
+    }
+    return monitor->deviceKey;
+}
+
+void
+enterStandby(MonitorPower& power)
+{
+    if (power.state != PowerState::Standby) {
+        power.standbySince = GetTickCount64();
+    }
+    power.state = PowerState::Standby;
+}
+
+bool
+isParkableWrite(uint32_t command, const uint32_t args[4])
+{
+    switch (command) {
+        case ddcipc::CMD_SET_VCP:
+            // 0xD6 is how a sleeping monitor gets woken up.
+            return args[0] != kPowerModeVcp;
+        case ddcipc::CMD_SET_HIGH_LEVEL_BRIGHTNESS:
+        case ddcipc::CMD_SET_HIGH_LEVEL_CONTRAST:
+            return true;
+        default:
+            return false;
+    }
+}
+
+uint32_t
+parkedWriteKey(uint32_t command, const uint32_t args[4])
+{
+    return command == ddcipc::CMD_SET_VCP ? args[0] : 0x100 + command;
+}
+
+void
+replayParkedWrites(const std::string& target, MonitorPower& power)
+{
+    auto parked = std::move(power.parked);
+    power.parked.clear();
+    for (auto const& write : parked) {
+        DdcResult result =
+          dispatchDdcCommand(write.second.first, target, write.second.second.data());
+        replayedWriteCount++;
+        if (result.status != ddcipc::STATUS_OK) {
+            p("Replaying parked write failed for " + target + ". Code: "
+              + std::to_string(result.errorCode));
+        }
+    }
+}
+
+// Probes 0xD6 (at most once per kWakeProbeIntervalMs) and replays parked
+// writes if the monitor is on. Returns whether it is.
+bool
+wakeIfReady(const std::string& target, MonitorPower& power)
+{
+    if (!displaysOn) {
+        return false;
+    }
+
+    ULONGLONG now = GetTickCount64();
+    if (now - power.lastProbe < kWakeProbeIntervalMs) {
+        return false;
+    }
+    power.lastProbe = now;
+
+    uint32_t args[4] = { kPowerModeVcp, 0, 0, 0 };
+    DdcResult probe = dispatchDdcCommand(ddcipc::CMD_GET_VCP, target, args);
+
+    bool on = false;
+    if (probe.status == ddcipc::STATUS_OK) {
+        on = probe.values[0] == kPowerModeOn;
+    } else {
+        // A sleeping monitor can fail the probe outright rather than with a
+        // transient error, so a failure of either kind means it is still
+        // off until the wake timeout.
+        on = now - (std::max)(displaysOnSince, power.standbySince)
+             > kWakeTimeoutMs;
+    }
+
+    if (!on) {
+        enterStandby(power);
+        return false;
+    }
+    power.state = PowerState::On;
+    replayParkedWrites(target, power);
+    return true;
+}
+
+// `key` is a monitorPowerKey().
+bool
+shouldParkWrite(const std::string& key)
+{
+    if (!displaysOn) {
+        return true;
+    }
+    auto it = monitorPower.find(key);
+    if (it == monitorPower.end()) {
+        return false;
+    }
+    MonitorPower& power = it->second;
+    if (power.state != PowerState::Standby && power.parked.empty()) {
+        return false;
+    }
+    return !wakeIfReady(key, power);
+}
+
+// Learns power state from 0xD6 reads and writes made by the app itself.
+void
+observePowerState(uint32_t command,
+                  const std::string& target,
+                  const uint32_t args[4],
+                  const DdcResult& result)
+{
+    if (result.status != ddcipc::STATUS_OK || args[0] != kPowerModeVcp) {
+        return;
+    }
+
+    if (command == ddcipc::CMD_GET_VCP) {
+        const std::string key = monitorPowerKey(target);
+        MonitorPower& power = monitorPower[key];
+        if (result.values[0] != kPowerModeOn) {
+            enterStandby(power);
+        } else {
+            power.state = PowerState::On;
+            if (!power.parked.empty()) {
+                replayParkedWrites(key, power);
+            }
+        }
+    } else if (command == ddcipc::CMD_SET_VCP) {
+        // Writing 0xD6 either puts the monitor to sleep or starts waking it.
+        // A waking monitor takes a moment to accept commands, so keep
+        // parking until a probe confirms it is on.
+        MonitorPower& power = monitorPower[monitorPowerKey(target)];
+        enterStandby(power);
+        power.lastProbe = GetTickCount64();
+    }
+}
+
+// Command queue
+//
+// The async exports hand their commands to one thread, which runs them in
+// order. A command that comes in while a scheduled refresh is probing waits
+// for it on that thread instead of failing, and the JS thread never waits on
+// a monitor. Like the refresh, the queue only holds ddcMutex for
+// bookkeeping; the hardware call itself goes through withHardware().
+
+// `run` executes on the queue thread with ddcMutex held. `convert` turns its
+// result into the callback's value on the JS thread, and throws a Napi::Error
+// to fail the callback instead. Work queued by the addon itself has no
+// callback.
+struct QueuedCommand {
+    std::function<DdcResult()> run;
+    std::function<Napi::Value(Napi::Env, const DdcResult&)> convert;
+    Napi::ThreadSafeFunction callback;
+    bool hasCallback = false;
+    DdcResult result;
+};
+
+class DdcCommandQueue
+{
+  public:
+    void push(std::shared_ptr<QueuedCommand> command)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(command));
+        if (!thread.joinable()) {
+            stopping = false;
+            exited = false;
+            thread = std::thread(&DdcCommandQueue::run, this);
+        }
+        wake.notify_one();
+    }
+
+    // Waits up to kBackgroundStopTimeoutMs for the command that is running.
+    // A thread stuck on a hung monitor is left behind and drops its result.
+    void stop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+        wake.notify_one();
+        if (thread.joinable()) {
+            if (finished.wait_for(
+                  lock,
+                  std::chrono::milliseconds(kBackgroundStopTimeoutMs),
+                  [this]() { return exited; })) {
+                lock.unlock();
+                thread.join();
+                lock.lock();
+            } else {
+                thread.detach();
+            }
+        }
+        for (auto& command : queue) {
+            if (command->hasCallback) {
+                command->callback.Release();
+            }
+        }
+        queue.clear();
+    }
+
+    ~DdcCommandQueue()
+    {
+        // As for the refresh scheduler, stop() runs from the env cleanup
+        // hook; joining here could wait on a hung monitor.
+        if (thread.joinable()) {
+            thread.detach();
+        }
+    }
+
+  private:
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::thread thread;
+    bool stopping = false;
+    bool exited = false;
+    std::deque<std::shared_ptr<QueuedCommand>> queue;
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            if (queue.empty()) {
+                wake.wait(lock);
+                continue;
+            }
+            std::shared_ptr<QueuedCommand> command = queue.front();
+            queue.pop_front();
+            lock.unlock();
+
+            {
+                std::unique_lock<std::recursive_mutex> ddcLock(ddcMutex);
+                waitForHardwareIdle(ddcLock);
+                BackgroundWorkScope background(ddcLock);
+                try {
+                    command->result = command->run();
+                } catch (...) {
+                    command->result.status = ddcipc::STATUS_FAILED;
+                    command->result.errorCode = ERROR_GEN_FAILURE;
+                }
+            }
+
+            lock.lock();
+            if (stopping) {
+                break;
+            }
+            if (command->hasCallback) {
+                command->callback.BlockingCall(
+                  new std::shared_ptr<QueuedCommand>(command), deliver);
+                command->callback.Release();
+            }
+        }
+        exited = true;
+        finished.notify_all();
+    }
+
+    static void deliver(Napi::Env env,
+                        Napi::Function callback,
+                        std::shared_ptr<QueuedCommand>* command)
+    {
+        Napi::Value value;
+        Napi::Value error = env.Null();
+        try {
+            value = (*command)->convert(env, (*command)->result);
+        } catch (const Napi::Error& e) {
+            error = e.Value();
+        }
+        delete command;
+
+        if (error.IsNull()) {
+            callback.Call({ env.Null(), value });
+        } else {
+            callback.Call({ error });
+        }
+    }
+};
+
+DdcCommandQueue commandQueue;
+
+void
+queueInternalCommand(std::function<DdcResult()> run)
+{
+    auto command = std::make_shared<QueuedCommand>();
+    command->run = std::move(run);
+    commandQueue.push(command);
+}
+
+// Writes made while the hardware is busy, latest per code.
+std::map<std::string,
+         std::map<uint32_t, std::pair<uint32_t, std::array<uint32_t, 4>>>>
+  heldWrites;
+// Set when clearDisplayCache() or setLogLevel() came in while it was busy.
+bool clearCacheWhenIdle = false;
+bool sendLogLevelWhenIdle = false;
+
+bool
+isHeldWhileBusy(uint32_t command)
+{
+    return command == ddcipc::CMD_SET_VCP
+           || command == ddcipc::CMD_SET_HIGH_LEVEL_BRIGHTNESS
+           || command == ddcipc::CMD_SET_HIGH_LEVEL_CONTRAST;
+}
+
+DdcResult
+executeDdcCommand(uint32_t command,
+                  const std::string& target,
+                  uint32_t arg0 = 0,
+                  uint32_t arg1 = 0)
+{
+    uint32_t args[4] = { arg0, arg1, 0, 0 };
+
+    if (hardwareBusy) {
+        DdcResult result;
+        if (isHeldWhileBusy(command)) {
+            heldWrites[target][parkedWriteKey(command, args)] = {
+                command, { args[0], args[1], args[2], args[3] }
+            };
+            d("Held write for " + target + " until the hardware is free");
+            result.parked = true;
+        } else {
+            result.status = ddcipc::STATUS_FAILED;
+            result.errorCode = ERROR_BUSY;
+        }
+        return result;
+    }
+
+    const std::string powerKey = monitorPowerKey(target);
+    if (isParkableWrite(command, args) && shouldParkWrite(powerKey)) {
+        MonitorPower& power = monitorPower[powerKey];
+        power.parked[parkedWriteKey(command, args)] = {
+            command, { args[0], args[1], args[2], args[3] }
+        };
+        parkedWriteCount++;
+        d("Parked write for sleeping monitor " + powerKey);
+
+        DdcResult result;
+        result.parked = true;
+        return result;
+    }
+
+    DdcResult result = dispatchDdcCommand(command, target, args);
+    observePowerState(command, target, args, result);
+    return result;
+}
+
+void
+clearDisplayCaches()
+{
+    if (ddcWorker.enabled && ddcWorker.running()) {
+        uint32_t args[4] = { 0, 0, 0, 0 };
+        withHardware([&]() {
+            return ddcWorker.call(ddcipc::CMD_CLEAR_DISPLAY_CACHE, "", args);
+        });
+    }
+    if (!physicalMonitorHandles.empty()) {
+        physicalMonitorHandles.clear();
+    }
+    if (!capabilities.empty()) {
+        capabilities.clear();
+    }
+    capabilitiesLengths.clear();
+    capabilitiesTimings.clear();
+}
+
+void
+sendLogLevelToWorker()
+{
+    // A worker started later picks the level up when it is spawned.
+    if (ddcWorker.enabled && ddcWorker.running()) {
+        uint32_t args[4] = { static_cast<uint32_t>(logLevel), 0, 0, 0 };
+        withHardware([&]() {
+            return ddcWorker.call(ddcipc::CMD_SET_LOG_LEVEL, "", args);
+        });
+    }
+}
+
+// Called with ddcMutex held before a background thread lets go of it for a
+// hardware call.
+void
+beginBackgroundWork()
+{
+    monitorsBeforeWork = serializeMonitors();
+    hardwareBusy = true;
+}
+
+// Called with ddcMutex held once the hardware call has returned. What came in
+// meanwhile goes on the command queue, behind the commands already there.
+void
+endBackgroundWork()
+{
+    hardwareBusy = false;
+    monitorsBeforeWork.clear();
+
+    if (clearCacheWhenIdle) {
+        clearCacheWhenIdle = false;
+        queueInternalCommand([]() {
+            clearDisplayCaches();
+            return DdcResult();
+        });
+    }
+    if (sendLogLevelWhenIdle) {
+        sendLogLevelWhenIdle = false;
+        queueInternalCommand([]() {
+            sendLogLevelToWorker();
+            return DdcResult();
+        });
+    }
+
+    auto held = std::move(heldWrites);
+    heldWrites.clear();
+    for (auto const& monitor : held) {
+        for (auto const& write : monitor.second) {
+            const std::string target = monitor.first;
+            const uint32_t command = write.second.first;
+            const std::array<uint32_t, 4> args = write.second.second;
+            queueInternalCommand([target, command, args]() {
+                DdcResult result =
+                  executeDdcCommand(command, target, args[0], args[1]);
+                if (result.status != ddcipc::STATUS_OK) {
+                    p("Held write failed for " + target + ". Code: "
+                      + std::to_string(result.errorCode));
+                }
+                return result;
+            });
+        }
+    }
+
+    hardwareIdle.notify_all();
+}
+
+// Builds the JS error for a failed command. `message` is used for hardware
+// failures; a lost worker is flagged so callers can tell a driver crash
+// apart from a monitor that simply didn't respond.
+Napi::Error
+makeDdcResultError(Napi::Env env,
+                   const DdcResult& result,
+                   const std::string& message)
+{
+    if (result.status == ddcipc::STATUS_NOT_FOUND) {
+        return Napi::Error::New(env, "Monitor not found");
+    }
+    if (result.status == ddcipc::STATUS_WORKER_LOST) {
+        Napi::Error error =
+          Napi::Error::New(env, "DDC/CI worker process exited unexpectedly");
+        error.Set("win32Code",
+                  Napi::Number::New(env, static_cast<double>(result.errorCode)));
+        error.Set("workerCrashed", Napi::Boolean::New(env, true));
+        return error;
+    }
+    return makeDdcCiError(env, message, result.errorCode);
+}
+
+void
+throwDdcResultError(Napi::Env env,
+                    const DdcResult& result,
+                    const std::string& message)
+{
+    throw makeDdcResultError(env, result, message);
+}
+
+// Runs a command export. When `info[callbackIndex]` is a function, the
+// command goes on the command queue and the callback gets `(err, value)`
+// once it has run; otherwise it runs now on the JS thread. `convert` builds
+// the value from the result and throws a Napi::Error for a failure.
+Napi::Value
+runOrQueueCommand(
+  const Napi::CallbackInfo& info,
+  size_t callbackIndex,
+  std::function<DdcResult()> run,
+  std::function<Napi::Value(Napi::Env, const DdcResult&)> convert)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() > callbackIndex && info[callbackIndex].IsFunction()) {
+        auto command = std::make_shared<QueuedCommand>();
+        command->run = std::move(run);
+        command->convert = std::move(convert);
+        command->callback =
+          Napi::ThreadSafeFunction::New(env,
+                                        info[callbackIndex].As<Napi::Function>(),
+                                        "node-ddcci command",
+                                        0,
+                                        1);
+        command->hasCallback = true;
+        commandQueue.push(command);
+        return env.Undefined();
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(ddcMutex);
+    return convert(env, run());
+}
+
+Napi::Array
+monitorsToArray(Napi::Env env,
+                const std::map<std::string, PhysicalMonitor>& monitorMap)
+{
+    Napi::Array monitors = Napi::Array::New(env);
+
+    int i = 0;
+    for (auto const& handle : monitorMap) {
+        Napi::Object monitor = Napi::Object::New(env);
+        monitor.Set("ddcciSupported",
+                    Napi::Boolean::New(env, handle.second.ddcciSupported));
+        monitor.Set("hlBrightnessSupported",
+                    Napi::Boolean::New(env, handle.second.hlCapabilities.brightnessOK));
+        monitor.Set("hlContrastSupported",
+                    Napi::Boolean::New(env, handle.second.hlCapabilities.contrastOK));
+        monitor.Set("handleIsValid",
+                    Napi::Boolean::New(env, handle.second.handleIsValid));
+        monitor.Set("name", Napi::String::New(env, handle.second.name));
+        monitor.Set("fullName", Napi::String::New(env, handle.second.fullName));
+        monitor.Set("physicalName", Napi::String::New(env, handle.second.physicalName));
+        monitor.Set("result", Napi::String::New(env, handle.second.result));
+        monitor.Set("deviceKey",
+                    Napi::String::New(env, handle.second.deviceKey));
+        monitor.Set("deviceID", Napi::String::New(env, handle.second.deviceID));
+
+        monitors.Set(i++, monitor);
+    }
+
+    return monitors;
+}
+
+// Refresh scheduler
+//
+// Docking a laptop fires several topology changes within a second, and a
+// refresh run while the topology is still settling creates and destroys
+// physical handles for nothing. scheduleRefresh() bumps the refresh
+// generation and restarts a settle timer instead. Once no request has come in
+// for the settle window, the scheduler thread runs one refresh for the newest
+// generation. A request that arrives while that refresh is probing cancels
+// it (see throwIfRefreshSuperseded()), and the refresh starts over once the
+// topology settles again. Callers get the generation their results belong to.
+
+const DWORD kDefaultRefreshSettleMs = 500;
+const DWORD kMaxRefreshSettleMs = 10000;
+
+struct RefreshOutcome {
+    LONG generation = 0;
+    LONG latestGeneration = 0;
+    DdcResult result;
+};
+
+class RefreshScheduler
+{
+  public:
+    // Bumps the generation and returns it. `callback` is called with the
+    // first refresh that completes for this generation or a newer one.
+    LONG schedule(const RefreshRequest& request,
+                  DWORD settleMs,
+                  Napi::ThreadSafeFunction callback)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // The previous request hasn't been served yet and now never will be
+        // on its own.
+        if (requestedGeneration > completedGeneration) {
+            coalescedCount++;
+        }
+        LONG generation = InterlockedIncrement(&localRefreshGeneration);
+        ddcWorker.publishRefreshGeneration(generation);
+
+        requestedGeneration = generation;
+        pending = request;
+        settleDeadline = GetTickCount64() + settleMs;
+        waiters.push_back({ generation, callback });
+
+        if (!thread.joinable()) {
+            stopping = false;
+            exited = false;
+            thread = std::thread(&RefreshScheduler::run, this);
+        }
+        wake.notify_one();
+        return generation;
+    }
+
+    // Waits up to kBackgroundStopTimeoutMs for the refresh to give up. A
+    // thread stuck on a hung monitor is left behind and drops its result.
+    void stop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+        // Let an in-flight refresh give up at its next probe.
+        LONG generation = InterlockedIncrement(&localRefreshGeneration);
+        ddcWorker.publishRefreshGeneration(generation);
+        wake.notify_one();
+        if (thread.joinable()) {
+            if (finished.wait_for(
+                  lock,
+                  std::chrono::milliseconds(kBackgroundStopTimeoutMs),
+                  [this]() { return exited; })) {
+                lock.unlock();
+                thread.join();
+                lock.lock();
+            } else {
+                thread.detach();
+            }
+        }
+        for (auto& waiter : waiters) {
+            waiter.callback.Release();
+        }
+        waiters.clear();
+    }
+
+    LONG requested()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return requestedGeneration;
+    }
+
+    LONG completed()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return completedGeneration;
+    }
+
+    uint32_t coalesced()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return coalescedCount;
+    }
+
+    uint32_t superseded()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return supersededCount;
+    }
+
+    ~RefreshScheduler()
+    {
+        // stop() runs from the env cleanup hook. If that never happened, the
+        // process is exiting and joining could wait on a hung probe.
+        if (thread.joinable()) {
+            thread.detach();
+        }
+    }
+
+  private:
+    struct Waiter {
+        LONG generation;
+        Napi::ThreadSafeFunction callback;
+    };
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::thread thread;
+    bool stopping = false;
+    bool exited = false;
+    RefreshRequest pending;
+    ULONGLONG settleDeadline = 0;
+    LONG requestedGeneration = 0;
+    LONG completedGeneration = 0;
+    uint32_t coalescedCount = 0;
+    uint32_t supersededCount = 0;
+    std::vector<Waiter> waiters;
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            if (requestedGeneration <= completedGeneration) {
+                wake.wait(lock);
+                continue;
+            }
+            ULONGLONG now = GetTickCount64();
+            if (now < settleDeadline) {
+                wake.wait_for(
+                  lock, std::chrono::milliseconds(settleDeadline - now));
+                continue;
+            }
+
+            const LONG generation = requestedGeneration;
+            const RefreshRequest request = pending;
+            lock.unlock();
+
+            RefreshOutcome outcome;
+            outcome.generation = generation;
+            outcome.result = runRefresh(request, generation);
+
+            lock.lock();
+            if (stopping) {
+                break;
+            }
+            if (outcome.result.status == ddcipc::STATUS_SUPERSEDED) {
+                supersededCount++;
+                continue;
+            }
+            completedGeneration = generation;
+            outcome.latestGeneration = requestedGeneration;
+
+            auto waiter = waiters.begin();
+            while (waiter != waiters.end()) {
+                if (waiter->generation > generation) {
+                    ++waiter;
+                    continue;
+                }
+                waiter->callback.BlockingCall(
+                  new RefreshOutcome(outcome),
+                  [](Napi::Env env,
+                     Napi::Function callback,
+                     RefreshOutcome* outcome) {
+                      deliverRefreshOutcome(env, callback, *outcome);
+                      delete outcome;
+                  });
+                waiter->callback.Release();
+                waiter = waiters.erase(waiter);
+            }
+        }
+        exited = true;
+        finished.notify_all();
+    }
+
+    // The probe runs without ddcMutex, so the exports keep answering on the
+    // JS thread while it does (see hardwareBusy). The lock is only held to
+    // hand over and to take the results back. Commands queued before the
+    // refresh started go first.
+    static DdcResult runRefresh(const RefreshRequest& request,
+                                LONG generation)
+    {
+        std::unique_lock<std::recursive_mutex> ddcLock(ddcMutex);
+        waitForHardwareIdle(ddcLock);
+        BackgroundWorkScope background(ddcLock);
+
+        // Replayed by a respawned worker, but never as a cancellable
+        // refresh.
+        lastRefresh = request;
+        lastRefresh.valid = true;
+
+        uint32_t args[4] = { request.args[0],
+                             request.args[1],
+                             static_cast<uint32_t>(generation),
+                             0 };
+        DdcResult listed;
+        DdcResult result = withHardware([&]() {
+            DdcResult refreshed =
+              dispatchDdcCommand(ddcipc::CMD_REFRESH, request.method, args);
+            if (refreshed.status == ddcipc::STATUS_OK && ddcWorker.enabled) {
+                listed = fetchWorkerMonitors();
+            }
+            return refreshed;
+        });
+
+        if (result.status == ddcipc::STATUS_OK) {
+            if (ddcWorker.enabled) {
+                applyWorkerMonitors(listed);
+            }
+            result.text = serializeMonitors();
+        }
+        return result;
+    }
+
+    static void deliverRefreshOutcome(Napi::Env env,
+                                      Napi::Function callback,
+                                      const RefreshOutcome& outcome)
+    {
+        if (outcome.result.status != ddcipc::STATUS_OK) {
+            Napi::Error error =
+              outcome.result.status == ddcipc::STATUS_WORKER_LOST
+                ? makeDdcResultError(env, outcome.result, "")
+                : Napi::Error::New(env, "Error refreshing DDC/CI displays!");
+            error.Set("generation",
+                      Napi::Number::New(env, outcome.generation));
+            callback.Call({ error.Value() });
+            return;
+        }
+
+        std::map<std::string, HANDLE> handleKeys;
+        std::map<std::string, PhysicalMonitor> monitors;
+        parseMonitorSnapshot(outcome.result.text, handleKeys, monitors);
+
+        Napi::Object ret = Napi::Object::New(env);
+        ret.Set("generation", Napi::Number::New(env, outcome.generation));
+        ret.Set("latestGeneration",
+                Napi::Number::New(env, outcome.latestGeneration));
+        ret.Set("monitors", monitorsToArray(env, monitors));
+        callback.Call({ env.Null(), ret });
+    }
+};
+
+RefreshScheduler refreshScheduler;
+
+// refresh(method, usePreviousResults, checkHighLevel[, callback]). Without a
+// callback it refreshes now and returns true, or returns false without
+// refreshing while the hardware is busy. With one, the refresh is queued
+// and the callback gets true once it has run.
+Napi::Value
+refresh(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3) {
+        throw Napi::TypeError::New(env, "Not enough arguments");
+    }
+    if (!info[0].IsString() || !info[1].IsBoolean() || !info[2].IsBoolean()) {
+        throw Napi::TypeError::New(env, "Invalid arguments");
+    }
+
+    RefreshRequest request;
+    request.valid = true;
+    request.method = info[0].As<Napi::String>().Utf8Value();
+    request.args[0] = info[1].As<Napi::Boolean>().ToBoolean() ? 1 : 0;
+    request.args[1] = info[2].As<Napi::Boolean>().ToBoolean() ? 1 : 0;
+
+    std::lock_guard<std::recursive_mutex> lock(ddcMutex);
+    if (hardwareBusy && !(info.Length() > 3 && info[3].IsFunction())) {
+        return Napi::Boolean::New(env, false);
+    }
+
+    return runOrQueueCommand(
+      info,
+      3,
+      [request]() {
+          lastRefresh = request;
+          DdcResult result = executeDdcCommand(ddcipc::CMD_REFRESH,
+                                               request.method,
+                                               request.args[0],
+                                               request.args[1]);
+          if (result.status == ddcipc::STATUS_OK && ddcWorker.enabled) {
+              mirrorWorkerMonitors();
+          }
+          return result;
+      },
+      [](Napi::Env env, const DdcResult& result) -> Napi::Value {
+          if (result.status == ddcipc::STATUS_WORKER_LOST) {
+              throwDdcResultError(env, result, "");
+          }
+          if (result.status != ddcipc::STATUS_OK) {
+              throw Napi::Error::New(env, "Error refreshing DDC/CI displays!");
+          }
+          return Napi::Boolean::New(env, true);
+      });
+}
+
+// scheduleRefresh(method, usePreviousResults, checkHighLevel, settleMs,
+// callback). Returns the generation of this request. `callback(err, result)`
+// gets { generation, latestGeneration, monitors } from the first refresh
+// that covers it; when `generation` is behind `latestGeneration`, a newer
+// refresh is already on its way.
+Napi::Value
+scheduleRefresh(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 5) {
+        throw Napi::TypeError::New(env, "Not enough arguments");
+    }
+    if (!info[0].IsString() || !info[1].IsBoolean() || !info[2].IsBoolean()
+        || !info[3].IsNumber() || !info[4].IsFunction()) {
+        throw Napi::TypeError::New(env, "Invalid arguments");
+    }
+
+    RefreshRequest request;
+    request.valid = true;
+    request.method = info[0].As<Napi::String>().Utf8Value();
+    request.args[0] = info[1].As<Napi::Boolean>().Value() ? 1 : 0;
+    request.args[1] = info[2].As<Napi::Boolean>().Value() ? 1 : 0;
+
+    double settleMs = info[3].As<Napi::Number>().DoubleValue();
+    if (!(settleMs >= 0)) {
+        settleMs = kDefaultRefreshSettleMs;
+    }
+    settleMs = (std::min)(settleMs, static_cast<double>(kMaxRefreshSettleMs));
+
+    Napi::ThreadSafeFunction callback = Napi::ThreadSafeFunction::New(
+      env, info[4].As<Napi::Function>(), "node-ddcci refresh", 0, 1);
+
+    LONG generation = refreshScheduler.schedule(
+      request, static_cast<DWORD>(settleMs), callback);
+    return Napi::Number::New(env, generation);
+}
+
+Napi::Value
+getRefreshStatus(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    Napi::Object status = Napi::Object::New(env);
+    status.Set("requested", Napi::Number::New(env, refreshScheduler.requested()));
+    status.Set("completed", Napi::Number::New(env, refreshScheduler.completed()));
+    status.Set("coalesced", Napi::Number::New(env, refreshScheduler.coalesced()));
+    status.Set("superseded",
+               Napi::Number::New(env, refreshScheduler.superseded()));
+    return status;
+}
+
+void
+clearDisplayCache(const Napi::CallbackInfo& info)
+{
+    std::lock_guard<std::recursive_mutex> lock(ddcMutex);
+    if (hardwareBusy) {
+        clearCacheWhenIdle = true;
+        return;
+    }
+    clearDisplayCaches();
+}
+
+// getCapabilitiesString(monitorId[, callback])
+Napi::Value
+getNAPICapabilitiesString(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(env, "Not enough arguments");
+    }
+    if (!info[0].IsString()) {
+        throw Napi::TypeError::New(env, "Invalid arguments");
+    }
+
+    std::string monitorName = info[0].As<Napi::String>().Utf8Value();
+    return runOrQueueCommand(
+      info,
+      1,
+      [monitorName]() {
+          DdcResult result =
+            executeDdcCommand(ddcipc::CMD_GET_CAPABILITIES, monitorName);
+          // Keep the mirrored maps in step with the worker's caches.
+          if (result.status == ddcipc::STATUS_OK && ddcWorker.enabled) {
+              PhysicalMonitor* physicalMonitor =
+                findPhysicalMonitor(monitorName);
+              applyCapabilitiesResult(physicalMonitor, result.text);
+              if (physicalMonitor == nullptr) {
+                  capabilities[monitorName] = result.text;
+              }
+          }
+          return result;
+      },
+      [](Napi::Env env, const DdcResult& result) -> Napi::Value {
+          if (result.status == ddcipc::STATUS_FAILED
+              && result.errorCode != ERROR_BUSY) {
+              throw Napi::Error::New(
+                env, "Monitor not responding."); // Does not respond to DDC/CI
+          }
+          if (result.status != ddcipc::STATUS_OK) {
+              throwDdcResultError(env, result, "");
+          }
+          return Napi::String::New(env, result.text);
+      });
+}
+
+// Returns how the last capabilities fetch for a monitor went: whether the
+// length came from cache, and the duration and outcome of each attempt.
+Napi::Value
+getCapabilitiesTiming(const Napi::CallbackInfo& info)
+{
+    std::lock_guard<std::recursive_mutex> lock(ddcMutex);
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(env, "Not enough arguments");
+    }
+    if (!info[0].IsString()) {
+        throw Napi::TypeError::New(env, "Invalid arguments");
+    }
+
+    std::string monitorName = info[0].As<Napi::String>().Utf8Value();
+    DdcResult result =
+      executeDdcCommand(ddcipc::CMD_GET_CAPABILITIES_TIMING, monitorName);
+    if (result.status == ddcipc::STATUS_NOT_FOUND) {
+        return env.Null();
+    }
+    if (result.status != ddcipc::STATUS_OK) {
+        throwDdcResultError(env, result, "");
+    }
+
+    std::vector<std::vector<std::string>> records;
+    std::istringstream recordStream(result.text);
+    std::string record;
+    while (std::getline(recordStream, record, ddcipc::kRecordSeparator)) {
+        std::vector<std::string> fields;
+        std::istringstream fieldStream(record);
+        std::string field;
+        while (std::getline(fieldStream, field, ddcipc::kFieldSeparator)) {
+            fields.push_back(field);
+        }
+        records.push_back(fields);
+    }
+    if (records.empty() || records[0].size() < 3) {
+        return env.Null();
+    }
+
+    Napi::Object timing = Napi::Object::New(env);
+    timing.Set("lengthCached", Napi::Boolean::New(env, records[0][0] == "1"));
+    timing.Set("length",
+               Napi::Number::New(env, std::stod(records[0][1])));
+    timing.Set("totalMs", Napi::Number::New(env, std::stod(records[0][2])));
+
+    Napi::Array attempts = Napi::Array::New(env);
+    uint32_t count = 0;
+    for (size_t i = 1; i < records.size(); i++) {
+        if (records[i].size() < 4) {
+            continue;
+        }
+        Napi::Object attempt = Napi::Object::New(env);
+        attempt.Set("phase", Napi::String::New(env, records[i][0]));
+        attempt.Set("ms", Napi::Number::New(env, std::stod(records[i][1])));
+        attempt.Set("ok", Napi::Boolean::New(env, records[i][2] == "1"));
+        attempt.Set("win32Code",
+                    Napi::Number::New(env, std::stod(records[i][3])));
+        attempts.Set(count++, attempt);
+    }
+    timing.Set("attempts", attempts);
+
+    return timing;
+}
+
+
+Napi::Array
+getMonitorList(const Napi::CallbackInfo& info)
+{
+    std::lock_guard<std::recursive_mutex> lock(ddcMutex);
     Napi::Env env = info.Env();
 
-    if (info.Length() < 2) {
+    std::map<std::string, HANDLE> snapshotHandles;
+    std::map<std::string, PhysicalMonitor> snapshotMonitors;
+    if (hardwareBusy) {
+        parseMonitorSnapshot(monitorsBeforeWork, snapshotHandles, snapshotMonitors);
+    }
+    const std::map<std::string, HANDLE>& monitorHandles =
+      hardwareBusy ? snapshotHandles : handles;
+
+    Napi::Array ret = Napi::Array::New(env, monitorHandles.size());
+
+    int i = 0;
+    for (auto const& handle : monitorHandles) {
+        ret.Set(i++, handle.first);
+    }
+
+    return ret;
+}
+
+Napi::Array
+getAllMonitors(const Napi::CallbackInfo& info)
+{
+    std::lock_guard<std::recursive_mutex> lock(ddcMutex);
+    if (hardwareBusy) {
+        std::map<std::string, HANDLE> snapshotHandles;
+        std::map<std::string, PhysicalMonitor> snapshotMonitors;
+        parseMonitorSnapshot(monitorsBeforeWork, snapshotHandles, snapshotMonitors);
+        return monitorsToArray(info.Env(), snapshotMonitors);
+    }
+    return monitorsToArray(info.Env(), physicalMonitorHandles);
+}
+
+
+// setVCP(monitorId, code, value[, callback])
+Napi::Value
+setVCP(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3) {
         throw Napi::TypeError::New(env, "Not enough arguments");
     }
-    if (!info[0].IsString() || !info[1].IsNumber()) {
+    if (!info[0].IsString() || !info[1].IsNumber() || !info[2].IsNumber()) {
         throw Napi::TypeError::New(env, "Invalid arguments");
     }
 
     std::string monitorName = info[0].As<Napi::String>().Utf8Value();
+    BYTE vcpCode = static_cast<BYTE>(info[1].As<Napi::Number>().Int32Value());
     DWORD newValue =
-      static_cast<DWORD>(info[1].As<Napi::Number>().Int32Value());
+      static_cast<DWORD>(info[2].As<Napi::Number>().Int32Value());
 
-    auto it = handles.find(monitorName);
-    if (it == handles.end()) {
-        throw Napi::Error::New(env, "Monitor not found");
-    }
+    return runOrQueueCommand(
+      info,
+      3,
+      [monitorName, vcpCode, newValue]() {
+          return executeDdcCommand(
+            ddcipc::CMD_SET_VCP, monitorName, vcpCode, newValue);
+      },
+      [](Napi::Env env, const DdcResult& result) -> Napi::Value {
+          if (result.status != ddcipc::STATUS_OK) {
+              throwDdcResultError(env, result, "Failed to set VCP code value");
+          }
+          return env.Undefined();
+      });
+}
 
-    DWORD errorCode = ERROR_SUCCESS;
-    BOOL ok = tryDdcCiOperation(
-      [&]() { return SetMonitorBrightness(it->second, newValue); }, errorCode);
-    if (!ok) {
-        throwDdcCiError(env, "Failed to set high level brightness", errorCode);
+// getVCP(monitorId, code[, callback])
+Napi::Value
+getVCP(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2) {
+        throw Napi::TypeError::New(env, "Not enough arguments");
+    }
+    if (!info[0].IsString() || !info[1].IsNumber()) {
+        throw Napi::TypeError::New(env, "Invalid arguments");
     }
 
-    return env.Undefined();
+    std::string monitorName = info[0].As<Napi::String>().Utf8Value();
+    BYTE vcpCode = static_cast<BYTE>(info[1].As<Napi::Number>().Int32Value());
+
+    return runOrQueueCommand(
+      info,
+      2,
+      [monitorName, vcpCode]() {
+          return executeDdcCommand(ddcipc::CMD_GET_VCP, monitorName, vcpCode);
+      },
+      [](Napi::Env env, const DdcResult& result) -> Napi::Value {
+          if (result.status != ddcipc::STATUS_OK) {
+              throwDdcResultError(env, result, "Failed to get VCP code value");
+          }
+
+          Napi::Array ret = Napi::Array::New(env, 2);
+          ret.Set((uint32_t)0, static_cast<double>(result.values[0]));
+          ret.Set((uint32_t)1, static_cast<double>(result.values[1]));
+          return ret;
+      });
 }
 
+// saveCurrentSettings(monitorId[, callback])
 Napi::Value
-getHighLevelContrast(const Napi::CallbackInfo& info)
+saveCurrentSettings(const Napi::CallbackInfo& info)
 {
     Napi::Env env = info.Env();
 
@@ -1363,35 +3134,63 @@ getHighLevelContrast(const Napi::CallbackInfo& info)
 
     std::string monitorName = info[0].As<Napi::String>().Utf8Value();
 
-    auto it = handles.find(monitorName);
-    if (it == handles.end()) {
-        throw Napi::Error::New(env, "Monitor not found");
-    }
-
-    DWORD minValue;
-    DWORD currentValue;
-    DWORD maxValue;
-    DWORD errorCode = ERROR_SUCCESS;
-    BOOL ok = tryDdcCiOperation(
-      [&]() {
-          return GetMonitorContrast(
-            it->second, &minValue, &currentValue, &maxValue);
+    return runOrQueueCommand(
+      info,
+      1,
+      [monitorName]() {
+          return executeDdcCommand(ddcipc::CMD_SAVE_CURRENT_SETTINGS,
+                                   monitorName);
       },
-      errorCode);
-    if (!ok) {
-        throwDdcCiError(env, "Failed to get high level contrast", errorCode);
+      [](Napi::Env env, const DdcResult& result) -> Napi::Value {
+          if (result.status != ddcipc::STATUS_OK) {
+              throwDdcResultError(
+                env, result, "Failed to save current settings");
+          }
+          return Napi::Boolean::New(env, result.values[0] != 0);
+      });
+}
+
+// Shared by the high-level brightness/contrast getters, which return
+// [current, max, min].
+Napi::Value
+getHighLevelValue(const Napi::CallbackInfo& info,
+                  uint32_t command,
+                  const std::string& errorMessage)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(env, "Not enough arguments");
+    }
+    if (!info[0].IsString()) {
+        throw Napi::TypeError::New(env, "Invalid arguments");
     }
 
-    Napi::Array ret = Napi::Array::New(env, 3);
-    ret.Set((uint32_t)0, static_cast<double>(currentValue));
-    ret.Set((uint32_t)1, static_cast<double>(maxValue));
-    ret.Set((uint32_t)2, static_cast<double>(minValue));
+    std::string monitorName = info[0].As<Napi::String>().Utf8Value();
 
-    return ret;
+    return runOrQueueCommand(
+      info,
+      1,
+      [command, monitorName]() {
+          return executeDdcCommand(command, monitorName);
+      },
+      [errorMessage](Napi::Env env, const DdcResult& result) -> Napi::Value {
+          if (result.status != ddcipc::STATUS_OK) {
+              throwDdcResultError(env, result, errorMessage);
+          }
+
+          Napi::Array ret = Napi::Array::New(env, 3);
+          ret.Set((uint32_t)0, static_cast<double>(result.values[0]));
+          ret.Set((uint32_t)1, static_cast<double>(result.values[1]));
+          ret.Set((uint32_t)2, static_cast<double>(result.values[2]));
+          return ret;
+      });
 }
 
 Napi::Value
-setHighLevelContrast(const Napi::CallbackInfo& info)
+setHighLevelValue(const Napi::CallbackInfo& info,
+                  uint32_t command,
+                  const std::string& errorMessage)
 {
     Napi::Env env = info.Env();
 
@@ -1406,23 +3205,55 @@ setHighLevelContrast(const Napi::CallbackInfo& info)
     DWORD newValue =
       static_cast<DWORD>(info[1].As<Napi::Number>().Int32Value());
 
-    auto it = handles.find(monitorName);
-    if (it == handles.end()) {
-        throw Napi::Error::New(env, "Monitor not found");
-    }
+    return runOrQueueCommand(
+      info,
+      2,
+      [command, monitorName, newValue]() {
+          return executeDdcCommand(command, monitorName, newValue);
+      },
+      [errorMessage](Napi::Env env, const DdcResult& result) -> Napi::Value {
+          if (result.status != ddcipc::STATUS_OK) {
+              throwDdcResultError(env, result, errorMessage);
+          }
+          return env.Undefined();
+      });
+}
 
-    DWORD errorCode = ERROR_SUCCESS;
-    BOOL ok = tryDdcCiOperation(
-      [&]() { return SetMonitorContrast(it->second, newValue); }, errorCode);
-    if (!ok) {
-        throwDdcCiError(env, "Failed to set high level contrast", errorCode);
-    }
+Napi::Value
+getHighLevelBrightness(const Napi::CallbackInfo& info)
+{
+    return getHighLevelValue(info,
+                             ddcipc::CMD_GET_HIGH_LEVEL_BRIGHTNESS,
+                             "Failed to get high level brightness");
+}
+
+Napi::Value
+setHighLevelBrightness(const Napi::CallbackInfo& info)
+{
+    return setHighLevelValue(info,
+                             ddcipc::CMD_SET_HIGH_LEVEL_BRIGHTNESS,
+                             "Failed to set high level brightness");
+}
+
+Napi::Value
+getHighLevelContrast(const Napi::CallbackInfo& info)
+{
+    return getHighLevelValue(info,
+                             ddcipc::CMD_GET_HIGH_LEVEL_CONTRAST,
+                             "Failed to get high level contrast");
+}
 
-    return env.Undefined();
+Napi::Value
+setHighLevelContrast(const Napi::CallbackInfo& info)
+{
+    return setHighLevelValue(info,
+                             ddcipc::CMD_SET_HIGH_LEVEL_CONTRAST,
+                             "Failed to set high level contrast");
 }
 
 void
 setLogLevel(const Napi::CallbackInfo& info) {
+    std::lock_guard<std::recursive_mutex> lock(ddcMutex);
     Napi::Env env = info.Env();
 
     if (info.Length() < 1) {
@@ -1433,126 +3264,641 @@ setLogLevel(const Napi::CallbackInfo& info) {
     }
 
     logLevel = (int)info[0].ToNumber();
+
+    if (hardwareBusy) {
+        sendLogLevelWhenIdle = true;
+        return;
+    }
+    sendLogLevelToWorker();
 }
 
-Napi::Array
-getMonitorInputs(const Napi::CallbackInfo& info)
+// Moves DDC/CI access into ddcci_worker.exe, or back into this process.
+// Returns whether worker mode is active afterwards; if the worker can't be
+// started, the addon keeps working in-process.
+// setWorkerMode(enable[, callback]). Without a callback it throws an
+// ERROR_BUSY error while the hardware is busy; with one, the switch is
+// queued behind it.
+Napi::Value
+setWorkerMode(const Napi::CallbackInfo& info)
 {
-    napi_env env = info.Env();
-    
+    Napi::Env env = info.Env();
+
     if (info.Length() < 1) {
-        Napi::TypeError::New(env, "Monitor key required").ThrowAsJavaScriptException();
-        return Napi::Array::New(env);
+        throw Napi::TypeError::New(env, "Not enough arguments");
     }
-    
-    std::string searchKey = info[0].As<Napi::String>();
+    if (!info[0].IsBoolean()) {
+        throw Napi::TypeError::New(env, "Invalid arguments");
+    }
+
+    bool enable = info[0].As<Napi::Boolean>().Value();
+
+    std::lock_guard<std::recursive_mutex> lock(ddcMutex);
+    if (hardwareBusy && !(info.Length() > 1 && info[1].IsFunction())) {
+        throwDdcCiError(env, "DDC/CI is busy", ERROR_BUSY);
+    }
+
+    return runOrQueueCommand(
+      info,
+      1,
+      [enable]() {
+          DdcResult result;
+          if (enable != ddcWorker.enabled && enable) {
+              DWORD errorCode = ERROR_SUCCESS;
+              DdcResult started = withHardware([&]() {
+                  DdcResult start;
+                  if (!ddcWorker.start(errorCode)) {
+                      start.status = ddcipc::STATUS_FAILED;
+                  }
+                  return start;
+              });
+              if (started.status != ddcipc::STATUS_OK) {
+                  p("Couldn't start DDC/CI worker: "
+                    + getLastErrorString(errorCode));
+              } else {
+                  ddcWorker.enabled = true;
+                  // Drops our own handles in favor of the worker's.
+                  mirrorWorkerMonitors();
+              }
+          } else if (enable != ddcWorker.enabled) {
+              ddcWorker.enabled = false;
+              withHardware([]() {
+                  ddcWorker.stop();
+                  clearMonitorData();
+                  if (lastRefresh.valid) {
+                      populateHandlesMap(lastRefresh.method,
+                                         lastRefresh.args[0] != 0,
+                                         lastRefresh.args[1] != 0);
+                  }
+                  return DdcResult();
+              });
+          }
+          result.values[0] = ddcWorker.enabled ? 1 : 0;
+          return result;
+      },
+      [](Napi::Env env, const DdcResult& result) -> Napi::Value {
+          return Napi::Boolean::New(env, result.values[0] != 0);
+      });
+}
+
+Napi::Object
+getWorkerStatus(const Napi::CallbackInfo& info)
+{
+    std::lock_guard<std::recursive_mutex> lock(ddcMutex);
+    Napi::Env env = info.Env();
+    Napi::Object status = Napi::Object::New(env);
+
+    // The counters are atomic, so this doesn't wait for a background thread
+    // that is using the worker.
+    status.Set("enabled", Napi::Boolean::New(env, ddcWorker.enabled));
+    status.Set("running", Napi::Boolean::New(env, ddcWorker.processId != 0));
+    status.Set("pid",
+               Napi::Number::New(env, static_cast<double>(ddcWorker.processId)));
+    status.Set("restarts",
+               Napi::Number::New(env, static_cast<double>(ddcWorker.restarts)));
+    status.Set("crashes",
+               Napi::Number::New(env, static_cast<double>(ddcWorker.crashes)));
+    status.Set(
+      "lastExitCode",
+      Napi::Number::New(env, static_cast<double>(ddcWorker.lastExitCode)));
+
+    return status;
+}
 
-    // Look up the monitor by any of its known keys
-    const PhysicalMonitor* foundMonitor = nullptr;
+// Records the OS display state (e.g. GUID_CONSOLE_DISPLAY_STATE). While
+// displays are off every write is parked.
+void
+setDisplayPowerState(const Napi::CallbackInfo& info)
+{
+    std::lock_guard<std::recursive_mutex> lock(ddcMutex);
+    Napi::Env env = info.Env();
 
-    for (auto const& pair : physicalMonitorHandles) {
-        const PhysicalMonitor& monitor = pair.second;
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(env, "Not enough arguments");
+    }
+    if (!info[0].IsBoolean()) {
+        throw Napi::TypeError::New(env, "Invalid arguments");
+    }
 
-        if (pair.first == searchKey ||
-            monitor.name == searchKey ||
-            monitor.fullName == searchKey ||
-            monitor.physicalName == searchKey ||
-            monitor.deviceKey == searchKey ||
-            monitor.deviceID == searchKey) {
-            
-            foundMonitor = &monitor;
-            break;
+    bool on = info[0].As<Napi::Boolean>().Value();
+    if (on && !displaysOn) {
+        displaysOnSince = GetTickCount64();
+        for (auto& entry : monitorPower) {
+            entry.second.lastProbe = 0;
         }
     }
-    
-    if (foundMonitor == nullptr) {
-        Napi::Error::New(env, "Monitor not found. Search key: " + searchKey).ThrowAsJavaScriptException();
-        return Napi::Array::New(env);
-    }
-    
-    const PhysicalMonitor& monitor = *foundMonitor;
-    std::string result = monitor.result;
-    
-    Napi::Array resultArray = Napi::Array::New(env);
-    
-    try {
-        // Find the input source list (VCP code 60) in the capabilities string
-        size_t inputStart = result.find("60(");
-        if (inputStart == std::string::npos) {
-            return resultArray;
+    displaysOn = on;
+}
+
+// Probes monitors with parked writes and replays them for the ones that are
+// on. Returns { replayed, pending }.
+// resumeParkedWrites([callback])
+Napi::Value
+resumeParkedWrites(const Napi::CallbackInfo& info)
+{
+    return runOrQueueCommand(
+      info,
+      0,
+      []() {
+          DdcResult result;
+          uint32_t replayedBefore = replayedWriteCount;
+          uint32_t pending = 0;
+          for (auto& entry : monitorPower) {
+              // Probing has to wait for the hardware to be free.
+              if (!entry.second.parked.empty() && !hardwareBusy) {
+                  wakeIfReady(entry.first, entry.second);
+                  pending += static_cast<uint32_t>(entry.second.parked.size());
+              }
+          }
+          result.values[0] = replayedWriteCount - replayedBefore;
+          result.values[1] = pending;
+          return result;
+      },
+      [](Napi::Env env, const DdcResult& result) -> Napi::Value {
+          Napi::Object ret = Napi::Object::New(env);
+          ret.Set("replayed",
+                  Napi::Number::New(env, static_cast<double>(result.values[0])));
+          ret.Set("pending",
+                  Napi::Number::New(env, static_cast<double>(result.values[1])));
+          return ret;
+      });
+}
+
+Napi::Value
+getPowerStates(const Napi::CallbackInfo& info)
+{
+    std::lock_guard<std::recursive_mutex> lock(ddcMutex);
+    Napi::Env env = info.Env();
+
+    Napi::Object monitors = Napi::Object::New(env);
+    for (auto const& entry : monitorPower) {
+        Napi::Object monitor = Napi::Object::New(env);
+        const char* state = entry.second.state == PowerState::On
+                              ? "on"
+                              : entry.second.state == PowerState::Standby
+                                  ? "standby"
+                                  : "unknown";
+        monitor.Set("state", Napi::String::New(env, state));
+        monitor.Set("parked",
+                    Napi::Number::New(env, static_cast<double>(entry.second.parked.size())));
+        monitors.Set(entry.first, monitor);
+    }
+
+    Napi::Object ret = Napi::Object::New(env);
+    ret.Set("displaysOn", Napi::Boolean::New(env, displaysOn));
+    ret.Set("parkedTotal", Napi::Number::New(env, parkedWriteCount));
+    ret.Set("replayedTotal", Napi::Number::New(env, replayedWriteCount));
+    ret.Set("monitors", monitors);
+    return ret;
+}
+
+// Brightness transfer functions
+//
+// A transfer function maps a 0-100 slider percentage to the raw value a
+// monitor expects. It combines an optional perceptual curve, the user's remap
+// range and calibration points, and the monitor's brightness VCP code and
+// raw range. It is compiled once into a 101-entry table, so a percent write
+// is one lookup followed by one DDC/CI call.
+
+struct CalibrationPoint {
+    double input;
+    double output;
+};
+
+struct BrightnessTransfer {
+    BYTE vcpCode = 0x10;
+    bool highLevel = false;
+    DWORD raw[101] = {};
+};
+
+std::map<std::string, BrightnessTransfer> brightnessTransfers;
+
+// Same piecewise-linear mapping as getCalibratedValue() in the app's Utils.js.
+double
+applyCalibration(double value, std::vector<CalibrationPoint> points)
+{
+    value = (std::max)(0.0, (std::min)(100.0, value));
+
+    bool hasMin = false;
+    bool hasMax = false;
+    for (auto& point : points) {
+        point.input = (std::max)(0.0, (std::min)(100.0, point.input));
+        if (point.input == 0) hasMin = true;
+        if (point.input == 100) hasMax = true;
+    }
+    if (!hasMin) {
+        points.insert(points.begin(), CalibrationPoint{ 0, 0 });
+    }
+    if (!hasMax) {
+        points.push_back({ 100, 100 });
+    }
+    std::stable_sort(points.begin(),
+                     points.end(),
+                     [](const CalibrationPoint& a, const CalibrationPoint& b) {
+                         return a.input < b.input;
+                     });
+
+    if (value == 0 && points[0].input == 0) {
+        return points[0].output;
+    }
+    for (size_t i = 0; i + 1 < points.size(); i++) {
+        const CalibrationPoint& p1 = points[i];
+        const CalibrationPoint& p2 = points[i + 1];
+        if (value >= p1.input && value <= p2.input) {
+            double ratio = (value - p1.input) / (p2.input - p1.input);
+            return p1.output + ratio * (p2.output - p1.output);
         }
+    }
+    return value;
+}
+
+// Treats the slider as perceived lightness (CIE L*) and returns the matching
+// relative luminance, so equal slider steps look like equal brightness steps.
+// Same as perceptualToLinear() in the app's Utils.js.
+double
+perceptualToLinear(double lightness)
+{
+    lightness = (std::max)(0.0, (std::min)(100.0, lightness));
+    if (lightness > 8.0) {
+        return 100.0 * std::pow((lightness + 16.0) / 116.0, 3.0);
+    }
+    return 100.0 * lightness / 903.3;
+}
+
+BrightnessTransfer
+compileBrightnessTransfer(BYTE vcpCode,
+                          bool highLevel,
+                          DWORD minValue,
+                          DWORD maxValue,
+                          double min,
+                          double max,
+                          std::vector<CalibrationPoint> calibration,
+                          bool perceptual)
+{
+    BrightnessTransfer transfer;
+    transfer.vcpCode = vcpCode;
+    transfer.highLevel = highLevel;
 
-        size_t inputEnd = result.find(")", inputStart);
-        if (inputEnd == std::string::npos) {
-            return resultArray;
+    // The remap range becomes the calibration's end points, as in the app.
+    if (min > 0) calibration.push_back({ 0, min });
+    if (max < 100) calibration.push_back({ 100, max });
+
+    if (maxValue < minValue) {
+        maxValue = minValue;
+    }
+    for (int percent = 0; percent <= 100; percent++) {
+        double level = perceptual ? perceptualToLinear(percent) : percent;
+        level = applyCalibration(level, calibration);
+        level = (std::max)(0.0, (std::min)(100.0, level));
+        transfer.raw[percent] =
+          minValue
+          + static_cast<DWORD>(std::lround(level / 100.0 * (maxValue - minValue)));
+    }
+
+    return transfer;
+}
+
+// Nearest table entry for a raw value read back from the monitor.
+int
+brightnessPercentForRaw(const BrightnessTransfer& transfer, DWORD raw)
+{
+    int best = 0;
+    DWORD bestDistance = MAXDWORD;
+    for (int percent = 0; percent <= 100; percent++) {
+        DWORD distance = transfer.raw[percent] > raw
+                           ? transfer.raw[percent] - raw
+                           : raw - transfer.raw[percent];
+        if (distance < bestDistance) {
+            best = percent;
+            bestDistance = distance;
         }
+    }
+    return best;
+}
 
-        // Extract the substring containing the input source codes
-        std::string inputsStr = result.substr(inputStart + 3, inputEnd - inputStart - 3);
+double
+getNumberOption(const Napi::Object& options, const char* key, double fallback)
+{
+    Napi::Value value = options.Get(key);
+    return value.IsNumber() ? value.As<Napi::Number>().DoubleValue() : fallback;
+}
 
-        // Split into individual codes
-        std::vector<std::string> inputCodes;
-        std::istringstream iss(inputsStr);
-        std::string code;
-        
-        while (std::getline(iss, code, ' ')) {
-            if (!code.empty()) {
-                inputCodes.push_back(code);
-            }
+// setBrightnessTransfer(monitorId, { vcpCode, highLevel, minValue, maxValue,
+// min, max, calibration, curve }). Returns the compiled table.
+Napi::Value
+setBrightnessTransfer(const Napi::CallbackInfo& info)
+{
+    std::lock_guard<std::recursive_mutex> lock(ddcMutex);
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2) {
+        throw Napi::TypeError::New(env, "Not enough arguments");
+    }
+    if (!info[0].IsString() || !info[1].IsObject()) {
+        throw Napi::TypeError::New(env, "Invalid arguments");
+    }
+
+    std::string monitorName = info[0].As<Napi::String>().Utf8Value();
+    Napi::Object options = info[1].As<Napi::Object>();
+
+    std::vector<CalibrationPoint> calibration;
+    Napi::Value calibrationValue = options.Get("calibration");
+    if (calibrationValue.IsArray()) {
+        Napi::Array points = calibrationValue.As<Napi::Array>();
+        for (uint32_t i = 0; i < points.Length(); i++) {
+            Napi::Value point = points.Get(i);
+            if (!point.IsObject()) continue;
+            Napi::Object pointObject = point.As<Napi::Object>();
+            Napi::Value input = pointObject.Get("input");
+            Napi::Value output = pointObject.Get("output");
+            if (!input.IsNumber() || !output.IsNumber()) continue;
+            calibration.push_back({ input.As<Napi::Number>().DoubleValue(),
+                                    output.As<Napi::Number>().DoubleValue() });
         }
-        
-        if (inputCodes.empty()) {
-            return resultArray;
-        }
-        
-        // Read the monitor's current input source
-        DWORD currentInput = 0;
-        DWORD inputs = 0;
-        BOOL success = GetVCPFeatureAndVCPFeatureReply(
-            monitor.handle,
-            (BYTE)0x60,
-            NULL,
-            &currentInput,
-            &inputs
-        );
-
-        // Convert the current input to a number
-        unsigned int currentCodeValue = 0;
-        if (success) {
-            std::stringstream ss;
-            ss << std::hex << currentInput;
-            ss >> currentCodeValue;
-        }
-        
-        // Build the array of all available inputs (codes only)
-        Napi::Array availableInputs = Napi::Array::New(env);
-        int availableIndex = 0;
-
-        for (const auto& code : inputCodes) {
-            // Convert the hex string to a number
-            unsigned int codeValue;
-            std::stringstream ss;
-            ss << std::hex << code;
-            ss >> codeValue;
-            
-            availableInputs.Set(uint32_t(availableIndex++), Napi::Number::New(env, codeValue));
-        }
-        
-        // Return a two-element array: [current input, all available inputs]
-        resultArray.Set(uint32_t(0), Napi::Number::New(env, currentCodeValue));
-        resultArray.Set(uint32_t(1), availableInputs);
-        
-    } catch (const std::exception& e) {
-        Napi::Error::New(env, std::string("Error parsing monitor inputs: ") + e.what()).ThrowAsJavaScriptException();
+    }
+
+    Napi::Value curve = options.Get("curve");
+    bool perceptual =
+      curve.IsString() && curve.As<Napi::String>().Utf8Value() == "perceptual";
+    Napi::Value highLevel = options.Get("highLevel");
+
+    BrightnessTransfer transfer = compileBrightnessTransfer(
+      static_cast<BYTE>(getNumberOption(options, "vcpCode", 0x10)),
+      highLevel.IsBoolean() && highLevel.As<Napi::Boolean>().Value(),
+      static_cast<DWORD>((std::max)(0.0, getNumberOption(options, "minValue", 0))),
+      static_cast<DWORD>((std::max)(0.0, getNumberOption(options, "maxValue", 100))),
+      getNumberOption(options, "min", 0),
+      getNumberOption(options, "max", 100),
+      calibration,
+      perceptual);
+    brightnessTransfers[monitorName] = transfer;
+
+    Napi::Array table = Napi::Array::New(env, 101);
+    for (uint32_t i = 0; i <= 100; i++) {
+        table.Set(i, static_cast<double>(transfer.raw[i]));
+    }
+    return table;
+}
+
+void
+clearBrightnessTransfer(const Napi::CallbackInfo& info)
+{
+    std::lock_guard<std::recursive_mutex> lock(ddcMutex);
+    if (info.Length() > 0 && info[0].IsString()) {
+        brightnessTransfers.erase(info[0].As<Napi::String>().Utf8Value());
+    } else {
+        brightnessTransfers.clear();
+    }
+}
+
+// Writes the raw value for a 0-100 percentage and returns it.
+// setBrightnessPercent(monitorId, percent[, callback])
+Napi::Value
+setBrightnessPercent(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2) {
+        throw Napi::TypeError::New(env, "Not enough arguments");
+    }
+    if (!info[0].IsString() || !info[1].IsNumber()) {
+        throw Napi::TypeError::New(env, "Invalid arguments");
+    }
+
+    std::string monitorName = info[0].As<Napi::String>().Utf8Value();
+    double percent = info[1].As<Napi::Number>().DoubleValue();
+    int index = static_cast<int>(
+      std::lround((std::max)(0.0, (std::min)(100.0, percent))));
+
+    // The table is looked up when the command runs, so a transfer function
+    // set after a queued write still applies to it.
+    return runOrQueueCommand(
+      info,
+      2,
+      [monitorName, index]() {
+          DdcResult result;
+          auto it = brightnessTransfers.find(monitorName);
+          if (it == brightnessTransfers.end()) {
+              result.status = ddcipc::STATUS_NOT_FOUND;
+              return result;
+          }
+          const BrightnessTransfer& transfer = it->second;
+          DWORD raw = transfer.raw[index];
+
+          result =
+            transfer.highLevel
+              ? executeDdcCommand(
+                  ddcipc::CMD_SET_HIGH_LEVEL_BRIGHTNESS, monitorName, raw)
+              : executeDdcCommand(
+                  ddcipc::CMD_SET_VCP, monitorName, transfer.vcpCode, raw);
+          result.values[1] = raw;
+          return result;
+      },
+      [](Napi::Env env, const DdcResult& result) -> Napi::Value {
+          if (result.status == ddcipc::STATUS_NOT_FOUND) {
+              throw Napi::Error::New(env, "No brightness transfer function");
+          }
+          if (result.status != ddcipc::STATUS_OK) {
+              throwDdcResultError(env, result, "Failed to set brightness");
+          }
+          return Napi::Number::New(env, static_cast<double>(result.values[1]));
+      });
+}
+
+// Reads the brightness back and returns [percent, raw].
+// getBrightnessPercent(monitorId[, callback])
+Napi::Value
+getBrightnessPercent(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(env, "Not enough arguments");
+    }
+    if (!info[0].IsString()) {
+        throw Napi::TypeError::New(env, "Invalid arguments");
+    }
+
+    std::string monitorName = info[0].As<Napi::String>().Utf8Value();
+
+    return runOrQueueCommand(
+      info,
+      1,
+      [monitorName]() {
+          DdcResult result;
+          auto it = brightnessTransfers.find(monitorName);
+          if (it == brightnessTransfers.end()) {
+              result.status = ddcipc::STATUS_NOT_FOUND;
+              return result;
+          }
+          const BrightnessTransfer& transfer = it->second;
+
+          result =
+            transfer.highLevel
+              ? executeDdcCommand(ddcipc::CMD_GET_HIGH_LEVEL_BRIGHTNESS,
+                                  monitorName)
+              : executeDdcCommand(
+                  ddcipc::CMD_GET_VCP, monitorName, transfer.vcpCode);
+          if (result.status == ddcipc::STATUS_OK) {
+              result.values[1] =
+                brightnessPercentForRaw(transfer, result.values[0]);
+          }
+          return result;
+      },
+      [](Napi::Env env, const DdcResult& result) -> Napi::Value {
+          if (result.status == ddcipc::STATUS_NOT_FOUND) {
+              throw Napi::Error::New(env, "No brightness transfer function");
+          }
+          if (result.status != ddcipc::STATUS_OK) {
+              throwDdcResultError(env, result, "Failed to get brightness");
+          }
+
+          Napi::Array ret = Napi::Array::New(env, 2);
+          ret.Set((uint32_t)0, static_cast<double>(result.values[1]));
+          ret.Set((uint32_t)1, static_cast<double>(result.values[0]));
+          return ret;
+      });
+}
+
+// What getMonitorInputs() found for a monitor: its current input source and
+// the ones listed under VCP 0x60 in its capabilities string.
+struct MonitorInputs {
+    bool found = false;
+    std::string parseError;
+    unsigned int current = 0;
+    std::vector<unsigned int> available;
+};
+
+// getMonitorInputs(monitorId[, callback])
+Napi::Value
+getMonitorInputs(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(env, "Monitor key required");
     }
     
-    return resultArray;
+    std::string searchKey = info[0].As<Napi::String>();
+
+    std::lock_guard<std::recursive_mutex> lock(ddcMutex);
+    if (hardwareBusy && !(info.Length() > 1 && info[1].IsFunction())) {
+        throwDdcCiError(env, "DDC/CI is busy", ERROR_BUSY);
+    }
+
+    auto inputs = std::make_shared<MonitorInputs>();
+    return runOrQueueCommand(
+      info,
+      1,
+      [searchKey, inputs]() {
+          DdcResult lookup;
+
+          // Look up the monitor by any of its known keys
+          const PhysicalMonitor* foundMonitor = nullptr;
+
+          for (auto const& pair : physicalMonitorHandles) {
+              const PhysicalMonitor& monitor = pair.second;
+
+              if (pair.first == searchKey ||
+                  monitor.name == searchKey ||
+                  monitor.fullName == searchKey ||
+                  monitor.physicalName == searchKey ||
+                  monitor.deviceKey == searchKey ||
+                  monitor.deviceID == searchKey) {
+
+                  foundMonitor = &monitor;
+                  break;
+              }
+          }
+
+          if (foundMonitor == nullptr) {
+              return lookup;
+          }
+          inputs->found = true;
+
+          // The maps can change while the read below runs unlocked.
+          const std::string deviceKey = foundMonitor->deviceKey;
+          const std::string result = foundMonitor->result;
+
+          try {
+              // Find the input source list (VCP code 60) in the capabilities string
+              size_t inputStart = result.find("60(");
+              if (inputStart == std::string::npos) {
+                  return lookup;
+              }
+
+              size_t inputEnd = result.find(")", inputStart);
+              if (inputEnd == std::string::npos) {
+                  return lookup;
+              }
+
+              // Extract the substring containing the input source codes
+              std::string inputsStr = result.substr(inputStart + 3, inputEnd - inputStart - 3);
+
+              // Split into individual codes, converting each hex string to a number
+              std::istringstream iss(inputsStr);
+              std::string code;
+
+              while (std::getline(iss, code, ' ')) {
+                  if (!code.empty()) {
+                      unsigned int codeValue;
+                      std::stringstream ss;
+                      ss << std::hex << code;
+                      ss >> codeValue;
+                      inputs->available.push_back(codeValue);
+                  }
+              }
+
+              if (inputs->available.empty()) {
+                  return lookup;
+              }
+
+              // Read the monitor's current input source
+              DdcResult inputResult =
+                executeDdcCommand(ddcipc::CMD_GET_VCP, deviceKey, 0x60);
+
+              // Convert the current input to a number
+              if (inputResult.status == ddcipc::STATUS_OK) {
+                  std::stringstream ss;
+                  ss << std::hex << inputResult.values[0];
+                  ss >> inputs->current;
+              }
+          } catch (const std::exception& e) {
+              inputs->parseError = e.what();
+          }
+          return lookup;
+      },
+      [searchKey, inputs](Napi::Env env, const DdcResult&) -> Napi::Value {
+          if (!inputs->found) {
+              throw Napi::Error::New(env, "Monitor not found. Search key: " + searchKey);
+          }
+          if (!inputs->parseError.empty()) {
+              throw Napi::Error::New(env, "Error parsing monitor inputs: " + inputs->parseError);
+          }
+
+          Napi::Array resultArray = Napi::Array::New(env);
+          if (inputs->available.empty()) {
+              return resultArray;
+          }
+
+          // Build the array of all available inputs (codes only)
+          Napi::Array availableInputs = Napi::Array::New(env);
+          for (size_t i = 0; i < inputs->available.size(); i++) {
+              availableInputs.Set(uint32_t(i), Napi::Number::New(env, inputs->available[i]));
+          }
+
+          // Return a two-element array: [current input, all available inputs]
+          resultArray.Set(uint32_t(0), Napi::Number::New(env, inputs->current));
+          resultArray.Set(uint32_t(1), availableInputs);
+          return resultArray;
+      });
 }
 
 
 Napi::Object
 Init(Napi::Env env, Napi::Object exports)
 {
+    jsThreadId = std::this_thread::get_id();
+
     exports.Set("getMonitorList",
                 Napi::Function::New(env, getMonitorList, "getMonitorList"));
     exports.Set("getAllMonitors",
@@ -1561,6 +3907,8 @@ Init(Napi::Env env, Napi::Object exports)
       "clearDisplayCache",
       Napi::Function::New(env, clearDisplayCache, "clearDisplayCache"));
     exports.Set("refresh", Napi::Function::New(env, refresh, "refresh"));
+    exports.Set("scheduleRefresh", Napi::Function::New(env, scheduleRefresh, "scheduleRefresh"));
+    exports.Set("getRefreshStatus", Napi::Function::New(env, getRefreshStatus, "getRefreshStatus"));
     exports.Set("setVCP", Napi::Function::New(env, setVCP, "setVCP"));
     exports.Set("getVCP", Napi::Function::New(env, getVCP, "getVCP"));
     exports.Set(
@@ -1575,6 +3923,25 @@ Init(Napi::Env env, Napi::Object exports)
     exports.Set("setHighLevelContrast", Napi::Function::New(env, setHighLevelContrast, "setHighLevelContrast"));
     exports.Set("setLogLevel", Napi::Function::New(env, setLogLevel, "setLogLevel"));
     exports.Set("getMonitorInputs", Napi::Function::New(env, getMonitorInputs, "getMonitorInputs"));
+    exports.Set("getCapabilitiesTiming", Napi::Function::New(env, getCapabilitiesTiming, "getCapabilitiesTiming"));
+    exports.Set("setWorkerMode", Napi::Function::New(env, setWorkerMode, "setWorkerMode"));
+    exports.Set("getWorkerStatus", Napi::Function::New(env, getWorkerStatus, "getWorkerStatus"));
+    exports.Set("setDisplayPowerState", Napi::Function::New(env, setDisplayPowerState, "setDisplayPowerState"));
+    exports.Set("resumeParkedWrites", Napi::Function::New(env, resumeParkedWrites, "resumeParkedWrites"));
+    exports.Set("getPowerStates", Napi::Function::New(env, getPowerStates, "getPowerStates"));
+    exports.Set("setBrightnessTransfer", Napi::Function::New(env, setBrightnessTransfer, "setBrightnessTransfer"));
+    exports.Set("clearBrightnessTransfer", Napi::Function::New(env, clearBrightnessTransfer, "clearBrightnessTransfer"));
+    exports.Set("setBrightnessPercent", Napi::Function::New(env, setBrightnessPercent, "setBrightnessPercent"));
+    exports.Set("getBrightnessPercent", Napi::Function::New(env, getBrightnessPercent, "getBrightnessPercent"));
+
+    napi_add_env_cleanup_hook(
+      env,
+      [](void*) {
+          commandQueue.stop();
+          refreshScheduler.stop();
+          ddcWorker.stop();
+      },
+      nullptr);
 
     // Preserve the original warm-up behavior without leaking its handles.
     std::vector<struct Monitor> initialHandles = getAllHandles();
@@ -1584,3 +3951,5 @@ Init(Napi::Env env, Napi::Object exports)
 }
 
 NODE_API_MODULE(NODE_GYP_MODULE_NAME, Init)
+
+#endif // DDCCI_WORKER
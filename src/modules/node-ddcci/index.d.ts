@@ -2,13 +2,76 @@ export function _getVCP (monitorId: string, code: number): number;
 export function _setVCP (monitorId: string, code: number, value: number): void;
 export function _getCapabilities (monitorId: string): string;
 export function _saveCurrentSettings (monitorId: string): boolean;
-export function _refresh (): void;
+export function _refresh (): boolean;
+
+export interface WorkerStatus {
+    enabled: boolean;
+    running: boolean;
+    pid: number;
+    restarts: number;
+    crashes: number;
+    lastExitCode: number;
+}
 
 export function getMonitorList (): string[];
-export function getMonitorInputs (monitorFullName: string): object[]
+
+export interface ScheduledRefreshResult {
+    generation: number;
+    latestGeneration: number;
+    monitors: object[];
+}
+
+export interface RefreshStatus {
+    requested: number;
+    completed: number;
+    coalesced: number;
+    superseded: number;
+}
+
+export function scheduleRefresh (method?: string, usePreviousResults?: boolean, checkHighLevel?: boolean, settleMs?: number): Promise<ScheduledRefreshResult>;
+export function getRefreshStatus (): RefreshStatus;
+export function getMonitorInputs (monitorFullName: string): Promise<[number, number[]] | []>
 
 export function getVCP (monitorId: string, code: number): number;
 export function setVCP (monitorId: string, code: number, value: number): void;
+export function getVCPAsync (monitorId: string, code: number): Promise<number[]>;
+export function setVCPAsync (monitorId: string, code: number, value: number): Promise<void>;
+export function _getHighLevelBrightnessAsync (monitorId: string): Promise<number[]>;
+export function _setHighLevelBrightnessAsync (monitorId: string, level: number): Promise<void>;
+export function _getHighLevelContrastAsync (monitorId: string): Promise<number[]>;
+export function _setHighLevelContrastAsync (monitorId: string, level: number): Promise<void>;
+
+export interface BrightnessTransferOptions {
+    vcpCode?: number;
+    highLevel?: boolean;
+    minValue?: number;
+    maxValue?: number;
+    min?: number;
+    max?: number;
+    calibration?: { input: number, output: number }[];
+    curve?: "linear" | "perceptual";
+}
+
+export function _setBrightnessTransfer (monitorId: string, options: BrightnessTransferOptions): number[];
+export function _clearBrightnessTransfer (monitorId?: string): void;
+export function setBrightnessPercent (monitorId: string, percent: number): number;
+export function getBrightnessPercent (monitorId: string): number;
+export function setBrightnessPercentAsync (monitorId: string, percent: number): Promise<number>;
+export function getBrightnessPercentAsync (monitorId: string): Promise<number>;
+
+export interface PowerStates {
+    displaysOn: boolean;
+    parkedTotal: number;
+    replayedTotal: number;
+    monitors: { [monitorId: string]: { state: "on" | "standby" | "unknown", parked: number } };
+}
+
+export function setDisplayPowerState (on: boolean): void;
+export function resumeParkedWrites (): Promise<{ replayed: number, pending: number }>;
+export function getPowerStates (): PowerStates;
+
+export function useWorkerProcess (enabled?: boolean): Promise<boolean>;
+export function getWorkerStatus (): WorkerStatus;
 
 export function getBrightness (monitorId: string): number;
 export function getMaxBrightness (monitorId: string): number;
@@ -19,6 +82,24 @@ export function getMaxContrast (monitorId: string): number;
 export function setContrast (monitorId: string): void;
 
 export function getCapabilities (monitorId: string): object;
+export function getCapabilitiesAsync (monitorId: string): Promise<object | false>;
+export function getCapabilitiesRawAsync (monitorId: string): Promise<string>;
+
+export interface CapabilitiesAttempt {
+    phase: "length" | "reply";
+    ms: number;
+    ok: boolean;
+    win32Code: number;
+}
+
+export interface CapabilitiesTiming {
+    lengthCached: boolean;
+    length: number;
+    totalMs: number;
+    attempts: CapabilitiesAttempt[];
+}
+
+export function getCapabilitiesTiming (monitorId: string): CapabilitiesTiming | null;
 
 export const vcp: {
     CODE_PAGE: 0x00;
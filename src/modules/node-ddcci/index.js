@@ -3,6 +3,15 @@
 const ddcci = require("bindings")("ddcci");
 const vcp = require("./vcp");
 
+// Runs a command on the addon's command queue. It waits there behind a
+// scheduled refresh instead of failing with ERROR_BUSY, and never blocks the
+// JS thread on the monitor.
+function queued(fn, ...args) {
+    return new Promise((resolve, reject) => {
+        fn(...args, (err, value) => err ? reject(err) : resolve(value));
+    });
+}
+
 module.exports = {
     vcp
 
@@ -13,9 +22,17 @@ module.exports = {
     , _setHighLevelBrightness: ddcci.setHighLevelBrightness
     , _getHighLevelContrast: ddcci.getHighLevelContrast
     , _setHighLevelContrast: ddcci.setHighLevelContrast
+    , _getHighLevelBrightnessAsync: (monitorId) => queued(ddcci.getHighLevelBrightness, monitorId)
+    , _setHighLevelBrightnessAsync: (monitorId, level) => queued(ddcci.setHighLevelBrightness, monitorId, level)
+    , _getHighLevelContrastAsync: (monitorId) => queued(ddcci.getHighLevelContrast, monitorId)
+    , _setHighLevelContrastAsync: (monitorId, level) => queued(ddcci.setHighLevelContrast, monitorId, level)
     , _getAllMonitors: ddcci.getAllMonitors
     , _clearDisplayCache: ddcci.clearDisplayCache
     , _setLogLevel: ddcci.setLogLevel
+    , _setWorkerMode: ddcci.setWorkerMode
+    , _getWorkerStatus: ddcci.getWorkerStatus
+    , _setBrightnessTransfer: ddcci.setBrightnessTransfer
+    , _clearBrightnessTransfer: ddcci.clearBrightnessTransfer
     , _parseCapabilitiesString: parseCapabilitiesString
     , _refresh: (method = "accurate", usePreviousResults = true, checkHighLevel = true) => ddcci.refresh(method, usePreviousResults, checkHighLevel)
     , getMonitorList: (method = "accurate", usePreviousResults = true, checkHighLevel = true) => {
@@ -34,13 +51,54 @@ module.exports = {
         }
         return monitors;
     }
-    , getMonitorInputs: (monitorFullName) => {
-        ddcci.refresh("accurate", true, true)
-        return ddcci.getMonitorInputs(monitorFullName)
+    // Debounced refresh for topology changes. Requests within `settleMs` of
+    // each other share one refresh, and a refresh still probing when a newer
+    // request arrives is abandoned. Resolves with { generation,
+    // latestGeneration, monitors }; if generation < latestGeneration, a newer
+    // refresh is pending and these monitors are already out of date.
+    , scheduleRefresh(method = "accurate", usePreviousResults = true, checkHighLevel = true, settleMs = 500) {
+        return new Promise((resolve, reject) => {
+            ddcci.scheduleRefresh(method, usePreviousResults, checkHighLevel, settleMs, (err, result) => {
+                if (err) return reject(err);
+                for (const monitor of result.monitors) {
+                    if (monitor.result && monitor.result != "ok" && monitor.result != "invalid") {
+                        monitor.capabilities = parseCapabilitiesString(monitor.result);
+                        monitor.capabilitiesRaw = monitor.result;
+                    }
+                    delete monitor.result;
+                }
+                resolve(result);
+            });
+        });
+    }
+    , getRefreshStatus: ddcci.getRefreshStatus
+    // Refreshes the monitor list, then reads the monitor's inputs, both on
+    // the command queue. Resolves with [currentInput, availableInputs].
+    , async getMonitorInputs(monitorFullName) {
+        await queued(ddcci.refresh, "accurate", true, true)
+        return queued(ddcci.getMonitorInputs, monitorFullName)
     }
 
     , getVCP: ddcci.getVCP
     , setVCP: ddcci.setVCP
+    , getVCPAsync: (monitorId, code) => queued(ddcci.getVCP, monitorId, code)
+    , setVCPAsync: (monitorId, code, value) => queued(ddcci.setVCP, monitorId, code, value)
+
+    // Runs all DDC/CI calls in a separate worker process, so a crashing
+    // monitor driver can't take the host process down. Resolves with whether
+    // the worker is in use; if it can't be started, calls stay in-process.
+    , useWorkerProcess(enabled = true) {
+        return queued(ddcci.setWorkerMode, !!enabled);
+    }
+    , getWorkerStatus: ddcci.getWorkerStatus
+
+    // Writes to monitors that are asleep are parked and replayed once they
+    // report on (VCP 0xD6). The OS display state is passed in here.
+    , setDisplayPowerState(on) {
+        ddcci.setDisplayPowerState(!!on);
+    }
+    , resumeParkedWrites: () => queued(ddcci.resumeParkedWrites)
+    , getPowerStates: ddcci.getPowerStates
 
     , getBrightness(monitorId) {
         return ddcci.getVCP(monitorId, vcp.LUMINANCE)[0];
@@ -66,6 +124,17 @@ module.exports = {
         ddcci.setVCP(monitorId, vcp.LUMINANCE, level);
     }
 
+    // Percent-based brightness using the table compiled by
+    // _setBrightnessTransfer(). Returns the raw value written.
+    , setBrightnessPercent: ddcci.setBrightnessPercent
+    , getBrightnessPercent(monitorId) {
+        return ddcci.getBrightnessPercent(monitorId)[0];
+    }
+    , setBrightnessPercentAsync: (monitorId, percent) => queued(ddcci.setBrightnessPercent, monitorId, percent)
+    , async getBrightnessPercentAsync(monitorId) {
+        return (await queued(ddcci.getBrightnessPercent, monitorId))[0];
+    }
+
     , setContrast(monitorId, level) {
         if (level < 0) {
             throw RangeError("Contrast level not within valid range");
@@ -83,6 +152,15 @@ module.exports = {
     , getCapabilitiesRaw(monitorId) {
         return ddcci.getCapabilitiesString(monitorId);
     }
+    , async getCapabilitiesAsync(monitorId) {
+        return parseCapabilitiesString(await queued(ddcci.getCapabilitiesString, monitorId));
+    }
+    , getCapabilitiesRawAsync: (monitorId) => queued(ddcci.getCapabilitiesString, monitorId)
+
+    // Timing of the last capabilities fetch for a monitor, or null if none was made.
+    , getCapabilitiesTiming(monitorId) {
+        return ddcci.getCapabilitiesTiming(monitorId);
+    }
 };
 
 function parseCapabilitiesString(report = "") {
@@ -14,6 +14,20 @@
       },
       'defines': [ 'NAPI_CPP_EXCEPTIONS' ],
     },
+    {
+      "target_name": "windows_event_hub",
+      "cflags!": [ ],
+      "cflags_cc!": [ ],
+      "sources": [ "windows_event_hub.cc" ],
+      "include_dirs": [
+        "<!@(node -p \"require('node-addon-api').include\")"
+      ],
+      "libraries": [ "hid.lib" ],
+      'msvs_settings': {
+        'VCCLCompilerTool': { "ExceptionHandling": 1 }
+      },
+      'defines': [ 'NAPI_CPP_EXCEPTIONS' ],
+    },
     {
       "target_name": "windows_window_utils",
       "cflags!": [ ],
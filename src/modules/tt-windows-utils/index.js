@@ -6,6 +6,61 @@ const MediaStatus = require("bindings")("windows_media_status");
 const AppStartup = require("bindings")("windows_app_startup");
 const WindowMaterial = require("bindings")("windows_window_material");
 const DisplayBrightness = require("bindings")("windows_display_brightness");
+const EventHub = require("bindings")("windows_event_hub");
+
+// Every subscriber shares the one native hub thread and window. Each event
+// type is only registered with Windows while something is listening to it.
+const eventHubListeners = new Map()
+const eventHubThrottles = new Map()
+let eventHubStarted = false
+
+function dispatchHubEvent(event) {
+    const listeners = eventHubListeners.get(event.type)
+    if(!listeners) return;
+    for(const listener of [...listeners]) {
+        try {
+            listener(event)
+        } catch(e) {
+            console.log(`Event hub listener for ${event.type} failed:`, e)
+        }
+    }
+}
+
+function onHubEvent(type, listener) {
+    if(!eventHubStarted) {
+        eventHubStarted = EventHub.start(dispatchHubEvent)
+        if(!eventHubStarted) return false;
+        for(const [throttledType, interval] of eventHubThrottles) {
+            EventHub.setThrottle(throttledType, interval)
+        }
+    }
+    let listeners = eventHubListeners.get(type)
+    if(!listeners) {
+        if(!EventHub.setEnabled(type, true)) return false;
+        listeners = new Set()
+        eventHubListeners.set(type, listeners)
+    }
+    listeners.add(listener)
+    return () => offHubEvent(type, listener)
+}
+
+// Events of one type arriving within `interval` ms of the last delivery are
+// held back and delivered together, keeping only the latest one per name.
+function setHubThrottle(type, interval) {
+    eventHubThrottles.set(type, interval)
+    if(eventHubStarted) EventHub.setThrottle(type, interval);
+}
+
+function offHubEvent(type, listener) {
+    const listeners = eventHubListeners.get(type)
+    if(!listeners || !listeners.delete(listener) || listeners.size > 0) return;
+    eventHubListeners.delete(type)
+    EventHub.setEnabled(type, false)
+    if(eventHubListeners.size === 0) {
+        EventHub.stop()
+        eventHubStarted = false
+    }
+}
 
 module.exports = {
     BrightnessKeys: {
@@ -27,6 +82,11 @@ module.exports = {
         unregisterPowerSettingNotifications: PowerEvents.unregisterPowerSettingNotifications,
         getPowerSetting: PowerEvents.getPowerSetting,
     },
+    EventHub: {
+        on: onHubEvent,
+        off: offHubEvent,
+        setThrottle: setHubThrottle
+    },
     MediaStatus: {
         getPlaybackStatus: MediaStatus.getPlaybackStatus,
         getPlaybackInfo: MediaStatus.getPlaybackInfo
@@ -0,0 +1,113 @@
+#ifndef TT_WINDOWS_BRIGHTNESS_KEY_READER_H
+#define TT_WINDOWS_BRIGHTNESS_KEY_READER_H
+
+#include <windows.h>
+#include <hidusage.h>
+#include <hidpi.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Consumer Control parsing shared by windows_brightness_keys and
+// windows_event_hub. Link with hid.lib.
+constexpr USAGE kConsumerUsagePage = 0x0C;
+constexpr USAGE kConsumerControlUsage = 0x01;
+constexpr USAGE kBrightnessIncrementUsage = 0x006F;
+constexpr USAGE kBrightnessDecrementUsage = 0x0070;
+
+inline std::string ReadBrightnessKey(HRAWINPUT inputHandle)
+{
+    UINT inputSize = 0;
+    if (GetRawInputData(inputHandle,
+                        RID_INPUT,
+                        NULL,
+                        &inputSize,
+                        sizeof(RAWINPUTHEADER)) == static_cast<UINT>(-1) ||
+        inputSize < sizeof(RAWINPUTHEADER)) {
+        return "";
+    }
+
+    std::vector<BYTE> inputBuffer(inputSize);
+    if (GetRawInputData(inputHandle,
+                        RID_INPUT,
+                        inputBuffer.data(),
+                        &inputSize,
+                        sizeof(RAWINPUTHEADER)) == static_cast<UINT>(-1)) {
+        return "";
+    }
+
+    RAWINPUT* input = reinterpret_cast<RAWINPUT*>(inputBuffer.data());
+    if (input->header.dwType != RIM_TYPEHID || input->header.hDevice == NULL) {
+        return "";
+    }
+
+    UINT preparsedSize = 0;
+    if (GetRawInputDeviceInfo(input->header.hDevice,
+                              RIDI_PREPARSEDDATA,
+                              NULL,
+                              &preparsedSize) == static_cast<UINT>(-1) ||
+        preparsedSize == 0) {
+        return "";
+    }
+
+    std::vector<BYTE> preparsedBuffer(preparsedSize);
+    if (GetRawInputDeviceInfo(input->header.hDevice,
+                              RIDI_PREPARSEDDATA,
+                              preparsedBuffer.data(),
+                              &preparsedSize) == static_cast<UINT>(-1)) {
+        return "";
+    }
+
+    PHIDP_PREPARSED_DATA preparsedData =
+      reinterpret_cast<PHIDP_PREPARSED_DATA>(preparsedBuffer.data());
+    HIDP_CAPS capabilities = {};
+    if (HidP_GetCaps(preparsedData, &capabilities) != HIDP_STATUS_SUCCESS ||
+        capabilities.UsagePage != kConsumerUsagePage ||
+        capabilities.Usage != kConsumerControlUsage) {
+        return "";
+    }
+
+    const RAWHID& hid = input->data.hid;
+    const size_t dataOffset = input->data.hid.bRawData - inputBuffer.data();
+    const size_t rawDataSize =
+      static_cast<size_t>(hid.dwSizeHid) * static_cast<size_t>(hid.dwCount);
+    if (hid.dwSizeHid == 0 || hid.dwCount == 0 ||
+        dataOffset > inputBuffer.size() ||
+        rawDataSize > inputBuffer.size() - dataOffset) {
+        return "";
+    }
+
+    const ULONG maxUsageCount = HidP_MaxUsageListLength(
+      HidP_Input, kConsumerUsagePage, preparsedData);
+    if (maxUsageCount == 0) return "";
+
+    std::vector<USAGE> usages(maxUsageCount);
+    bool parsedConsumerReport = false;
+    for (DWORD reportIndex = 0; reportIndex < hid.dwCount; reportIndex++) {
+        PCHAR report = reinterpret_cast<PCHAR>(
+          input->data.hid.bRawData + (reportIndex * hid.dwSizeHid));
+        ULONG usageCount = maxUsageCount;
+        // This is a valid Consumer Control report even when its usage list is
+        // empty (the documented key-release report uses usage value zero).
+        parsedConsumerReport = true;
+        NTSTATUS usageStatus = HidP_GetUsages(HidP_Input,
+                                              kConsumerUsagePage,
+                                              0,
+                                              usages.data(),
+                                              &usageCount,
+                                              preparsedData,
+                                              report,
+                                              hid.dwSizeHid);
+        if (usageStatus != HIDP_STATUS_SUCCESS) continue;
+        for (ULONG usageIndex = 0; usageIndex < usageCount; usageIndex++) {
+            if (usages[usageIndex] == kBrightnessIncrementUsage) return "up";
+            if (usages[usageIndex] == kBrightnessDecrementUsage) return "down";
+        }
+    }
+
+    // Consumer Control devices send a zero-usage report when a key is released.
+    return parsedConsumerReport ? "release" : "";
+}
+
+#endif
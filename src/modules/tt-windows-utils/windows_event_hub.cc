@@ -0,0 +1,573 @@
+#include <napi.h>
+#include <windows.h>
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "windows_brightness_key_reader.h"
+#include "windows_power_settings.h"
+
+// One hidden window on one thread receives every window-message based
+// notification the app cares about and hands them to JavaScript through a
+// single ThreadSafeFunction. Subscribers are fanned out on the JS side.
+
+namespace {
+
+enum EventHubType {
+    EVENT_HUB_DISPLAY_CHANGE = 0,
+    EVENT_HUB_POWER_SETTING,
+    EVENT_HUB_FOREGROUND,
+    EVENT_HUB_BRIGHTNESS_KEY,
+    EVENT_HUB_TYPE_COUNT
+};
+
+const char* const kEventHubTypeNames[EVENT_HUB_TYPE_COUNT] = {
+  "displayChange",
+  "powerSetting",
+  "foreground",
+  "brightnessKey",
+};
+
+// Sent (not posted) from the JS thread so the caller gets the result of
+// registering on the hub thread, which owns the window.
+constexpr UINT WM_EVENT_HUB_SET_ENABLED = WM_APP + 1;
+constexpr UINT WM_EVENT_HUB_SET_THROTTLE = WM_APP + 2;
+
+constexpr wchar_t kEventHubClassName[] = L"tt-windows-utils Event Hub";
+
+struct EventHubEvent {
+    EventHubType type = EVENT_HUB_DISPLAY_CHANGE;
+    // The setting, key or WinEvent name. Throttling coalesces events that
+    // share a type and name, so distinct power settings are never merged.
+    std::string name;
+    std::string guid;
+    DWORD data = 0;
+    uint64_t hwnd = 0;
+    ULONGLONG time = 0;
+};
+
+struct EventHubThrottle {
+    DWORD interval = 0;
+    ULONGLONG lastDelivered = 0;
+    BOOL timerArmed = FALSE;
+    std::vector<EventHubEvent> pending;
+};
+
+class EventHub {
+   public:
+    EventHub(Napi::Env env, Napi::Function callback) : owner(env)
+    {
+        this->tsfn = Napi::ThreadSafeFunction::New(
+          env, callback, "tt-windows-utils event hub", 256, 1);
+    }
+
+    BOOL Start();
+    void Stop();
+
+    napi_env owner;
+    HWND hwnd = NULL;
+    std::thread thread;
+    Napi::ThreadSafeFunction tsfn;
+
+    // Only touched on the hub thread.
+    BOOL enabled[EVENT_HUB_TYPE_COUNT] = {};
+    EventHubThrottle throttles[EVENT_HUB_TYPE_COUNT];
+    std::vector<HPOWERNOTIFY> powerNotifications;
+    HWINEVENTHOOK foregroundHook = NULL;
+    HWINEVENTHOOK nameChangeHook = NULL;
+    UINT uxdDisplayChange = 0;
+
+    void Dispatch(EventHubEvent event);
+    void Flush(EventHubType type);
+    BOOL SetEnabled(EventHubType type, BOOL enable);
+    void DisableAll();
+
+   private:
+    void Run(std::promise<HWND> ready);
+};
+
+// The window procedure and WinEvent callbacks have no context argument, and
+// there is only ever one hub per process.
+std::mutex hubMutex;
+EventHub* hub = nullptr;
+
+void DeliverEvent(Napi::Env env, Napi::Function callback, EventHubEvent* event)
+{
+    if (env == nullptr || callback == nullptr) {
+        delete event;
+        return;
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("type", Napi::String::New(env, kEventHubTypeNames[event->type]));
+    result.Set("name", Napi::String::New(env, event->name));
+    if (!event->guid.empty()) {
+        result.Set("guid", Napi::String::New(env, event->guid));
+    }
+    result.Set("data", Napi::Number::New(env, event->data));
+    if (event->hwnd != 0) {
+        result.Set("hwnd", Napi::BigInt::New(env, event->hwnd));
+    }
+    result.Set("time", Napi::Number::New(env, (double)event->time));
+    delete event;
+    callback.Call({result});
+}
+
+void EventHub::Dispatch(EventHubEvent event)
+{
+    event.time = GetTickCount64();
+    EventHubThrottle& throttle = this->throttles[event.type];
+
+    if (throttle.interval == 0 ||
+        (!throttle.timerArmed &&
+         event.time - throttle.lastDelivered >= throttle.interval)) {
+        throttle.lastDelivered = event.time;
+        auto delivered = new EventHubEvent(std::move(event));
+        if (this->tsfn.NonBlockingCall(delivered, DeliverEvent) != napi_ok) {
+            delete delivered;
+        }
+        return;
+    }
+
+    // Inside the window: keep only the latest event per name and deliver
+    // them together once the interval has passed.
+    BOOL replaced = FALSE;
+    for (auto& pending : throttle.pending) {
+        if (pending.name == event.name) {
+            pending = event;
+            replaced = TRUE;
+            break;
+        }
+    }
+    if (!replaced) {
+        throttle.pending.push_back(event);
+    }
+
+    if (!throttle.timerArmed) {
+        ULONGLONG elapsed = event.time - throttle.lastDelivered;
+        UINT wait = elapsed >= throttle.interval
+                      ? USER_TIMER_MINIMUM
+                      : (UINT)(throttle.interval - elapsed);
+        if (SetTimer(this->hwnd, event.type + 1, wait, NULL) != 0) {
+            throttle.timerArmed = TRUE;
+        } else {
+            this->Flush(event.type);
+        }
+    }
+}
+
+void EventHub::Flush(EventHubType type)
+{
+    EventHubThrottle& throttle = this->throttles[type];
+    if (throttle.timerArmed) {
+        KillTimer(this->hwnd, type + 1);
+        throttle.timerArmed = FALSE;
+    }
+    if (throttle.pending.empty()) {
+        return;
+    }
+
+    throttle.lastDelivered = GetTickCount64();
+    for (auto& event : throttle.pending) {
+        auto delivered = new EventHubEvent(std::move(event));
+        if (this->tsfn.NonBlockingCall(delivered, DeliverEvent) != napi_ok) {
+            delete delivered;
+        }
+    }
+    throttle.pending.clear();
+}
+
+VOID CALLBACK HandleWinEvent(HWINEVENTHOOK hook,
+                             DWORD event,
+                             HWND hwnd,
+                             LONG idObject,
+                             LONG idChild,
+                             DWORD eventThread,
+                             DWORD eventTime)
+{
+    if (hub == nullptr || !hub->enabled[EVENT_HUB_FOREGROUND]) return;
+
+    if (event == EVENT_OBJECT_NAMECHANGE &&
+        (idObject != OBJID_WINDOW || hwnd != GetForegroundWindow())) {
+        // Only title changes of the foreground window itself are interesting.
+        return;
+    }
+
+    EventHubEvent result;
+    result.type = EVENT_HUB_FOREGROUND;
+    result.name = event == EVENT_SYSTEM_FOREGROUND ? "EVENT_SYSTEM_FOREGROUND"
+                                                   : "EVENT_OBJECT_NAMECHANGE";
+    result.hwnd = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(hwnd));
+    hub->Dispatch(std::move(result));
+}
+
+BOOL SetBrightnessKeysTarget(HWND hwnd, BOOL enable)
+{
+    RAWINPUTDEVICE device = {};
+    device.usUsagePage = kConsumerUsagePage;
+    device.usUsage = kConsumerControlUsage;
+    device.dwFlags = enable ? RIDEV_INPUTSINK : RIDEV_REMOVE;
+    device.hwndTarget = enable ? hwnd : NULL;
+    return RegisterRawInputDevices(&device, 1, sizeof(device));
+}
+
+BOOL EventHub::SetEnabled(EventHubType type, BOOL enable)
+{
+    if (this->enabled[type] == enable) {
+        return TRUE;
+    }
+
+    switch (type) {
+        case EVENT_HUB_DISPLAY_CHANGE:
+            break;
+
+        case EVENT_HUB_POWER_SETTING:
+            if (enable) {
+                for (const GUID* setting : kPowerSettings) {
+                    HPOWERNOTIFY notification = RegisterPowerSettingNotification(
+                      this->hwnd, setting, DEVICE_NOTIFY_WINDOW_HANDLE);
+                    if (notification != NULL) {
+                        this->powerNotifications.push_back(notification);
+                    }
+                }
+                // As with registerPowerSettingNotifications, one unsupported
+                // GUID shouldn't cost the others.
+                if (this->powerNotifications.empty()) return FALSE;
+            } else {
+                for (HPOWERNOTIFY notification : this->powerNotifications) {
+                    UnregisterPowerSettingNotification(notification);
+                }
+                this->powerNotifications.clear();
+            }
+            break;
+
+        case EVENT_HUB_FOREGROUND:
+            if (enable) {
+                // Two narrow hooks rather than one spanning every event code
+                // between them, which would wake this thread constantly.
+                this->foregroundHook = SetWinEventHook(EVENT_SYSTEM_FOREGROUND,
+                                                       EVENT_SYSTEM_FOREGROUND,
+                                                       NULL,
+                                                       HandleWinEvent,
+                                                       0,
+                                                       0,
+                                                       WINEVENT_OUTOFCONTEXT);
+                this->nameChangeHook = SetWinEventHook(EVENT_OBJECT_NAMECHANGE,
+                                                       EVENT_OBJECT_NAMECHANGE,
+                                                       NULL,
+                                                       HandleWinEvent,
+                                                       0,
+                                                       0,
+                                                       WINEVENT_OUTOFCONTEXT);
+                if (this->foregroundHook == NULL) {
+                    if (this->nameChangeHook != NULL) {
+                        UnhookWinEvent(this->nameChangeHook);
+                        this->nameChangeHook = NULL;
+                    }
+                    return FALSE;
+                }
+            } else {
+                if (this->foregroundHook != NULL) UnhookWinEvent(this->foregroundHook);
+                if (this->nameChangeHook != NULL) UnhookWinEvent(this->nameChangeHook);
+                this->foregroundHook = NULL;
+                this->nameChangeHook = NULL;
+            }
+            break;
+
+        case EVENT_HUB_BRIGHTNESS_KEY:
+            if (!SetBrightnessKeysTarget(this->hwnd, enable) && enable) {
+                return FALSE;
+            }
+            break;
+
+        default:
+            return FALSE;
+    }
+
+    this->enabled[type] = enable;
+    if (!enable) {
+        this->throttles[type].pending.clear();
+        if (this->throttles[type].timerArmed) {
+            KillTimer(this->hwnd, type + 1);
+            this->throttles[type].timerArmed = FALSE;
+        }
+    }
+    return TRUE;
+}
+
+void EventHub::DisableAll()
+{
+    for (int type = 0; type < EVENT_HUB_TYPE_COUNT; type++) {
+        this->SetEnabled((EventHubType)type, FALSE);
+    }
+}
+
+LRESULT CALLBACK EventHubWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+    if (hub == nullptr || hub->hwnd != hwnd) {
+        return DefWindowProcW(hwnd, msg, wParam, lParam);
+    }
+
+    switch (msg) {
+        case WM_EVENT_HUB_SET_ENABLED:
+            return hub->SetEnabled((EventHubType)wParam, (BOOL)lParam);
+
+        case WM_EVENT_HUB_SET_THROTTLE:
+            hub->throttles[wParam].interval = (DWORD)lParam;
+            if (lParam == 0) {
+                hub->Flush((EventHubType)wParam);
+            }
+            return TRUE;
+
+        case WM_TIMER:
+            if (wParam >= 1 && wParam <= EVENT_HUB_TYPE_COUNT) {
+                hub->Flush((EventHubType)(wParam - 1));
+                return 0;
+            }
+            break;
+
+        case WM_DISPLAYCHANGE:
+            if (hub->enabled[EVENT_HUB_DISPLAY_CHANGE]) {
+                EventHubEvent event;
+                event.type = EVENT_HUB_DISPLAY_CHANGE;
+                event.name = "WM_DISPLAYCHANGE";
+                hub->Dispatch(std::move(event));
+            }
+            break;
+
+        case WM_POWERBROADCAST:
+            if (wParam == PBT_POWERSETTINGCHANGE && lParam != 0 &&
+                hub->enabled[EVENT_HUB_POWER_SETTING]) {
+                auto setting = reinterpret_cast<const POWERBROADCAST_SETTING*>(lParam);
+                EventHubEvent event;
+                event.type = EVENT_HUB_POWER_SETTING;
+                event.guid = GUIDToString(setting->PowerSetting);
+                event.name = GetPowerSettingName(setting->PowerSetting);
+                if (event.name.empty()) event.name = event.guid;
+                event.data = GetPowerSettingData(setting);
+                hub->Dispatch(std::move(event));
+            }
+            return TRUE;
+
+        case WM_INPUT:
+            if (hub->enabled[EVENT_HUB_BRIGHTNESS_KEY]) {
+                // The raw input handle is only valid while this message is
+                // being handled, so the report is parsed here.
+                std::string key = ReadBrightnessKey(reinterpret_cast<HRAWINPUT>(lParam));
+                if (!key.empty()) {
+                    EventHubEvent event;
+                    event.type = EVENT_HUB_BRIGHTNESS_KEY;
+                    event.name = key;
+                    hub->Dispatch(std::move(event));
+                }
+            }
+            // WM_INPUT must still reach DefWindowProc for cleanup.
+            break;
+
+        case WM_CLOSE:
+            DestroyWindow(hwnd);
+            return 0;
+
+        case WM_DESTROY:
+            hub->DisableAll();
+            PostQuitMessage(0);
+            return 0;
+
+        default:
+            if (msg == hub->uxdDisplayChange && msg != 0 &&
+                hub->enabled[EVENT_HUB_DISPLAY_CHANGE]) {
+                EventHubEvent event;
+                event.type = EVENT_HUB_DISPLAY_CHANGE;
+                event.name = "UxdDisplayChangeMessage";
+                hub->Dispatch(std::move(event));
+                return 0;
+            }
+            break;
+    }
+
+    return DefWindowProcW(hwnd, msg, wParam, lParam);
+}
+
+HINSTANCE GetEventHubModule()
+{
+    HMODULE module = NULL;
+    GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
+                         GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                       reinterpret_cast<LPCWSTR>(&EventHubWindowProc),
+                       &module);
+    return module;
+}
+
+void EventHub::Run(std::promise<HWND> ready)
+{
+    HINSTANCE instance = GetEventHubModule();
+
+    WNDCLASSEXW windowClass = {};
+    windowClass.cbSize = sizeof(windowClass);
+    windowClass.lpfnWndProc = EventHubWindowProc;
+    windowClass.hInstance = instance;
+    windowClass.lpszClassName = kEventHubClassName;
+    if (RegisterClassExW(&windowClass) == 0 &&
+        GetLastError() != ERROR_CLASS_ALREADY_EXISTS) {
+        ready.set_value(NULL);
+        return;
+    }
+
+    // Display changes are broadcast to top-level windows only, which rules
+    // out HWND_MESSAGE. A top-level popup that is never shown gets them and
+    // stays out of the taskbar and Alt+Tab.
+    this->uxdDisplayChange = RegisterWindowMessageW(L"UxdDisplayChangeMessage");
+    this->hwnd = CreateWindowExW(WS_EX_TOOLWINDOW | WS_EX_NOACTIVATE,
+                                 kEventHubClassName,
+                                 kEventHubClassName,
+                                 WS_POPUP,
+                                 0, 0, 0, 0,
+                                 NULL,
+                                 NULL,
+                                 instance,
+                                 NULL);
+    ready.set_value(this->hwnd);
+    if (this->hwnd == NULL) {
+        return;
+    }
+
+    MSG msg;
+    while (GetMessageW(&msg, NULL, 0, 0) > 0) {
+        TranslateMessage(&msg);
+        DispatchMessageW(&msg);
+    }
+}
+
+BOOL EventHub::Start()
+{
+    std::promise<HWND> ready;
+    std::future<HWND> readyHwnd = ready.get_future();
+    this->thread = std::thread(&EventHub::Run, this, std::move(ready));
+    if (readyHwnd.get() == NULL) {
+        this->thread.join();
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void EventHub::Stop()
+{
+    if (this->hwnd != NULL) {
+        PostMessageW(this->hwnd, WM_CLOSE, 0, 0);
+    }
+    if (this->thread.joinable()) {
+        this->thread.join();
+    }
+    this->hwnd = NULL;
+}
+
+// Stops the hub, or only the hub started by `owner` when one is given.
+void StopEventHub(napi_env owner = nullptr)
+{
+    std::lock_guard<std::mutex> lock(hubMutex);
+    if (hub == nullptr || (owner != nullptr && hub->owner != owner)) return;
+    hub->Stop();
+    hub->tsfn.Release();
+    delete hub;
+    hub = nullptr;
+}
+
+bool ParseEventHubType(const Napi::Value& value, EventHubType* type)
+{
+    if (!value.IsString()) return false;
+    std::string name = value.As<Napi::String>().Utf8Value();
+    for (int i = 0; i < EVENT_HUB_TYPE_COUNT; i++) {
+        if (name == kEventHubTypeNames[i]) {
+            *type = (EventHubType)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+Napi::Boolean Start(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsFunction()) {
+        throw Napi::TypeError::New(env, "Expected a callback");
+    }
+
+    std::lock_guard<std::mutex> lock(hubMutex);
+    if (hub != nullptr) {
+        // Already running for this process.
+        return Napi::Boolean::New(env, false);
+    }
+
+    // The window procedure reads `hub` as soon as the window exists, so it is
+    // published before the thread starts.
+    hub = new EventHub(env, info[0].As<Napi::Function>());
+    if (!hub->Start()) {
+        hub->tsfn.Release();
+        delete hub;
+        hub = nullptr;
+        return Napi::Boolean::New(env, false);
+    }
+    return Napi::Boolean::New(env, true);
+}
+
+void Stop(const Napi::CallbackInfo& info)
+{
+    StopEventHub();
+}
+
+Napi::Boolean SetEnabled(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    EventHubType type;
+    if (info.Length() < 2 || !ParseEventHubType(info[0], &type)) {
+        throw Napi::TypeError::New(env, "Expected an event type");
+    }
+    BOOL enable = info[1].ToBoolean().Value() ? TRUE : FALSE;
+
+    std::lock_guard<std::mutex> lock(hubMutex);
+    if (hub == nullptr || hub->hwnd == NULL) {
+        return Napi::Boolean::New(env, false);
+    }
+    LRESULT result = SendMessageW(hub->hwnd, WM_EVENT_HUB_SET_ENABLED, type, enable);
+    return Napi::Boolean::New(env, result != FALSE);
+}
+
+Napi::Boolean SetThrottle(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    EventHubType type;
+    if (info.Length() < 2 || !ParseEventHubType(info[0], &type) || !info[1].IsNumber()) {
+        throw Napi::TypeError::New(env, "Expected an event type and an interval");
+    }
+    double interval = info[1].As<Napi::Number>().DoubleValue();
+    if (!(interval >= 0)) interval = 0;
+    if (interval > 60000) interval = 60000;
+
+    std::lock_guard<std::mutex> lock(hubMutex);
+    if (hub == nullptr || hub->hwnd == NULL) {
+        return Napi::Boolean::New(env, false);
+    }
+    SendMessageW(hub->hwnd, WM_EVENT_HUB_SET_THROTTLE, type, (LPARAM)interval);
+    return Napi::Boolean::New(env, true);
+}
+
+} // namespace
+
+Napi::Object Init(Napi::Env env, Napi::Object exports)
+{
+    napi_env owner = env;
+    env.AddCleanupHook([owner]() { StopEventHub(owner); });
+
+    exports.Set("start", Napi::Function::New(env, Start));
+    exports.Set("stop", Napi::Function::New(env, Stop));
+    exports.Set("setEnabled", Napi::Function::New(env, SetEnabled));
+    exports.Set("setThrottle", Napi::Function::New(env, SetThrottle));
+    return exports;
+}
+
+NODE_API_MODULE(NODE_GYP_MODULE_NAME, Init)
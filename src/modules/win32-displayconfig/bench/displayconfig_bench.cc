@@ -0,0 +1,246 @@
+/*
+ * displayconfig_bench.cc: part of the "win32-displayconfig" Node package.
+ * See the COPYRIGHT file at the top-level directory of this distribution.
+ *
+ * Runs the query, diff and toggle code against the topology simulator and
+ * reports how long each takes and how often it calls into the backend.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "../displayconfig_core.h"
+#include "../displayconfig_simulator.h"
+
+namespace {
+
+const LUID kIntegratedAdapter = {0x1000, 0};
+const LUID kDiscreteAdapter = {0x2000, 0};
+
+struct Win32SimulatedTarget MakeTarget(LUID adapterId, UINT32 id, const wchar_t *name, UINT32 width, UINT32 height, UINT32 hz) {
+    struct Win32SimulatedTarget target = {};
+    target.adapterId = adapterId;
+    target.id = id;
+    target.friendlyName = name;
+    target.devicePath = std::wstring(L"\\\\?\\DISPLAY#SIM") + std::to_wstring(id) + L"#5&1b2c3d4e&0&UID" + std::to_wstring(id) +
+                        L"#{e6f07b5f-ee97-4a90-b076-33f57bf4eaa7}";
+    target.outputTechnology = DISPLAYCONFIG_OUTPUT_TECHNOLOGY_DISPLAYPORT_EXTERNAL;
+    target.edidManufactureId = 0x10ac;
+    target.edidProductCodeId = (UINT16)id;
+    target.available = TRUE;
+    target.width = width;
+    target.height = height;
+    target.refreshRate = {hz * 1000, 1000};
+    target.pixelRate = (UINT64)width * height * hz * 12 / 10;
+    target.sdrWhiteLevel = 1000;
+    return target;
+}
+
+// A laptop panel and two monitors on the integrated GPU, one of them off,
+// and a monitor and a TV on the discrete GPU, the TV off.
+std::shared_ptr<Win32DisplayTopologySimulator> MakeDesk(const struct Win32DisplayTopologySimulatorOptions &options, UINT32 integratedLimit) {
+    auto simulator = std::make_shared<Win32DisplayTopologySimulator>(options);
+    simulator->AddAdapter(kIntegratedAdapter, 4, integratedLimit);
+    simulator->AddAdapter(kDiscreteAdapter, 4);
+
+    auto panel = MakeTarget(kIntegratedAdapter, 0x1100, L"Built-in Display", 2560, 1600, 120);
+    panel.outputTechnology = DISPLAYCONFIG_OUTPUT_TECHNOLOGY_INTERNAL;
+    panel.advancedColorSupported = TRUE;
+    simulator->AddTarget(panel);
+    simulator->AddTarget(MakeTarget(kIntegratedAdapter, 0x1101, L"DELL U2720Q", 3840, 2160, 60));
+    simulator->AddTarget(MakeTarget(kIntegratedAdapter, 0x1102, L"DELL P2419H", 1920, 1080, 60));
+    auto hdr = MakeTarget(kDiscreteAdapter, 0x2100, L"LG ULTRAGEAR", 2560, 1440, 144);
+    hdr.advancedColorSupported = TRUE;
+    hdr.advancedColorEnabled = TRUE;
+    hdr.sdrWhiteLevel = 2500;
+    simulator->AddTarget(hdr);
+    auto tv = MakeTarget(kDiscreteAdapter, 0x2101, L"LG TV SSCR2", 3840, 2160, 60);
+    tv.outputTechnology = DISPLAYCONFIG_OUTPUT_TECHNOLOGY_HDMI;
+    simulator->AddTarget(tv);
+
+    simulator->Activate(kIntegratedAdapter, 0x1100);
+    simulator->Activate(kIntegratedAdapter, 0x1101);
+    simulator->Activate(kDiscreteAdapter, 0x2100);
+    return simulator;
+}
+
+double Measure(UINT32 iterations, const std::function<void()> &body) {
+    auto start = std::chrono::steady_clock::now();
+    for (UINT32 i = 0; i < iterations; i++) {
+        body();
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+void Report(const char *name, double usPerOp, UINT32 iterations, const struct Win32DisplayTopologySimulatorStats &stats) {
+    printf("%-34s %10.2f us/op  %6.2f sizes/op  %6.2f queries/op  %6.2f deviceInfo/op  %6.2f faults/op\n",
+           name,
+           usPerOp,
+           (double)stats.bufferSizeCalls / iterations,
+           (double)stats.queryCalls / iterations,
+           (double)stats.deviceInfoCalls / iterations,
+           (double)stats.injectedBufferFaults / iterations);
+}
+
+void Fail(const char *what) {
+    fprintf(stderr, "displayconfig_bench: %s\n", what);
+    exit(1);
+}
+
+void BenchQuery(const char *name, UINT32 iterations, double faultRate, BOOL activeOnly, BOOL nameCache) {
+    struct Win32DisplayTopologySimulatorOptions options;
+    options.insufficientBufferRate = faultRate;
+    auto simulator = MakeDesk(options, 0);
+    SetDisplayConfigBackend(simulator);
+    if (nameCache) {
+        SetDeviceNameCacheEnabled(TRUE);
+    }
+
+    struct Win32QueryDisplayConfigOptions queryOptions;
+    queryOptions.activeOnly = activeOnly;
+    auto usPerOp = Measure(iterations, [&queryOptions]() {
+        auto results = DoQueryDisplayConfig(queryOptions);
+        if (results->error != ERROR_SUCCESS || results->rgNameInfo.empty()) {
+            Fail("query failed");
+        }
+    });
+    Report(name, usPerOp, iterations, simulator->Stats());
+
+    if (nameCache) {
+        SetDeviceNameCacheEnabled(FALSE);
+    }
+}
+
+// What the display change thread does per change: query the active paths,
+// snapshot them and diff against the previous snapshot.
+void BenchChangeDiff(UINT32 iterations) {
+    auto simulator = MakeDesk(Win32DisplayTopologySimulatorOptions(), 0);
+    SetDisplayConfigBackend(simulator);
+    SetDeviceNameCacheEnabled(TRUE);
+
+    struct Win32QueryDisplayConfigOptions queryOptions;
+    queryOptions.activeOnly = TRUE;
+    auto previous = CollectActiveTargets(DoQueryDisplayConfig(queryOptions));
+    size_t changes = 0;
+    UINT32 i = 0;
+    auto usPerOp = Measure(iterations, [&]() {
+        simulator->SetAdvancedColorEnabled(kIntegratedAdapter, 0x1100, (i++ & 1) == 0);
+        auto current = CollectActiveTargets(DoQueryDisplayConfig(queryOptions));
+        changes += DiffActiveTargets(previous, current).size();
+        previous = current;
+    });
+    if (changes != iterations) {
+        Fail("diff missed advanced color changes");
+    }
+    Report("change query + collect + diff", usPerOp, iterations, simulator->Stats());
+    SetDeviceNameCacheEnabled(FALSE);
+}
+
+// Descriptors for every active target, fresh each time or, with a display
+// change thread standing in, from the cache, optionally with the white
+// levels read again.
+void BenchTargetDescriptors(const char *name, UINT32 iterations, BOOL cached, BOOL refreshWhiteLevels = FALSE) {
+    auto simulator = MakeDesk(Win32DisplayTopologySimulatorOptions(), 0);
+    SetDisplayConfigBackend(simulator);
+    if (cached) {
+        SetDeviceNameCacheEnabled(TRUE);
+    }
+
+    auto usPerOp = Measure(iterations, [refreshWhiteLevels]() {
+        auto descriptors = AcquireTargetDescriptors(FALSE, refreshWhiteLevels);
+        if (descriptors->error != ERROR_SUCCESS || descriptors->targets.size() != 3 ||
+            !descriptors->targets[2].hasSdrWhiteLevel || descriptors->targets[2].sdrWhiteLevel != 2500 ||
+            !descriptors->targets[2].hasColorMode ||
+            descriptors->targets[2].activeColorMode != TT_DISPLAYCONFIG_ADVANCED_COLOR_MODE_HDR) {
+            Fail("target descriptors are incomplete");
+        }
+    });
+    Report(name, usPerOp, iterations, simulator->Stats());
+
+    if (cached) {
+        SetDeviceNameCacheEnabled(FALSE);
+    }
+}
+
+BOOL IsActive(const std::shared_ptr<Win32DisplayTopologySimulator> &simulator, LUID adapterId, UINT32 id) {
+    auto active = simulator->ActiveTargets();
+    for (auto it = active.begin(); it != active.end(); it++) {
+        if (LuidEquals(it->first, adapterId) && it->second == id) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+// Swaps which of the two integrated monitors is on, back and forth. With an
+// adapter limit of two, the staged fallback can't go through its all-enabled
+// state, so every rejected validation ends in a failed toggle.
+void BenchToggle(const char *name, UINT32 iterations, double rejectRate, UINT32 integratedLimit, BOOL persistent) {
+    struct Win32DisplayTopologySimulatorOptions options;
+    options.validationRejectRate = rejectRate;
+    auto simulator = MakeDesk(options, integratedLimit);
+    SetDisplayConfigBackend(simulator);
+
+    struct Win32TransientDeviceId external = {kIntegratedAdapter, 0x1101};
+    struct Win32TransientDeviceId spare = {kIntegratedAdapter, 0x1102};
+    UINT32 planned = 0, staged = 0, failed = 0, modeSets = 0;
+    UINT32 i = 0;
+    auto usPerOp = Measure(iterations, [&]() {
+        auto args = std::make_shared<struct Win32DeviceConfigToggleEnabled>();
+        args->persistent = persistent;
+        BOOL toSpare = (i++ & 1) == 0;
+        args->enable.push_back(toSpare ? spare : external);
+        args->disable.push_back(toSpare ? external : spare);
+
+        struct Win32ToggleEnabledResult result;
+        auto error = ToggleEnabled(args, result);
+        modeSets += result.modeSets;
+        if (error != ERROR_SUCCESS) {
+            failed++;
+            return;
+        }
+        planned += result.strategy == TOGGLE_STRATEGY_PLANNED;
+        staged += result.strategy == TOGGLE_STRATEGY_STAGED;
+        if (IsActive(simulator, spare.adapterId, spare.id) != toSpare ||
+            IsActive(simulator, external.adapterId, external.id) == toSpare) {
+            Fail("toggle left the wrong displays enabled");
+        }
+    });
+
+    auto stats = simulator->Stats();
+    if (persistent && stats.databaseSaves != planned + staged) {
+        Fail("persistent toggle didn't save the configuration");
+    }
+    printf("%-34s %10.2f us/op  %6.2f modeSets/op  %6.2f simulated/op  planned %u  staged %u  failed %u\n",
+           name, usPerOp, (double)modeSets / iterations, (double)stats.modeSets / iterations, planned, staged, failed);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    UINT32 iterations = argc > 1 ? (UINT32)atoi(argv[1]) : 20000;
+    if (iterations < 10) {
+        iterations = 10;
+    }
+
+    BenchQuery("query all paths", iterations, 0, FALSE, FALSE);
+    BenchQuery("query all paths, 20% races", iterations, 0.2, FALSE, FALSE);
+    BenchQuery("query all paths, name cache", iterations, 0, FALSE, TRUE);
+    BenchQuery("query active paths", iterations, 0, TRUE, FALSE);
+    BenchQuery("query active paths, name cache", iterations, 0, TRUE, TRUE);
+    BenchChangeDiff(iterations);
+    BenchTargetDescriptors("target descriptors", iterations, FALSE);
+    BenchTargetDescriptors("target descriptors, cached", iterations, TRUE);
+    BenchTargetDescriptors("target descriptors, white levels", iterations, TRUE, TRUE);
+    BenchToggle("toggle enabled", iterations / 10, 0, 0, FALSE);
+    BenchToggle("toggle enabled, persistent", iterations / 10, 0, 0, TRUE);
+    BenchToggle("toggle enabled, 30% rejected", iterations / 10, 0.3, 0, FALSE);
+    BenchToggle("toggle enabled, adapter limit 2", iterations / 10, 0.3, 2, FALSE);
+
+    SetDisplayConfigBackend(nullptr);
+    return 0;
+}
@@ -10,7 +10,8 @@
             "cflags_cc": [ "-std=c++20" ],
             "conditions": [
                 ["OS=='win'", {
-                    "sources": ["win32-displayconfig.cc"]
+                    "sources": ["win32-displayconfig.cc", "displayconfig_core.cc", "displayconfig_backend.cc"],
+                    "libraries": ["Shcore.lib"]
                 }],
             ],
             "include_dirs": [
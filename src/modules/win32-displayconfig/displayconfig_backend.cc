@@ -0,0 +1,81 @@
+/*
+ * displayconfig_backend.cc: part of the "win32-displayconfig" Node package.
+ * See the COPYRIGHT file at the top-level directory of this distribution.
+ */
+#include "displayconfig_backend.h"
+
+#include <mutex>
+
+namespace {
+
+#ifdef _WIN32
+class Win32SystemDisplayConfigBackend : public Win32DisplayConfigBackend {
+   public:
+    LONG GetBufferSizes(UINT32 flags, UINT32 *numPathArrayElements, UINT32 *numModeInfoArrayElements) override {
+        return GetDisplayConfigBufferSizes(flags, numPathArrayElements, numModeInfoArrayElements);
+    }
+
+    LONG Query(
+        UINT32 flags,
+        UINT32 *numPathArrayElements,
+        DISPLAYCONFIG_PATH_INFO *pathArray,
+        UINT32 *numModeInfoArrayElements,
+        DISPLAYCONFIG_MODE_INFO *modeInfoArray) override {
+        return QueryDisplayConfig(flags, numPathArrayElements, pathArray, numModeInfoArrayElements, modeInfoArray, NULL);
+    }
+
+    LONG Set(
+        UINT32 numPathArrayElements,
+        DISPLAYCONFIG_PATH_INFO *pathArray,
+        UINT32 numModeInfoArrayElements,
+        DISPLAYCONFIG_MODE_INFO *modeInfoArray,
+        UINT32 flags) override {
+        return SetDisplayConfig(numPathArrayElements, pathArray, numModeInfoArrayElements, modeInfoArray, flags);
+    }
+
+    LONG GetDeviceInfo(DISPLAYCONFIG_DEVICE_INFO_HEADER *requestPacket) override {
+        return DisplayConfigGetDeviceInfo(requestPacket);
+    }
+};
+
+typedef Win32SystemDisplayConfigBackend Win32DefaultDisplayConfigBackend;
+#else
+class Win32UnsupportedDisplayConfigBackend : public Win32DisplayConfigBackend {
+   public:
+    LONG GetBufferSizes(UINT32, UINT32 *, UINT32 *) override {
+        return ERROR_NOT_SUPPORTED;
+    }
+
+    LONG Query(UINT32, UINT32 *, DISPLAYCONFIG_PATH_INFO *, UINT32 *, DISPLAYCONFIG_MODE_INFO *) override {
+        return ERROR_NOT_SUPPORTED;
+    }
+
+    LONG Set(UINT32, DISPLAYCONFIG_PATH_INFO *, UINT32, DISPLAYCONFIG_MODE_INFO *, UINT32) override {
+        return ERROR_NOT_SUPPORTED;
+    }
+
+    LONG GetDeviceInfo(DISPLAYCONFIG_DEVICE_INFO_HEADER *) override {
+        return ERROR_NOT_SUPPORTED;
+    }
+};
+
+typedef Win32UnsupportedDisplayConfigBackend Win32DefaultDisplayConfigBackend;
+#endif
+
+std::mutex backendMutex;
+std::shared_ptr<Win32DisplayConfigBackend> backend;
+
+}  // namespace
+
+std::shared_ptr<Win32DisplayConfigBackend> DisplayConfigBackend() {
+    std::lock_guard<std::mutex> lock(backendMutex);
+    if (!backend) {
+        backend = std::make_shared<Win32DefaultDisplayConfigBackend>();
+    }
+    return backend;
+}
+
+void SetDisplayConfigBackend(std::shared_ptr<Win32DisplayConfigBackend> replacement) {
+    std::lock_guard<std::mutex> lock(backendMutex);
+    backend = replacement;
+}
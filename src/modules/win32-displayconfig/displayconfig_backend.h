@@ -0,0 +1,81 @@
+/*
+ * displayconfig_backend.h: part of the "win32-displayconfig" Node package.
+ * See the COPYRIGHT file at the top-level directory of this distribution.
+ */
+#ifndef WIN32_DISPLAYCONFIG_BACKEND_H
+#define WIN32_DISPLAYCONFIG_BACKEND_H
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include "displayconfig_win32_types.h"
+#endif
+
+#include <memory>
+
+// DISPLAYCONFIG_GET_ADVANCED_COLOR_INFO_2 (Windows 11 24H2+) reports the
+// active color mode, which tells HDR from SDR with Auto Color Management
+// where the legacy struct reports advancedColorEnabled for both. Defined
+// here, with distinct names, so this builds with older SDKs; on older
+// Windows the call fails and only the legacy state is known.
+enum {
+    TT_DISPLAYCONFIG_DEVICE_INFO_GET_ADVANCED_COLOR_INFO_2 = 15
+};
+
+typedef enum {
+    TT_DISPLAYCONFIG_ADVANCED_COLOR_MODE_SDR = 0,
+    TT_DISPLAYCONFIG_ADVANCED_COLOR_MODE_WCG = 1,
+    TT_DISPLAYCONFIG_ADVANCED_COLOR_MODE_HDR = 2
+} TT_DISPLAYCONFIG_ADVANCED_COLOR_MODE;
+
+typedef struct TT_DISPLAYCONFIG_GET_ADVANCED_COLOR_INFO_2 {
+    DISPLAYCONFIG_DEVICE_INFO_HEADER header;
+    union {
+        struct {
+            UINT32 advancedColorSupported : 1;
+            UINT32 advancedColorActive : 1;
+            UINT32 reserved1 : 1;
+            UINT32 advancedColorLimitedByPolicy : 1;
+            UINT32 highDynamicRangeSupported : 1;
+            UINT32 highDynamicRangeUserEnabled : 1;
+            UINT32 wideColorSupported : 1;
+            UINT32 wideColorUserEnabled : 1;
+            UINT32 reserved : 24;
+        };
+        UINT32 value;
+    };
+    DISPLAYCONFIG_COLOR_ENCODING colorEncoding;
+    UINT32 bitsPerColorChannel;
+    TT_DISPLAYCONFIG_ADVANCED_COLOR_MODE activeColorMode;
+} TT_DISPLAYCONFIG_GET_ADVANCED_COLOR_INFO_2;
+
+// Everything the display configuration code asks of Windows. The system
+// backend forwards to user32; the topology simulator stands in for it where
+// there are no real displays to talk to.
+class Win32DisplayConfigBackend {
+   public:
+    virtual ~Win32DisplayConfigBackend() {}
+
+    virtual LONG GetBufferSizes(UINT32 flags, UINT32 *numPathArrayElements, UINT32 *numModeInfoArrayElements) = 0;
+    virtual LONG Query(
+        UINT32 flags,
+        UINT32 *numPathArrayElements,
+        DISPLAYCONFIG_PATH_INFO *pathArray,
+        UINT32 *numModeInfoArrayElements,
+        DISPLAYCONFIG_MODE_INFO *modeInfoArray) = 0;
+    virtual LONG Set(
+        UINT32 numPathArrayElements,
+        DISPLAYCONFIG_PATH_INFO *pathArray,
+        UINT32 numModeInfoArrayElements,
+        DISPLAYCONFIG_MODE_INFO *modeInfoArray,
+        UINT32 flags) = 0;
+    virtual LONG GetDeviceInfo(DISPLAYCONFIG_DEVICE_INFO_HEADER *requestPacket) = 0;
+};
+
+// The backend every query and mode set goes through. On Windows this is the
+// system backend until another one is installed; elsewhere every call fails
+// with ERROR_NOT_SUPPORTED until one is.
+std::shared_ptr<Win32DisplayConfigBackend> DisplayConfigBackend();
+void SetDisplayConfigBackend(std::shared_ptr<Win32DisplayConfigBackend> backend);
+
+#endif
@@ -0,0 +1,869 @@
+/*
+ * displayconfig_core.cc: part of the "win32-displayconfig" Node package.
+ * See the COPYRIGHT file at the top-level directory of this distribution.
+ */
+#include "displayconfig_core.h"
+
+#include <algorithm>
+#include <set>
+
+bool TransientDeviceIdVectorContains(const std::vector<struct Win32TransientDeviceId> &vec, struct Win32TransientDeviceId &dev) {
+    for (auto it = vec.begin(); it != vec.end(); it++) {
+        if (it->adapterId.LowPart != dev.adapterId.LowPart) {
+            continue;
+        }
+        if (it->adapterId.HighPart != dev.adapterId.HighPart) {
+            continue;
+        }
+        if (it->id != dev.id) {
+            continue;
+        }
+        return true;
+    }
+    return false;
+}
+
+// Device names only change along with the display topology, so they are kept
+// between queries for as long as a display change thread is running to clear
+// them. Without one there is nothing to say when they go stale, and every
+// query asks Windows again.
+std::mutex deviceNameCacheMutex;
+std::map<Win32DeviceNameKey, struct Win32DeviceNameInfo> deviceNameCache;
+// Bumped on every invalidation, so a query that started before a display
+// change can't put its names back into the cache afterwards.
+UINT64 deviceNameCacheGeneration = 0;
+LONG deviceNameCacheUsers = 0;
+// Target descriptors go stale along with the names, so they share the lock
+// and the generation.
+std::shared_ptr<const struct Win32TargetDescriptors> targetDescriptorCache;
+
+void InvalidateDeviceNameCache() {
+    std::lock_guard<std::mutex> lock(deviceNameCacheMutex);
+    deviceNameCache.clear();
+    targetDescriptorCache = nullptr;
+    deviceNameCacheGeneration++;
+}
+
+void SetDeviceNameCacheEnabled(BOOL enabled) {
+    std::lock_guard<std::mutex> lock(deviceNameCacheMutex);
+    deviceNameCacheUsers += enabled ? 1 : -1;
+    deviceNameCache.clear();
+    targetDescriptorCache = nullptr;
+    deviceNameCacheGeneration++;
+}
+
+void AcquireDeviceNames(std::shared_ptr<struct Win32QueryDisplayConfigResults> configResults) {
+    DISPLAYCONFIG_TARGET_DEVICE_NAME request;
+    request.header.type = DISPLAYCONFIG_DEVICE_INFO_GET_TARGET_NAME;
+    request.header.size = sizeof(request);
+
+    BOOL useCache;
+    UINT64 cacheGeneration;
+    std::vector<struct Win32DeviceNameInfo> uncached;
+    std::set<Win32DeviceNameKey> seen;
+    auto backend = DisplayConfigBackend();
+
+    std::unique_lock<std::mutex> lock(deviceNameCacheMutex);
+    useCache = deviceNameCacheUsers > 0;
+    cacheGeneration = deviceNameCacheGeneration;
+
+    for (auto it = configResults->rgPathInfo.begin(); it != configResults->rgPathInfo.end(); it++) {
+        Win32DeviceNameKey key(it->targetInfo.adapterId.LowPart, it->targetInfo.adapterId.HighPart, it->targetInfo.id);
+        if (!seen.insert(key).second) {
+            continue;
+        }
+
+        if (useCache) {
+            auto cached = deviceNameCache.find(key);
+            if (cached != deviceNameCache.end()) {
+                configResults->rgNameInfo.push_back(cached->second);
+                continue;
+            }
+        }
+
+        // Don't hold the cache while waiting on the driver.
+        lock.unlock();
+
+        request.header.adapterId.LowPart = it->targetInfo.adapterId.LowPart;
+        request.header.adapterId.HighPart = it->targetInfo.adapterId.HighPart;
+        request.header.id = it->targetInfo.id;
+        request.monitorFriendlyDeviceName[0] = '\0';
+        request.monitorDevicePath[0] = '\0';
+
+        auto error = backend->GetDeviceInfo(&request.header);
+        lock.lock();
+        if (error != ERROR_SUCCESS) {
+            // In the event of failure, drop your breakpoint/logging/evs here.
+            // No, we're not going to expose this to Node. It's too much work.
+            continue;
+        }
+
+        configResults->rgNameInfo.push_back(Win32DeviceNameInfo());
+        auto newEntry = configResults->rgNameInfo.end();
+        newEntry--;
+
+        newEntry->adapterId.LowPart = it->targetInfo.adapterId.LowPart;
+        newEntry->adapterId.HighPart = it->targetInfo.adapterId.HighPart;
+        newEntry->id = it->targetInfo.id;
+        newEntry->deviceFlags = request.flags;
+        newEntry->outputTechnology = request.outputTechnology;
+        newEntry->edidManufactureId = request.edidManufactureId;
+        newEntry->edidProductCodeId = request.edidProductCodeId;
+        newEntry->connectorInstance = request.connectorInstance;
+        wcscpy_s(newEntry->monitorFriendlyDeviceName, DEVICE_NAME_SIZE, request.monitorFriendlyDeviceName);
+        wcscpy_s(newEntry->monitorDevicePath, DEVICE_PATH_SIZE, request.monitorDevicePath);
+
+        if (useCache && cacheGeneration == deviceNameCacheGeneration) {
+            deviceNameCache[key] = *newEntry;
+        }
+    }
+}
+
+// Keeps only the paths to the requested targets. Mode indices stay valid,
+// since the mode array is left as it is.
+void FilterPathsByTargetId(std::shared_ptr<struct Win32QueryDisplayConfigResults> configResults, const std::vector<UINT32> &targetIds) {
+    std::set<UINT32> wanted(targetIds.begin(), targetIds.end());
+    auto &paths = configResults->rgPathInfo;
+    auto kept = paths.begin();
+    for (auto it = paths.begin(); it != paths.end(); it++) {
+        if (wanted.count(it->targetInfo.id) != 0) {
+            *kept++ = *it;
+        }
+    }
+    paths.erase(kept, paths.end());
+}
+
+std::shared_ptr<struct Win32QueryDisplayConfigResults> DoQueryDisplayConfig(const struct Win32QueryDisplayConfigOptions &options) {
+    UINT32 flags = options.activeOnly ? QDC_ONLY_ACTIVE_PATHS : QDC_ALL_PATHS;
+    UINT32 cPathInfo = 0, cModeInfo = 0, cPathInfoMax = 0, cModeInfoMax = 0;
+    auto backend = DisplayConfigBackend();
+    while (true) {
+        LONG errorCode = backend->GetBufferSizes(flags, &cPathInfo, &cModeInfo);
+        if (errorCode != ERROR_SUCCESS) {
+            cPathInfo = cModeInfo = 0;
+        } else {
+            if (cPathInfo > cPathInfoMax) {
+                cPathInfoMax = cPathInfo;
+            }
+            cPathInfo = cPathInfoMax;
+
+            if (cModeInfo > cModeInfoMax) {
+                cModeInfoMax = cModeInfo;
+            }
+            cModeInfo = cModeInfoMax;
+        }
+
+        auto result = std::make_shared<struct Win32QueryDisplayConfigResults>(cPathInfo, cModeInfo);
+        if (errorCode != ERROR_SUCCESS) {
+            result->error = errorCode;
+            result->faultWasBuffer = true;
+            return result;
+        }
+
+        errorCode = backend->Query(flags, &cPathInfo, result->rgPathInfo.data(), &cModeInfo, result->rgModeInfo.data());
+        result->error = errorCode;
+        if (errorCode == ERROR_SUCCESS) {
+            result->rgPathInfo.resize(cPathInfo);
+            result->rgModeInfo.resize(cModeInfo);
+            if (!options.targetIds.empty()) {
+                FilterPathsByTargetId(result, options.targetIds);
+            }
+            AcquireDeviceNames(result);
+            if (options.namesOnly) {
+                result->rgPathInfo.clear();
+                result->rgModeInfo.clear();
+            }
+            return result;
+        } else if (errorCode != ERROR_INSUFFICIENT_BUFFER) {
+            result->faultWasBuffer = false;
+            return result;
+        }
+    }
+}
+
+bool LuidEquals(const LUID &left, const LUID &right) {
+    return left.LowPart == right.LowPart && left.HighPart == right.HighPart;
+}
+
+std::vector<struct Win32ActiveTargetState> CollectActiveTargets(const std::shared_ptr<struct Win32QueryDisplayConfigResults> &results) {
+    std::vector<struct Win32ActiveTargetState> targets;
+    auto backend = DisplayConfigBackend();
+
+    for (auto it = results->rgPathInfo.begin(); it != results->rgPathInfo.end(); it++) {
+        if ((it->flags & DISPLAYCONFIG_PATH_ACTIVE) != DISPLAYCONFIG_PATH_ACTIVE) {
+            continue;
+        }
+
+        struct Win32ActiveTargetState target = {};
+        target.adapterId = it->targetInfo.adapterId;
+        target.id = it->targetInfo.id;
+        target.rotation = it->targetInfo.rotation;
+        target.scaling = it->targetInfo.scaling;
+        target.refreshRate = it->targetInfo.refreshRate;
+
+        auto sourceModeIdx = it->sourceInfo.modeInfoIdx;
+        if (sourceModeIdx != DISPLAYCONFIG_PATH_MODE_IDX_INVALID &&
+            sourceModeIdx < results->rgModeInfo.size() &&
+            results->rgModeInfo[sourceModeIdx].infoType == DISPLAYCONFIG_MODE_INFO_TYPE_SOURCE) {
+            auto &sourceMode = results->rgModeInfo[sourceModeIdx].sourceMode;
+            target.hasSourceMode = TRUE;
+            target.width = sourceMode.width;
+            target.height = sourceMode.height;
+            target.position = sourceMode.position;
+        }
+
+        for (auto name = results->rgNameInfo.begin(); name != results->rgNameInfo.end(); name++) {
+            if (LuidEquals(name->adapterId, target.adapterId) && name->id == target.id) {
+                target.devicePath = name->monitorDevicePath;
+                break;
+            }
+        }
+
+        DISPLAYCONFIG_GET_ADVANCED_COLOR_INFO colorInfo = {};
+        colorInfo.header.type = DISPLAYCONFIG_DEVICE_INFO_GET_ADVANCED_COLOR_INFO;
+        colorInfo.header.size = sizeof(colorInfo);
+        colorInfo.header.adapterId = target.adapterId;
+        colorInfo.header.id = target.id;
+        if (backend->GetDeviceInfo(&colorInfo.header) == ERROR_SUCCESS) {
+            target.advancedColorSupported = colorInfo.advancedColorSupported;
+            target.advancedColorEnabled = colorInfo.advancedColorEnabled;
+        }
+
+        targets.push_back(target);
+    }
+
+    return targets;
+}
+
+std::vector<struct Win32DisplayConfigChange> DiffActiveTargets(
+    const std::vector<struct Win32ActiveTargetState> &before,
+    const std::vector<struct Win32ActiveTargetState> &after) {
+    std::vector<struct Win32DisplayConfigChange> changes;
+    auto addChange = [&changes](Win32DisplayConfigChangeType type,
+                                const struct Win32ActiveTargetState &from,
+                                const struct Win32ActiveTargetState &to) {
+        struct Win32DisplayConfigChange change;
+        change.type = type;
+        change.before = from;
+        change.after = to;
+        changes.push_back(change);
+    };
+
+    for (auto previous = before.begin(); previous != before.end(); previous++) {
+        auto current = after.begin();
+        for (; current != after.end(); current++) {
+            if (LuidEquals(current->adapterId, previous->adapterId) && current->id == previous->id) {
+                break;
+            }
+        }
+
+        if (current == after.end()) {
+            addChange(DISPLAY_CHANGE_REMOVED, *previous, *previous);
+            continue;
+        }
+
+        if (previous->hasSourceMode != current->hasSourceMode ||
+            previous->width != current->width ||
+            previous->height != current->height ||
+            previous->position.x != current->position.x ||
+            previous->position.y != current->position.y) {
+            addChange(DISPLAY_CHANGE_MODE, *previous, *current);
+        }
+        if (previous->rotation != current->rotation) {
+            addChange(DISPLAY_CHANGE_ROTATION, *previous, *current);
+        }
+        if (previous->scaling != current->scaling) {
+            addChange(DISPLAY_CHANGE_SCALING, *previous, *current);
+        }
+        // Compare the rationals by cross-multiplying; 60/1 and 60000/1000 are the same rate.
+        if ((UINT64)previous->refreshRate.Numerator * current->refreshRate.Denominator !=
+            (UINT64)current->refreshRate.Numerator * previous->refreshRate.Denominator) {
+            addChange(DISPLAY_CHANGE_REFRESH_RATE, *previous, *current);
+        }
+        if (previous->advancedColorEnabled != current->advancedColorEnabled ||
+            previous->advancedColorSupported != current->advancedColorSupported) {
+            addChange(DISPLAY_CHANGE_ADVANCED_COLOR, *previous, *current);
+        }
+    }
+
+    for (auto current = after.begin(); current != after.end(); current++) {
+        auto previous = before.begin();
+        for (; previous != before.end(); previous++) {
+            if (LuidEquals(current->adapterId, previous->adapterId) && current->id == previous->id) {
+                break;
+            }
+        }
+        if (previous == before.end()) {
+            addChange(DISPLAY_CHANGE_ADDED, *current, *current);
+        }
+    }
+
+    return changes;
+}
+
+void ReadSdrWhiteLevel(const std::shared_ptr<Win32DisplayConfigBackend> &backend, struct Win32TargetDescriptor &descriptor) {
+    DISPLAYCONFIG_SDR_WHITE_LEVEL whiteLevel = {};
+    whiteLevel.header.type = DISPLAYCONFIG_DEVICE_INFO_GET_SDR_WHITE_LEVEL;
+    whiteLevel.header.size = sizeof(whiteLevel);
+    whiteLevel.header.adapterId = descriptor.adapterId;
+    whiteLevel.header.id = descriptor.id;
+    descriptor.hasSdrWhiteLevel = backend->GetDeviceInfo(&whiteLevel.header) == ERROR_SUCCESS;
+    descriptor.sdrWhiteLevel = descriptor.hasSdrWhiteLevel ? whiteLevel.SDRWhiteLevel : 0;
+}
+
+std::vector<struct Win32TargetDescriptor> CollectTargetDescriptors(const std::shared_ptr<struct Win32QueryDisplayConfigResults> &results) {
+    std::vector<struct Win32TargetDescriptor> descriptors;
+    auto backend = DisplayConfigBackend();
+
+    for (auto it = results->rgPathInfo.begin(); it != results->rgPathInfo.end(); it++) {
+        if ((it->flags & DISPLAYCONFIG_PATH_ACTIVE) != DISPLAYCONFIG_PATH_ACTIVE) {
+            continue;
+        }
+
+        struct Win32TargetDescriptor descriptor = {};
+        descriptor.adapterId = it->targetInfo.adapterId;
+        descriptor.id = it->targetInfo.id;
+        descriptor.sourceId = it->sourceInfo.id;
+        descriptor.outputTechnology = it->targetInfo.outputTechnology;
+        descriptor.rotation = it->targetInfo.rotation;
+        descriptor.scaling = it->targetInfo.scaling;
+        descriptor.refreshRate = it->targetInfo.refreshRate;
+
+        auto sourceModeIdx = it->sourceInfo.modeInfoIdx;
+        if (sourceModeIdx != DISPLAYCONFIG_PATH_MODE_IDX_INVALID &&
+            sourceModeIdx < results->rgModeInfo.size() &&
+            results->rgModeInfo[sourceModeIdx].infoType == DISPLAYCONFIG_MODE_INFO_TYPE_SOURCE) {
+            descriptor.hasSourceMode = TRUE;
+            descriptor.sourceMode = results->rgModeInfo[sourceModeIdx].sourceMode;
+        }
+        auto targetModeIdx = it->targetInfo.modeInfoIdx;
+        if (targetModeIdx != DISPLAYCONFIG_PATH_MODE_IDX_INVALID &&
+            targetModeIdx < results->rgModeInfo.size() &&
+            results->rgModeInfo[targetModeIdx].infoType == DISPLAYCONFIG_MODE_INFO_TYPE_TARGET) {
+            descriptor.hasSignalInfo = TRUE;
+            descriptor.signalInfo = results->rgModeInfo[targetModeIdx].targetMode.targetVideoSignalInfo;
+        }
+
+        for (auto name = results->rgNameInfo.begin(); name != results->rgNameInfo.end(); name++) {
+            if (LuidEquals(name->adapterId, descriptor.adapterId) && name->id == descriptor.id) {
+                descriptor.friendlyName = name->monitorFriendlyDeviceName;
+                descriptor.devicePath = name->monitorDevicePath;
+                descriptor.edidManufactureId = name->edidManufactureId;
+                descriptor.edidProductCodeId = name->edidProductCodeId;
+                descriptor.connectorInstance = name->connectorInstance;
+                break;
+            }
+        }
+
+        DISPLAYCONFIG_GET_ADVANCED_COLOR_INFO colorInfo = {};
+        colorInfo.header.type = DISPLAYCONFIG_DEVICE_INFO_GET_ADVANCED_COLOR_INFO;
+        colorInfo.header.size = sizeof(colorInfo);
+        colorInfo.header.adapterId = descriptor.adapterId;
+        colorInfo.header.id = descriptor.id;
+        if (backend->GetDeviceInfo(&colorInfo.header) == ERROR_SUCCESS) {
+            descriptor.hasAdvancedColor = TRUE;
+            descriptor.advancedColorSupported = colorInfo.advancedColorSupported;
+            descriptor.advancedColorEnabled = colorInfo.advancedColorEnabled;
+            descriptor.wideColorEnforced = colorInfo.wideColorEnforced;
+            descriptor.advancedColorForceDisabled = colorInfo.advancedColorForceDisabled;
+            descriptor.colorEncoding = colorInfo.colorEncoding;
+            descriptor.bitsPerColorChannel = colorInfo.bitsPerColorChannel;
+        }
+
+        TT_DISPLAYCONFIG_GET_ADVANCED_COLOR_INFO_2 colorInfo2 = {};
+        colorInfo2.header.type = (DISPLAYCONFIG_DEVICE_INFO_TYPE)TT_DISPLAYCONFIG_DEVICE_INFO_GET_ADVANCED_COLOR_INFO_2;
+        colorInfo2.header.size = sizeof(colorInfo2);
+        colorInfo2.header.adapterId = descriptor.adapterId;
+        colorInfo2.header.id = descriptor.id;
+        if (backend->GetDeviceInfo(&colorInfo2.header) == ERROR_SUCCESS) {
+            descriptor.hasColorMode = TRUE;
+            descriptor.highDynamicRangeSupported = colorInfo2.highDynamicRangeSupported;
+            descriptor.highDynamicRangeUserEnabled = colorInfo2.highDynamicRangeUserEnabled;
+            descriptor.activeColorMode = colorInfo2.activeColorMode;
+        }
+
+        ReadSdrWhiteLevel(backend, descriptor);
+        descriptors.push_back(descriptor);
+    }
+
+    return descriptors;
+}
+
+// Served from the cache while a display change thread keeps it current.
+// `refresh` reads everything again regardless; the SDR white level can be
+// changed without Windows announcing a display change. `refreshWhiteLevels`
+// re-reads only that, one DisplayConfigGetDeviceInfo per cached target.
+std::shared_ptr<const struct Win32TargetDescriptors> AcquireTargetDescriptors(BOOL refresh, BOOL refreshWhiteLevels) {
+    BOOL useCache;
+    UINT64 cacheGeneration;
+    std::shared_ptr<const struct Win32TargetDescriptors> cached;
+    {
+        std::lock_guard<std::mutex> lock(deviceNameCacheMutex);
+        useCache = deviceNameCacheUsers > 0;
+        cacheGeneration = deviceNameCacheGeneration;
+        if (useCache && !refresh) {
+            cached = targetDescriptorCache;
+        }
+    }
+    if (cached && !refreshWhiteLevels) {
+        return cached;
+    }
+    if (cached) {
+        auto updated = std::make_shared<struct Win32TargetDescriptors>(*cached);
+        auto backend = DisplayConfigBackend();
+        for (auto &target : updated->targets) {
+            ReadSdrWhiteLevel(backend, target);
+        }
+
+        std::lock_guard<std::mutex> lock(deviceNameCacheMutex);
+        if (targetDescriptorCache == cached) {
+            targetDescriptorCache = updated;
+        }
+        return updated;
+    }
+
+    auto descriptors = std::make_shared<struct Win32TargetDescriptors>();
+    descriptors->generation = cacheGeneration;
+
+    struct Win32QueryDisplayConfigOptions activeOnly;
+    activeOnly.activeOnly = TRUE;
+    auto results = DoQueryDisplayConfig(activeOnly);
+    if (results->error != ERROR_SUCCESS) {
+        descriptors->error = results->error;
+        return descriptors;
+    }
+    descriptors->targets = CollectTargetDescriptors(results);
+
+    std::lock_guard<std::mutex> lock(deviceNameCacheMutex);
+    if (useCache && cacheGeneration == deviceNameCacheGeneration) {
+        targetDescriptorCache = descriptors;
+    }
+    return descriptors;
+}
+
+// The original approach, kept for topologies Windows won't accept in one
+// step: enable everything wanted, then query again and disable the rest.
+LONG ToggleEnabledStaged(
+    const std::shared_ptr<struct Win32DeviceConfigToggleEnabled> args,
+    const std::shared_ptr<struct Win32QueryDisplayConfigResults> initialQueryResults,
+    struct Win32ToggleEnabledResult &result) {
+    struct Win32TransientDeviceId currentPathDeviceId;
+    std::vector<DISPLAYCONFIG_PATH_INFO> preserve;
+    std::vector<struct Win32TransientDeviceId> alreadyEnabled;
+
+    // First, ensure that the already enabled devices are accounted for.
+    // Windows likes to report all the possible source modes for a given monitor,
+    // and we don't want to override them here: we just want to enable the ones
+    // that aren't enabled yet.
+    for (auto it = initialQueryResults->rgPathInfo.begin(); it != initialQueryResults->rgPathInfo.end(); it++) {
+        currentPathDeviceId.adapterId.LowPart = it->targetInfo.adapterId.LowPart;
+        currentPathDeviceId.adapterId.HighPart = it->targetInfo.adapterId.HighPart;
+        currentPathDeviceId.id = it->targetInfo.id;
+
+        if (it->sourceInfo.modeInfoIdx == DISPLAYCONFIG_PATH_MODE_IDX_INVALID ||
+            it->targetInfo.modeInfoIdx == DISPLAYCONFIG_PATH_MODE_IDX_INVALID) {
+            continue;
+        }
+
+        if ((it->flags & DISPLAYCONFIG_PATH_ACTIVE) == DISPLAYCONFIG_PATH_ACTIVE) {
+            auto copied = *it;
+            copied.sourceInfo.modeInfoIdx = DISPLAYCONFIG_PATH_MODE_IDX_INVALID;
+            copied.sourceInfo.statusFlags = 0;
+            copied.targetInfo.modeInfoIdx = DISPLAYCONFIG_PATH_MODE_IDX_INVALID;
+            copied.targetInfo.statusFlags = 0;
+            preserve.push_back(copied);
+            alreadyEnabled.push_back(currentPathDeviceId);
+        }
+    }
+
+    // Then, enable the devices we wanted to enable but haven't yet
+    for (auto it = initialQueryResults->rgPathInfo.begin(); it != initialQueryResults->rgPathInfo.end(); it++) {
+        currentPathDeviceId.adapterId.LowPart = it->targetInfo.adapterId.LowPart;
+        currentPathDeviceId.adapterId.HighPart = it->targetInfo.adapterId.HighPart;
+        currentPathDeviceId.id = it->targetInfo.id;
+
+        if (it->sourceInfo.modeInfoIdx == DISPLAYCONFIG_PATH_MODE_IDX_INVALID) {
+            continue;
+        }
+
+        if (TransientDeviceIdVectorContains(args->enable, currentPathDeviceId) &&
+            !TransientDeviceIdVectorContains(alreadyEnabled, currentPathDeviceId)) {
+            auto copied = *it;
+            copied.sourceInfo.modeInfoIdx = DISPLAYCONFIG_PATH_MODE_IDX_INVALID;
+            copied.sourceInfo.statusFlags = 0;
+            copied.targetInfo.modeInfoIdx = DISPLAYCONFIG_PATH_MODE_IDX_INVALID;
+            copied.targetInfo.statusFlags = 0;
+            copied.targetInfo.scaling = DISPLAYCONFIG_SCALING_PREFERRED;
+            copied.flags = DISPLAYCONFIG_PATH_ACTIVE;
+            preserve.push_back(copied);
+            alreadyEnabled.push_back(currentPathDeviceId);
+        }
+    }
+
+    // Then, enable all of the devices we know were or need to be enabled.
+    // Note that some disabled devices are still in here. Due to Windows being
+    // Windows, the only way out of this hole is to turn them all on, then turn off
+    // the ones we don't want.
+    auto error = DisplayConfigBackend()->Set(
+        preserve.size(),
+        preserve.data(),
+        0,
+        NULL,
+        SDC_APPLY | SDC_TOPOLOGY_SUPPLIED | SDC_ALLOW_PATH_ORDER_CHANGES);
+    result.modeSets++;
+
+    if (error != ERROR_SUCCESS) {
+        return error;
+    }
+
+    auto allOnQueryResults = DoQueryDisplayConfig();
+    if (allOnQueryResults->error != ERROR_SUCCESS) {
+        return allOnQueryResults->error;
+    }
+
+    preserve.clear();
+
+    // Finally, disable the monitors that shouldn't be there.
+    for (auto it = allOnQueryResults->rgPathInfo.begin(); it != allOnQueryResults->rgPathInfo.end(); it++) {
+        currentPathDeviceId.adapterId.LowPart = it->targetInfo.adapterId.LowPart;
+        currentPathDeviceId.adapterId.HighPart = it->targetInfo.adapterId.HighPart;
+        currentPathDeviceId.id = it->targetInfo.id;
+
+        if (it->sourceInfo.modeInfoIdx == DISPLAYCONFIG_PATH_MODE_IDX_INVALID ||
+            it->targetInfo.modeInfoIdx == DISPLAYCONFIG_PATH_MODE_IDX_INVALID) {
+            continue;
+        }
+
+        if (((it->flags & DISPLAYCONFIG_PATH_ACTIVE) == DISPLAYCONFIG_PATH_ACTIVE) &&
+            !TransientDeviceIdVectorContains(args->disable, currentPathDeviceId)) {
+            auto copied = *it;
+            copied.sourceInfo.modeInfoIdx = DISPLAYCONFIG_PATH_MODE_IDX_INVALID;
+            copied.sourceInfo.statusFlags = 0;
+            copied.targetInfo.modeInfoIdx = DISPLAYCONFIG_PATH_MODE_IDX_INVALID;
+            copied.targetInfo.statusFlags = 0;
+            preserve.push_back(copied);
+        }
+    }
+
+    error = DisplayConfigBackend()->Set(
+        preserve.size(),
+        preserve.data(),
+        0,
+        NULL,
+        SDC_APPLY | SDC_TOPOLOGY_SUPPLIED | SDC_ALLOW_PATH_ORDER_CHANGES);
+    result.modeSets++;
+    return error;
+}
+
+// A path as SDC_TOPOLOGY_SUPPLIED wants it: Windows picks the modes.
+DISPLAYCONFIG_PATH_INFO TopologyPath(const DISPLAYCONFIG_PATH_INFO &path) {
+    auto copied = path;
+    copied.sourceInfo.modeInfoIdx = DISPLAYCONFIG_PATH_MODE_IDX_INVALID;
+    copied.sourceInfo.statusFlags = 0;
+    copied.targetInfo.modeInfoIdx = DISPLAYCONFIG_PATH_MODE_IDX_INVALID;
+    copied.targetInfo.statusFlags = 0;
+    return copied;
+}
+
+// Computes the final topology in one go: the active paths that aren't being
+// disabled, plus the first available path to each display being enabled.
+// `changed` is set if that differs from what is active now.
+std::vector<DISPLAYCONFIG_PATH_INFO> PlanToggleEnabled(
+    const std::shared_ptr<struct Win32DeviceConfigToggleEnabled> args,
+    const std::shared_ptr<struct Win32QueryDisplayConfigResults> queryResults,
+    BOOL *changed) {
+    struct Win32TransientDeviceId currentPathDeviceId;
+    std::vector<DISPLAYCONFIG_PATH_INFO> plan;
+    std::vector<struct Win32TransientDeviceId> enabled;
+    *changed = FALSE;
+
+    for (auto it = queryResults->rgPathInfo.begin(); it != queryResults->rgPathInfo.end(); it++) {
+        currentPathDeviceId.adapterId = it->targetInfo.adapterId;
+        currentPathDeviceId.id = it->targetInfo.id;
+
+        if (it->sourceInfo.modeInfoIdx == DISPLAYCONFIG_PATH_MODE_IDX_INVALID ||
+            it->targetInfo.modeInfoIdx == DISPLAYCONFIG_PATH_MODE_IDX_INVALID ||
+            (it->flags & DISPLAYCONFIG_PATH_ACTIVE) != DISPLAYCONFIG_PATH_ACTIVE) {
+            continue;
+        }
+
+        if (TransientDeviceIdVectorContains(args->disable, currentPathDeviceId)) {
+            *changed = TRUE;
+            continue;
+        }
+        plan.push_back(TopologyPath(*it));
+        enabled.push_back(currentPathDeviceId);
+    }
+
+    for (auto it = queryResults->rgPathInfo.begin(); it != queryResults->rgPathInfo.end(); it++) {
+        currentPathDeviceId.adapterId = it->targetInfo.adapterId;
+        currentPathDeviceId.id = it->targetInfo.id;
+
+        if (it->sourceInfo.modeInfoIdx == DISPLAYCONFIG_PATH_MODE_IDX_INVALID) {
+            continue;
+        }
+
+        if (TransientDeviceIdVectorContains(args->enable, currentPathDeviceId) &&
+            !TransientDeviceIdVectorContains(args->disable, currentPathDeviceId) &&
+            !TransientDeviceIdVectorContains(enabled, currentPathDeviceId)) {
+            auto copied = TopologyPath(*it);
+            copied.targetInfo.scaling = DISPLAYCONFIG_SCALING_PREFERRED;
+            copied.flags = DISPLAYCONFIG_PATH_ACTIVE;
+            plan.push_back(copied);
+            enabled.push_back(currentPathDeviceId);
+            *changed = TRUE;
+        }
+    }
+
+    return plan;
+}
+
+LONG ToggleEnabled(const std::shared_ptr<struct Win32DeviceConfigToggleEnabled> args, struct Win32ToggleEnabledResult &result) {
+    auto initialQueryResults = DoQueryDisplayConfig();
+    if (initialQueryResults->error != ERROR_SUCCESS) {
+        return initialQueryResults->error;
+    }
+
+    BOOL changed;
+    auto plan = PlanToggleEnabled(args, initialQueryResults, &changed);
+    LONG error = ERROR_SUCCESS;
+
+    if (changed) {
+        // Every applied SetDisplayConfig is a full mode set, with the flicker
+        // that comes with it. Ask Windows whether it takes the final topology
+        // as-is before falling back to going through an all-enabled state.
+        result.validationError = DisplayConfigBackend()->Set(
+            plan.size(),
+            plan.data(),
+            0,
+            NULL,
+            SDC_VALIDATE | SDC_TOPOLOGY_SUPPLIED | SDC_ALLOW_PATH_ORDER_CHANGES);
+
+        if (result.validationError == ERROR_SUCCESS) {
+            result.strategy = TOGGLE_STRATEGY_PLANNED;
+            error = DisplayConfigBackend()->Set(
+                plan.size(),
+                plan.data(),
+                0,
+                NULL,
+                SDC_APPLY | SDC_TOPOLOGY_SUPPLIED | SDC_ALLOW_PATH_ORDER_CHANGES);
+            result.modeSets++;
+        } else {
+            result.strategy = TOGGLE_STRATEGY_STAGED;
+            error = ToggleEnabledStaged(args, initialQueryResults, result);
+        }
+    }
+
+    if (!args->persistent || error != ERROR_SUCCESS) {
+        return error;
+    }
+
+    // If we say "persistent", then we have to do this whole dance where we figure out
+    // what Windows decided to give us and hand it _back_ to Windows to save it.
+
+    auto persistentQueryResults = DoQueryDisplayConfig();
+    if (persistentQueryResults->error != ERROR_SUCCESS) {
+        return persistentQueryResults->error;
+    }
+
+    result.modeSets++;
+    return DisplayConfigBackend()->Set(
+        persistentQueryResults->rgPathInfo.size(),
+        persistentQueryResults->rgPathInfo.data(),
+        persistentQueryResults->rgModeInfo.size(),
+        persistentQueryResults->rgModeInfo.data(),
+        SDC_APPLY | SDC_USE_SUPPLIED_DISPLAY_CONFIG | SDC_SAVE_TO_DATABASE);
+}
+
+// Profiles are keyed by the sorted set of device paths they enable, so a
+// known desk setup maps to the same profile whichever order it was saved in.
+std::mutex displayProfilesMutex;
+std::map<std::wstring, std::shared_ptr<const struct Win32DisplayProfile>> displayProfiles;
+
+std::wstring DisplayProfileKey(std::vector<std::wstring> devicePaths) {
+    std::sort(devicePaths.begin(), devicePaths.end());
+    devicePaths.erase(std::unique(devicePaths.begin(), devicePaths.end()), devicePaths.end());
+    std::wstring key;
+    for (auto it = devicePaths.begin(); it != devicePaths.end(); it++) {
+        if (!key.empty()) {
+            key.push_back(L'\n');
+        }
+        key.append(*it);
+    }
+    return key;
+}
+
+std::shared_ptr<struct Win32DisplayProfile> CompileDisplayProfile(const std::vector<struct Win32DisplayProfileEntry> &entries) {
+    auto profile = std::make_shared<struct Win32DisplayProfile>();
+    DWORD dwModeInfoOffset = 0;
+    for (auto it = entries.begin(); it != entries.end(); it++) {
+        auto pathInfoCopy = it->pathInfo;
+        pathInfoCopy.sourceInfo.modeInfoIdx = dwModeInfoOffset++;
+        pathInfoCopy.targetInfo.modeInfoIdx = dwModeInfoOffset++;
+
+        profile->entryDevicePaths.push_back(it->devicePath);
+        profile->rgPathInfo.push_back(pathInfoCopy);
+        profile->rgModeInfo.push_back(it->sourceModeInfo);
+        profile->rgModeInfo.push_back(it->targetModeInfo);
+    }
+    return profile;
+}
+
+std::wstring StoreDisplayProfile(std::shared_ptr<const struct Win32DisplayProfile> profile) {
+    auto key = DisplayProfileKey(profile->entryDevicePaths);
+    std::lock_guard<std::mutex> lock(displayProfilesMutex);
+    displayProfiles[key] = profile;
+    return key;
+}
+
+std::shared_ptr<const struct Win32DisplayProfile> FindDisplayProfile(const std::wstring &key) {
+    std::lock_guard<std::mutex> lock(displayProfilesMutex);
+    auto found = displayProfiles.find(key);
+    if (found == displayProfiles.end()) {
+        return nullptr;
+    }
+    return found->second;
+}
+
+// Collects the active layout as profile entries, in path order.
+std::vector<struct Win32DisplayProfileEntry> CaptureDisplayProfileEntries(const std::shared_ptr<struct Win32QueryDisplayConfigResults> queryResults) {
+    std::vector<struct Win32DisplayProfileEntry> entries;
+    for (auto it = queryResults->rgPathInfo.begin(); it != queryResults->rgPathInfo.end(); it++) {
+        if ((it->flags & DISPLAYCONFIG_PATH_ACTIVE) != DISPLAYCONFIG_PATH_ACTIVE) {
+            continue;
+        }
+        auto sourceModeIdx = it->sourceInfo.modeInfoIdx;
+        auto targetModeIdx = it->targetInfo.modeInfoIdx;
+        if (sourceModeIdx >= queryResults->rgModeInfo.size() ||
+            targetModeIdx >= queryResults->rgModeInfo.size() ||
+            queryResults->rgModeInfo[sourceModeIdx].infoType != DISPLAYCONFIG_MODE_INFO_TYPE_SOURCE ||
+            queryResults->rgModeInfo[targetModeIdx].infoType != DISPLAYCONFIG_MODE_INFO_TYPE_TARGET) {
+            continue;
+        }
+
+        for (auto name = queryResults->rgNameInfo.begin(); name != queryResults->rgNameInfo.end(); name++) {
+            if (!LuidEquals(name->adapterId, it->targetInfo.adapterId) || name->id != it->targetInfo.id) {
+                continue;
+            }
+            if (name->monitorDevicePath[0] == L'\0') {
+                break;
+            }
+
+            struct Win32DisplayProfileEntry entry;
+            entry.devicePath = name->monitorDevicePath;
+            entry.pathInfo = *it;
+            entry.sourceModeInfo = queryResults->rgModeInfo[sourceModeIdx];
+            entry.targetModeInfo = queryResults->rgModeInfo[targetModeIdx];
+            entries.push_back(entry);
+            break;
+        }
+    }
+    return entries;
+}
+
+// Where each attached device path currently lives: the target's adapter and
+// ID, and the source adapter of a path to it, preferring an active path.
+std::map<std::wstring, struct Win32DeviceBinding> CurrentDeviceBindings(const std::shared_ptr<struct Win32QueryDisplayConfigResults> queryResults) {
+    std::map<Win32DeviceNameKey, std::wstring> devicePaths;
+    for (auto name = queryResults->rgNameInfo.begin(); name != queryResults->rgNameInfo.end(); name++) {
+        if (name->monitorDevicePath[0] != L'\0') {
+            devicePaths[Win32DeviceNameKey(name->adapterId.LowPart, name->adapterId.HighPart, name->id)] = name->monitorDevicePath;
+        }
+    }
+
+    std::map<std::wstring, struct Win32DeviceBinding> bindings;
+    for (int activePass = 1; activePass >= 0; activePass--) {
+        for (auto it = queryResults->rgPathInfo.begin(); it != queryResults->rgPathInfo.end(); it++) {
+            BOOL active = (it->flags & DISPLAYCONFIG_PATH_ACTIVE) == DISPLAYCONFIG_PATH_ACTIVE;
+            if (active != (BOOL)activePass || !it->targetInfo.targetAvailable) {
+                continue;
+            }
+            auto devicePath = devicePaths.find(Win32DeviceNameKey(it->targetInfo.adapterId.LowPart, it->targetInfo.adapterId.HighPart, it->targetInfo.id));
+            if (devicePath == devicePaths.end() || bindings.count(devicePath->second) != 0) {
+                continue;
+            }
+
+            struct Win32DeviceBinding binding = {};
+            binding.sourceId.adapterId = it->sourceInfo.adapterId;
+            binding.sourceId.id = it->sourceInfo.id;
+            binding.targetId.adapterId = it->targetInfo.adapterId;
+            binding.targetId.id = it->targetInfo.id;
+            bindings[devicePath->second] = binding;
+        }
+    }
+    return bindings;
+}
+
+// Restores a stored profile. With an empty key, the stored profile enabling the
+// most displays that are all attached is used. Fails with ERROR_NOT_FOUND if
+// there is no such profile or one of its displays isn't attached.
+LONG RestoreDisplayProfile(const std::wstring &requestedKey, BOOL persistent, struct Win32RestoreDisplayProfileResult &result) {
+    auto queryResults = DoQueryDisplayConfig();
+    if (queryResults->error != ERROR_SUCCESS) {
+        return queryResults->error;
+    }
+    auto bindings = CurrentDeviceBindings(queryResults);
+
+    std::shared_ptr<const struct Win32DisplayProfile> profile;
+    result.key = requestedKey;
+    if (!result.key.empty()) {
+        profile = FindDisplayProfile(result.key);
+    } else {
+        std::lock_guard<std::mutex> lock(displayProfilesMutex);
+        for (auto it = displayProfiles.begin(); it != displayProfiles.end(); it++) {
+            auto &paths = it->second->entryDevicePaths;
+            auto allAttached = std::all_of(paths.begin(), paths.end(), [&bindings](const std::wstring &path) {
+                return bindings.count(path) != 0;
+            });
+            if (allAttached && (!profile || paths.size() > profile->entryDevicePaths.size())) {
+                profile = it->second;
+                result.key = it->first;
+            }
+        }
+    }
+    if (!profile) {
+        return ERROR_NOT_FOUND;
+    }
+
+    // The compiled arrays are shared; bind a copy.
+    auto rgPathInfo = profile->rgPathInfo;
+    auto rgModeInfo = profile->rgModeInfo;
+    for (size_t i = 0; i < rgPathInfo.size(); i++) {
+        auto binding = bindings.find(profile->entryDevicePaths[i]);
+        if (binding == bindings.end()) {
+            result.missingDevices++;
+            continue;
+        }
+
+        // Take note: the source "id" fields are not modified.
+        // They actually are persistent across reboots, and have special
+        // meaning with respect to which extension is "primary" vs secondary.
+        rgPathInfo[i].sourceInfo.adapterId = binding->second.sourceId.adapterId;
+        rgPathInfo[i].targetInfo.adapterId = binding->second.targetId.adapterId;
+        rgPathInfo[i].targetInfo.id = binding->second.targetId.id;
+        rgModeInfo[2 * i].adapterId = binding->second.sourceId.adapterId;
+        rgModeInfo[2 * i + 1].adapterId = binding->second.targetId.adapterId;
+        rgModeInfo[2 * i + 1].id = binding->second.targetId.id;
+    }
+    if (result.missingDevices != 0) {
+        return ERROR_NOT_FOUND;
+    }
+
+    result.validationError = DisplayConfigBackend()->Set(
+        rgPathInfo.size(),
+        rgPathInfo.data(),
+        rgModeInfo.size(),
+        rgModeInfo.data(),
+        SDC_VALIDATE | SDC_USE_SUPPLIED_DISPLAY_CONFIG);
+    if (result.validationError != ERROR_SUCCESS) {
+        return result.validationError;
+    }
+
+    auto persistFlag = persistent ? SDC_SAVE_TO_DATABASE : 0;
+    return DisplayConfigBackend()->Set(
+        rgPathInfo.size(),
+        rgPathInfo.data(),
+        rgModeInfo.size(),
+        rgModeInfo.data(),
+        SDC_APPLY | SDC_USE_SUPPLIED_DISPLAY_CONFIG | persistFlag);
+}
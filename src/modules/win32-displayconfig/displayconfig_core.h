@@ -0,0 +1,246 @@
+/*
+ * displayconfig_core.h: part of the "win32-displayconfig" Node package.
+ * See the COPYRIGHT file at the top-level directory of this distribution.
+ */
+#ifndef WIN32_DISPLAYCONFIG_CORE_H
+#define WIN32_DISPLAYCONFIG_CORE_H
+
+// Querying, diffing and reconfiguring the display topology, independent of
+// Node. Everything here talks to Windows through DisplayConfigBackend(), so
+// it builds and runs against the topology simulator on any platform.
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "displayconfig_backend.h"
+
+const int DEVICE_NAME_SIZE = 64;   // 64 comes from DISPLAYCONFIG_TARGET_DEVICE_NAME.monitorFriendlyDeviceName
+const int DEVICE_PATH_SIZE = 128;  // 128 comes from DISPLAYCONFIG_TARGET_DEVICE_NAME.monitorDevicePath
+
+struct Win32DeviceNameInfo {
+    // Apparently, the adapterId is _not_ persistent between reboots.
+    // And yet, the id is. So we likely want to find a better name.
+    LUID adapterId;
+    UINT32 id;
+    DISPLAYCONFIG_TARGET_DEVICE_NAME_FLAGS deviceFlags;
+    DISPLAYCONFIG_VIDEO_OUTPUT_TECHNOLOGY outputTechnology;
+    UINT16 edidManufactureId;
+    UINT16 edidProductCodeId;
+    UINT32 connectorInstance;
+    WCHAR monitorFriendlyDeviceName[DEVICE_NAME_SIZE];
+    WCHAR monitorDevicePath[DEVICE_PATH_SIZE];
+};
+
+struct Win32QueryDisplayConfigResults {
+    Win32QueryDisplayConfigResults(UINT32 cPathInfo, UINT32 cModeInfo)
+        : error(ERROR_SUCCESS) {
+        this->rgPathInfo = std::vector<DISPLAYCONFIG_PATH_INFO>(cPathInfo);
+        this->rgModeInfo = std::vector<DISPLAYCONFIG_MODE_INFO>(cModeInfo);
+        this->rgNameInfo = std::vector<struct Win32DeviceNameInfo>();
+    }
+
+    std::vector<DISPLAYCONFIG_PATH_INFO> rgPathInfo;
+    std::vector<DISPLAYCONFIG_MODE_INFO> rgModeInfo;
+    std::vector<struct Win32DeviceNameInfo> rgNameInfo;
+    LONG error;
+    BOOL faultWasBuffer;
+};
+
+// Narrows what DoQueryDisplayConfig asks Windows for and hands back.
+// The defaults reproduce a plain QDC_ALL_PATHS query.
+struct Win32QueryDisplayConfigOptions {
+    Win32QueryDisplayConfigOptions() : activeOnly(FALSE), namesOnly(FALSE), targetIds() {}
+
+    // Query with QDC_ONLY_ACTIVE_PATHS instead of QDC_ALL_PATHS.
+    BOOL activeOnly;
+    // Only the names are wanted; drop the path and mode arrays afterwards.
+    BOOL namesOnly;
+    // If not empty, only paths to these target IDs are kept and named.
+    std::vector<UINT32> targetIds;
+};
+
+struct Win32TransientDeviceId {
+    LUID adapterId;
+    UINT32 id;
+};
+
+struct Win32DeviceConfigToggleEnabled {
+    Win32DeviceConfigToggleEnabled() : enable(), disable() {}
+
+    BOOL persistent;
+    std::vector<struct Win32TransientDeviceId> enable;
+    std::vector<struct Win32TransientDeviceId> disable;
+};
+
+enum Win32ToggleEnabledStrategy {
+    // The requested state was already in effect.
+    TOGGLE_STRATEGY_UNCHANGED,
+    // The final topology was validated and applied in one SetDisplayConfig call.
+    TOGGLE_STRATEGY_PLANNED,
+    // Validation rejected the plan, so everything was enabled and then the
+    // unwanted displays were disabled.
+    TOGGLE_STRATEGY_STAGED,
+};
+
+struct Win32ToggleEnabledResult {
+    Win32ToggleEnabledResult()
+        : error(ERROR_SUCCESS), strategy(TOGGLE_STRATEGY_UNCHANGED), modeSets(0), validationError(ERROR_SUCCESS) {}
+
+    LONG error;
+    Win32ToggleEnabledStrategy strategy;
+    // How many SetDisplayConfig calls applied a configuration.
+    UINT32 modeSets;
+    // What SDC_VALIDATE said about the planned topology.
+    LONG validationError;
+};
+
+// Where an attached display currently sits in the topology.
+struct Win32DeviceBinding {
+    struct Win32TransientDeviceId sourceId;
+    struct Win32TransientDeviceId targetId;
+};
+
+// A saved display layout, compiled into the arrays SetDisplayConfig takes.
+// Each path's source and target modes sit at 2i and 2i + 1. Adapter LUIDs
+// change across reboots, so they and the target IDs are bound again by
+// device path when the profile is restored.
+struct Win32DisplayProfile {
+    // The device path of each entry in rgPathInfo, in the same order.
+    std::vector<std::wstring> entryDevicePaths;
+    std::vector<DISPLAYCONFIG_PATH_INFO> rgPathInfo;
+    std::vector<DISPLAYCONFIG_MODE_INFO> rgModeInfo;
+};
+
+struct Win32DisplayProfileEntry {
+    std::wstring devicePath;
+    DISPLAYCONFIG_PATH_INFO pathInfo;
+    DISPLAYCONFIG_MODE_INFO sourceModeInfo;
+    DISPLAYCONFIG_MODE_INFO targetModeInfo;
+};
+
+// Snapshot of one active target, as compared between display changes.
+struct Win32ActiveTargetState {
+    LUID adapterId;
+    UINT32 id;
+    std::wstring devicePath;
+    BOOL hasSourceMode;
+    UINT32 width;
+    UINT32 height;
+    POINTL position;
+    DISPLAYCONFIG_ROTATION rotation;
+    DISPLAYCONFIG_SCALING scaling;
+    DISPLAYCONFIG_RATIONAL refreshRate;
+    BOOL advancedColorSupported;
+    BOOL advancedColorEnabled;
+};
+
+enum Win32DisplayConfigChangeType {
+    DISPLAY_CHANGE_ADDED,
+    DISPLAY_CHANGE_REMOVED,
+    DISPLAY_CHANGE_MODE,
+    DISPLAY_CHANGE_ROTATION,
+    DISPLAY_CHANGE_SCALING,
+    DISPLAY_CHANGE_REFRESH_RATE,
+    DISPLAY_CHANGE_ADVANCED_COLOR,
+};
+
+struct Win32DisplayConfigChange {
+    Win32DisplayConfigChangeType type;
+    struct Win32ActiveTargetState before;
+    struct Win32ActiveTargetState after;
+};
+
+// Everything known about one active target, gathered in one pass over the
+// active paths: names, the modes it runs at, and its color state.
+struct Win32TargetDescriptor {
+    LUID adapterId;
+    UINT32 id;
+    UINT32 sourceId;
+    std::wstring friendlyName;
+    std::wstring devicePath;
+    DISPLAYCONFIG_VIDEO_OUTPUT_TECHNOLOGY outputTechnology;
+    UINT16 edidManufactureId;
+    UINT16 edidProductCodeId;
+    UINT32 connectorInstance;
+    DISPLAYCONFIG_ROTATION rotation;
+    DISPLAYCONFIG_SCALING scaling;
+    DISPLAYCONFIG_RATIONAL refreshRate;
+    BOOL hasSourceMode;
+    DISPLAYCONFIG_SOURCE_MODE sourceMode;
+    BOOL hasSignalInfo;
+    DISPLAYCONFIG_VIDEO_SIGNAL_INFO signalInfo;
+    BOOL hasAdvancedColor;
+    BOOL advancedColorSupported;
+    BOOL advancedColorEnabled;
+    BOOL wideColorEnforced;
+    BOOL advancedColorForceDisabled;
+    DISPLAYCONFIG_COLOR_ENCODING colorEncoding;
+    UINT32 bitsPerColorChannel;
+    // Only known where Windows has ADVANCED_COLOR_INFO_2.
+    BOOL hasColorMode;
+    BOOL highDynamicRangeSupported;
+    BOOL highDynamicRangeUserEnabled;
+    TT_DISPLAYCONFIG_ADVANCED_COLOR_MODE activeColorMode;
+    BOOL hasSdrWhiteLevel;
+    // SDR white in nits is sdrWhiteLevel / 1000 * 80.
+    ULONG sdrWhiteLevel;
+};
+
+struct Win32TargetDescriptors {
+    Win32TargetDescriptors() : error(ERROR_SUCCESS), generation(0), targets() {}
+
+    LONG error;
+    // The device name cache generation the descriptors were read under. It
+    // only moves while a display change thread is running.
+    UINT64 generation;
+    std::vector<struct Win32TargetDescriptor> targets;
+};
+
+struct Win32RestoreDisplayProfileResult {
+    Win32RestoreDisplayProfileResult() : key(), validationError(ERROR_SUCCESS), missingDevices(0) {}
+
+    std::wstring key;
+    LONG validationError;
+    UINT32 missingDevices;
+};
+
+typedef std::tuple<DWORD, LONG, UINT32> Win32DeviceNameKey;
+
+bool TransientDeviceIdVectorContains(const std::vector<struct Win32TransientDeviceId> &vec, struct Win32TransientDeviceId &dev);
+bool LuidEquals(const LUID &left, const LUID &right);
+
+std::shared_ptr<struct Win32QueryDisplayConfigResults> DoQueryDisplayConfig(
+    const struct Win32QueryDisplayConfigOptions &options = Win32QueryDisplayConfigOptions());
+void InvalidateDeviceNameCache();
+void SetDeviceNameCacheEnabled(BOOL enabled);
+std::vector<struct Win32ActiveTargetState> CollectActiveTargets(const std::shared_ptr<struct Win32QueryDisplayConfigResults> &results);
+std::vector<struct Win32DisplayConfigChange> DiffActiveTargets(
+    const std::vector<struct Win32ActiveTargetState> &before,
+    const std::vector<struct Win32ActiveTargetState> &after);
+
+std::vector<struct Win32TargetDescriptor> CollectTargetDescriptors(const std::shared_ptr<struct Win32QueryDisplayConfigResults> &results);
+std::shared_ptr<const struct Win32TargetDescriptors> AcquireTargetDescriptors(BOOL refresh, BOOL refreshWhiteLevels = FALSE);
+
+DISPLAYCONFIG_PATH_INFO TopologyPath(const DISPLAYCONFIG_PATH_INFO &path);
+std::vector<DISPLAYCONFIG_PATH_INFO> PlanToggleEnabled(
+    const std::shared_ptr<struct Win32DeviceConfigToggleEnabled> args,
+    const std::shared_ptr<struct Win32QueryDisplayConfigResults> queryResults,
+    BOOL *changed);
+LONG ToggleEnabled(const std::shared_ptr<struct Win32DeviceConfigToggleEnabled> args, struct Win32ToggleEnabledResult &result);
+
+extern std::mutex displayProfilesMutex;
+extern std::map<std::wstring, std::shared_ptr<const struct Win32DisplayProfile>> displayProfiles;
+
+std::wstring DisplayProfileKey(std::vector<std::wstring> devicePaths);
+std::shared_ptr<struct Win32DisplayProfile> CompileDisplayProfile(const std::vector<struct Win32DisplayProfileEntry> &entries);
+std::wstring StoreDisplayProfile(std::shared_ptr<const struct Win32DisplayProfile> profile);
+std::shared_ptr<const struct Win32DisplayProfile> FindDisplayProfile(const std::wstring &key);
+std::vector<struct Win32DisplayProfileEntry> CaptureDisplayProfileEntries(const std::shared_ptr<struct Win32QueryDisplayConfigResults> queryResults);
+std::map<std::wstring, struct Win32DeviceBinding> CurrentDeviceBindings(const std::shared_ptr<struct Win32QueryDisplayConfigResults> queryResults);
+LONG RestoreDisplayProfile(const std::wstring &requestedKey, BOOL persistent, struct Win32RestoreDisplayProfileResult &result);
+
+#endif
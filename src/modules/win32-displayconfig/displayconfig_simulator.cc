@@ -0,0 +1,577 @@
+/*
+ * displayconfig_simulator.cc: part of the "win32-displayconfig" Node package.
+ * See the COPYRIGHT file at the top-level directory of this distribution.
+ */
+#include "displayconfig_simulator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <thread>
+
+namespace {
+
+bool SameLuid(const LUID &left, const LUID &right) {
+    return left.LowPart == right.LowPart && left.HighPart == right.HighPart;
+}
+
+bool SameSourceMode(const DISPLAYCONFIG_SOURCE_MODE &left, const DISPLAYCONFIG_SOURCE_MODE &right) {
+    return left.width == right.width && left.height == right.height &&
+           left.pixelFormat == right.pixelFormat &&
+           left.position.x == right.position.x && left.position.y == right.position.y;
+}
+
+// Unlike wcscpy_s, cuts names that don't fit instead of failing.
+void CopyName(WCHAR *dest, size_t destSize, const std::wstring &src) {
+    size_t i = 0;
+    for (; i + 1 < destSize && i < src.size(); i++) {
+        dest[i] = src[i];
+    }
+    dest[i] = L'\0';
+}
+
+}  // namespace
+
+Win32DisplayTopologySimulator::Win32DisplayTopologySimulator(const struct Win32DisplayTopologySimulatorOptions &options)
+    : options(options), rng(options.seed), stats() {}
+
+void Win32DisplayTopologySimulator::AddAdapter(LUID adapterId, UINT32 sources, UINT32 maxActiveTargets) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->adapters.push_back({adapterId, sources, maxActiveTargets});
+}
+
+void Win32DisplayTopologySimulator::AddTarget(const struct Win32SimulatedTarget &target) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->targets.push_back(target);
+}
+
+BOOL Win32DisplayTopologySimulator::Activate(LUID adapterId, UINT32 targetId) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    size_t targetIndex = 0, adapterIndex = 0;
+    auto target = this->FindTarget(adapterId, targetId, &targetIndex);
+    auto adapter = this->FindAdapter(adapterId, &adapterIndex);
+    if (target == NULL || adapter == NULL || !target->available) {
+        return FALSE;
+    }
+
+    std::set<UINT32> busy;
+    for (auto it = this->active.begin(); it != this->active.end(); it++) {
+        if (it->target == targetIndex) {
+            return TRUE;
+        }
+        if (it->adapter == adapterIndex) {
+            busy.insert(it->sourceId);
+        }
+    }
+
+    for (UINT32 sourceId = 0; sourceId < adapter->sources; sourceId++) {
+        if (busy.count(sourceId) != 0) {
+            continue;
+        }
+
+        auto next = this->active;
+        next.push_back({targetIndex, adapterIndex, sourceId, DISPLAYCONFIG_ROTATION_IDENTITY, DISPLAYCONFIG_SCALING_PREFERRED});
+        if (this->Validate(next) != ERROR_SUCCESS) {
+            return FALSE;
+        }
+
+        DISPLAYCONFIG_SOURCE_MODE mode = {};
+        mode.width = target->width;
+        mode.height = target->height;
+        mode.pixelFormat = DISPLAYCONFIG_PIXELFORMAT_32BPP;
+        mode.position = this->NextPosition(this->sourceModes);
+        this->sourceModes[SourceKey(adapterIndex, sourceId)] = mode;
+        this->active = next;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+void Win32DisplayTopologySimulator::SetTargetAvailable(LUID adapterId, UINT32 targetId, BOOL available) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    size_t targetIndex;
+    auto target = this->FindTarget(adapterId, targetId, &targetIndex);
+    if (target == NULL) {
+        return;
+    }
+    target->available = available;
+    if (available) {
+        return;
+    }
+
+    std::set<SourceKey> stillUsed;
+    auto kept = this->active.begin();
+    for (auto it = this->active.begin(); it != this->active.end(); it++) {
+        if (it->target != targetIndex) {
+            stillUsed.insert(SourceKey(it->adapter, it->sourceId));
+            *kept++ = *it;
+        }
+    }
+    this->active.erase(kept, this->active.end());
+    for (auto it = this->sourceModes.begin(); it != this->sourceModes.end();) {
+        if (stillUsed.count(it->first) == 0) {
+            it = this->sourceModes.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+void Win32DisplayTopologySimulator::SetAdvancedColorEnabled(LUID adapterId, UINT32 targetId, BOOL enabled) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto target = this->FindTarget(adapterId, targetId, NULL);
+    if (target != NULL && target->advancedColorSupported) {
+        target->advancedColorEnabled = enabled;
+    }
+}
+
+std::vector<std::pair<LUID, UINT32>> Win32DisplayTopologySimulator::ActiveTargets() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::vector<std::pair<LUID, UINT32>> result;
+    for (auto it = this->active.begin(); it != this->active.end(); it++) {
+        auto &target = this->targets[it->target];
+        result.push_back(std::make_pair(target.adapterId, target.id));
+    }
+    return result;
+}
+
+struct Win32DisplayTopologySimulatorStats Win32DisplayTopologySimulator::Stats() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->stats;
+}
+
+void Win32DisplayTopologySimulator::ResetStats() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stats = Win32DisplayTopologySimulatorStats();
+}
+
+LONG Win32DisplayTopologySimulator::GetBufferSizes(UINT32 flags, UINT32 *numPathArrayElements, UINT32 *numModeInfoArrayElements) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stats.bufferSizeCalls++;
+    this->Delay();
+
+    if (numPathArrayElements == NULL || numModeInfoArrayElements == NULL) {
+        return ERROR_INVALID_PARAMETER;
+    }
+    if (flags != QDC_ALL_PATHS && flags != QDC_ONLY_ACTIVE_PATHS) {
+        return ERROR_NOT_SUPPORTED;
+    }
+
+    std::vector<DISPLAYCONFIG_PATH_INFO> paths;
+    std::vector<DISPLAYCONFIG_MODE_INFO> modes;
+    this->Layout(flags, paths, modes);
+    *numPathArrayElements = (UINT32)paths.size();
+    *numModeInfoArrayElements = (UINT32)modes.size();
+    return ERROR_SUCCESS;
+}
+
+LONG Win32DisplayTopologySimulator::Query(
+    UINT32 flags,
+    UINT32 *numPathArrayElements,
+    DISPLAYCONFIG_PATH_INFO *pathArray,
+    UINT32 *numModeInfoArrayElements,
+    DISPLAYCONFIG_MODE_INFO *modeInfoArray) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stats.queryCalls++;
+    this->Delay();
+
+    if (numPathArrayElements == NULL || numModeInfoArrayElements == NULL) {
+        return ERROR_INVALID_PARAMETER;
+    }
+    if (flags != QDC_ALL_PATHS && flags != QDC_ONLY_ACTIVE_PATHS) {
+        return ERROR_NOT_SUPPORTED;
+    }
+
+    std::vector<DISPLAYCONFIG_PATH_INFO> paths;
+    std::vector<DISPLAYCONFIG_MODE_INFO> modes;
+    this->Layout(flags, paths, modes);
+
+    if (this->Roll(this->options.insufficientBufferRate)) {
+        this->stats.injectedBufferFaults++;
+        return ERROR_INSUFFICIENT_BUFFER;
+    }
+    if (paths.size() > *numPathArrayElements || modes.size() > *numModeInfoArrayElements) {
+        return ERROR_INSUFFICIENT_BUFFER;
+    }
+    if ((!paths.empty() && pathArray == NULL) || (!modes.empty() && modeInfoArray == NULL)) {
+        return ERROR_INVALID_PARAMETER;
+    }
+
+    std::copy(paths.begin(), paths.end(), pathArray);
+    std::copy(modes.begin(), modes.end(), modeInfoArray);
+    *numPathArrayElements = (UINT32)paths.size();
+    *numModeInfoArrayElements = (UINT32)modes.size();
+    return ERROR_SUCCESS;
+}
+
+LONG Win32DisplayTopologySimulator::Set(
+    UINT32 numPathArrayElements,
+    DISPLAYCONFIG_PATH_INFO *pathArray,
+    UINT32 numModeInfoArrayElements,
+    DISPLAYCONFIG_MODE_INFO *modeInfoArray,
+    UINT32 flags) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stats.setCalls++;
+    this->Delay();
+
+    BOOL topologySupplied = (flags & SDC_TOPOLOGY_SUPPLIED) != 0;
+    BOOL configSupplied = (flags & SDC_USE_SUPPLIED_DISPLAY_CONFIG) != 0;
+    if ((flags & (SDC_VALIDATE | SDC_APPLY)) == 0 || (topologySupplied && configSupplied)) {
+        return ERROR_INVALID_PARAMETER;
+    }
+    if (!topologySupplied && !configSupplied) {
+        // The clone/extend/internal/external presets aren't simulated.
+        return ERROR_NOT_SUPPORTED;
+    }
+    if (numPathArrayElements == 0 || pathArray == NULL) {
+        return ERROR_INVALID_PARAMETER;
+    }
+    if (topologySupplied && numModeInfoArrayElements != 0) {
+        return ERROR_INVALID_PARAMETER;
+    }
+    if (configSupplied && modeInfoArray == NULL) {
+        return ERROR_INVALID_PARAMETER;
+    }
+
+    std::vector<ActivePath> next;
+    std::map<SourceKey, DISPLAYCONFIG_SOURCE_MODE> nextModes;
+    for (UINT32 i = 0; i < numPathArrayElements; i++) {
+        auto &path = pathArray[i];
+        if ((path.flags & DISPLAYCONFIG_PATH_ACTIVE) != DISPLAYCONFIG_PATH_ACTIVE) {
+            continue;
+        }
+
+        size_t targetIndex = 0, adapterIndex = 0;
+        auto target = this->FindTarget(path.targetInfo.adapterId, path.targetInfo.id, &targetIndex);
+        auto adapter = this->FindAdapter(path.sourceInfo.adapterId, &adapterIndex);
+        if (target == NULL || adapter == NULL ||
+            !SameLuid(path.sourceInfo.adapterId, path.targetInfo.adapterId) ||
+            path.sourceInfo.id >= adapter->sources) {
+            return ERROR_INVALID_PARAMETER;
+        }
+
+        ActivePath entry;
+        entry.target = targetIndex;
+        entry.adapter = adapterIndex;
+        entry.sourceId = path.sourceInfo.id;
+        entry.rotation = path.targetInfo.rotation == 0 ? DISPLAYCONFIG_ROTATION_IDENTITY : path.targetInfo.rotation;
+        entry.scaling = path.targetInfo.scaling == 0 ? DISPLAYCONFIG_SCALING_PREFERRED : path.targetInfo.scaling;
+        next.push_back(entry);
+
+        if (configSupplied) {
+            auto sourceIdx = path.sourceInfo.modeInfoIdx;
+            auto targetIdx = path.targetInfo.modeInfoIdx;
+            if (sourceIdx >= numModeInfoArrayElements || targetIdx >= numModeInfoArrayElements ||
+                modeInfoArray[sourceIdx].infoType != DISPLAYCONFIG_MODE_INFO_TYPE_SOURCE ||
+                modeInfoArray[targetIdx].infoType != DISPLAYCONFIG_MODE_INFO_TYPE_TARGET) {
+                return ERROR_INVALID_PARAMETER;
+            }
+            nextModes[SourceKey(adapterIndex, entry.sourceId)] = modeInfoArray[sourceIdx].sourceMode;
+        }
+    }
+
+    if (next.empty()) {
+        return ERROR_INVALID_PARAMETER;
+    }
+    auto error = this->Validate(next);
+    if (error != ERROR_SUCCESS) {
+        return error;
+    }
+
+    if ((flags & SDC_VALIDATE) != 0) {
+        this->stats.validations++;
+        return this->Roll(this->options.validationRejectRate) ? ERROR_BAD_CONFIGURATION : ERROR_SUCCESS;
+    }
+
+    if (topologySupplied) {
+        // Sources that stay on keep their modes; newly enabled ones get their
+        // display's preferred mode to the right of everything else.
+        for (auto it = next.begin(); it != next.end(); it++) {
+            SourceKey key(it->adapter, it->sourceId);
+            auto current = this->sourceModes.find(key);
+            if (current != this->sourceModes.end()) {
+                nextModes[key] = current->second;
+            }
+        }
+        for (auto it = next.begin(); it != next.end(); it++) {
+            SourceKey key(it->adapter, it->sourceId);
+            if (nextModes.count(key) != 0) {
+                continue;
+            }
+            DISPLAYCONFIG_SOURCE_MODE mode = {};
+            mode.width = this->targets[it->target].width;
+            mode.height = this->targets[it->target].height;
+            mode.pixelFormat = DISPLAYCONFIG_PIXELFORMAT_32BPP;
+            mode.position = this->NextPosition(nextModes);
+            nextModes[key] = mode;
+        }
+    }
+
+    BOOL changed = next.size() != this->active.size() || nextModes.size() != this->sourceModes.size();
+    for (size_t i = 0; !changed && i < next.size(); i++) {
+        changed = next[i].target != this->active[i].target ||
+                  next[i].sourceId != this->active[i].sourceId ||
+                  next[i].rotation != this->active[i].rotation ||
+                  next[i].scaling != this->active[i].scaling;
+    }
+    for (auto it = nextModes.begin(); !changed && it != nextModes.end(); it++) {
+        auto current = this->sourceModes.find(it->first);
+        changed = current == this->sourceModes.end() || !SameSourceMode(current->second, it->second);
+    }
+
+    if (changed) {
+        this->stats.modeSets++;
+    }
+    if ((flags & SDC_SAVE_TO_DATABASE) != 0) {
+        this->stats.databaseSaves++;
+    }
+    this->active = next;
+    this->sourceModes = nextModes;
+    return ERROR_SUCCESS;
+}
+
+LONG Win32DisplayTopologySimulator::GetDeviceInfo(DISPLAYCONFIG_DEVICE_INFO_HEADER *requestPacket) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stats.deviceInfoCalls++;
+    this->Delay();
+
+    if (requestPacket == NULL) {
+        return ERROR_INVALID_PARAMETER;
+    }
+    auto target = this->FindTarget(requestPacket->adapterId, requestPacket->id, NULL);
+    if (target == NULL) {
+        return ERROR_INVALID_PARAMETER;
+    }
+
+    switch ((int)requestPacket->type) {
+        case DISPLAYCONFIG_DEVICE_INFO_GET_TARGET_NAME: {
+            if (requestPacket->size != sizeof(DISPLAYCONFIG_TARGET_DEVICE_NAME)) {
+                return ERROR_INVALID_PARAMETER;
+            }
+            auto request = (DISPLAYCONFIG_TARGET_DEVICE_NAME *)requestPacket;
+            request->flags.value = 0;
+            request->flags.friendlyNameFromEdid = 1;
+            request->flags.edidIdsValid = 1;
+            request->outputTechnology = target->outputTechnology;
+            request->edidManufactureId = target->edidManufactureId;
+            request->edidProductCodeId = target->edidProductCodeId;
+            request->connectorInstance = 1;
+            CopyName(request->monitorFriendlyDeviceName, sizeof(request->monitorFriendlyDeviceName) / sizeof(WCHAR), target->friendlyName);
+            CopyName(request->monitorDevicePath, sizeof(request->monitorDevicePath) / sizeof(WCHAR), target->devicePath);
+            return ERROR_SUCCESS;
+        }
+        case DISPLAYCONFIG_DEVICE_INFO_GET_ADVANCED_COLOR_INFO: {
+            if (requestPacket->size != sizeof(DISPLAYCONFIG_GET_ADVANCED_COLOR_INFO)) {
+                return ERROR_INVALID_PARAMETER;
+            }
+            auto request = (DISPLAYCONFIG_GET_ADVANCED_COLOR_INFO *)requestPacket;
+            request->value = 0;
+            request->advancedColorSupported = target->advancedColorSupported ? 1 : 0;
+            request->advancedColorEnabled = target->advancedColorEnabled ? 1 : 0;
+            request->colorEncoding = DISPLAYCONFIG_COLOR_ENCODING_RGB;
+            request->bitsPerColorChannel = target->advancedColorEnabled ? 10 : 8;
+            return ERROR_SUCCESS;
+        }
+        case TT_DISPLAYCONFIG_DEVICE_INFO_GET_ADVANCED_COLOR_INFO_2: {
+            if (requestPacket->size != sizeof(TT_DISPLAYCONFIG_GET_ADVANCED_COLOR_INFO_2)) {
+                return ERROR_INVALID_PARAMETER;
+            }
+            // Simulated advanced color is always HDR, never Auto Color Management.
+            auto request = (TT_DISPLAYCONFIG_GET_ADVANCED_COLOR_INFO_2 *)requestPacket;
+            request->value = 0;
+            request->advancedColorSupported = target->advancedColorSupported ? 1 : 0;
+            request->advancedColorActive = target->advancedColorEnabled ? 1 : 0;
+            request->highDynamicRangeSupported = target->advancedColorSupported ? 1 : 0;
+            request->highDynamicRangeUserEnabled = target->advancedColorEnabled ? 1 : 0;
+            request->colorEncoding = DISPLAYCONFIG_COLOR_ENCODING_RGB;
+            request->bitsPerColorChannel = target->advancedColorEnabled ? 10 : 8;
+            request->activeColorMode = target->advancedColorEnabled
+                ? TT_DISPLAYCONFIG_ADVANCED_COLOR_MODE_HDR
+                : TT_DISPLAYCONFIG_ADVANCED_COLOR_MODE_SDR;
+            return ERROR_SUCCESS;
+        }
+        case DISPLAYCONFIG_DEVICE_INFO_GET_SDR_WHITE_LEVEL: {
+            if (requestPacket->size != sizeof(DISPLAYCONFIG_SDR_WHITE_LEVEL)) {
+                return ERROR_INVALID_PARAMETER;
+            }
+            auto request = (DISPLAYCONFIG_SDR_WHITE_LEVEL *)requestPacket;
+            request->SDRWhiteLevel = target->sdrWhiteLevel;
+            return ERROR_SUCCESS;
+        }
+        default:
+            return ERROR_NOT_SUPPORTED;
+    }
+}
+
+void Win32DisplayTopologySimulator::Delay() {
+    if (this->options.callLatencyMicroseconds != 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(this->options.callLatencyMicroseconds));
+    }
+}
+
+BOOL Win32DisplayTopologySimulator::Roll(double rate) {
+    if (rate <= 0) {
+        return FALSE;
+    }
+    return std::uniform_real_distribution<double>(0, 1)(this->rng) < rate;
+}
+
+Win32DisplayTopologySimulator::Adapter *Win32DisplayTopologySimulator::FindAdapter(const LUID &adapterId, size_t *index) {
+    for (size_t i = 0; i < this->adapters.size(); i++) {
+        if (SameLuid(this->adapters[i].adapterId, adapterId)) {
+            if (index != NULL) {
+                *index = i;
+            }
+            return &this->adapters[i];
+        }
+    }
+    return NULL;
+}
+
+struct Win32SimulatedTarget *Win32DisplayTopologySimulator::FindTarget(const LUID &adapterId, UINT32 id, size_t *index) {
+    for (size_t i = 0; i < this->targets.size(); i++) {
+        if (SameLuid(this->targets[i].adapterId, adapterId) && this->targets[i].id == id) {
+            if (index != NULL) {
+                *index = i;
+            }
+            return &this->targets[i];
+        }
+    }
+    return NULL;
+}
+
+void Win32DisplayTopologySimulator::Layout(UINT32 flags, std::vector<DISPLAYCONFIG_PATH_INFO> &paths, std::vector<DISPLAYCONFIG_MODE_INFO> &modes) {
+    std::map<SourceKey, UINT32> sourceModeIdx;
+    auto sourceMode = [this, &modes, &sourceModeIdx](const SourceKey &key) {
+        auto found = sourceModeIdx.find(key);
+        if (found != sourceModeIdx.end()) {
+            return found->second;
+        }
+
+        DISPLAYCONFIG_MODE_INFO mode = {};
+        mode.infoType = DISPLAYCONFIG_MODE_INFO_TYPE_SOURCE;
+        mode.id = key.second;
+        mode.adapterId = this->adapters[key.first].adapterId;
+        auto current = this->sourceModes.find(key);
+        if (current != this->sourceModes.end()) {
+            mode.sourceMode = current->second;
+        } else {
+            mode.sourceMode.width = 1024;
+            mode.sourceMode.height = 768;
+            mode.sourceMode.pixelFormat = DISPLAYCONFIG_PIXELFORMAT_32BPP;
+        }
+
+        UINT32 idx = (UINT32)modes.size();
+        modes.push_back(mode);
+        sourceModeIdx[key] = idx;
+        return idx;
+    };
+
+    std::set<size_t> activeTargets;
+    for (auto it = this->active.begin(); it != this->active.end(); it++) {
+        auto &target = this->targets[it->target];
+        activeTargets.insert(it->target);
+
+        DISPLAYCONFIG_PATH_INFO path = {};
+        path.sourceInfo.adapterId = target.adapterId;
+        path.sourceInfo.id = it->sourceId;
+        path.sourceInfo.modeInfoIdx = sourceMode(SourceKey(it->adapter, it->sourceId));
+        path.sourceInfo.statusFlags = DISPLAYCONFIG_SOURCE_IN_USE;
+
+        DISPLAYCONFIG_MODE_INFO targetMode = {};
+        targetMode.infoType = DISPLAYCONFIG_MODE_INFO_TYPE_TARGET;
+        targetMode.id = target.id;
+        targetMode.adapterId = target.adapterId;
+        auto &signal = targetMode.targetMode.targetVideoSignalInfo;
+        signal.pixelRate = target.pixelRate;
+        signal.vSyncFreq = target.refreshRate;
+        signal.activeSize.cx = target.width;
+        signal.activeSize.cy = target.height;
+        signal.totalSize.cx = target.width + target.width / 10;
+        signal.totalSize.cy = target.height + target.height / 20;
+        signal.hSyncFreq.Numerator = target.refreshRate.Numerator * signal.totalSize.cy;
+        signal.hSyncFreq.Denominator = target.refreshRate.Denominator;
+        signal.videoStandard = 255;
+        signal.scanLineOrdering = DISPLAYCONFIG_SCANLINE_ORDERING_PROGRESSIVE;
+
+        path.targetInfo.adapterId = target.adapterId;
+        path.targetInfo.id = target.id;
+        path.targetInfo.modeInfoIdx = (UINT32)modes.size();
+        modes.push_back(targetMode);
+        path.targetInfo.outputTechnology = target.outputTechnology;
+        path.targetInfo.rotation = it->rotation;
+        path.targetInfo.scaling = it->scaling;
+        path.targetInfo.refreshRate = target.refreshRate;
+        path.targetInfo.scanLineOrdering = DISPLAYCONFIG_SCANLINE_ORDERING_PROGRESSIVE;
+        path.targetInfo.targetAvailable = TRUE;
+        path.targetInfo.statusFlags = DISPLAYCONFIG_TARGET_IN_USE;
+        path.flags = DISPLAYCONFIG_PATH_ACTIVE;
+        paths.push_back(path);
+    }
+
+    if ((flags & QDC_ALL_PATHS) == 0) {
+        return;
+    }
+
+    for (size_t targetIndex = 0; targetIndex < this->targets.size(); targetIndex++) {
+        if (activeTargets.count(targetIndex) != 0) {
+            continue;
+        }
+
+        auto &target = this->targets[targetIndex];
+        size_t adapterIndex;
+        auto adapter = this->FindAdapter(target.adapterId, &adapterIndex);
+        if (adapter == NULL) {
+            continue;
+        }
+
+        for (int busyPass = 0; busyPass < 2; busyPass++) {
+            for (UINT32 sourceId = 0; sourceId < adapter->sources; sourceId++) {
+                SourceKey key(adapterIndex, sourceId);
+                if ((this->sourceModes.count(key) != 0) != (busyPass != 0)) {
+                    continue;
+                }
+
+                DISPLAYCONFIG_PATH_INFO path = {};
+                path.sourceInfo.adapterId = target.adapterId;
+                path.sourceInfo.id = sourceId;
+                path.sourceInfo.modeInfoIdx = sourceMode(key);
+                path.targetInfo.adapterId = target.adapterId;
+                path.targetInfo.id = target.id;
+                path.targetInfo.modeInfoIdx = DISPLAYCONFIG_PATH_MODE_IDX_INVALID;
+                path.targetInfo.outputTechnology = target.outputTechnology;
+                path.targetInfo.rotation = DISPLAYCONFIG_ROTATION_IDENTITY;
+                path.targetInfo.scaling = DISPLAYCONFIG_SCALING_PREFERRED;
+                path.targetInfo.scanLineOrdering = DISPLAYCONFIG_SCANLINE_ORDERING_UNSPECIFIED;
+                path.targetInfo.targetAvailable = target.available;
+                paths.push_back(path);
+            }
+        }
+    }
+}
+
+LONG Win32DisplayTopologySimulator::Validate(const std::vector<ActivePath> &proposed) {
+    std::set<size_t> seen;
+    std::map<size_t, UINT32> perAdapter;
+    for (auto it = proposed.begin(); it != proposed.end(); it++) {
+        if (!seen.insert(it->target).second || !this->targets[it->target].available) {
+            return ERROR_INVALID_PARAMETER;
+        }
+        auto limit = this->adapters[it->adapter].maxActiveTargets;
+        if (limit != 0 && ++perAdapter[it->adapter] > limit) {
+            return ERROR_BAD_CONFIGURATION;
+        }
+    }
+    return ERROR_SUCCESS;
+}
+
+POINTL Win32DisplayTopologySimulator::NextPosition(const std::map<SourceKey, DISPLAYCONFIG_SOURCE_MODE> &modes) {
+    POINTL position = {0, 0};
+    for (auto it = modes.begin(); it != modes.end(); it++) {
+        LONG right = it->second.position.x + (LONG)it->second.width;
+        if (right > position.x) {
+            position.x = right;
+        }
+    }
+    return position;
+}
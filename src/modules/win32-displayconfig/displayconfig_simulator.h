@@ -0,0 +1,139 @@
+/*
+ * displayconfig_simulator.h: part of the "win32-displayconfig" Node package.
+ * See the COPYRIGHT file at the top-level directory of this distribution.
+ */
+#ifndef WIN32_DISPLAYCONFIG_SIMULATOR_H
+#define WIN32_DISPLAYCONFIG_SIMULATOR_H
+
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "displayconfig_backend.h"
+
+// One monitor attached to a simulated adapter. width, height and refreshRate
+// are its preferred mode, which is what it gets when it is enabled.
+struct Win32SimulatedTarget {
+    LUID adapterId;
+    UINT32 id;
+    std::wstring friendlyName;
+    std::wstring devicePath;
+    DISPLAYCONFIG_VIDEO_OUTPUT_TECHNOLOGY outputTechnology;
+    UINT16 edidManufactureId;
+    UINT16 edidProductCodeId;
+    BOOL available;
+    UINT32 width;
+    UINT32 height;
+    DISPLAYCONFIG_RATIONAL refreshRate;
+    UINT64 pixelRate;
+    BOOL advancedColorSupported;
+    BOOL advancedColorEnabled;
+    // In the units DISPLAYCONFIG_SDR_WHITE_LEVEL reports; 1000 is 80 nits.
+    ULONG sdrWhiteLevel;
+};
+
+struct Win32DisplayTopologySimulatorOptions {
+    Win32DisplayTopologySimulatorOptions()
+        : insufficientBufferRate(0), validationRejectRate(0), callLatencyMicroseconds(0), seed(1) {}
+
+    // Chance that a Query finds the topology grew since GetBufferSizes and
+    // fails with ERROR_INSUFFICIENT_BUFFER, as it does when a display is
+    // plugged in between the two calls.
+    double insufficientBufferRate;
+    // Chance that SDC_VALIDATE turns down a topology it would otherwise accept.
+    double validationRejectRate;
+    // Added to every call, to stand in for the round trip to the driver.
+    UINT32 callLatencyMicroseconds;
+    UINT32 seed;
+};
+
+struct Win32DisplayTopologySimulatorStats {
+    UINT64 bufferSizeCalls;
+    UINT64 queryCalls;
+    UINT64 setCalls;
+    UINT64 deviceInfoCalls;
+    UINT64 injectedBufferFaults;
+    UINT64 validations;
+    // Applied SetDisplayConfig calls that changed what was on screen.
+    UINT64 modeSets;
+    UINT64 databaseSaves;
+};
+
+// An in-memory display topology that answers the DisplayConfig API the way
+// Windows does, closely enough for the query, toggle and profile code to run
+// against it. QDC_ALL_PATHS lists the active paths first, then every source
+// each inactive target could be driven from, idle sources first. Inactive
+// paths point at their source's mode but have no target mode.
+class Win32DisplayTopologySimulator : public Win32DisplayConfigBackend {
+   public:
+    explicit Win32DisplayTopologySimulator(const struct Win32DisplayTopologySimulatorOptions &options = Win32DisplayTopologySimulatorOptions());
+
+    // maxActiveTargets of 0 means every source can drive a display at once.
+    void AddAdapter(LUID adapterId, UINT32 sources, UINT32 maxActiveTargets = 0);
+    void AddTarget(const struct Win32SimulatedTarget &target);
+    // Enables a target on the first idle source of its adapter, to the right
+    // of what is already active. Returns FALSE if it can't be.
+    BOOL Activate(LUID adapterId, UINT32 targetId);
+    // Plugs or unplugs a target. Unplugging an active one takes it off the desktop.
+    void SetTargetAvailable(LUID adapterId, UINT32 targetId, BOOL available);
+    void SetAdvancedColorEnabled(LUID adapterId, UINT32 targetId, BOOL enabled);
+
+    std::vector<std::pair<LUID, UINT32>> ActiveTargets();
+    struct Win32DisplayTopologySimulatorStats Stats();
+    void ResetStats();
+
+    LONG GetBufferSizes(UINT32 flags, UINT32 *numPathArrayElements, UINT32 *numModeInfoArrayElements) override;
+    LONG Query(
+        UINT32 flags,
+        UINT32 *numPathArrayElements,
+        DISPLAYCONFIG_PATH_INFO *pathArray,
+        UINT32 *numModeInfoArrayElements,
+        DISPLAYCONFIG_MODE_INFO *modeInfoArray) override;
+    LONG Set(
+        UINT32 numPathArrayElements,
+        DISPLAYCONFIG_PATH_INFO *pathArray,
+        UINT32 numModeInfoArrayElements,
+        DISPLAYCONFIG_MODE_INFO *modeInfoArray,
+        UINT32 flags) override;
+    LONG GetDeviceInfo(DISPLAYCONFIG_DEVICE_INFO_HEADER *requestPacket) override;
+
+   private:
+    struct Adapter {
+        LUID adapterId;
+        UINT32 sources;
+        UINT32 maxActiveTargets;
+    };
+
+    // A target on the desktop, and the source that scans out to it.
+    struct ActivePath {
+        size_t target;
+        size_t adapter;
+        UINT32 sourceId;
+        DISPLAYCONFIG_ROTATION rotation;
+        DISPLAYCONFIG_SCALING scaling;
+    };
+
+    typedef std::pair<size_t, UINT32> SourceKey;
+
+    void Delay();
+    BOOL Roll(double rate);
+    Adapter *FindAdapter(const LUID &adapterId, size_t *index);
+    struct Win32SimulatedTarget *FindTarget(const LUID &adapterId, UINT32 id, size_t *index);
+    void Layout(UINT32 flags, std::vector<DISPLAYCONFIG_PATH_INFO> &paths, std::vector<DISPLAYCONFIG_MODE_INFO> &modes);
+    LONG Validate(const std::vector<ActivePath> &proposed);
+    POINTL NextPosition(const std::map<SourceKey, DISPLAYCONFIG_SOURCE_MODE> &modes);
+
+    std::mutex mutex;
+    struct Win32DisplayTopologySimulatorOptions options;
+    std::mt19937 rng;
+    std::vector<Adapter> adapters;
+    std::vector<struct Win32SimulatedTarget> targets;
+    std::vector<ActivePath> active;
+    std::map<SourceKey, DISPLAYCONFIG_SOURCE_MODE> sourceModes;
+    struct Win32DisplayTopologySimulatorStats stats;
+};
+
+#endif
@@ -122,7 +122,80 @@ export interface QueryDisplayConfigResults {
   nameArray: NameInfo[];
 }
 
-export function queryDisplayConfig(): Promise<QueryDisplayConfigResults>;
+export interface QueryDisplayConfigOptions {
+  activeOnly?: boolean;
+  targetIds?: number[];
+  namesOnly?: boolean;
+}
+
+export function queryDisplayConfig(
+  options?: QueryDisplayConfigOptions
+): Promise<QueryDisplayConfigResults>;
+
+interface PackedPathInfo {
+  flags: number;
+  sourceAdapterLowPart: number;
+  sourceAdapterHighPart: number;
+  sourceId: number;
+  sourceModeInfoIdx: number;
+  sourceStatusFlags: number;
+  targetAdapterLowPart: number;
+  targetAdapterHighPart: number;
+  targetId: number;
+  targetModeInfoIdx: number;
+  outputTechnology: number;
+  rotation: number;
+  scaling: number;
+  refreshRateNumerator: number;
+  refreshRateDenominator: number;
+  scanLineOrdering: number;
+  targetAvailable: number;
+  targetStatusFlags: number;
+}
+
+interface PackedModeInfo {
+  infoType: number;
+  id: number;
+  adapterLowPart: number;
+  adapterHighPart: number;
+  pixelRate: PixelRate;
+  hSyncNumerator: number;
+  hSyncDenominator: number;
+  vSyncNumerator: number;
+  vSyncDenominator: number;
+  activeWidth: number;
+  activeHeight: number;
+  totalWidth: number;
+  totalHeight: number;
+  videoStandard: number;
+  signalScanLineOrdering: number;
+  sourceWidth: number;
+  sourceHeight: number;
+  pixelFormat: number;
+  positionX: number;
+  positionY: number;
+}
+
+export interface PackedDisplayConfig {
+  readonly pathCount: number;
+  readonly modeCount: number;
+  readonly nameArray: NameInfo[];
+  path(index: number): PackedPathInfo;
+  mode(index: number): PackedModeInfo | undefined;
+  sourceModeIndex(path: PackedPathInfo): number | undefined;
+  targetModeIndex(path: PackedPathInfo): number | undefined;
+  pathBuffer(index: number): Buffer;
+  modeBuffer(index: number): Buffer;
+  nameInfo(
+    adapterLowPart: number,
+    adapterHighPart: number,
+    id: number
+  ): NameInfo | undefined;
+}
+
+export function queryDisplayConfigPacked(
+  options?: QueryDisplayConfigOptions
+): Promise<PackedDisplayConfig>;
 
 interface ConfigId {
   adapterId: AdapterId;
@@ -145,7 +218,57 @@ export interface ExtractedDisplayConfig {
   targetModeBuffer?: Buffer;
 }
 
-export function extractDisplayConfig(): Promise<ExtractedDisplayConfig[]>;
+export function extractDisplayConfig(
+  options?: QueryDisplayConfigOptions
+): Promise<ExtractedDisplayConfig[]>;
+
+export interface DisplayTargetAdvancedColor {
+  supported: boolean;
+  enabled: boolean;
+  wideColorEnforced: boolean;
+  forceDisabled: boolean;
+  colorEncoding: "rgb" | "ycbcr444" | "ycbcr422" | "ycbcr420" | "intensity" | "unknown";
+  bitsPerColorChannel: number;
+  hdrSupported: boolean | null;
+  hdrUserEnabled: boolean | null;
+  activeColorMode: "sdr" | "wcg" | "hdr" | "unknown" | null;
+}
+
+export interface DisplayTarget {
+  adapterId: AdapterId;
+  id: number;
+  sourceId: number;
+  name: string;
+  devicePath: string;
+  outputTechnology: string;
+  edidManufactureId: number;
+  edidProductCodeId: number;
+  connectorInstance: number;
+  rotation: number;
+  scaling: string;
+  refreshRate: DisplayConfigFractional;
+  refreshRateHz: number | null;
+  sourceMode: SourceMode | null;
+  pixelRate: number | null;
+  vSyncFreq: DisplayConfigFractional | null;
+  hSyncFreq: DisplayConfigFractional | null;
+  activeSize: DisplayConfigSize | null;
+  totalSize: DisplayConfigSize | null;
+  scanLineOrdering: string | null;
+  advancedColor: DisplayTargetAdvancedColor | null;
+  sdrWhiteLevel: number | null;
+  sdrWhiteNits: number | null;
+}
+
+export interface DisplayTargets {
+  generation: number;
+  targets: DisplayTarget[];
+}
+
+export function queryDisplayTargets(options?: {
+  refresh?: boolean;
+  refreshWhiteLevels?: boolean;
+}): Promise<DisplayTargets>;
 
 export interface ToggleEnabledDisplayArgs {
   enable?: string[];
@@ -153,9 +276,15 @@ export interface ToggleEnabledDisplayArgs {
   persistent?: boolean;
 }
 
+export interface ToggleEnabledDisplaysReport {
+  strategy: "unchanged" | "planned" | "staged";
+  modeSets: number;
+  validationError: number;
+}
+
 export function toggleEnabledDisplays(
   args: ToggleEnabledDisplayArgs
-): Promise<void>;
+): Promise<ToggleEnabledDisplaysReport>;
 
 export interface DisplayRestorationConfigurationEntry {
   devicePath: string;
@@ -179,9 +308,75 @@ export function restoreDisplayConfig(
   args: RestoreDisplayConfigArgs
 ): Promise<void>;
 
+export interface DisplayProfile {
+  key: string;
+  devicePaths: string[];
+}
+
+export interface SavedDisplayProfile extends DisplayProfile {
+  config: DisplayRestorationConfigurationEntry[];
+}
+
+export function saveDisplayProfile(): Promise<SavedDisplayProfile>;
+export function loadDisplayProfile(
+  config: DisplayRestorationConfigurationEntry[]
+): string | undefined;
+export function listDisplayProfiles(): DisplayProfile[];
+export function removeDisplayProfile(key: string): boolean;
+
+export interface RestoreDisplayProfileArgs {
+  key?: string;
+  persistent?: boolean;
+}
+
+export interface RestoreDisplayProfileReport {
+  key: string;
+  validationError: number;
+  missingDevices: number;
+}
+
+export function restoreDisplayProfile(
+  args?: RestoreDisplayProfileArgs
+): Promise<RestoreDisplayProfileReport>;
+
+export interface DisplayConfigChangeMode {
+  width?: number;
+  height?: number;
+  position?: DisplayConfigPosition;
+}
+
+export type DisplayConfigChange = {
+  adapterId: AdapterId;
+  id: number;
+  devicePath: string;
+} & (
+  | {
+      type: "added";
+      mode: DisplayConfigChangeMode;
+      rotation: number;
+      refreshRate: number | null;
+    }
+  | { type: "removed" }
+  | { type: "mode"; from: DisplayConfigChangeMode; to: DisplayConfigChangeMode }
+  | { type: "rotation"; from: number; to: number }
+  | { type: "scaling"; from: string; to: string }
+  | { type: "refreshRate"; from: number | null; to: number | null }
+  | { type: "advancedColor"; from: boolean; to: boolean }
+);
+
+export interface DisplayChangeBatch {
+  count: number;
+  generation: number;
+}
+
 export type DisplayChangeListener = {
   (err: Error): void;
-  (err: null, conf: ExtractedDisplayConfig[]): void;
+  (
+    err: null,
+    conf: ExtractedDisplayConfig[],
+    changes?: DisplayConfigChange[],
+    batch?: DisplayChangeBatch
+  ): void;
 };
 
 export function addDisplayChangeListener(
@@ -191,10 +386,44 @@ export function removeDisplayChangeListener(
   listener: DisplayChangeListener
 ): void;
 
+export interface DisplayChangeCoalescing {
+  quietPeriod: number;
+  maxDelay: number;
+}
+export function setDisplayChangeCoalescing(
+  options: Partial<DisplayChangeCoalescing>
+): DisplayChangeCoalescing;
+
+export interface DisplayRect {
+  left: number;
+  top: number;
+  right: number;
+  bottom: number;
+}
+
+export interface DisplayGeometryEntry {
+  adapterId: AdapterId;
+  id: number;
+  devicePath: string;
+  bounds: DisplayRect;
+  refreshRate: number;
+  dpiX: number;
+  dpiY: number;
+  scaleFactor: number;
+}
+
 export class VerticalRefreshRateContext {
+  /** Resolves once the display change thread has published its first geometry. */
+  readyPromise: Promise<void>;
   findVerticalRefreshRateForDisplayPoint(
     x: number,
     y: number
   ): Promise<number | undefined>;
+  findVerticalRefreshRateForDisplayPointSync(
+    x: number,
+    y: number
+  ): number | undefined;
+  findDisplaysAtPoint(x: number, y: number): DisplayGeometryEntry[];
+  findDisplaysInRect(rect: DisplayRect): DisplayGeometryEntry[];
   close(): void;
 }
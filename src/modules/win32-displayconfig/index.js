@@ -4,6 +4,7 @@
  */
 "use strict";
 const addon = require("bindings")("./win32_displayconfig");
+const { createPackedAccessors } = require("./packed");
 
 /**
  * Represents a numeric error code returned from the Win32 API.
@@ -171,6 +172,15 @@ module.exports.Win32Error = Win32Error;
  * @property {NameInfo[]} nameArray
  */
 
+/**
+ * @typedef QueryDisplayConfigOptions
+ * @type {object}
+ * @property {boolean} [activeOnly] Only query active paths (QDC_ONLY_ACTIVE_PATHS)
+ *   instead of all of them (QDC_ALL_PATHS)
+ * @property {number[]} [targetIds] Only return paths to, and names of, these target IDs
+ * @property {boolean} [namesOnly] Only return nameArray; pathArray and modeArray are empty
+ */
+
 /**
  * Retrieves low-level information from the Win32 API QueryDisplayConfig.
  *
@@ -181,13 +191,15 @@ module.exports.Win32Error = Win32Error;
  *
  * Additionally, this function uses the DisplayConfigGetDeviceInfo function over
  * all resolved displays to return the names, output technology, and manufacturer IDs
- * in the nameArray results.
+ * in the nameArray results. While a display change listener is registered, names
+ * are cached between calls, and are only queried again after a display change.
  *
+ * @param {QueryDisplayConfigOptions} [options]
  * @returns {Promise<QueryDisplayConfigResults>}
  *   A Promise, resolving to { pathArray: [...], modeArray: [...], nameArray: [...] },
  *   or rejecting with a {@link Win32Error} if something goes wrong.
  */
-module.exports.queryDisplayConfig = () => {
+module.exports.queryDisplayConfig = (options) => {
   return new Promise((resolve, reject) => {
     const ran = addon.win32_queryDisplayConfig((err, result) => {
       if (err !== null) {
@@ -195,7 +207,43 @@ module.exports.queryDisplayConfig = () => {
       } else {
         resolve(result);
       }
-    });
+    }, options);
+    if (!ran) {
+      reject(new Win32Error(87));
+    }
+  });
+};
+
+let packedAccessorsCache;
+function packedAccessors() {
+  if (packedAccessorsCache === undefined) {
+    packedAccessorsCache = createPackedAccessors(addon);
+  }
+  return packedAccessorsCache;
+}
+
+/**
+ * Retrieves the same information as {@link queryDisplayConfig}, but leaves the
+ * path and mode arrays in the binary form QueryDisplayConfig returned them in.
+ *
+ * Fields are decoded only when they are read, so this is much cheaper than
+ * {@link queryDisplayConfig} when most paths are inactive and skipped.
+ *
+ * @param {QueryDisplayConfigOptions} [options]
+ * @returns {Promise<PackedDisplayConfig>}
+ *   A Promise, resolving to a {@link PackedDisplayConfig},
+ *   or rejecting with a {@link Win32Error} if something goes wrong.
+ */
+module.exports.queryDisplayConfigPacked = (options) => {
+  return new Promise((resolve, reject) => {
+    const ran = addon.win32_queryDisplayConfigPacked((err, result) => {
+      if (err !== null) {
+        reject(new Win32Error(err));
+      } else {
+        const { PackedDisplayConfig } = packedAccessors();
+        resolve(new PackedDisplayConfig(result));
+      }
+    }, options);
     if (!ran) {
       reject(new Win32Error(87));
     }
@@ -236,55 +284,38 @@ module.exports.queryDisplayConfig = () => {
  * Unlike {@link queryDisplayConfig}, this function pulls all relevant information
  * about a device/mode pairing into a single object.
  *
+ * @param {QueryDisplayConfigOptions} [options] Passed on to {@link queryDisplayConfigPacked};
+ *   `namesOnly` leaves nothing to extract.
  * @returns {Promise<ExtractedDisplayConfig>} A Promise, resolving to display configuration information
  *   or rejecting with a {@link Win32Error} if something goes wrong.
  */
-module.exports.extractDisplayConfig = async () => {
-  const config = await module.exports.queryDisplayConfig();
+module.exports.extractDisplayConfig = async (options) => {
+  const config = await module.exports.queryDisplayConfigPacked(options);
+  const { names } = packedAccessors();
   const ret = [];
-  for (const { value, buffer: pathBuffer } of config.pathArray) {
-    let inUse = value.flags & (1 === 1) ? true : false;
-    const { sourceInfo, targetInfo } = value;
-
-    const {
-      modeInfoIdx: sourceModeIdx,
-      adapterId: sourceAdapterId,
-      id: sourceId,
-    } = sourceInfo;
-    const {
-      adapterId,
-      id,
-      outputTechnology,
-      rotation,
-      scaling,
-      modeInfoIdx: targetModeIdx,
-    } = targetInfo;
-
-    const sourceConfigId = {
-      adapterId: sourceAdapterId,
-      id: sourceId,
-    };
-    const targetConfigId = {
-      adapterId,
-      id,
+  for (let i = 0; i < config.pathCount; i++) {
+    const path = config.path(i);
+    let inUse = path.flags & (1 === 1) ? true : false;
+
+    const targetAdapterId = {
+      LowPart: path.targetAdapterLowPart,
+      HighPart: path.targetAdapterHighPart,
     };
+    const targetId = path.targetId;
 
-    const displayNameEntry = config.nameArray.find(
-      (n) =>
-        n.adapterId.LowPart === adapterId.LowPart &&
-        n.adapterId.HighPart === adapterId.HighPart &&
-        n.id === id &&
-        n.outputTechnology &&
-        outputTechnology &&
-        n.monitorDevicePath.length > 0
+    const displayNameEntry = config.nameInfo(
+      targetAdapterId.LowPart,
+      targetAdapterId.HighPart,
+      targetId
     );
-
     if (displayNameEntry === undefined) {
       continue;
     }
 
-    const sourceMode = config.modeArray[sourceModeIdx];
-    const targetMode = config.modeArray[targetModeIdx];
+    const sourceModeIdx = config.sourceModeIndex(path);
+    const targetModeIdx = config.targetModeIndex(path);
+    const sourceMode = config.mode(sourceModeIdx);
+    const targetMode = config.mode(targetModeIdx);
     if (sourceMode === undefined) {
       continue;
     }
@@ -294,8 +325,7 @@ module.exports.extractDisplayConfig = async () => {
       inUse = false;
     }
 
-    const sourceModeValue = sourceMode.value;
-    if (sourceModeValue.infoType !== "source") {
+    if (names.infoType(sourceMode.infoType) !== "source") {
       continue;
     }
 
@@ -303,24 +333,53 @@ module.exports.extractDisplayConfig = async () => {
     const output = {
       displayName: monitorFriendlyDeviceName,
       devicePath: monitorDevicePath,
-      sourceConfigId,
-      targetConfigId,
+      sourceConfigId: {
+        adapterId: {
+          LowPart: path.sourceAdapterLowPart,
+          HighPart: path.sourceAdapterHighPart,
+        },
+        id: path.sourceId,
+      },
+      targetConfigId: {
+        adapterId: targetAdapterId,
+        id: targetId,
+      },
       inUse,
-      outputTechnology,
-      rotation,
-      scaling,
-      sourceMode: sourceModeValue.sourceMode,
-      pathBuffer,
-      sourceModeBuffer: sourceMode.buffer,
+      outputTechnology: names.outputTechnology(path.outputTechnology),
+      rotation: names.rotation(path.rotation),
+      scaling: names.scaling(path.scaling),
+      sourceMode: {
+        width: sourceMode.sourceWidth,
+        height: sourceMode.sourceHeight,
+        pixelFormat: names.pixelFormat(sourceMode.pixelFormat),
+        position: { x: sourceMode.positionX, y: sourceMode.positionY },
+      },
+      pathBuffer: config.pathBuffer(i),
+      sourceModeBuffer: config.modeBuffer(sourceModeIdx),
     };
 
-    if (targetMode !== undefined) {
-      const targetModeValue = targetMode.value;
-      if (targetModeValue.infoType === "target") {
-        output.targetVideoSignalInfo =
-          targetModeValue.targetMode.targetVideoSignalInfo;
-        output.targetModeBuffer = targetMode.buffer;
-      }
+    if (
+      targetMode !== undefined &&
+      names.infoType(targetMode.infoType) === "target"
+    ) {
+      output.targetVideoSignalInfo = {
+        pixelRate: targetMode.pixelRate,
+        hSyncFreq: {
+          Numerator: targetMode.hSyncNumerator,
+          Denominator: targetMode.hSyncDenominator,
+        },
+        vSyncFreq: {
+          Numerator: targetMode.vSyncNumerator,
+          Denominator: targetMode.vSyncDenominator,
+        },
+        activeSize: { cx: targetMode.activeWidth, cy: targetMode.activeHeight },
+        totalSize: { cx: targetMode.totalWidth, cy: targetMode.totalHeight },
+        videoStandard: targetMode.videoStandard,
+        scanlineOrdering: names.scanLineOrdering(
+          targetMode.signalScanLineOrdering
+        ),
+      };
+      output.targetModeBuffer = config.modeBuffer(targetModeIdx);
     }
 
     ret.push(output);
@@ -328,21 +387,105 @@ module.exports.extractDisplayConfig = async () => {
   return ret;
 };
 
+/**
+ * @typedef DisplayTargetAdvancedColor
+ * @type {object}
+ * @property {boolean} supported
+ * @property {boolean} enabled
+ * @property {boolean} wideColorEnforced
+ * @property {boolean} forceDisabled
+ * @property {"rgb" | "ycbcr444" | "ycbcr422" | "ycbcr420" | "intensity" | "unknown"} colorEncoding
+ * @property {number} bitsPerColorChannel
+ * @property {boolean | null} hdrSupported Null where Windows doesn't report
+ *   ADVANCED_COLOR_INFO_2 (before Windows 11 24H2), as are the next two
+ * @property {boolean | null} hdrUserEnabled
+ * @property {"sdr" | "wcg" | "hdr" | "unknown" | null} activeColorMode Tells HDR
+ *   apart from SDR with Auto Color Management, which both report `enabled`
+ */
+
+/**
+ * @typedef DisplayTarget
+ * @type {object}
+ * @property {AdapterId} adapterId
+ * @property {number} id The target ID
+ * @property {number} sourceId The ID of the source driving the target
+ * @property {string} name The "friendly name" of the display
+ * @property {string} devicePath The Windows NT device path of the display
+ * @property {string} outputTechnology
+ * @property {number} edidManufactureId
+ * @property {number} edidProductCodeId
+ * @property {number} connectorInstance
+ * @property {number} rotation
+ * @property {string} scaling
+ * @property {{Numerator: number, Denominator: number}} refreshRate
+ * @property {number | null} refreshRateHz
+ * @property {{width: number, height: number, pixelFormat: number | string, position: {x: number, y: number}} | null} sourceMode
+ * @property {number | null} pixelRate The pixel clock of the target mode, in Hz
+ * @property {{Numerator: number, Denominator: number} | null} vSyncFreq
+ * @property {{Numerator: number, Denominator: number} | null} hSyncFreq
+ * @property {{cx: number, cy: number} | null} activeSize
+ * @property {{cx: number, cy: number} | null} totalSize
+ * @property {string | null} scanLineOrdering
+ * @property {DisplayTargetAdvancedColor | null} advancedColor
+ * @property {number | null} sdrWhiteLevel The raw SDR white level, where 1000 is 80 nits
+ * @property {number | null} sdrWhiteNits
+ */
+
+/**
+ * Describes every active display in one native pass: its names, modes,
+ * signal timing, advanced color state and SDR white level.
+ *
+ * While a display change listener is registered, the result is cached and
+ * only read again after a display change. The SDR white level can change
+ * without one, so pass `refresh` after changing it, or `refreshWhiteLevels`
+ * to re-read just the white levels of the cached targets.
+ *
+ * @param {{refresh?: boolean, refreshWhiteLevels?: boolean}} [options]
+ * @returns {Promise<{generation: number, targets: DisplayTarget[]}>}
+ *   A Promise, rejecting with a {@link Win32Error} if something goes wrong.
+ */
+module.exports.queryDisplayTargets = (options) => {
+  return new Promise((resolve, reject) => {
+    const ran = addon.win32_queryTargetDescriptors((err, result) => {
+      if (err !== null) {
+        reject(new Win32Error(err));
+      } else {
+        resolve(result);
+      }
+    }, !!(options && options.refresh), !!(options && options.refreshWhiteLevels));
+    if (!ran) {
+      reject(new Win32Error(87));
+    }
+  });
+};
+
 async function win32_toggleEnabledDisplays(args) {
   return new Promise((resolve, reject) => {
-    const ran = addon.win32_toggleEnabledDisplays(args, (_, errorCode) => {
+    const ran = addon.win32_toggleEnabledDisplays(args, (_, errorCode, report) => {
       if (errorCode === 0) {
-        resolve();
+        resolve(report);
       } else {
         reject(new Win32Error(errorCode));
       }
     });
     if (!ran) {
-      resolve();
+      resolve({ strategy: "unchanged", modeSets: 0, validationError: 0 });
     }
   });
 }
 
+/**
+ * @typedef ToggleEnabledDisplaysReport
+ * @type {object}
+ * @property {"unchanged" | "planned" | "staged"} strategy How the change was applied:
+ *   "planned" if the final topology was validated and applied at once, "staged" if
+ *   Windows rejected it and displays were enabled first and disabled afterwards, or
+ *   "unchanged" if the displays were already in the requested state
+ * @property {number} modeSets How many configurations were applied, including
+ *   saving a persistent configuration
+ * @property {number} validationError The Win32 error SDC_VALIDATE returned for the plan
+ */
+
 /**
  * @typedef ToggleEnabledDisplaysArgs
  * @type {object}
@@ -357,6 +500,7 @@ async function win32_toggleEnabledDisplays(args) {
  * If "persistent", then this is saved between restarts.
  *
  * @param {ToggleEnabledDisplaysArgs} args
+ * @returns {Promise<ToggleEnabledDisplaysReport>}
  */
 module.exports.toggleEnabledDisplays = async (args) => {
   const { persistent, enable: enablePaths, disable: disablePaths } = args;
@@ -373,33 +517,9 @@ module.exports.toggleEnabledDisplays = async (args) => {
     }
   }
 
-  await win32_toggleEnabledDisplays({ enable, disable, persistent });
+  return await win32_toggleEnabledDisplays({ enable, disable, persistent });
 };
 
-function setSubtract(left, right) {
-  const ret = new Set();
-  for (const entry of left) {
-    if (!right.has(entry)) {
-      ret.add(entry);
-    }
-  }
-  return Array.from(ret);
-}
-
-function devicePathLookupForEnabledDisplayConfig(conf) {
-  const ret = {};
-  for (const entry of conf) {
-    if (entry.inUse && entry.targetModeBuffer === undefined) {
-      continue;
-    }
-    if (ret[entry.devicePath] !== undefined) {
-      continue;
-    }
-    ret[entry.devicePath] = entry;
-  }
-  return ret;
-}
-
 /**
  * @typedef DisplayRestorationConfigurationEntry
  * @type {object}
@@ -418,39 +538,145 @@ function devicePathLookupForEnabledDisplayConfig(conf) {
  * @returns {DisplayRestorationConfigurationEntry[]}
  */
 module.exports.displayConfigForRestoration = async () => {
-  const currentConfig = await module.exports.extractDisplayConfig();
-  const ret = [];
+  const { config } = await module.exports.saveDisplayProfile();
+  return config;
+};
 
-  for (const entry of currentConfig) {
-    if (!entry.inUse || entry.targetModeBuffer === undefined) {
-      continue;
+// ERROR_NOT_FOUND
+const ERROR_NOT_FOUND = 1168;
+
+/**
+ * @typedef DisplayProfile
+ * @type {object}
+ * @property {string} key Identifies the profile by the set of displays it enables
+ * @property {string[]} devicePaths The device paths of the displays it enables, sorted
+ */
+
+/**
+ * @typedef SavedDisplayProfile
+ * @type {object}
+ * @property {string} key
+ * @property {string[]} devicePaths
+ * @property {DisplayRestorationConfigurationEntry[]} config The same JSON-safe form
+ *   {@link displayConfigForRestoration} returns, for storing across restarts
+ */
+
+/**
+ * Saves the current display layout as a profile in the native profile store,
+ * replacing any profile that enables the same displays.
+ *
+ * The store only lives as long as the process; keep `config` to load the
+ * profile again with {@link loadDisplayProfile}.
+ *
+ * @returns {Promise<SavedDisplayProfile>}
+ */
+module.exports.saveDisplayProfile = () => {
+  return new Promise((resolve, reject) => {
+    const ran = addon.win32_saveDisplayProfile((err, result) => {
+      if (err !== null) {
+        reject(new Win32Error(err));
+        return;
+      }
+      const { key, devicePaths, entries } = result;
+      const config = entries.map(
+        ({ devicePath, pathBuffer, sourceModeBuffer, targetModeBuffer }) => ({
+          devicePath,
+          pathBuffer: pathBuffer.toString("base64"),
+          sourceModeBuffer: sourceModeBuffer.toString("base64"),
+          targetModeBuffer: targetModeBuffer.toString("base64"),
+        })
+      );
+      resolve({ key, devicePaths, config });
+    });
+    if (!ran) {
+      reject(new Win32Error(87));
     }
-    const {
-      devicePath,
-      pathBuffer,
-      sourceModeBuffer,
-      targetModeBuffer,
-    } = entry;
-    ret.push({
+  });
+};
+
+/**
+ * Compiles a configuration from {@link displayConfigForRestoration} into the
+ * native profile store. Entries for disabled displays are skipped.
+ *
+ * @param {DisplayRestorationConfigurationEntry[]} config
+ * @returns {string | undefined} The profile's key, or undefined if the
+ *   configuration enables no displays
+ */
+module.exports.loadDisplayProfile = (config) => {
+  if (!Array.isArray(config)) {
+    throw new TypeError("config must be an array of display configurations");
+  }
+  const entries = config
+    .filter(({ targetModeBuffer }) => targetModeBuffer !== undefined)
+    .map(({ devicePath, pathBuffer, sourceModeBuffer, targetModeBuffer }) => ({
       devicePath,
-      pathBuffer: pathBuffer.toString("base64"),
-      sourceModeBuffer: sourceModeBuffer.toString("base64"),
-      targetModeBuffer: targetModeBuffer.toString("base64"),
-    });
+      pathBuffer: Buffer.from(pathBuffer, "base64"),
+      sourceModeBuffer: Buffer.from(sourceModeBuffer, "base64"),
+      targetModeBuffer: Buffer.from(targetModeBuffer, "base64"),
+    }));
+  if (entries.length === 0) {
+    return undefined;
+  }
+  const key = addon.win32_loadDisplayProfile(entries);
+  if (key === false) {
+    throw new Win32Error(87);
   }
+  return key;
+};
 
-  return ret;
+/**
+ * @returns {DisplayProfile[]} The profiles in the native profile store.
+ */
+module.exports.listDisplayProfiles = () => {
+  return addon.win32_listDisplayProfiles();
+};
+
+/**
+ * @param {string} key
+ * @returns {boolean} Whether a profile was removed.
+ */
+module.exports.removeDisplayProfile = (key) => {
+  return addon.win32_removeDisplayProfile(key);
 };
 
-async function win32_restoreDisplayConfig(configs, persistent) {
+/**
+ * @typedef RestoreDisplayProfileArgs
+ * @type {object}
+ * @property {string} [key] The profile to restore. If omitted, the stored profile
+ *   enabling the most displays that are all attached is used.
+ * @property {boolean} [persistent] Whether to save this configuration as the default configuration
+ */
+
+/**
+ * @typedef RestoreDisplayProfileReport
+ * @type {object}
+ * @property {string} key The profile that was restored
+ * @property {number} validationError The Win32 error SDC_VALIDATE returned
+ * @property {number} missingDevices How many of the profile's displays weren't attached
+ */
+
+/**
+ * Restores a stored profile. The saved paths and modes are bound to the current
+ * adapter LUIDs and target IDs natively, validated, and applied in one call.
+ *
+ * Rejects with a {@link Win32Error} with code 1168 (ERROR_NOT_FOUND) if the profile
+ * doesn't exist or one of its displays isn't attached.
+ *
+ * @param {RestoreDisplayProfileArgs} [args]
+ * @returns {Promise<RestoreDisplayProfileReport>}
+ */
+module.exports.restoreDisplayProfile = (args) => {
+  const { key, persistent } = args || {};
   return new Promise((resolve, reject) => {
-    const ran = addon.win32_restoreDisplayConfig(
-      configs,
-      (_, errorCode) => {
+    const ran = addon.win32_restoreDisplayProfile(
+      key,
+      (_, errorCode, report) => {
         if (errorCode === 0) {
-          resolve();
+          resolve(report);
         } else {
-          reject(new Win32Error(errorCode));
+          const error = new Win32Error(errorCode);
+          error.report = report;
+          reject(error);
         }
       },
       persistent
@@ -459,7 +685,7 @@ async function win32_restoreDisplayConfig(configs, persistent) {
       reject(new Win32Error(87));
     }
   });
-}
+};
 
 /**
  * @typedef RestoreDisplayConfigArgs
@@ -486,91 +712,115 @@ module.exports.restoreDisplayConfig = async (args) => {
   const devicePathNames = args.config
     .filter(({ targetModeBuffer }) => targetModeBuffer !== undefined)
     .map(({ devicePath }) => devicePath);
-  const currentConfig = await module.exports.extractDisplayConfig();
 
-  const givenAsSet = new Set(currentConfig.map(({ devicePath }) => devicePath));
-  const expectedEnabledAsSet = new Set(devicePathNames);
-
-  const missingEnabled = setSubtract(expectedEnabledAsSet, givenAsSet);
-
-  // Here's the idea behind this:
-  // We have a set of monitors we want enabled, and a set of monitors that are enabled.
-  // Ideally, these should be identical sets. But it's also possible that
-  //
-  // 1. The current state has strictly more enabled monitors than the expected state
-  // 2. The current state has strictly fewer enabled monitors than the expected state
-  // 3. The current state has some monitors that are missing, and some that are unexpected.
-  //
-  // What we're about to do here is coerce the monitor state to the expected state; if more
-  // monitors are enabled or disabled in the given state then that's fine, we're correcting
-  // that away. The trick here is that the monitors in the expected state we _do_ want to
-  // enable have to exist in the first place (we don't care about the ones we want to disable,
-  // missing is also disabled if you squint hard enough).
-  if (missingEnabled.length === 0) {
-    const pathLookup = devicePathLookupForEnabledDisplayConfig(currentConfig);
-    const coercedState = [];
-    for (const entry of args.config) {
-      if (entry.targetModeBuffer === undefined) {
-        continue;
-      }
-      const currentConfigEntry = pathLookup[entry.devicePath];
-      if (currentConfigEntry === undefined) {
-        continue;
-      }
-      const { sourceConfigId, targetConfigId } = currentConfigEntry;
-      const { pathBuffer, sourceModeBuffer, targetModeBuffer } = entry;
-      coercedState.push({
-        sourceConfigId,
-        targetConfigId,
-        pathBuffer: Buffer.from(pathBuffer, "base64"),
-        sourceModeBuffer: Buffer.from(sourceModeBuffer, "base64"),
-        targetModeBuffer: Buffer.from(targetModeBuffer, "base64"),
-      });
+  // The common case: every display we want enabled is attached. The profile
+  // store binds and applies the configuration natively in one validated call.
+  const key = module.exports.loadDisplayProfile(args.config);
+  if (key === undefined) {
+    throw new Win32Error(87);
+  }
+  try {
+    await module.exports.restoreDisplayProfile({
+      key,
+      persistent: args.persistent,
+    });
+    return;
+  } catch (e) {
+    if (!(e instanceof Win32Error) || e.code !== ERROR_NOT_FOUND) {
+      throw e;
     }
+  }
 
-    if (coercedState.length === 0) {
-      throw new Win32Error(87);
-    }
+  // Some of the displays we want enabled are missing. We have a set of monitors we
+  // want enabled, and a set of monitors that are enabled; the monitors in the expected
+  // state we _do_ want to enable have to exist in the first place (we don't care about
+  // the ones we want to disable, missing is also disabled if you squint hard enough).
+  // So enable the ones we can, and disable the attached ones the configuration
+  // says should be off.
+  const currentConfig = await module.exports.extractDisplayConfig();
+  const givenAsSet = new Set(currentConfig.map(({ devicePath }) => devicePath));
 
-    await win32_restoreDisplayConfig(coercedState, args.persistent);
-  } else {
-    const seen = new Set();
-    const enable = [];
-    const disable = [];
+  const seen = new Set();
+  const enable = [];
+  const disable = [];
 
-    const notInUse = args.config
-      .filter(({ targetModeBuffer }) => targetModeBuffer === undefined)
-      .map(({ devicePath }) => devicePath);
+  const notInUse = args.config
+    .filter(({ targetModeBuffer }) => targetModeBuffer === undefined)
+    .map(({ devicePath }) => devicePath);
 
-    for (const devicePathName of devicePathNames) {
-      if (!seen.has(devicePathName) && givenAsSet.has(devicePathName)) {
-        enable.push(devicePathName);
-        seen.add(devicePathName);
-      }
+  for (const devicePathName of devicePathNames) {
+    if (!seen.has(devicePathName) && givenAsSet.has(devicePathName)) {
+      enable.push(devicePathName);
+      seen.add(devicePathName);
     }
-    for (const devicePathName of notInUse) {
-      if (!seen.has(devicePathName) && givenAsSet.has(devicePathName)) {
-        disable.push(devicePathName);
-        seen.add(devicePathName);
-      }
+  }
+  for (const devicePathName of notInUse) {
+    if (!seen.has(devicePathName) && givenAsSet.has(devicePathName)) {
+      disable.push(devicePathName);
+      seen.add(devicePathName);
     }
-
-    await module.exports.toggleEnabledDisplays({
-      enable,
-      disable,
-      persistent: args.persistent,
-    });
   }
+
+  await module.exports.toggleEnabledDisplays({
+    enable,
+    disable,
+    persistent: args.persistent,
+  });
 };
 
 let currentDisplayConfig;
 const displayChangeCallbacks = new Set();
 
-async function updateDisplayStateAndNotifyCallbacks() {
+/**
+ * @typedef DisplayConfigChange
+ * @type {object}
+ * @property {"added" | "removed" | "mode" | "rotation" | "scaling" | "refreshRate" | "advancedColor"} type
+ * @property {AdapterId} adapterId The target adapter
+ * @property {number} id The target id
+ * @property {string} devicePath The Windows NT device path of the target
+ * @property {*} [from] The previous value, for changes to an existing target
+ * @property {*} [to] The new value, for changes to an existing target
+ * @property {{width: number, height: number, position: {x: number, y: number}}} [mode]
+ *   The source mode of an added target
+ * @property {number} [rotation] The rotation of an added target
+ * @property {number | null} [refreshRate] The refresh rate of an added target, in Hz
+ */
+
+/**
+ * @typedef DisplayChangeBatch
+ * @type {object}
+ * @property {number} count How many Windows display change messages the
+ *   notification covers after coalescing
+ * @property {number} generation Increases with every notification from the
+ *   current listener
+ */
+
+// Changes and batch info from notifications that haven't been handled yet.
+// Only the newest generation queries; older queued updates are dropped and
+// their changes handed on to it.
+let latestDisplayChangeGeneration = 0;
+let pendingDisplayChanges = [];
+let pendingDisplayChangeCount = 0;
+
+/**
+ * @param {DisplayConfigChange[] | undefined} changes The changes to active
+ *   targets since the last notification, as computed by the native listener,
+ *   or undefined if they aren't known.
+ * @param {DisplayChangeBatch} [batch]
+ */
+async function updateDisplayStateAndNotifyCallbacks(changes, batch) {
   try {
-    currentDisplayConfig = await module.exports.extractDisplayConfig();
+    // Nothing about the active targets changed, so the last extracted
+    // configuration still holds and doesn't need to be queried again.
+    if (
+      currentDisplayConfig === undefined ||
+      changes === undefined ||
+      changes.length > 0
+    ) {
+      currentDisplayConfig = await module.exports.extractDisplayConfig();
+    }
     for (const callback of Array.from(displayChangeCallbacks)) {
-      callback(null, currentDisplayConfig);
+      callback(null, currentDisplayConfig, changes, batch);
     }
   } catch (e) {
     for (const callback of Array.from(displayChangeCallbacks)) {
@@ -581,23 +831,70 @@ async function updateDisplayStateAndNotifyCallbacks() {
 
 let currentDisplayConfigPromise = updateDisplayStateAndNotifyCallbacks();
 
+let displayChangeCoalescing = {};
+
+// Whether the native listener thread has published its first geometry, and
+// who is waiting for it (see VerticalRefreshRateContext).
+let displayGeometryReady = false;
+const displayGeometryReadyCallbacks = new Set();
+
+function markDisplayGeometryReady() {
+  displayGeometryReady = true;
+  for (const callback of Array.from(displayGeometryReadyCallbacks)) {
+    callback();
+  }
+  displayGeometryReadyCallbacks.clear();
+}
+
 function setupListenForDisplayChanges() {
+  latestDisplayChangeGeneration = 0;
+  pendingDisplayChanges = [];
+  pendingDisplayChangeCount = 0;
+  displayGeometryReady = false;
+
   const notifyError = (err) => {
+    // Nothing will be published after an error, so don't leave lookups
+    // waiting for it.
+    markDisplayGeometryReady();
     const error = new Win32Error(err);
     for (const callback of Array.from(displayChangeCallbacks)) {
       callback(error);
     }
   };
 
-  const result = addon.win32_listenForDisplayChanges((err) => {
-    if (err === null) {
-      currentDisplayConfigPromise = currentDisplayConfigPromise.then(() =>
-        updateDisplayStateAndNotifyCallbacks()
-      );
-    } else {
+  const result = addon.win32_listenForDisplayChanges((err, changes, batch) => {
+    if (err !== null) {
       notifyError(err);
+      return;
     }
-  });
+    // The native thread publishes geometry before it notifies, so any
+    // notification means lookups are ready.
+    markDisplayGeometryReady();
+    if (batch.geometryReady) {
+      return;
+    }
+
+    latestDisplayChangeGeneration = batch.generation;
+    pendingDisplayChangeCount += batch.count;
+    if (pendingDisplayChanges !== undefined) {
+      pendingDisplayChanges = changes ? pendingDisplayChanges.concat(changes) : undefined;
+    }
+
+    currentDisplayConfigPromise = currentDisplayConfigPromise.then(() => {
+      if (batch.generation !== latestDisplayChangeGeneration) {
+        // Superseded while queued; the newer notification covers this one.
+        return;
+      }
+      const coalesced = {
+        count: pendingDisplayChangeCount,
+        generation: batch.generation,
+      };
+      const coalescedChanges = pendingDisplayChanges;
+      pendingDisplayChanges = [];
+      pendingDisplayChangeCount = 0;
+      return updateDisplayStateAndNotifyCallbacks(coalescedChanges, coalesced);
+    });
+  }, displayChangeCoalescing);
 
   if (typeof result === "number" && result !== 0) {
     notifyError(result);
@@ -612,12 +909,21 @@ function setupListenForDisplayChanges() {
  * configuration changes in Windows, e.g. when users attach or rearrange new
  * displays, or alter the output resolution of already-attached displays.
  *
+ * On changes, the listener also receives the list of {@link DisplayConfigChange}
+ * records describing what happened to the active targets. The list is empty when
+ * Windows reported a change that didn't affect them, so listeners can skip their
+ * work, and undefined when the changes couldn't be determined.
+ *
+ * Bursts of Windows display change messages are coalesced natively (see
+ * {@link setDisplayChangeCoalescing}), and the {@link DisplayChangeBatch}
+ * passed last says how many messages a notification covers.
+ *
  * Note that the Node event loop will continue executing if any outstanding change
  * listeners are registered, precluding graceful shutdown. Use {@link removeDisplayChangeListener}
  * to remove outstanding display change listeners and clear the event loop.
  *
- * @param {function(Error | null, ExtractedDisplayConfig | undefined): void} listener
- * @returns {function(Error | null, ExtractedDisplayConfig | undefined): void} the listener argument as passed
+ * @param {function(Error | null, ExtractedDisplayConfig | undefined, DisplayConfigChange[] | undefined, DisplayChangeBatch | undefined): void} listener
+ * @returns {function(Error | null, ExtractedDisplayConfig | undefined, DisplayConfigChange[] | undefined, DisplayChangeBatch | undefined): void} the listener argument as passed
  */
 module.exports.addDisplayChangeListener = (listener) => {
   const shouldStartListening = displayChangeCallbacks.size === 0;
@@ -634,6 +940,20 @@ module.exports.addDisplayChangeListener = (listener) => {
   return listener;
 };
 
+/**
+ * Configures how display change messages are coalesced. The listener waits
+ * until no message has arrived for `quietPeriod` ms, but no longer than
+ * `maxDelay` ms after the first one, then queries once. A quiet period of 0
+ * handles every message on its own. Applies to a running listener too.
+ *
+ * @param {{quietPeriod?: number, maxDelay?: number}} options
+ * @returns {{quietPeriod: number, maxDelay: number}} the resulting settings
+ */
+module.exports.setDisplayChangeCoalescing = (options) => {
+  displayChangeCoalescing = addon.win32_setDisplayChangeCoalescing(options);
+  return displayChangeCoalescing;
+};
+
 /**
  * De-registers a display change listener.
  *
@@ -649,9 +969,27 @@ module.exports.removeDisplayChangeListener = (listener) => {
   }
 };
 
+/**
+ * @typedef DisplayGeometryEntry
+ * @type {object}
+ * @property {AdapterId} adapterId
+ * @property {number} id The target ID of the display
+ * @property {string} devicePath The Windows NT device path of the display
+ * @property {{left: number, top: number, right: number, bottom: number}} bounds
+ *   The display's rectangle in desktop coordinates
+ * @property {number} refreshRate The vertical refresh rate in Hz
+ * @property {number} dpiX The effective horizontal DPI
+ * @property {number} dpiY The effective vertical DPI
+ * @property {number} scaleFactor dpiX relative to 96 DPI
+ */
+
 /**
  * Establishes a context for determining the vertical refresh rate.
  *
+ * The display geometry is kept natively, and updated by the display change
+ * thread before listeners are notified, so queries are synchronous binary
+ * searches rather than scans over the extracted configuration.
+ *
  * Active instances of this class will establish perpetual work on the event loop,
  * as the internals use {@link addDisplayChangeListener} to react to display changes.
  *
@@ -671,43 +1009,18 @@ class VerticalRefreshRateContext {
       };
     });
     this.readyPromiseResolver = readyPromiseResolver;
-    this.geometry = [];
-
-    const computeDisplayGeometryFromConfig = (err, conf) => {
-      if (err !== null) {
-        this.geometry = [];
-        readyPromiseResolver();
-        return;
-      }
-      const geom = [];
-
-      for (const { sourceMode, targetVideoSignalInfo, inUse } of conf) {
-        if (!inUse) {
-          continue;
-        }
-
-        const { width, height, position } = sourceMode;
-        const { vSyncFreq } = targetVideoSignalInfo;
-        // 30Hz is a safe guess for broken vSyncFreq outputs, I think...
-        const vRefreshRate =
-          vSyncFreq.Numerator === 0 || vSyncFreq.Denominator === 0
-            ? 30
-            : vSyncFreq.Numerator / vSyncFreq.Denominator;
-        const top = position.y;
-        const bottom = position.y + height;
-        const left = position.x;
-        const right = position.x + width;
-
-        geom.push({ top, bottom, left, right, vRefreshRate });
-      }
-
-      this.geometry = geom;
+    this.closed = false;
+
+    // The geometry itself is maintained by the native listener thread; this
+    // listener only keeps that thread running. The context is ready once the
+    // thread has published its first geometry, which can be after the
+    // listener's first call with the JS-side configuration.
+    this.changeListener = module.exports.addDisplayChangeListener(() => {});
+    if (displayGeometryReady) {
       readyPromiseResolver();
-    };
-
-    this.changeListener = module.exports.addDisplayChangeListener(
-      computeDisplayGeometryFromConfig
-    );
+    } else {
+      displayGeometryReadyCallbacks.add(readyPromiseResolver);
+    }
   }
 
   /**
@@ -719,7 +1032,8 @@ class VerticalRefreshRateContext {
    *
    * This method is asynchronous due to the implementation of addDisplayChangeListener;
    * it waits for a valid display configuration to be captured before returning the
-   * best possible refresh rate.
+   * best possible refresh rate. See {@link findVerticalRefreshRateForDisplayPointSync}
+   * for a version that doesn't wait.
    *
    * @param {number} x The vertical offset of the display point
    * @param {number} y The horizontal offset of the display point
@@ -729,15 +1043,56 @@ class VerticalRefreshRateContext {
    */
   async findVerticalRefreshRateForDisplayPoint(x, y) {
     await this.readyPromise;
+    return this.findVerticalRefreshRateForDisplayPointSync(x, y);
+  }
 
-    let ret;
-    for (const { top, bottom, left, right, vRefreshRate } of this.geometry) {
-      if (left <= x && x < right && top <= y && y < bottom) {
-        ret = ret === undefined ? vRefreshRate : Math.min(ret, vRefreshRate);
-      }
+  /**
+   * Like {@link findVerticalRefreshRateForDisplayPoint}, but returns immediately.
+   * Cheap enough to call on every animation frame. Returns undefined until the
+   * native listener thread has published the first geometry.
+   *
+   * @param {number} x
+   * @param {number} y
+   * @returns {number | undefined}
+   */
+  findVerticalRefreshRateForDisplayPointSync(x, y) {
+    if (this.closed) {
+      return undefined;
+    }
+    const hits = addon.win32_displayGeometryAtPoint(x, y);
+    if (hits === undefined || hits.refreshRate === null) {
+      return undefined;
+    }
+    return hits.refreshRate;
+  }
+
+  /**
+   * Finds the displays covering a given display point.
+   *
+   * @param {number} x
+   * @param {number} y
+   * @returns {DisplayGeometryEntry[]}
+   */
+  findDisplaysAtPoint(x, y) {
+    if (this.closed) {
+      return [];
     }
+    const hits = addon.win32_displayGeometryAtPoint(x, y);
+    return hits === undefined ? [] : hits.displays;
+  }
 
-    return ret;
+  /**
+   * Finds the displays intersecting a rectangle in desktop coordinates.
+   *
+   * @param {{left: number, top: number, right: number, bottom: number}} rect
+   * @returns {DisplayGeometryEntry[]}
+   */
+  findDisplaysInRect({ left, top, right, bottom }) {
+    if (this.closed) {
+      return [];
+    }
+    const hits = addon.win32_displayGeometryInRect(left, top, right, bottom);
+    return hits === undefined ? [] : hits.displays;
   }
 
   /**
@@ -748,7 +1103,8 @@ class VerticalRefreshRateContext {
    */
   close() {
     module.exports.removeDisplayChangeListener(this.changeListener);
-    this.geometry = [];
+    this.closed = true;
+    displayGeometryReadyCallbacks.delete(this.readyPromiseResolver);
     this.readyPromiseResolver();
   }
 }
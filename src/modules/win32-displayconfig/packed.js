@@ -0,0 +1,175 @@
+/*
+ * packed.js: part of the "win32-displayconfig" Node package.
+ * See the COPYRIGHT file at the top-level directory of this distribution.
+ */
+"use strict";
+
+// DISPLAYCONFIG_PATH_SUPPORT_VIRTUAL_MODE
+const PATH_SUPPORT_VIRTUAL_MODE = 0x8;
+// DISPLAYCONFIG_PATH_SOURCE_MODE_IDX_INVALID / TARGET_MODE_IDX_INVALID
+const VIRTUAL_MODE_IDX_INVALID = 0xffff;
+
+const readers = {
+  u32: (view, offset) => view.getUint32(offset, true),
+  i32: (view, offset) => view.getInt32(offset, true),
+  u64: (view, offset) => ({
+    lowPart: view.getUint32(offset, true),
+    highPart: view.getUint32(offset + 4, true),
+  }),
+};
+
+/**
+ * Generates a class whose getters read the fields of one native struct
+ * straight out of a DataView, using the offsets reported by the addon.
+ * Nothing is copied until a getter is called.
+ */
+function defineStructView(layout) {
+  class StructView {
+    constructor(view, offset) {
+      this.view = view;
+      this.offset = offset;
+    }
+  }
+
+  for (const [name, [fieldOffset, kind]] of Object.entries(layout.fields)) {
+    const read = readers[kind];
+    Object.defineProperty(StructView.prototype, name, {
+      get() {
+        return read(this.view, this.offset + fieldOffset);
+      },
+    });
+  }
+  StructView.size = layout.size;
+
+  return StructView;
+}
+
+function enumLookup(entries) {
+  const names = new Map(entries);
+  return (value) => (names.has(value) ? names.get(value) : undefined);
+}
+
+/**
+ * Builds the accessor layer for the running addon.
+ *
+ * @param {object} addon The native addon, providing win32_displayConfigLayout
+ */
+function createPackedAccessors(addon) {
+  const layout = addon.win32_displayConfigLayout();
+  const PathView = defineStructView(layout.pathInfo);
+  const ModeView = defineStructView(layout.modeInfo);
+
+  const outputTechnology = enumLookup(layout.enums.outputTechnology);
+  const rotation = enumLookup(layout.enums.rotation);
+  const scaling = enumLookup(layout.enums.scaling);
+  const scanLineOrdering = enumLookup(layout.enums.scanLineOrdering);
+  const pixelFormat = enumLookup(layout.enums.pixelFormat);
+  const infoType = enumLookup(layout.enums.infoType);
+
+  // The Convert* fallbacks in the addon for values it doesn't know.
+  const orDefault = (lookup, fallback) => (value) => {
+    const name = lookup(value);
+    return name === undefined ? fallback : name;
+  };
+
+  const names = {
+    outputTechnology: orDefault(outputTechnology, "other"),
+    rotation: orDefault(rotation, 0),
+    scaling: orDefault(scaling, "identity"),
+    scanLineOrdering: orDefault(scanLineOrdering, "unspecified"),
+    pixelFormat: orDefault(pixelFormat, "nongdi"),
+    infoType,
+  };
+
+  /**
+   * A QueryDisplayConfig result as returned by the addon's packed query:
+   * the path and mode arrays exactly as Windows filled them in, plus the
+   * (small) array of name entries.
+   */
+  class PackedDisplayConfig {
+    constructor(raw) {
+      this.pathCount = raw.pathCount;
+      this.modeCount = raw.modeCount;
+      this.nameArray = raw.nameArray;
+      this.pathArrayBuffer = raw.pathBuffer;
+      this.modeArrayBuffer = raw.modeBuffer;
+      this.pathView = new DataView(raw.pathBuffer);
+      this.modeView = new DataView(raw.modeBuffer);
+    }
+
+    /** @returns {PathView} */
+    path(index) {
+      return new PathView(this.pathView, index * PathView.size);
+    }
+
+    /** @returns {ModeView | undefined} */
+    mode(index) {
+      if (!(index >= 0 && index < this.modeCount)) {
+        return undefined;
+      }
+      return new ModeView(this.modeView, index * ModeView.size);
+    }
+
+    /**
+     * The mode index a path refers to for its source or target, accounting
+     * for virtual-mode-aware paths packing two indices into one field.
+     */
+    sourceModeIndex(path) {
+      if (path.flags & PATH_SUPPORT_VIRTUAL_MODE) {
+        const idx = path.sourceModeInfoIdx >>> 16;
+        return idx === VIRTUAL_MODE_IDX_INVALID ? undefined : idx;
+      }
+      return path.sourceModeInfoIdx;
+    }
+
+    targetModeIndex(path) {
+      if (path.flags & PATH_SUPPORT_VIRTUAL_MODE) {
+        const idx = path.targetModeInfoIdx >>> 16;
+        return idx === VIRTUAL_MODE_IDX_INVALID ? undefined : idx;
+      }
+      return path.targetModeInfoIdx;
+    }
+
+    /** A Buffer over the raw DISPLAYCONFIG_PATH_INFO, sharing its memory. */
+    pathBuffer(index) {
+      return Buffer.from(
+        this.pathArrayBuffer,
+        index * PathView.size,
+        PathView.size
+      );
+    }
+
+    /** A Buffer over the raw DISPLAYCONFIG_MODE_INFO, sharing its memory. */
+    modeBuffer(index) {
+      return Buffer.from(
+        this.modeArrayBuffer,
+        index * ModeView.size,
+        ModeView.size
+      );
+    }
+
+    /**
+     * Looks up the name entry for a target, or undefined. Only entries with
+     * a device path are indexed. The map is built on first use.
+     */
+    nameInfo(adapterLowPart, adapterHighPart, id) {
+      if (this.nameIndex === undefined) {
+        this.nameIndex = new Map();
+        for (const name of this.nameArray) {
+          if (!name.outputTechnology || name.monitorDevicePath.length === 0) {
+            continue;
+          }
+          const key = `${name.adapterId.LowPart}:${name.adapterId.HighPart}:${name.id}`;
+          if (!this.nameIndex.has(key)) {
+            this.nameIndex.set(key, name);
+          }
+        }
+      }
+      return this.nameIndex.get(`${adapterLowPart}:${adapterHighPart}:${id}`);
+    }
+  }
+
+  return { PackedDisplayConfig, PathView, ModeView, names };
+}
+
+module.exports.createPackedAccessors = createPackedAccessors;
@@ -4,71 +4,79 @@
  */
 #define NAPI_VERSION 4
 #include <napi.h>
+#include <shellscalingapi.h>
 #include <string.h>
 #include <windows.h>
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <tuple>
 #include <vector>
 
-const int DEVICE_NAME_SIZE = 64;   // 64 comes from DISPLAYCONFIG_TARGET_DEVICE_NAME.monitorFriendlyDeviceName
-const int DEVICE_PATH_SIZE = 128;  // 128 comes from DISPLAYCONFIG_TARGET_DEVICE_NAME.monitorDevicePath
-
-struct Win32DeviceNameInfo {
-    // Apparently, the adapterId is _not_ persistent between reboots.
-    // And yet, the id is. So we likely want to find a better name.
-    LUID adapterId;
-    UINT32 id;
-    DISPLAYCONFIG_TARGET_DEVICE_NAME_FLAGS deviceFlags;
-    DISPLAYCONFIG_VIDEO_OUTPUT_TECHNOLOGY outputTechnology;
-    UINT16 edidManufactureId;
-    UINT16 edidProductCodeId;
-    UINT32 connectorInstance;
-    WCHAR monitorFriendlyDeviceName[DEVICE_NAME_SIZE];
-    WCHAR monitorDevicePath[DEVICE_PATH_SIZE];
-};
-
-struct Win32QueryDisplayConfigResults {
-    Win32QueryDisplayConfigResults(UINT32 cPathInfo, UINT32 cModeInfo)
-        : error(ERROR_SUCCESS) {
-        this->rgPathInfo = std::vector<DISPLAYCONFIG_PATH_INFO>(cPathInfo);
-        this->rgModeInfo = std::vector<DISPLAYCONFIG_MODE_INFO>(cModeInfo);
-        this->rgNameInfo = std::vector<struct Win32DeviceNameInfo>();
-    }
-
-    std::vector<DISPLAYCONFIG_PATH_INFO> rgPathInfo;
-    std::vector<DISPLAYCONFIG_MODE_INFO> rgModeInfo;
-    std::vector<struct Win32DeviceNameInfo> rgNameInfo;
-    LONG error;
-    BOOL faultWasBuffer;
+#include "displayconfig_core.h"
+
+// What the display change thread hands to JavaScript for one
+// UxdDisplayChangeMessage. If the configuration couldn't be queried,
+// `changesKnown` is FALSE and listeners have to assume anything changed.
+struct Win32DisplayConfigDelta {
+    BOOL changesKnown;
+    std::vector<struct Win32DisplayConfigChange> changes;
+    // How many display change messages this delta covers, and its position in
+    // the sequence of deltas delivered by the current listener.
+    UINT32 count;
+    UINT64 generation;
 };
 
-struct Win32TransientDeviceId {
+// One active display in desktop coordinates, as served to point queries.
+struct Win32DisplayGeometryEntry {
     LUID adapterId;
     UINT32 id;
+    std::wstring devicePath;
+    RECT bounds;
+    double refreshRate;
+    UINT dpiX;
+    UINT dpiY;
 };
 
-struct Win32DeviceConfigToggleEnabled {
-    Win32DeviceConfigToggleEnabled() : enable(), disable() {}
-
-    BOOL persistent;
-    std::vector<struct Win32TransientDeviceId> enable;
-    std::vector<struct Win32TransientDeviceId> disable;
+// The active displays, split into a grid along every distinct edge. A cell
+// lists the displays covering it, so finding the displays at a point is two
+// binary searches no matter how the displays overlap.
+struct Win32DisplayGeometry {
+    UINT64 generation;
+    std::vector<struct Win32DisplayGeometryEntry> entries;
+    std::vector<LONG> xs;
+    std::vector<LONG> ys;
+    std::vector<std::vector<UINT32>> cells;
 };
 
-struct Win32RestoreDisplayConfigDevice {
-    struct Win32TransientDeviceId sourceId;
-    struct Win32TransientDeviceId targetId;
-    DISPLAYCONFIG_PATH_INFO pathInfo;
-    DISPLAYCONFIG_MODE_INFO sourceModeInfo;
-    DISPLAYCONFIG_MODE_INFO targetModeInfo;
-};
+std::shared_ptr<struct Win32DisplayGeometry> BuildDisplayGeometry(const std::vector<struct Win32ActiveTargetState> &targets);
+void PublishDisplayGeometry(std::shared_ptr<struct Win32DisplayGeometry> geometry);
+Napi::Object ConvertLUID(Napi::Env env, const LUID *luid);
+Napi::Number ConvertRotation(Napi::Env env, DISPLAYCONFIG_ROTATION rotation);
+Napi::String ConvertScaling(Napi::Env env, DISPLAYCONFIG_SCALING scaling);
+Napi::Object ConvertDisplayConfigChange(Napi::Env env, const struct Win32DisplayConfigChange &change);
 
 DWORD RunDisplayChangeContextLoop(LPVOID lpParam);
 
+// Display changes arrive in bursts (a dock connect sends 5-10 messages), so
+// the listener waits for a quiet period before querying, but never longer than
+// the maximum delay after the first message of a burst.
+#define DISPLAY_CHANGE_QUIET_PERIOD_DEFAULT 200
+#define DISPLAY_CHANGE_MAX_DELAY_DEFAULT 1000
+#define DISPLAY_CHANGE_TIMER_ID 1
+
 class Win32DisplayChangeContext {
    public:
-    Win32DisplayChangeContext(Napi::Env env, Napi::Function &callback) : running(), dwThreadId(0) {
+    Win32DisplayChangeContext(Napi::Env env, Napi::Function &callback, DWORD quietPeriod, DWORD maxDelay)
+        : running(), dwThreadId(0), quietPeriod(quietPeriod), maxDelay(maxDelay), generation(0) {
         this->running.store(TRUE);
         this->hThread = NULL;
         this->tsfn = Napi::ThreadSafeFunction::New(
@@ -107,6 +115,9 @@ class Win32DisplayChangeContext {
     HANDLE hThread;
     Napi::ThreadSafeFunction tsfn;
     DWORD dwThreadId;
+    std::atomic<DWORD> quietPeriod;
+    std::atomic<DWORD> maxDelay;
+    std::atomic<UINT64> generation;
 };
 
 void HandleDisplayChangeError(Napi::Env env, Napi::Function callback, LPVOID error) {
@@ -116,8 +127,34 @@ void HandleDisplayChangeError(Napi::Env env, Napi::Function callback, LPVOID err
 #pragma warning(pop)
 }
 
-void HandleDisplayChangeSuccess(Napi::Env env, Napi::Function callback) {
-    callback.Call(env.Global(), {env.Null()});
+Napi::Object ConvertDisplayChangeBatch(Napi::Env env, const struct Win32DisplayConfigDelta *delta) {
+    auto result = Napi::Object::New(env);
+    result.Set("count", Napi::Number::New(env, (double)delta->count));
+    result.Set("generation", Napi::Number::New(env, (double)delta->generation));
+    return result;
+}
+
+void HandleDisplayChangeSuccess(Napi::Env env, Napi::Function callback, struct Win32DisplayConfigDelta *delta) {
+    if (!delta->changesKnown) {
+        callback.Call(env.Global(), {env.Null(), env.Null(), ConvertDisplayChangeBatch(env, delta)});
+    } else {
+        auto changes = Napi::Array::New(env, delta->changes.size());
+        for (size_t i = 0; i < delta->changes.size(); i++) {
+            changes.Set(i, ConvertDisplayConfigChange(env, delta->changes[i]));
+        }
+        callback.Call(env.Global(), {env.Null(), changes, ConvertDisplayChangeBatch(env, delta)});
+    }
+    delete delta;
+}
+
+// Sent once the thread has published its first geometry (or found there is
+// none), so lookups waiting on it can go ahead without a query of their own.
+void HandleDisplayGeometryReady(Napi::Env env, Napi::Function callback) {
+    auto batch = Napi::Object::New(env);
+    batch.Set("count", Napi::Number::New(env, 0));
+    batch.Set("generation", Napi::Number::New(env, 0));
+    batch.Set("geometryReady", Napi::Boolean::New(env, true));
+    callback.Call(env.Global(), {env.Null(), env.Null(), batch});
 }
 
 DWORD RunDisplayChangeContextLoop(LPVOID lpParam) {
@@ -159,15 +196,107 @@ DWORD RunDisplayChangeContextLoop(LPVOID lpParam) {
         return error;
     }
 
+    // While this thread is around to see display changes, device names can
+    // be cached between queries.
+    SetDeviceNameCacheEnabled(TRUE);
+
+    // Keep the last known set of active targets around, so each change can
+    // be reported as a diff instead of making every listener re-query.
+    struct Win32QueryDisplayConfigOptions activeOnly;
+    activeOnly.activeOnly = TRUE;
+    std::vector<struct Win32ActiveTargetState> previousTargets;
+    BOOL havePreviousTargets = FALSE;
+    auto initialResults = DoQueryDisplayConfig(activeOnly);
+    if (initialResults->error == ERROR_SUCCESS) {
+        previousTargets = CollectActiveTargets(initialResults);
+        havePreviousTargets = TRUE;
+        PublishDisplayGeometry(BuildDisplayGeometry(previousTargets));
+    }
+    context->tsfn.NonBlockingCall(HandleDisplayGeometryReady);
+
+    // Messages seen since the last delivered delta, and changes found by a
+    // query that a newer message made stale before it could be delivered.
+    UINT32 pendingMessages = 0;
+    ULONGLONG firstPendingTick = 0;
+    BOOL carriedChangesKnown = TRUE;
+    std::vector<struct Win32DisplayConfigChange> carriedChanges;
+
     while (context->running.load() != FALSE && (getMessageResponse = GetMessage(&msg, NULL, 0, 0)) > 0) {
         if (msg.message == displayChange) {
-            context->tsfn.NonBlockingCall(HandleDisplayChangeSuccess);
+            // Names are cheap to drop and must not be served stale while
+            // the burst settles.
+            InvalidateDeviceNameCache();
+            if (pendingMessages++ == 0) {
+                firstPendingTick = GetTickCount64();
+            }
+
+            DWORD quietPeriod = context->quietPeriod.load();
+            ULONGLONG waited = GetTickCount64() - firstPendingTick;
+            if (quietPeriod > 0 && waited < context->maxDelay.load()) {
+                // Re-arming the timer pushes the query back until the burst
+                // has been quiet for a whole period.
+                DWORD remaining = (DWORD)(context->maxDelay.load() - waited);
+                SetTimer(hWnd, DISPLAY_CHANGE_TIMER_ID, std::min<DWORD>(quietPeriod, remaining), NULL);
+                continue;
+            }
+        } else if (msg.message == WM_TIMER && msg.hwnd == hWnd && msg.wParam == DISPLAY_CHANGE_TIMER_ID) {
+            KillTimer(hWnd, DISPLAY_CHANGE_TIMER_ID);
+        } else {
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+            continue;
+        }
+
+        if (pendingMessages == 0) {
+            continue;
+        }
+        KillTimer(hWnd, DISPLAY_CHANGE_TIMER_ID);
+
+        auto results = DoQueryDisplayConfig(activeOnly);
+        BOOL changesKnown = FALSE;
+        std::vector<struct Win32DisplayConfigChange> changes;
+        if (results->error == ERROR_SUCCESS) {
+            auto currentTargets = CollectActiveTargets(results);
+            if (havePreviousTargets) {
+                changes = DiffActiveTargets(previousTargets, currentTargets);
+                changesKnown = TRUE;
+            }
+            previousTargets = std::move(currentTargets);
+            havePreviousTargets = TRUE;
+            PublishDisplayGeometry(BuildDisplayGeometry(previousTargets));
+        } else {
+            havePreviousTargets = FALSE;
+            PublishDisplayGeometry(nullptr);
         }
 
-        TranslateMessage(&msg);
-        DispatchMessage(&msg);
+        carriedChangesKnown = carriedChangesKnown && changesKnown;
+        carriedChanges.insert(carriedChanges.end(), changes.begin(), changes.end());
+
+        // Another change arrived while querying, so this result is already
+        // superseded. Keep its changes for the next delta instead of making
+        // listeners act on a configuration that no longer exists.
+        MSG newer;
+        if (PeekMessage(&newer, NULL, displayChange, displayChange, PM_NOREMOVE)) {
+            continue;
+        }
+
+        auto delta = new Win32DisplayConfigDelta();
+        delta->changesKnown = carriedChangesKnown;
+        if (carriedChangesKnown) {
+            delta->changes = std::move(carriedChanges);
+        }
+        delta->count = pendingMessages;
+        delta->generation = ++context->generation;
+        carriedChanges.clear();
+        carriedChangesKnown = TRUE;
+        pendingMessages = 0;
+
+        if (context->tsfn.NonBlockingCall(delta, HandleDisplayChangeSuccess) != napi_ok) {
+            delete delta;
+        }
     }
 
+    KillTimer(hWnd, DISPLAY_CHANGE_TIMER_ID);
     auto wasRunning = context->running.exchange(FALSE);
     if (getMessageResponse < 0) {
         error = GetLastError();
@@ -183,291 +312,158 @@ DWORD RunDisplayChangeContextLoop(LPVOID lpParam) {
 #pragma warning(pop)
     }
 
+    SetDeviceNameCacheEnabled(FALSE);
+    PublishDisplayGeometry(nullptr);
     DestroyWindow(hWnd);
     return error;
 }
 
-bool TransientDeviceIdVectorContains(const std::vector<struct Win32TransientDeviceId> &vec, struct Win32TransientDeviceId &dev) {
-    for (auto it = vec.begin(); it != vec.end(); it++) {
-        if (it->adapterId.LowPart != dev.adapterId.LowPart) {
-            continue;
-        }
-        if (it->adapterId.HighPart != dev.adapterId.HighPart) {
-            continue;
-        }
-        if (it->id != dev.id) {
-            continue;
-        }
-        return true;
-    }
-    return false;
-}
-
-bool AlreadyHasNameInfo(const std::vector<struct Win32DeviceNameInfo> &rgNameInfo, LUID &adapterId, UINT32 id) {
-    for (auto it = rgNameInfo.begin(); it != rgNameInfo.end(); it++) {
-        if (it->adapterId.LowPart != adapterId.LowPart) {
-            continue;
-        }
-        if (it->adapterId.HighPart != adapterId.HighPart) {
-            continue;
-        }
-        if (it->id != id) {
-            continue;
-        }
-        return true;
-    }
-    return false;
-}
-
-void AcquireDeviceNames(std::shared_ptr<struct Win32QueryDisplayConfigResults> configResults) {
-    DISPLAYCONFIG_TARGET_DEVICE_NAME request;
-    request.header.type = DISPLAYCONFIG_DEVICE_INFO_GET_TARGET_NAME;
-    request.header.size = sizeof(request);
-
-    for (auto it = configResults->rgPathInfo.begin(); it != configResults->rgPathInfo.end(); it++) {
-        if (AlreadyHasNameInfo(configResults->rgNameInfo, it->targetInfo.adapterId, it->targetInfo.id)) {
-            continue;
-        }
+// The display change thread keeps the published geometry current, and
+// clears it when it stops.
+std::mutex displayGeometryMutex;
+std::shared_ptr<const struct Win32DisplayGeometry> displayGeometry;
+UINT64 displayGeometryGeneration = 0;
 
-        request.header.adapterId.LowPart = it->targetInfo.adapterId.LowPart;
-        request.header.adapterId.HighPart = it->targetInfo.adapterId.HighPart;
-        request.header.id = it->targetInfo.id;
-        request.monitorFriendlyDeviceName[0] = '\0';
-        request.monitorDevicePath[0] = '\0';
+std::shared_ptr<struct Win32DisplayGeometry> BuildDisplayGeometry(const std::vector<struct Win32ActiveTargetState> &targets) {
+    auto geometry = std::make_shared<struct Win32DisplayGeometry>();
+    geometry->generation = 0;
 
-        auto error = DisplayConfigGetDeviceInfo(&request.header);
-        if (error != ERROR_SUCCESS) {
-            // In the event of failure, drop your breakpoint/logging/evs here.
-            // No, we're not going to expose this to Node. It's too much work.
+    for (auto it = targets.begin(); it != targets.end(); it++) {
+        if (!it->hasSourceMode || it->width == 0 || it->height == 0) {
             continue;
         }
 
-        configResults->rgNameInfo.push_back(Win32DeviceNameInfo());
-        auto newEntry = configResults->rgNameInfo.end();
-        newEntry--;
-
-        newEntry->adapterId.LowPart = it->targetInfo.adapterId.LowPart;
-        newEntry->adapterId.HighPart = it->targetInfo.adapterId.HighPart;
-        newEntry->id = it->targetInfo.id;
-        newEntry->deviceFlags = request.flags;
-        newEntry->outputTechnology = request.outputTechnology;
-        newEntry->edidManufactureId = request.edidManufactureId;
-        newEntry->edidProductCodeId = request.edidProductCodeId;
-        newEntry->connectorInstance = request.connectorInstance;
-        wcscpy_s(newEntry->monitorFriendlyDeviceName, DEVICE_NAME_SIZE, request.monitorFriendlyDeviceName);
-        wcscpy_s(newEntry->monitorDevicePath, DEVICE_PATH_SIZE, request.monitorDevicePath);
-    }
-}
-
-std::shared_ptr<struct Win32QueryDisplayConfigResults> DoQueryDisplayConfig() {
-    UINT32 cPathInfo = 0, cModeInfo = 0, cPathInfoMax = 0, cModeInfoMax = 0;
-    while (true) {
-        LONG errorCode = GetDisplayConfigBufferSizes(QDC_ALL_PATHS, &cPathInfo, &cModeInfo);
-        if (errorCode != ERROR_SUCCESS) {
-            cPathInfo = cModeInfo = 0;
+        struct Win32DisplayGeometryEntry entry;
+        entry.adapterId = it->adapterId;
+        entry.id = it->id;
+        entry.devicePath = it->devicePath;
+        entry.bounds.left = it->position.x;
+        entry.bounds.top = it->position.y;
+        entry.bounds.right = it->position.x + (LONG)it->width;
+        entry.bounds.bottom = it->position.y + (LONG)it->height;
+        // 30Hz is a safe guess for broken refresh rates, same as the JavaScript
+        // side has always assumed.
+        if (it->refreshRate.Numerator == 0 || it->refreshRate.Denominator == 0) {
+            entry.refreshRate = 30;
         } else {
-            if (cPathInfo > cPathInfoMax) {
-                cPathInfoMax = cPathInfo;
-            }
-            cPathInfo = cPathInfoMax;
-
-            if (cModeInfo > cModeInfoMax) {
-                cModeInfoMax = cModeInfo;
-            }
-            cModeInfo = cModeInfoMax;
+            entry.refreshRate = (double)it->refreshRate.Numerator / (double)it->refreshRate.Denominator;
         }
 
-        auto result = std::make_shared<struct Win32QueryDisplayConfigResults>(cPathInfo, cModeInfo);
-        if (errorCode != ERROR_SUCCESS) {
-            result->error = errorCode;
-            result->faultWasBuffer = true;
-            return result;
+        entry.dpiX = entry.dpiY = USER_DEFAULT_SCREEN_DPI;
+        auto hMonitor = MonitorFromRect(&entry.bounds, MONITOR_DEFAULTTONULL);
+        if (hMonitor != NULL) {
+            UINT dpiX, dpiY;
+            if (SUCCEEDED(GetDpiForMonitor(hMonitor, MDT_EFFECTIVE_DPI, &dpiX, &dpiY))) {
+                entry.dpiX = dpiX;
+                entry.dpiY = dpiY;
+            }
         }
 
-        errorCode = QueryDisplayConfig(QDC_ALL_PATHS, &cPathInfo, result->rgPathInfo.data(), &cModeInfo, result->rgModeInfo.data(), NULL);
-        result->error = errorCode;
-        if (errorCode == ERROR_SUCCESS) {
-            result->rgPathInfo.resize(cPathInfo);
-            result->rgModeInfo.resize(cModeInfo);
-            AcquireDeviceNames(result);
-            return result;
-        } else if (errorCode != ERROR_INSUFFICIENT_BUFFER) {
-            result->faultWasBuffer = false;
-            return result;
-        }
+        geometry->entries.push_back(entry);
+        geometry->xs.push_back(entry.bounds.left);
+        geometry->xs.push_back(entry.bounds.right);
+        geometry->ys.push_back(entry.bounds.top);
+        geometry->ys.push_back(entry.bounds.bottom);
     }
-}
 
-LONG ToggleEnabled(const std::shared_ptr<struct Win32DeviceConfigToggleEnabled> args) {
-    auto initialQueryResults = DoQueryDisplayConfig();
-    if (initialQueryResults->error != ERROR_SUCCESS) {
-        return initialQueryResults->error;
+    std::sort(geometry->xs.begin(), geometry->xs.end());
+    geometry->xs.erase(std::unique(geometry->xs.begin(), geometry->xs.end()), geometry->xs.end());
+    std::sort(geometry->ys.begin(), geometry->ys.end());
+    geometry->ys.erase(std::unique(geometry->ys.begin(), geometry->ys.end()), geometry->ys.end());
+    if (geometry->xs.size() < 2 || geometry->ys.size() < 2) {
+        return geometry;
     }
 
-    struct Win32TransientDeviceId currentPathDeviceId;
-    std::vector<DISPLAYCONFIG_PATH_INFO> preserve;
-    std::vector<struct Win32TransientDeviceId> alreadyEnabled;
-
-    // First, ensure that the already enabled devices are accounted for.
-    // Windows likes to report all the possible source modes for a given monitor,
-    // and we don't want to override them here: we just want to enable the ones
-    // that aren't enabled yet.
-    for (auto it = initialQueryResults->rgPathInfo.begin(); it != initialQueryResults->rgPathInfo.end(); it++) {
-        currentPathDeviceId.adapterId.LowPart = it->targetInfo.adapterId.LowPart;
-        currentPathDeviceId.adapterId.HighPart = it->targetInfo.adapterId.HighPart;
-        currentPathDeviceId.id = it->targetInfo.id;
-
-        if (it->sourceInfo.modeInfoIdx == DISPLAYCONFIG_PATH_MODE_IDX_INVALID ||
-            it->targetInfo.modeInfoIdx == DISPLAYCONFIG_PATH_MODE_IDX_INVALID) {
-            continue;
-        }
-
-        if ((it->flags & DISPLAYCONFIG_PATH_ACTIVE) == DISPLAYCONFIG_PATH_ACTIVE) {
-            auto copied = *it;
-            copied.sourceInfo.modeInfoIdx = DISPLAYCONFIG_PATH_MODE_IDX_INVALID;
-            copied.sourceInfo.statusFlags = 0;
-            copied.targetInfo.modeInfoIdx = DISPLAYCONFIG_PATH_MODE_IDX_INVALID;
-            copied.targetInfo.statusFlags = 0;
-            preserve.push_back(copied);
-            alreadyEnabled.push_back(currentPathDeviceId);
+    auto columns = geometry->xs.size() - 1;
+    geometry->cells.resize(columns * (geometry->ys.size() - 1));
+    for (UINT32 i = 0; i < geometry->entries.size(); i++) {
+        auto &bounds = geometry->entries[i].bounds;
+        auto xFirst = std::lower_bound(geometry->xs.begin(), geometry->xs.end(), bounds.left) - geometry->xs.begin();
+        auto xLast = std::lower_bound(geometry->xs.begin(), geometry->xs.end(), bounds.right) - geometry->xs.begin();
+        auto yFirst = std::lower_bound(geometry->ys.begin(), geometry->ys.end(), bounds.top) - geometry->ys.begin();
+        auto yLast = std::lower_bound(geometry->ys.begin(), geometry->ys.end(), bounds.bottom) - geometry->ys.begin();
+        for (auto y = yFirst; y < yLast; y++) {
+            for (auto x = xFirst; x < xLast; x++) {
+                geometry->cells[y * columns + x].push_back(i);
+            }
         }
     }
 
-    // Then, enable the devices we wanted to enable but haven't yet
-    for (auto it = initialQueryResults->rgPathInfo.begin(); it != initialQueryResults->rgPathInfo.end(); it++) {
-        currentPathDeviceId.adapterId.LowPart = it->targetInfo.adapterId.LowPart;
-        currentPathDeviceId.adapterId.HighPart = it->targetInfo.adapterId.HighPart;
-        currentPathDeviceId.id = it->targetInfo.id;
-
-        if (it->sourceInfo.modeInfoIdx == DISPLAYCONFIG_PATH_MODE_IDX_INVALID) {
-            continue;
-        }
+    return geometry;
+}
 
-        if (TransientDeviceIdVectorContains(args->enable, currentPathDeviceId) &&
-            !TransientDeviceIdVectorContains(alreadyEnabled, currentPathDeviceId)) {
-            auto copied = *it;
-            copied.sourceInfo.modeInfoIdx = DISPLAYCONFIG_PATH_MODE_IDX_INVALID;
-            copied.sourceInfo.statusFlags = 0;
-            copied.targetInfo.modeInfoIdx = DISPLAYCONFIG_PATH_MODE_IDX_INVALID;
-            copied.targetInfo.statusFlags = 0;
-            copied.targetInfo.scaling = DISPLAYCONFIG_SCALING_PREFERRED;
-            copied.flags = DISPLAYCONFIG_PATH_ACTIVE;
-            preserve.push_back(copied);
-            alreadyEnabled.push_back(currentPathDeviceId);
-        }
+void PublishDisplayGeometry(std::shared_ptr<struct Win32DisplayGeometry> geometry) {
+    std::lock_guard<std::mutex> lock(displayGeometryMutex);
+    if (geometry) {
+        geometry->generation = ++displayGeometryGeneration;
     }
+    displayGeometry = geometry;
+}
 
-    // Then, enable all of the devices we know were or need to be enabled.
-    // Note that some disabled devices are still in here. Due to Windows being
-    // Windows, the only way out of this hole is to turn them all on, then turn off
-    // the ones we don't want.
-    auto error = SetDisplayConfig(
-        preserve.size(),
-        preserve.data(),
-        0,
-        NULL,
-        SDC_APPLY | SDC_TOPOLOGY_SUPPLIED | SDC_ALLOW_PATH_ORDER_CHANGES);
-
-    if (error != ERROR_SUCCESS) {
-        return error;
-    }
+// Returns the geometry the display change thread last published, or null
+// while no listener is running or its last query failed. Never queries the
+// display configuration itself, so lookups stay cheap on the JS thread.
+std::shared_ptr<const struct Win32DisplayGeometry> AcquireDisplayGeometry() {
+    std::lock_guard<std::mutex> lock(displayGeometryMutex);
+    return displayGeometry;
+}
 
-    auto allOnQueryResults = DoQueryDisplayConfig();
-    if (allOnQueryResults->error != ERROR_SUCCESS) {
-        return allOnQueryResults->error;
+// Returns the index of the grid cell along one axis containing `value`, or -1.
+ptrdiff_t FindGeometryCell(const std::vector<LONG> &edges, LONG value) {
+    auto upper = std::upper_bound(edges.begin(), edges.end(), value);
+    if (upper == edges.begin() || upper == edges.end()) {
+        return -1;
     }
+    return (upper - edges.begin()) - 1;
+}
 
-    preserve.clear();
-
-    // Finally, disable the monitors that shouldn't be there.
-    for (auto it = allOnQueryResults->rgPathInfo.begin(); it != allOnQueryResults->rgPathInfo.end(); it++) {
-        currentPathDeviceId.adapterId.LowPart = it->targetInfo.adapterId.LowPart;
-        currentPathDeviceId.adapterId.HighPart = it->targetInfo.adapterId.HighPart;
-        currentPathDeviceId.id = it->targetInfo.id;
-
-        if (it->sourceInfo.modeInfoIdx == DISPLAYCONFIG_PATH_MODE_IDX_INVALID ||
-            it->targetInfo.modeInfoIdx == DISPLAYCONFIG_PATH_MODE_IDX_INVALID) {
-            continue;
-        }
-
-        if (((it->flags & DISPLAYCONFIG_PATH_ACTIVE) == DISPLAYCONFIG_PATH_ACTIVE) &&
-            !TransientDeviceIdVectorContains(args->disable, currentPathDeviceId)) {
-            auto copied = *it;
-            copied.sourceInfo.modeInfoIdx = DISPLAYCONFIG_PATH_MODE_IDX_INVALID;
-            copied.sourceInfo.statusFlags = 0;
-            copied.targetInfo.modeInfoIdx = DISPLAYCONFIG_PATH_MODE_IDX_INVALID;
-            copied.targetInfo.statusFlags = 0;
-            preserve.push_back(copied);
-        }
+std::vector<UINT32> FindDisplaysAtPoint(const struct Win32DisplayGeometry &geometry, LONG x, LONG y) {
+    auto column = FindGeometryCell(geometry.xs, x);
+    auto row = FindGeometryCell(geometry.ys, y);
+    if (column < 0 || row < 0) {
+        return std::vector<UINT32>();
     }
+    return geometry.cells[row * (geometry.xs.size() - 1) + column];
+}
 
-    error = SetDisplayConfig(
-        preserve.size(),
-        preserve.data(),
-        0,
-        NULL,
-        SDC_APPLY | SDC_TOPOLOGY_SUPPLIED | SDC_ALLOW_PATH_ORDER_CHANGES);
-
-    if (!args->persistent || error != ERROR_SUCCESS) {
-        return error;
+std::vector<UINT32> FindDisplaysInRect(const struct Win32DisplayGeometry &geometry, const RECT &rect) {
+    std::vector<UINT32> found;
+    if (geometry.cells.empty() || rect.right <= rect.left || rect.bottom <= rect.top) {
+        return found;
     }
 
-    // If we say "persistent", then we have to do this whole dance where we figure out
-    // what Windows decided to give us and hand it _back_ to Windows to save it.
-
-    auto persistentQueryResults = DoQueryDisplayConfig();
-    if (persistentQueryResults->error != ERROR_SUCCESS) {
-        return persistentQueryResults->error;
+    // Clamp the rectangle to the grid, then walk the cells it covers.
+    auto columns = (ptrdiff_t)geometry.xs.size() - 1;
+    auto rows = (ptrdiff_t)geometry.ys.size() - 1;
+    auto clampCell = [](const std::vector<LONG> &edges, LONG value, ptrdiff_t count) -> ptrdiff_t {
+        if (value < edges.front()) {
+            return 0;
+        }
+        auto upper = std::upper_bound(edges.begin(), edges.end(), value);
+        return std::min<ptrdiff_t>((upper - edges.begin()) - 1, count - 1);
+    };
+    if (rect.right <= geometry.xs.front() || rect.left >= geometry.xs.back() ||
+        rect.bottom <= geometry.ys.front() || rect.top >= geometry.ys.back()) {
+        return found;
     }
-
-    return SetDisplayConfig(
-        persistentQueryResults->rgPathInfo.size(),
-        persistentQueryResults->rgPathInfo.data(),
-        persistentQueryResults->rgModeInfo.size(),
-        persistentQueryResults->rgModeInfo.data(),
-        SDC_APPLY | SDC_USE_SUPPLIED_DISPLAY_CONFIG | SDC_SAVE_TO_DATABASE);
-}
-
-LONG RestoreDeviceConfig(const std::shared_ptr<std::vector<struct Win32RestoreDisplayConfigDevice>> restoreConfig, BOOL persistent) {
-    std::vector<DISPLAYCONFIG_PATH_INFO> rgPathInfo;
-    std::vector<DISPLAYCONFIG_MODE_INFO> rgModeInfo;
-    DWORD dwModeInfoOffset = 0;
-
-    for (auto it = restoreConfig->begin(); it != restoreConfig->end(); it++) {
-        auto pathInfoCopy = it->pathInfo;
-        auto sourceModeInfoCopy = it->sourceModeInfo;
-        auto targetModeInfoCopy = it->targetModeInfo;
-
-        // Take note: the source "id" fields are not modified.
-        // They actually are persistent across reboots, and have special
-        // meaning with respect to which extension is "primary" vs secondary.
-        // The adapterId still needs to be corrected, as do all IDs on the target.
-        // But the source id needs to remain the same.
-
-        pathInfoCopy.sourceInfo.adapterId = it->sourceId.adapterId;
-        pathInfoCopy.targetInfo.adapterId = it->targetId.adapterId;
-        pathInfoCopy.targetInfo.id = it->targetId.id;
-
-        pathInfoCopy.sourceInfo.modeInfoIdx = dwModeInfoOffset++;
-        pathInfoCopy.targetInfo.modeInfoIdx = dwModeInfoOffset++;
-
-        sourceModeInfoCopy.adapterId = it->sourceId.adapterId;
-        targetModeInfoCopy.adapterId = it->targetId.adapterId;
-        targetModeInfoCopy.id = it->targetId.id;
-
-        rgPathInfo.push_back(pathInfoCopy);
-        rgModeInfo.push_back(sourceModeInfoCopy);
-        rgModeInfo.push_back(targetModeInfoCopy);
+    auto xFirst = clampCell(geometry.xs, rect.left, columns);
+    auto xLast = clampCell(geometry.xs, rect.right - 1, columns);
+    auto yFirst = clampCell(geometry.ys, rect.top, rows);
+    auto yLast = clampCell(geometry.ys, rect.bottom - 1, rows);
+
+    std::vector<bool> seen(geometry.entries.size());
+    for (auto y = yFirst; y <= yLast; y++) {
+        for (auto x = xFirst; x <= xLast; x++) {
+            for (auto index : geometry.cells[y * columns + x]) {
+                if (!seen[index]) {
+                    seen[index] = true;
+                    found.push_back(index);
+                }
+            }
+        }
     }
-
-    auto persistFlag = persistent ? SDC_SAVE_TO_DATABASE : 0;
-
-    return SetDisplayConfig(
-        rgPathInfo.size(),
-        rgPathInfo.data(),
-        rgModeInfo.size(),
-        rgModeInfo.data(),
-        SDC_APPLY | SDC_USE_SUPPLIED_DISPLAY_CONFIG | persistFlag);
+    std::sort(found.begin(), found.end());
+    return found;
 }
 
 Napi::Object ConvertLUID(Napi::Env env, const LUID *luid) {
@@ -791,12 +787,51 @@ Napi::Object ConvertConfigResults(Napi::Env env, const std::shared_ptr<struct Wi
     return result;
 }
 
+// Reads { activeOnly, namesOnly, targetIds } from JavaScript. Missing fields
+// keep their defaults; anything malformed rejects the whole call.
+bool ParseQueryDisplayConfigOptions(const Napi::Value &value, struct Win32QueryDisplayConfigOptions &options) {
+    if (value.IsUndefined() || value.IsNull()) {
+        return true;
+    }
+    if (!value.IsObject()) {
+        return false;
+    }
+    auto object = value.As<Napi::Object>();
+
+    auto activeOnly = object.Get("activeOnly");
+    if (!activeOnly.IsUndefined()) {
+        options.activeOnly = activeOnly.ToBoolean().Value();
+    }
+    auto namesOnly = object.Get("namesOnly");
+    if (!namesOnly.IsUndefined()) {
+        options.namesOnly = namesOnly.ToBoolean().Value();
+    }
+
+    auto targetIdsVal = object.Get("targetIds");
+    if (targetIdsVal.IsUndefined()) {
+        return true;
+    }
+    if (!targetIdsVal.IsArray()) {
+        return false;
+    }
+    auto targetIds = targetIdsVal.As<Napi::Array>();
+    for (uint32_t i = 0; i < targetIds.Length(); i++) {
+        auto targetId = targetIds.Get(i);
+        if (!targetId.IsNumber()) {
+            return false;
+        }
+        options.targetIds.push_back(targetId.As<Napi::Number>().Uint32Value());
+    }
+    return true;
+}
+
 class Win32QueryDisplayConfigWorker : public Napi::AsyncWorker {
    public:
-    Win32QueryDisplayConfigWorker(Napi::Function &callback) : Napi::AsyncWorker(callback), configResults() {}
+    Win32QueryDisplayConfigWorker(Napi::Function &callback, const struct Win32QueryDisplayConfigOptions &options)
+        : Napi::AsyncWorker(callback), options(options), configResults() {}
 
     void Execute() {
-        this->configResults = DoQueryDisplayConfig();
+        this->configResults = DoQueryDisplayConfig(this->options);
     }
 
     std::vector<napi_value> GetResult(Napi::Env env) {
@@ -811,9 +846,225 @@ class Win32QueryDisplayConfigWorker : public Napi::AsyncWorker {
     }
 
    private:
+    struct Win32QueryDisplayConfigOptions options;
+    std::shared_ptr<struct Win32QueryDisplayConfigResults> configResults;
+};
+
+// Packed results hand JavaScript the QueryDisplayConfig arrays as they came
+// back from Windows, one ArrayBuffer each. packed.js reads fields out of them
+// using the offsets from Win32DisplayConfigLayout, so a query with hundreds of
+// inactive paths costs two copies instead of an object tree per path and mode.
+template <typename T>
+Napi::ArrayBuffer CopyToArrayBuffer(Napi::Env env, const std::vector<T> &items) {
+    auto buffer = Napi::ArrayBuffer::New(env, items.size() * sizeof(T));
+    if (!items.empty()) {
+        memcpy(buffer.Data(), items.data(), items.size() * sizeof(T));
+    }
+    return buffer;
+}
+
+Napi::Object ConvertPackedConfigResults(Napi::Env env, const std::shared_ptr<struct Win32QueryDisplayConfigResults> configResults) {
+    auto result = Napi::Object::New(env);
+    result.Set("pathBuffer", CopyToArrayBuffer(env, configResults->rgPathInfo));
+    result.Set("pathCount", (double)configResults->rgPathInfo.size());
+    result.Set("modeBuffer", CopyToArrayBuffer(env, configResults->rgModeInfo));
+    result.Set("modeCount", (double)configResults->rgModeInfo.size());
+    result.Set("nameArray", ConvertNamesInfo(env, configResults->rgNameInfo));
+    return result;
+}
+
+class Win32QueryDisplayConfigPackedWorker : public Napi::AsyncWorker {
+   public:
+    Win32QueryDisplayConfigPackedWorker(Napi::Function &callback, const struct Win32QueryDisplayConfigOptions &options)
+        : Napi::AsyncWorker(callback), options(options), configResults() {}
+
+    void Execute() {
+        this->configResults = DoQueryDisplayConfig(this->options);
+    }
+
+    std::vector<napi_value> GetResult(Napi::Env env) {
+        std::vector<napi_value> result{env.Null(), env.Undefined()};
+        if (this->configResults->error != ERROR_SUCCESS) {
+            result[0] = Napi::Number::New(env, (double)this->configResults->error);
+        } else {
+            result[1] = ConvertPackedConfigResults(env, this->configResults);
+        }
+
+        return result;
+    }
+
+   private:
+    struct Win32QueryDisplayConfigOptions options;
     std::shared_ptr<struct Win32QueryDisplayConfigResults> configResults;
 };
 
+Napi::Value Win32QueryDisplayConfigPacked(const Napi::CallbackInfo &info) {
+    if (info.Length() < 1) {
+        return Napi::Boolean::New(info.Env(), false);
+    }
+    if (!(info[0].IsFunction())) {
+        return Napi::Boolean::New(info.Env(), false);
+    }
+
+    struct Win32QueryDisplayConfigOptions options;
+    if (info.Length() >= 2 && !ParseQueryDisplayConfigOptions(info[1], options)) {
+        return Napi::Boolean::New(info.Env(), false);
+    }
+
+    auto callback = info[0].As<Napi::Function>();
+    auto worker = new Win32QueryDisplayConfigPackedWorker(callback, options);
+    worker->Queue();
+    return Napi::Boolean::New(info.Env(), true);
+}
+
+// Each field is described as [byte offset, kind], where kind is one of
+// "u32", "i32" or "u64".
+void SetLayoutField(Napi::Env env, Napi::Object &fields, const char *name, size_t offset, const char *kind) {
+    auto field = Napi::Array::New(env, 2);
+    field.Set((uint32_t)0, (double)offset);
+    field.Set((uint32_t)1, kind);
+    fields.Set(name, field);
+}
+
+Napi::Object PathInfoLayout(Napi::Env env) {
+    auto fields = Napi::Object::New(env);
+    SetLayoutField(env, fields, "flags", offsetof(DISPLAYCONFIG_PATH_INFO, flags), "u32");
+    SetLayoutField(env, fields, "sourceAdapterLowPart", offsetof(DISPLAYCONFIG_PATH_INFO, sourceInfo.adapterId.LowPart), "u32");
+    SetLayoutField(env, fields, "sourceAdapterHighPart", offsetof(DISPLAYCONFIG_PATH_INFO, sourceInfo.adapterId.HighPart), "i32");
+    SetLayoutField(env, fields, "sourceId", offsetof(DISPLAYCONFIG_PATH_INFO, sourceInfo.id), "u32");
+    SetLayoutField(env, fields, "sourceModeInfoIdx", offsetof(DISPLAYCONFIG_PATH_INFO, sourceInfo.modeInfoIdx), "u32");
+    SetLayoutField(env, fields, "sourceStatusFlags", offsetof(DISPLAYCONFIG_PATH_INFO, sourceInfo.statusFlags), "u32");
+    SetLayoutField(env, fields, "targetAdapterLowPart", offsetof(DISPLAYCONFIG_PATH_INFO, targetInfo.adapterId.LowPart), "u32");
+    SetLayoutField(env, fields, "targetAdapterHighPart", offsetof(DISPLAYCONFIG_PATH_INFO, targetInfo.adapterId.HighPart), "i32");
+    SetLayoutField(env, fields, "targetId", offsetof(DISPLAYCONFIG_PATH_INFO, targetInfo.id), "u32");
+    SetLayoutField(env, fields, "targetModeInfoIdx", offsetof(DISPLAYCONFIG_PATH_INFO, targetInfo.modeInfoIdx), "u32");
+    SetLayoutField(env, fields, "outputTechnology", offsetof(DISPLAYCONFIG_PATH_INFO, targetInfo.outputTechnology), "u32");
+    SetLayoutField(env, fields, "rotation", offsetof(DISPLAYCONFIG_PATH_INFO, targetInfo.rotation), "u32");
+    SetLayoutField(env, fields, "scaling", offsetof(DISPLAYCONFIG_PATH_INFO, targetInfo.scaling), "u32");
+    SetLayoutField(env, fields, "refreshRateNumerator", offsetof(DISPLAYCONFIG_PATH_INFO, targetInfo.refreshRate.Numerator), "u32");
+    SetLayoutField(env, fields, "refreshRateDenominator", offsetof(DISPLAYCONFIG_PATH_INFO, targetInfo.refreshRate.Denominator), "u32");
+    SetLayoutField(env, fields, "scanLineOrdering", offsetof(DISPLAYCONFIG_PATH_INFO, targetInfo.scanLineOrdering), "u32");
+    SetLayoutField(env, fields, "targetAvailable", offsetof(DISPLAYCONFIG_PATH_INFO, targetInfo.targetAvailable), "i32");
+    SetLayoutField(env, fields, "targetStatusFlags", offsetof(DISPLAYCONFIG_PATH_INFO, targetInfo.statusFlags), "u32");
+
+    auto result = Napi::Object::New(env);
+    result.Set("size", (double)sizeof(DISPLAYCONFIG_PATH_INFO));
+    result.Set("fields", fields);
+    return result;
+}
+
+Napi::Object ModeInfoLayout(Napi::Env env) {
+    auto fields = Napi::Object::New(env);
+    SetLayoutField(env, fields, "infoType", offsetof(DISPLAYCONFIG_MODE_INFO, infoType), "u32");
+    SetLayoutField(env, fields, "id", offsetof(DISPLAYCONFIG_MODE_INFO, id), "u32");
+    SetLayoutField(env, fields, "adapterLowPart", offsetof(DISPLAYCONFIG_MODE_INFO, adapterId.LowPart), "u32");
+    SetLayoutField(env, fields, "adapterHighPart", offsetof(DISPLAYCONFIG_MODE_INFO, adapterId.HighPart), "i32");
+
+    // DISPLAYCONFIG_MODE_INFO_TYPE_TARGET
+    SetLayoutField(env, fields, "pixelRate", offsetof(DISPLAYCONFIG_MODE_INFO, targetMode.targetVideoSignalInfo.pixelRate), "u64");
+    SetLayoutField(env, fields, "hSyncNumerator", offsetof(DISPLAYCONFIG_MODE_INFO, targetMode.targetVideoSignalInfo.hSyncFreq.Numerator), "u32");
+    SetLayoutField(env, fields, "hSyncDenominator", offsetof(DISPLAYCONFIG_MODE_INFO, targetMode.targetVideoSignalInfo.hSyncFreq.Denominator), "u32");
+    SetLayoutField(env, fields, "vSyncNumerator", offsetof(DISPLAYCONFIG_MODE_INFO, targetMode.targetVideoSignalInfo.vSyncFreq.Numerator), "u32");
+    SetLayoutField(env, fields, "vSyncDenominator", offsetof(DISPLAYCONFIG_MODE_INFO, targetMode.targetVideoSignalInfo.vSyncFreq.Denominator), "u32");
+    SetLayoutField(env, fields, "activeWidth", offsetof(DISPLAYCONFIG_MODE_INFO, targetMode.targetVideoSignalInfo.activeSize.cx), "u32");
+    SetLayoutField(env, fields, "activeHeight", offsetof(DISPLAYCONFIG_MODE_INFO, targetMode.targetVideoSignalInfo.activeSize.cy), "u32");
+    SetLayoutField(env, fields, "totalWidth", offsetof(DISPLAYCONFIG_MODE_INFO, targetMode.targetVideoSignalInfo.totalSize.cx), "u32");
+    SetLayoutField(env, fields, "totalHeight", offsetof(DISPLAYCONFIG_MODE_INFO, targetMode.targetVideoSignalInfo.totalSize.cy), "u32");
+    SetLayoutField(env, fields, "videoStandard", offsetof(DISPLAYCONFIG_MODE_INFO, targetMode.targetVideoSignalInfo.videoStandard), "u32");
+    SetLayoutField(env, fields, "signalScanLineOrdering", offsetof(DISPLAYCONFIG_MODE_INFO, targetMode.targetVideoSignalInfo.scanLineOrdering), "u32");
+
+    // DISPLAYCONFIG_MODE_INFO_TYPE_SOURCE
+    SetLayoutField(env, fields, "sourceWidth", offsetof(DISPLAYCONFIG_MODE_INFO, sourceMode.width), "u32");
+    SetLayoutField(env, fields, "sourceHeight", offsetof(DISPLAYCONFIG_MODE_INFO, sourceMode.height), "u32");
+    SetLayoutField(env, fields, "pixelFormat", offsetof(DISPLAYCONFIG_MODE_INFO, sourceMode.pixelFormat), "u32");
+    SetLayoutField(env, fields, "positionX", offsetof(DISPLAYCONFIG_MODE_INFO, sourceMode.position.x), "i32");
+    SetLayoutField(env, fields, "positionY", offsetof(DISPLAYCONFIG_MODE_INFO, sourceMode.position.y), "i32");
+
+    auto result = Napi::Object::New(env);
+    result.Set("size", (double)sizeof(DISPLAYCONFIG_MODE_INFO));
+    result.Set("fields", fields);
+    return result;
+}
+
+// Maps each raw enum value to the name the object-tree conversion uses, so
+// the two APIs can't drift apart.
+template <typename T, typename Converter>
+Napi::Array EnumNames(Napi::Env env, std::initializer_list<T> values, Converter convert) {
+    auto result = Napi::Array::New(env, values.size());
+    uint32_t i = 0;
+    for (auto value : values) {
+        auto entry = Napi::Array::New(env, 2);
+        entry.Set((uint32_t)0, (double)(UINT32)value);
+        entry.Set((uint32_t)1, convert(env, value));
+        result.Set(i++, entry);
+    }
+    return result;
+}
+
+Napi::Value Win32DisplayConfigLayout(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    auto result = Napi::Object::New(env);
+    result.Set("pathInfo", PathInfoLayout(env));
+    result.Set("modeInfo", ModeInfoLayout(env));
+
+    auto enums = Napi::Object::New(env);
+    enums.Set("outputTechnology", EnumNames(env, {
+        DISPLAYCONFIG_OUTPUT_TECHNOLOGY_HD15,
+        DISPLAYCONFIG_OUTPUT_TECHNOLOGY_SVIDEO,
+        DISPLAYCONFIG_OUTPUT_TECHNOLOGY_COMPOSITE_VIDEO,
+        DISPLAYCONFIG_OUTPUT_TECHNOLOGY_COMPONENT_VIDEO,
+        DISPLAYCONFIG_OUTPUT_TECHNOLOGY_DVI,
+        DISPLAYCONFIG_OUTPUT_TECHNOLOGY_HDMI,
+        DISPLAYCONFIG_OUTPUT_TECHNOLOGY_LVDS,
+        DISPLAYCONFIG_OUTPUT_TECHNOLOGY_D_JPN,
+        DISPLAYCONFIG_OUTPUT_TECHNOLOGY_SDI,
+        DISPLAYCONFIG_OUTPUT_TECHNOLOGY_DISPLAYPORT_EXTERNAL,
+        DISPLAYCONFIG_OUTPUT_TECHNOLOGY_DISPLAYPORT_EMBEDDED,
+        DISPLAYCONFIG_OUTPUT_TECHNOLOGY_UDI_EXTERNAL,
+        DISPLAYCONFIG_OUTPUT_TECHNOLOGY_UDI_EMBEDDED,
+        DISPLAYCONFIG_OUTPUT_TECHNOLOGY_SDTVDONGLE,
+        DISPLAYCONFIG_OUTPUT_TECHNOLOGY_MIRACAST,
+        DISPLAYCONFIG_OUTPUT_TECHNOLOGY_INDIRECT_WIRED,
+        DISPLAYCONFIG_OUTPUT_TECHNOLOGY_INDIRECT_VIRTUAL,
+        DISPLAYCONFIG_OUTPUT_TECHNOLOGY_INTERNAL,
+    }, ConvertVideoOutputTechnology));
+    enums.Set("rotation", EnumNames(env, {
+        DISPLAYCONFIG_ROTATION_IDENTITY,
+        DISPLAYCONFIG_ROTATION_ROTATE90,
+        DISPLAYCONFIG_ROTATION_ROTATE180,
+        DISPLAYCONFIG_ROTATION_ROTATE270,
+    }, ConvertRotation));
+    enums.Set("scaling", EnumNames(env, {
+        DISPLAYCONFIG_SCALING_IDENTITY,
+        DISPLAYCONFIG_SCALING_CENTERED,
+        DISPLAYCONFIG_SCALING_STRETCHED,
+        DISPLAYCONFIG_SCALING_ASPECTRATIOCENTEREDMAX,
+        DISPLAYCONFIG_SCALING_CUSTOM,
+        DISPLAYCONFIG_SCALING_PREFERRED,
+    }, ConvertScaling));
+    enums.Set("scanLineOrdering", EnumNames(env, {
+        DISPLAYCONFIG_SCANLINE_ORDERING_UNSPECIFIED,
+        DISPLAYCONFIG_SCANLINE_ORDERING_PROGRESSIVE,
+        DISPLAYCONFIG_SCANLINE_ORDERING_INTERLACED,
+        DISPLAYCONFIG_SCANLINE_ORDERING_INTERLACED_LOWERFIELDFIRST,
+    }, ConvertScanLineOrdering));
+    enums.Set("pixelFormat", EnumNames(env, {
+        DISPLAYCONFIG_PIXELFORMAT_8BPP,
+        DISPLAYCONFIG_PIXELFORMAT_16BPP,
+        DISPLAYCONFIG_PIXELFORMAT_24BPP,
+        DISPLAYCONFIG_PIXELFORMAT_32BPP,
+        DISPLAYCONFIG_PIXELFORMAT_NONGDI,
+    }, ConvertPixelFormat));
+    enums.Set("infoType", EnumNames(env, {
+        DISPLAYCONFIG_MODE_INFO_TYPE_SOURCE,
+        DISPLAYCONFIG_MODE_INFO_TYPE_TARGET,
+        DISPLAYCONFIG_MODE_INFO_TYPE_DESKTOP_IMAGE,
+    }, ConvertModeInfoType));
+    result.Set("enums", enums);
+
+    return result;
+}
+
 Napi::Value Win32QueryDisplayConfig(const Napi::CallbackInfo &info) {
     if (info.Length() < 1) {
         return Napi::Boolean::New(info.Env(), false);
@@ -822,29 +1073,56 @@ Napi::Value Win32QueryDisplayConfig(const Napi::CallbackInfo &info) {
         return Napi::Boolean::New(info.Env(), false);
     }
 
+    struct Win32QueryDisplayConfigOptions options;
+    if (info.Length() >= 2 && !ParseQueryDisplayConfigOptions(info[1], options)) {
+        return Napi::Boolean::New(info.Env(), false);
+    }
+
     auto callback = info[0].As<Napi::Function>();
-    auto worker = new Win32QueryDisplayConfigWorker(callback);
+    auto worker = new Win32QueryDisplayConfigWorker(callback, options);
     worker->Queue();
     return Napi::Boolean::New(info.Env(), true);
 }
 
+Napi::Object ConvertToggleEnabledResult(Napi::Env env, const struct Win32ToggleEnabledResult &toggleResult) {
+    auto result = Napi::Object::New(env);
+    switch (toggleResult.strategy) {
+        case TOGGLE_STRATEGY_PLANNED:
+            result.Set("strategy", "planned");
+            break;
+        case TOGGLE_STRATEGY_STAGED:
+            result.Set("strategy", "staged");
+            break;
+        default:
+            result.Set("strategy", "unchanged");
+            break;
+    }
+    result.Set("modeSets", (double)toggleResult.modeSets);
+    result.Set("validationError", (double)toggleResult.validationError);
+    return result;
+}
+
 class Win32ToggleEnabledWorker : public Napi::AsyncWorker {
    public:
     Win32ToggleEnabledWorker(Napi::Function &callback, std::shared_ptr<struct Win32DeviceConfigToggleEnabled> args)
         : Napi::AsyncWorker(callback), args(args) {}
 
     void Execute() {
-        this->errorCode = ToggleEnabled(this->args);
+        this->errorCode = ToggleEnabled(this->args, this->toggleResult);
     }
 
     std::vector<napi_value> GetResult(Napi::Env env) {
-        std::vector<napi_value> result{env.Null(), Napi::Number::New(env, (double)this->errorCode)};
+        std::vector<napi_value> result{
+            env.Null(),
+            Napi::Number::New(env, (double)this->errorCode),
+            ConvertToggleEnabledResult(env, this->toggleResult)};
         return result;
     }
 
    private:
     std::shared_ptr<struct Win32DeviceConfigToggleEnabled> args;
     LONG errorCode;
+    struct Win32ToggleEnabledResult toggleResult;
 };
 
 bool ExtractTransientDeviceId(Napi::Value val, Win32TransientDeviceId *const receiver) {
@@ -918,67 +1196,201 @@ Napi::Value Win32ToggleEnabledDisplays(const Napi::CallbackInfo &info) {
     return Napi::Boolean::New(info.Env(), true);
 }
 
-class Win32RestoreDisplayConfigWorker : public Napi::AsyncWorker {
+Napi::String ConvertWideString(Napi::Env env, const std::wstring &str) {
+    return Napi::String::New(env, (const char16_t *)str.c_str(), str.size());
+}
+
+std::wstring ExtractWideString(Napi::Value val) {
+    auto str = val.As<Napi::String>().Utf16Value();
+    return std::wstring(str.begin(), str.end());
+}
+
+Napi::Array ConvertDisplayProfileDevicePaths(Napi::Env env, const std::wstring &key) {
+    auto result = Napi::Array::New(env);
+    uint32_t count = 0;
+    size_t start = 0;
+    while (start < key.size()) {
+        auto end = key.find(L'\n', start);
+        if (end == std::wstring::npos) {
+            end = key.size();
+        }
+        result.Set(count++, ConvertWideString(env, key.substr(start, end - start)));
+        start = end + 1;
+    }
+    return result;
+}
+
+class Win32SaveDisplayProfileWorker : public Napi::AsyncWorker {
    public:
-    Win32RestoreDisplayConfigWorker(Napi::Function &callback, std::shared_ptr<std::vector<struct Win32RestoreDisplayConfigDevice>> configs, BOOL persistent)
-        : Napi::AsyncWorker(callback), configs(configs), persistent(persistent) {}
+    Win32SaveDisplayProfileWorker(Napi::Function &callback) : Napi::AsyncWorker(callback), errorCode(ERROR_SUCCESS) {}
 
     void Execute() {
-        this->errorCode = RestoreDeviceConfig(this->configs, this->persistent);
+        struct Win32QueryDisplayConfigOptions activeOnly;
+        activeOnly.activeOnly = TRUE;
+        auto queryResults = DoQueryDisplayConfig(activeOnly);
+        if (queryResults->error != ERROR_SUCCESS) {
+            this->errorCode = queryResults->error;
+            return;
+        }
+        this->entries = CaptureDisplayProfileEntries(queryResults);
+        if (this->entries.empty()) {
+            this->errorCode = ERROR_NOT_FOUND;
+            return;
+        }
+        this->key = StoreDisplayProfile(CompileDisplayProfile(this->entries));
     }
 
     std::vector<napi_value> GetResult(Napi::Env env) {
-        std::vector<napi_value> result{env.Null(), Napi::Number::New(env, (double)this->errorCode)};
+        std::vector<napi_value> result{env.Null(), env.Undefined()};
+        if (this->errorCode != ERROR_SUCCESS) {
+            result[0] = Napi::Number::New(env, (double)this->errorCode);
+            return result;
+        }
+
+        auto entries = Napi::Array::New(env, this->entries.size());
+        for (size_t i = 0; i < this->entries.size(); i++) {
+            auto &entry = this->entries[i];
+            auto converted = Napi::Object::New(env);
+            converted.Set("devicePath", ConvertWideString(env, entry.devicePath));
+            converted.Set("pathBuffer", Napi::Buffer<DISPLAYCONFIG_PATH_INFO>::Copy(env, &entry.pathInfo, 1));
+            converted.Set("sourceModeBuffer", Napi::Buffer<DISPLAYCONFIG_MODE_INFO>::Copy(env, &entry.sourceModeInfo, 1));
+            converted.Set("targetModeBuffer", Napi::Buffer<DISPLAYCONFIG_MODE_INFO>::Copy(env, &entry.targetModeInfo, 1));
+            entries.Set(i, converted);
+        }
+
+        auto profile = Napi::Object::New(env);
+        profile.Set("key", ConvertWideString(env, this->key));
+        profile.Set("devicePaths", ConvertDisplayProfileDevicePaths(env, this->key));
+        profile.Set("entries", entries);
+        result[1] = profile;
         return result;
     }
 
    private:
-    std::shared_ptr<std::vector<struct Win32RestoreDisplayConfigDevice>> configs;
     LONG errorCode;
-    BOOL persistent;
+    std::wstring key;
+    std::vector<struct Win32DisplayProfileEntry> entries;
 };
 
-BOOL ExtractRestoreDisplayConfigEntry(Napi::Env env, Napi::Object obj, struct Win32RestoreDisplayConfigDevice *receiver) {
-    auto sourceConfigIdVal = obj.Get("sourceConfigId");
-    auto targetConfigIdVal = obj.Get("targetConfigId");
-    auto pathBufferVal = obj.Get("pathBuffer");
-    auto sourceModeBufferVal = obj.Get("sourceModeBuffer");
-    auto targetModeBufferVal = obj.Get("targetModeBuffer");
-
-    if (!sourceConfigIdVal.IsObject() ||
-        !targetConfigIdVal.IsObject() ||
-        !pathBufferVal.IsBuffer() ||
-        !sourceModeBufferVal.IsBuffer() ||
-        !targetModeBufferVal.IsBuffer()) {
-        return false;
+Napi::Value Win32SaveDisplayProfile(const Napi::CallbackInfo &info) {
+    if (info.Length() < 1 || !info[0].IsFunction()) {
+        return Napi::Boolean::New(info.Env(), false);
     }
 
-    if (!ExtractTransientDeviceId(sourceConfigIdVal.As<Napi::Object>(), &receiver->sourceId)) {
-        return false;
+    auto callback = info[0].As<Napi::Function>();
+    auto worker = new Win32SaveDisplayProfileWorker(callback);
+    worker->Queue();
+    return Napi::Boolean::New(info.Env(), true);
+}
+
+// Compiles [{ devicePath, pathBuffer, sourceModeBuffer, targetModeBuffer }]
+// into the store and returns its key, or false if an entry is malformed.
+Napi::Value Win32LoadDisplayProfile(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    if (info.Length() < 1 || !info[0].IsArray()) {
+        return Napi::Boolean::New(env, false);
     }
-    if (!ExtractTransientDeviceId(targetConfigIdVal.As<Napi::Object>(), &receiver->targetId)) {
-        return false;
+
+    std::vector<struct Win32DisplayProfileEntry> entries;
+    auto providedArray = info[0].As<Napi::Array>();
+    for (uint32_t i = 0; i < providedArray.Length(); i++) {
+        auto providedCur = providedArray.Get(i);
+        if (!providedCur.IsObject()) {
+            return Napi::Boolean::New(env, false);
+        }
+        auto obj = providedCur.As<Napi::Object>();
+        auto devicePathVal = obj.Get("devicePath");
+        auto pathBufferVal = obj.Get("pathBuffer");
+        auto sourceModeBufferVal = obj.Get("sourceModeBuffer");
+        auto targetModeBufferVal = obj.Get("targetModeBuffer");
+        if (!devicePathVal.IsString() || !pathBufferVal.IsBuffer() ||
+            !sourceModeBufferVal.IsBuffer() || !targetModeBufferVal.IsBuffer()) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        auto pathBuffer = pathBufferVal.As<Napi::Buffer<uint8_t>>();
+        auto sourceModeBuffer = sourceModeBufferVal.As<Napi::Buffer<uint8_t>>();
+        auto targetModeBuffer = targetModeBufferVal.As<Napi::Buffer<uint8_t>>();
+        if (pathBuffer.Length() != sizeof(DISPLAYCONFIG_PATH_INFO) || sourceModeBuffer.Length() != sizeof(DISPLAYCONFIG_MODE_INFO) || targetModeBuffer.Length() != sizeof(DISPLAYCONFIG_MODE_INFO)) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        struct Win32DisplayProfileEntry entry;
+        entry.devicePath = ExtractWideString(devicePathVal);
+        memcpy_s(&entry.pathInfo, sizeof(entry.pathInfo), pathBuffer.Data(), pathBuffer.Length());
+        memcpy_s(&entry.sourceModeInfo, sizeof(entry.sourceModeInfo), sourceModeBuffer.Data(), sourceModeBuffer.Length());
+        memcpy_s(&entry.targetModeInfo, sizeof(entry.targetModeInfo), targetModeBuffer.Data(), targetModeBuffer.Length());
+        entries.push_back(entry);
+    }
+    if (entries.empty()) {
+        return Napi::Boolean::New(env, false);
     }
 
-    auto pathBuffer = pathBufferVal.As<Napi::Buffer<uint8_t>>();
-    auto sourceModeBuffer = sourceModeBufferVal.As<Napi::Buffer<uint8_t>>();
-    auto targetModeBuffer = targetModeBufferVal.As<Napi::Buffer<uint8_t>>();
+    return ConvertWideString(env, StoreDisplayProfile(CompileDisplayProfile(entries)));
+}
 
-    if (pathBuffer.Length() != sizeof(DISPLAYCONFIG_PATH_INFO) || sourceModeBuffer.Length() != sizeof(DISPLAYCONFIG_MODE_INFO) || targetModeBuffer.Length() != sizeof(DISPLAYCONFIG_MODE_INFO)) {
-        return false;
+Napi::Value Win32ListDisplayProfiles(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    std::vector<std::wstring> keys;
+    {
+        std::lock_guard<std::mutex> lock(displayProfilesMutex);
+        for (auto it = displayProfiles.begin(); it != displayProfiles.end(); it++) {
+            keys.push_back(it->first);
+        }
     }
 
-    memcpy_s(&receiver->pathInfo, sizeof(receiver->pathInfo), pathBuffer.Data(), pathBuffer.Length());
-    memcpy_s(&receiver->sourceModeInfo, sizeof(receiver->sourceModeInfo), sourceModeBuffer.Data(), sourceModeBuffer.Length());
-    memcpy_s(&receiver->targetModeInfo, sizeof(receiver->targetModeInfo), targetModeBuffer.Data(), targetModeBuffer.Length());
-    return true;
+    auto result = Napi::Array::New(env, keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        auto profile = Napi::Object::New(env);
+        profile.Set("key", ConvertWideString(env, keys[i]));
+        profile.Set("devicePaths", ConvertDisplayProfileDevicePaths(env, keys[i]));
+        result.Set(i, profile);
+    }
+    return result;
 }
 
-Napi::Value Win32RestoreDisplayConfig(const Napi::CallbackInfo &info) {
-    if (info.Length() < 2) {
+Napi::Value Win32RemoveDisplayProfile(const Napi::CallbackInfo &info) {
+    if (info.Length() < 1 || !info[0].IsString()) {
         return Napi::Boolean::New(info.Env(), false);
     }
-    if (!info[0].IsArray() || !info[1].IsFunction()) {
+    auto key = ExtractWideString(info[0]);
+    std::lock_guard<std::mutex> lock(displayProfilesMutex);
+    return Napi::Boolean::New(info.Env(), displayProfiles.erase(key) != 0);
+}
+
+class Win32RestoreDisplayProfileWorker : public Napi::AsyncWorker {
+   public:
+    Win32RestoreDisplayProfileWorker(Napi::Function &callback, const std::wstring &key, BOOL persistent)
+        : Napi::AsyncWorker(callback), key(key), persistent(persistent), errorCode(ERROR_SUCCESS) {}
+
+    void Execute() {
+        this->errorCode = RestoreDisplayProfile(this->key, this->persistent, this->restoreResult);
+    }
+
+    std::vector<napi_value> GetResult(Napi::Env env) {
+        auto report = Napi::Object::New(env);
+        report.Set("key", ConvertWideString(env, this->restoreResult.key));
+        report.Set("validationError", (double)this->restoreResult.validationError);
+        report.Set("missingDevices", (double)this->restoreResult.missingDevices);
+        std::vector<napi_value> result{env.Null(), Napi::Number::New(env, (double)this->errorCode), report};
+        return result;
+    }
+
+   private:
+    std::wstring key;
+    BOOL persistent;
+    LONG errorCode;
+    struct Win32RestoreDisplayProfileResult restoreResult;
+};
+
+Napi::Value Win32RestoreDisplayProfile(const Napi::CallbackInfo &info) {
+    if (info.Length() < 2 || !info[1].IsFunction()) {
+        return Napi::Boolean::New(info.Env(), false);
+    }
+    std::wstring key;
+    if (info[0].IsString()) {
+        key = ExtractWideString(info[0]);
+    } else if (!info[0].IsUndefined() && !info[0].IsNull()) {
         return Napi::Boolean::New(info.Env(), false);
     }
     BOOL persistent = false;
@@ -986,33 +1398,316 @@ Napi::Value Win32RestoreDisplayConfig(const Napi::CallbackInfo &info) {
         persistent = info[2].ToBoolean();
     }
 
-    struct Win32RestoreDisplayConfigDevice curConfig;
-    auto configs = std::make_shared<std::vector<struct Win32RestoreDisplayConfigDevice>>();
-    auto providedArray = info[0].As<Napi::Array>();
+    auto callback = info[1].As<Napi::Function>();
+    auto worker = new Win32RestoreDisplayProfileWorker(callback, key, persistent);
+    worker->Queue();
+    return Napi::Boolean::New(info.Env(), true);
+}
 
-    if (providedArray.Length() == 0) {
-        return Napi::Boolean::New(info.Env(), false);
+Napi::Value ConvertRefreshRateHz(Napi::Env env, const DISPLAYCONFIG_RATIONAL &rational) {
+    if (rational.Denominator == 0) {
+        return env.Null();
     }
+    return Napi::Number::New(env, (double)rational.Numerator / (double)rational.Denominator);
+}
 
-    for (DWORD i = 0; i < providedArray.Length(); i++) {
-        auto providedCur = providedArray.Get(i);
-        if (!providedCur.IsObject()) {
-            return Napi::Boolean::New(info.Env(), false);
+Napi::Object ConvertActiveTargetMode(Napi::Env env, const struct Win32ActiveTargetState &target) {
+    auto result = Napi::Object::New(env);
+    if (target.hasSourceMode) {
+        result.Set("width", (double)target.width);
+        result.Set("height", (double)target.height);
+        result.Set("position", ConvertPointL(env, target.position));
+    }
+    return result;
+}
+
+Napi::Object ConvertDisplayConfigChange(Napi::Env env, const struct Win32DisplayConfigChange &change) {
+    auto result = Napi::Object::New(env);
+    const auto &target = change.type == DISPLAY_CHANGE_REMOVED ? change.before : change.after;
+    result.Set("adapterId", ConvertLUID(env, &target.adapterId));
+    result.Set("id", (double)target.id);
+    result.Set("devicePath", Napi::String::New(env, (const char16_t *)target.devicePath.c_str()));
+
+    switch (change.type) {
+        case DISPLAY_CHANGE_ADDED:
+            result.Set("type", "added");
+            result.Set("mode", ConvertActiveTargetMode(env, change.after));
+            result.Set("rotation", ConvertRotation(env, change.after.rotation));
+            result.Set("refreshRate", ConvertRefreshRateHz(env, change.after.refreshRate));
+            break;
+        case DISPLAY_CHANGE_REMOVED:
+            result.Set("type", "removed");
+            break;
+        case DISPLAY_CHANGE_MODE:
+            result.Set("type", "mode");
+            result.Set("from", ConvertActiveTargetMode(env, change.before));
+            result.Set("to", ConvertActiveTargetMode(env, change.after));
+            break;
+        case DISPLAY_CHANGE_ROTATION:
+            result.Set("type", "rotation");
+            result.Set("from", ConvertRotation(env, change.before.rotation));
+            result.Set("to", ConvertRotation(env, change.after.rotation));
+            break;
+        case DISPLAY_CHANGE_SCALING:
+            result.Set("type", "scaling");
+            result.Set("from", ConvertScaling(env, change.before.scaling));
+            result.Set("to", ConvertScaling(env, change.after.scaling));
+            break;
+        case DISPLAY_CHANGE_REFRESH_RATE:
+            result.Set("type", "refreshRate");
+            result.Set("from", ConvertRefreshRateHz(env, change.before.refreshRate));
+            result.Set("to", ConvertRefreshRateHz(env, change.after.refreshRate));
+            break;
+        case DISPLAY_CHANGE_ADVANCED_COLOR:
+            result.Set("type", "advancedColor");
+            result.Set("from", Napi::Boolean::New(env, change.before.advancedColorEnabled != FALSE));
+            result.Set("to", Napi::Boolean::New(env, change.after.advancedColorEnabled != FALSE));
+            break;
+    }
+    return result;
+}
+
+Napi::Object ConvertGeometryEntry(Napi::Env env, const struct Win32DisplayGeometryEntry &entry) {
+    auto result = Napi::Object::New(env);
+    result.Set("adapterId", ConvertLUID(env, &entry.adapterId));
+    result.Set("id", (double)entry.id);
+    result.Set("devicePath", Napi::String::New(env, (const char16_t *)entry.devicePath.c_str(), entry.devicePath.size()));
+    RECTL bounds = {entry.bounds.left, entry.bounds.top, entry.bounds.right, entry.bounds.bottom};
+    result.Set("bounds", ConvertRectL(env, bounds));
+    result.Set("refreshRate", entry.refreshRate);
+    result.Set("dpiX", (double)entry.dpiX);
+    result.Set("dpiY", (double)entry.dpiY);
+    result.Set("scaleFactor", (double)entry.dpiX / USER_DEFAULT_SCREEN_DPI);
+    return result;
+}
+
+// { generation, refreshRate, displays }, where refreshRate is the lowest
+// refresh rate among the displays, or null if there are none.
+Napi::Object ConvertGeometryHits(Napi::Env env, const struct Win32DisplayGeometry &geometry, const std::vector<UINT32> &hits) {
+    auto result = Napi::Object::New(env);
+    auto displays = Napi::Array::New(env, hits.size());
+    double refreshRate = 0;
+    for (size_t i = 0; i < hits.size(); i++) {
+        auto &entry = geometry.entries[hits[i]];
+        displays.Set(i, ConvertGeometryEntry(env, entry));
+        if (i == 0 || entry.refreshRate < refreshRate) {
+            refreshRate = entry.refreshRate;
         }
+    }
+    result.Set("generation", (double)geometry.generation);
+    if (hits.empty()) {
+        result.Set("refreshRate", env.Null());
+    } else {
+        result.Set("refreshRate", refreshRate);
+    }
+    result.Set("displays", displays);
+    return result;
+}
+
+Napi::Value Win32DisplayGeometryAtPoint(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+        return env.Undefined();
+    }
+    auto geometry = AcquireDisplayGeometry();
+    if (!geometry) {
+        return env.Undefined();
+    }
+    auto x = (LONG)floor(info[0].As<Napi::Number>().DoubleValue());
+    auto y = (LONG)floor(info[1].As<Napi::Number>().DoubleValue());
+    return ConvertGeometryHits(env, *geometry, FindDisplaysAtPoint(*geometry, x, y));
+}
 
-        if (!ExtractRestoreDisplayConfigEntry(info.Env(), providedCur.As<Napi::Object>(), &curConfig)) {
-            return Napi::Boolean::New(info.Env(), false);
+Napi::Value Win32DisplayGeometryInRect(const Napi::CallbackInfo &info) {
+    auto env = info.Env();
+    if (info.Length() < 4) {
+        return env.Undefined();
+    }
+    for (size_t i = 0; i < 4; i++) {
+        if (!info[i].IsNumber()) {
+            return env.Undefined();
         }
-        configs->push_back(curConfig);
     }
+    auto geometry = AcquireDisplayGeometry();
+    if (!geometry) {
+        return env.Undefined();
+    }
+    RECT rect;
+    rect.left = (LONG)floor(info[0].As<Napi::Number>().DoubleValue());
+    rect.top = (LONG)floor(info[1].As<Napi::Number>().DoubleValue());
+    rect.right = (LONG)ceil(info[2].As<Napi::Number>().DoubleValue());
+    rect.bottom = (LONG)ceil(info[3].As<Napi::Number>().DoubleValue());
+    return ConvertGeometryHits(env, *geometry, FindDisplaysInRect(*geometry, rect));
+}
 
-    auto callback = info[1].As<Napi::Function>();
-    auto worker = new Win32RestoreDisplayConfigWorker(callback, configs, persistent);
+Napi::String ConvertColorEncoding(Napi::Env env, DISPLAYCONFIG_COLOR_ENCODING encoding) {
+    switch (encoding) {
+        case DISPLAYCONFIG_COLOR_ENCODING_RGB:
+            return Napi::String::New(env, "rgb");
+        case DISPLAYCONFIG_COLOR_ENCODING_YCBCR444:
+            return Napi::String::New(env, "ycbcr444");
+        case DISPLAYCONFIG_COLOR_ENCODING_YCBCR422:
+            return Napi::String::New(env, "ycbcr422");
+        case DISPLAYCONFIG_COLOR_ENCODING_YCBCR420:
+            return Napi::String::New(env, "ycbcr420");
+        case DISPLAYCONFIG_COLOR_ENCODING_INTENSITY:
+            return Napi::String::New(env, "intensity");
+        default:
+            return Napi::String::New(env, "unknown");
+    }
+}
+
+Napi::Value ConvertAdvancedColorMode(Napi::Env env, TT_DISPLAYCONFIG_ADVANCED_COLOR_MODE mode) {
+    switch (mode) {
+        case TT_DISPLAYCONFIG_ADVANCED_COLOR_MODE_SDR:
+            return Napi::String::New(env, "sdr");
+        case TT_DISPLAYCONFIG_ADVANCED_COLOR_MODE_WCG:
+            return Napi::String::New(env, "wcg");
+        case TT_DISPLAYCONFIG_ADVANCED_COLOR_MODE_HDR:
+            return Napi::String::New(env, "hdr");
+        default:
+            return Napi::String::New(env, "unknown");
+    }
+}
+
+Napi::Object ConvertTargetDescriptor(Napi::Env env, const struct Win32TargetDescriptor &descriptor) {
+    auto result = Napi::Object::New(env);
+    result.Set("adapterId", ConvertLUID(env, &descriptor.adapterId));
+    result.Set("id", (double)descriptor.id);
+    result.Set("sourceId", (double)descriptor.sourceId);
+    result.Set("name", Napi::String::New(env, (const char16_t *)descriptor.friendlyName.c_str(), descriptor.friendlyName.size()));
+    result.Set("devicePath", Napi::String::New(env, (const char16_t *)descriptor.devicePath.c_str(), descriptor.devicePath.size()));
+    result.Set("outputTechnology", ConvertVideoOutputTechnology(env, descriptor.outputTechnology));
+    result.Set("edidManufactureId", (double)descriptor.edidManufactureId);
+    result.Set("edidProductCodeId", (double)descriptor.edidProductCodeId);
+    result.Set("connectorInstance", (double)descriptor.connectorInstance);
+    result.Set("rotation", ConvertRotation(env, descriptor.rotation));
+    result.Set("scaling", ConvertScaling(env, descriptor.scaling));
+    result.Set("refreshRate", ConvertRational(env, descriptor.refreshRate));
+    result.Set("refreshRateHz", ConvertRefreshRateHz(env, descriptor.refreshRate));
+
+    if (descriptor.hasSourceMode) {
+        result.Set("sourceMode", ConvertSourceMode(env, descriptor.sourceMode));
+    } else {
+        result.Set("sourceMode", env.Null());
+    }
+
+    if (descriptor.hasSignalInfo) {
+        auto &signal = descriptor.signalInfo;
+        result.Set("pixelRate", (double)signal.pixelRate);
+        result.Set("vSyncFreq", ConvertRational(env, signal.vSyncFreq));
+        result.Set("hSyncFreq", ConvertRational(env, signal.hSyncFreq));
+        result.Set("activeSize", Convert2DRegion(env, signal.activeSize));
+        result.Set("totalSize", Convert2DRegion(env, signal.totalSize));
+        result.Set("scanLineOrdering", ConvertScanLineOrdering(env, signal.scanLineOrdering));
+    } else {
+        result.Set("pixelRate", env.Null());
+        result.Set("vSyncFreq", env.Null());
+        result.Set("hSyncFreq", env.Null());
+        result.Set("activeSize", env.Null());
+        result.Set("totalSize", env.Null());
+        result.Set("scanLineOrdering", env.Null());
+    }
+
+    if (descriptor.hasAdvancedColor) {
+        auto advancedColor = Napi::Object::New(env);
+        advancedColor.Set("supported", Napi::Boolean::New(env, descriptor.advancedColorSupported != FALSE));
+        advancedColor.Set("enabled", Napi::Boolean::New(env, descriptor.advancedColorEnabled != FALSE));
+        advancedColor.Set("wideColorEnforced", Napi::Boolean::New(env, descriptor.wideColorEnforced != FALSE));
+        advancedColor.Set("forceDisabled", Napi::Boolean::New(env, descriptor.advancedColorForceDisabled != FALSE));
+        advancedColor.Set("colorEncoding", ConvertColorEncoding(env, descriptor.colorEncoding));
+        advancedColor.Set("bitsPerColorChannel", (double)descriptor.bitsPerColorChannel);
+        if (descriptor.hasColorMode) {
+            advancedColor.Set("hdrSupported", Napi::Boolean::New(env, descriptor.highDynamicRangeSupported != FALSE));
+            advancedColor.Set("hdrUserEnabled", Napi::Boolean::New(env, descriptor.highDynamicRangeUserEnabled != FALSE));
+            advancedColor.Set("activeColorMode", ConvertAdvancedColorMode(env, descriptor.activeColorMode));
+        } else {
+            advancedColor.Set("hdrSupported", env.Null());
+            advancedColor.Set("hdrUserEnabled", env.Null());
+            advancedColor.Set("activeColorMode", env.Null());
+        }
+        result.Set("advancedColor", advancedColor);
+    } else {
+        result.Set("advancedColor", env.Null());
+    }
+
+    if (descriptor.hasSdrWhiteLevel) {
+        result.Set("sdrWhiteLevel", (double)descriptor.sdrWhiteLevel);
+        result.Set("sdrWhiteNits", (double)descriptor.sdrWhiteLevel * 80 / 1000);
+    } else {
+        result.Set("sdrWhiteLevel", env.Null());
+        result.Set("sdrWhiteNits", env.Null());
+    }
+    return result;
+}
+
+class Win32QueryTargetDescriptorsWorker : public Napi::AsyncWorker {
+   public:
+    Win32QueryTargetDescriptorsWorker(Napi::Function &callback, BOOL refresh, BOOL refreshWhiteLevels)
+        : Napi::AsyncWorker(callback), refresh(refresh), refreshWhiteLevels(refreshWhiteLevels), descriptors() {}
+
+    void Execute() {
+        this->descriptors = AcquireTargetDescriptors(this->refresh, this->refreshWhiteLevels);
+    }
+
+    std::vector<napi_value> GetResult(Napi::Env env) {
+        std::vector<napi_value> result{env.Null(), env.Undefined()};
+        if (this->descriptors->error != ERROR_SUCCESS) {
+            result[0] = Napi::Number::New(env, (double)this->descriptors->error);
+            return result;
+        }
+
+        auto &targets = this->descriptors->targets;
+        auto converted = Napi::Array::New(env, targets.size());
+        for (size_t i = 0; i < targets.size(); i++) {
+            converted.Set(i, ConvertTargetDescriptor(env, targets[i]));
+        }
+        auto value = Napi::Object::New(env);
+        value.Set("generation", (double)this->descriptors->generation);
+        value.Set("targets", converted);
+        result[1] = value;
+        return result;
+    }
+
+   private:
+    BOOL refresh;
+    BOOL refreshWhiteLevels;
+    std::shared_ptr<const struct Win32TargetDescriptors> descriptors;
+};
+
+Napi::Value Win32QueryTargetDescriptors(const Napi::CallbackInfo &info) {
+    if (info.Length() < 1 || !info[0].IsFunction()) {
+        return Napi::Boolean::New(info.Env(), false);
+    }
+    BOOL refresh = info.Length() > 1 && info[1].ToBoolean().Value();
+    BOOL refreshWhiteLevels = info.Length() > 2 && info[2].ToBoolean().Value();
+
+    auto callback = info[0].As<Napi::Function>();
+    auto worker = new Win32QueryTargetDescriptorsWorker(callback, refresh, refreshWhiteLevels);
     worker->Queue();
     return Napi::Boolean::New(info.Env(), true);
 }
 
 static Win32DisplayChangeContext *displayEventContext = NULL;
+static DWORD displayChangeQuietPeriod = DISPLAY_CHANGE_QUIET_PERIOD_DEFAULT;
+static DWORD displayChangeMaxDelay = DISPLAY_CHANGE_MAX_DELAY_DEFAULT;
+
+// Reads {quietPeriod, maxDelay} in milliseconds, leaving missing fields as
+// they are.
+void ParseDisplayChangeCoalescing(const Napi::Value &value, DWORD &quietPeriod, DWORD &maxDelay) {
+    if (!value.IsObject()) {
+        return;
+    }
+    auto options = value.As<Napi::Object>();
+    auto quietValue = options.Get("quietPeriod");
+    if (quietValue.IsNumber()) {
+        quietPeriod = (DWORD)std::clamp(quietValue.As<Napi::Number>().DoubleValue(), 0.0, 60000.0);
+    }
+    auto maxDelayValue = options.Get("maxDelay");
+    if (maxDelayValue.IsNumber()) {
+        maxDelay = (DWORD)std::clamp(maxDelayValue.As<Napi::Number>().DoubleValue(), 0.0, 60000.0);
+    }
+}
 
 Napi::Value Win32ListenForDisplayChanges(const Napi::CallbackInfo &info) {
     if (info.Length() < 1 || !info[0].IsFunction()) {
@@ -1027,8 +1722,12 @@ Napi::Value Win32ListenForDisplayChanges(const Napi::CallbackInfo &info) {
         displayEventContext = NULL;
     }
 
+    if (info.Length() > 1) {
+        ParseDisplayChangeCoalescing(info[1], displayChangeQuietPeriod, displayChangeMaxDelay);
+    }
+
     auto callback = info[0].As<Napi::Function>();
-    displayEventContext = new Win32DisplayChangeContext(info.Env(), callback);
+    displayEventContext = new Win32DisplayChangeContext(info.Env(), callback, displayChangeQuietPeriod, displayChangeMaxDelay);
     auto error = displayEventContext->Start();
     if (error != ERROR_SUCCESS) {
         delete displayEventContext;
@@ -1037,6 +1736,23 @@ Napi::Value Win32ListenForDisplayChanges(const Napi::CallbackInfo &info) {
     return Napi::Number::New(info.Env(), error);
 }
 
+Napi::Value Win32SetDisplayChangeCoalescing(const Napi::CallbackInfo &info) {
+    if (info.Length() > 0) {
+        ParseDisplayChangeCoalescing(info[0], displayChangeQuietPeriod, displayChangeMaxDelay);
+    }
+    // The listener thread reads these for every message, so a running
+    // listener picks them up with the next one.
+    if (displayEventContext != NULL) {
+        displayEventContext->quietPeriod.store(displayChangeQuietPeriod);
+        displayEventContext->maxDelay.store(displayChangeMaxDelay);
+    }
+
+    auto result = Napi::Object::New(info.Env());
+    result.Set("quietPeriod", Napi::Number::New(info.Env(), (double)displayChangeQuietPeriod));
+    result.Set("maxDelay", Napi::Number::New(info.Env(), (double)displayChangeMaxDelay));
+    return result;
+}
+
 Napi::Value Win32StopListeningForDisplayChanges(const Napi::CallbackInfo &info) {
     if (displayEventContext == NULL) {
         return info.Env().Undefined();
@@ -1053,8 +1769,17 @@ Napi::Value Win32StopListeningForDisplayChanges(const Napi::CallbackInfo &info)
 
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
     exports.Set("win32_queryDisplayConfig", Napi::Function::New(env, Win32QueryDisplayConfig));
+    exports.Set("win32_queryDisplayConfigPacked", Napi::Function::New(env, Win32QueryDisplayConfigPacked));
+    exports.Set("win32_displayConfigLayout", Napi::Function::New(env, Win32DisplayConfigLayout));
     exports.Set("win32_toggleEnabledDisplays", Napi::Function::New(env, Win32ToggleEnabledDisplays));
-    exports.Set("win32_restoreDisplayConfig", Napi::Function::New(env, Win32RestoreDisplayConfig));
+    exports.Set("win32_saveDisplayProfile", Napi::Function::New(env, Win32SaveDisplayProfile));
+    exports.Set("win32_loadDisplayProfile", Napi::Function::New(env, Win32LoadDisplayProfile));
+    exports.Set("win32_listDisplayProfiles", Napi::Function::New(env, Win32ListDisplayProfiles));
+    exports.Set("win32_removeDisplayProfile", Napi::Function::New(env, Win32RemoveDisplayProfile));
+    exports.Set("win32_restoreDisplayProfile", Napi::Function::New(env, Win32RestoreDisplayProfile));
+    exports.Set("win32_displayGeometryAtPoint", Napi::Function::New(env, Win32DisplayGeometryAtPoint));
+    exports.Set("win32_displayGeometryInRect", Napi::Function::New(env, Win32DisplayGeometryInRect));
+    exports.Set("win32_queryTargetDescriptors", Napi::Function::New(env, Win32QueryTargetDescriptors));
 
     // Take note: while none of these functions are meant to be called directly in JavaScript,
     // these two in particular _depend_ on ordering enforced by JavaScript to function correctly.
@@ -1065,6 +1790,7 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
     // dispatches other JavaScript functions for us.
     exports.Set("win32_listenForDisplayChanges", Napi::Function::New(env, Win32ListenForDisplayChanges));
     exports.Set("win32_stopListeningForDisplayChanges", Napi::Function::New(env, Win32StopListeningForDisplayChanges));
+    exports.Set("win32_setDisplayChangeCoalescing", Napi::Function::New(env, Win32SetDisplayChangeCoalescing));
 
     return exports;
 }
@@ -6,7 +6,8 @@
       "cflags_cc!": [ ],
       "conditions": [
         ["OS=='win'", {
-      	  "sources": [ "windows-hdr.cc" ]
+      	  "sources": [ "windows-hdr.cc" ],
+      	  "libraries": [ "dxgi.lib" ]
       	}],
       ],
       "include_dirs": [
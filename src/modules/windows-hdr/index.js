@@ -2,5 +2,9 @@
 const addon = require("bindings")("windows-hdr");
 module.exports = {
     getDisplays: addon.getDisplays,
-    setSDRBrightness: addon.setSDRBrightness
+    setSDRBrightness: addon.setSDRBrightness,
+    rampSDRBrightness: addon.rampSDRBrightness,
+    cancelSDRRamp: addon.cancelSDRRamp,
+    invalidateDisplays: addon.invalidateDisplays,
+    getDisplayCacheInfo: addon.getDisplayCacheInfo
 }
\ No newline at end of file
@@ -2,10 +2,20 @@
 
 #include <napi.h>
 #include <windows.h>
+#include <dxgi1_6.h>
 #include <stdio.h>
 #include <math.h>
 #include <map>
 #include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
 
 enum DISPLAYCONFIG_DEVICE_INFO_TYPE_INTERNAL {
     DISPLAYCONFIG_DEVICE_INFO_SET_SDR_WHITE_LEVEL = 0xFFFFFFEE,
@@ -67,6 +77,21 @@ LONG pathSetSdrWhite(DISPLAYCONFIG_PATH_INFO path, int nits) {
     return DisplayConfigSetDeviceInfo(&sdrWhiteParams.header);
 }
 
+// Reads the display's current SDR white level in nits.
+bool pathGetSdrWhite(const DISPLAYCONFIG_PATH_INFO& path, int& nits) {
+    DISPLAYCONFIG_SDR_WHITE_LEVEL whiteLevel = {};
+    whiteLevel.header.type = DISPLAYCONFIG_DEVICE_INFO_GET_SDR_WHITE_LEVEL;
+    whiteLevel.header.size = sizeof(whiteLevel);
+    whiteLevel.header.adapterId = path.targetInfo.adapterId;
+    whiteLevel.header.id = path.targetInfo.id;
+
+    if (DisplayConfigGetDeviceInfo(&whiteLevel.header) != ERROR_SUCCESS) {
+        return false;
+    }
+    nits = (int)whiteLevel.SDRWhiteLevel * 80 / 1000;
+    return true;
+}
+
 struct Display {
     std::string name;
     std::string path;
@@ -95,26 +120,34 @@ std::string wcharToString(const wchar_t* wstr) {
     }
 }
 
-boolean setSDRBrightness(DISPLAYCONFIG_PATH_INFO target, int desiredNits, bool silent) {
+// What setSDRBrightness actually sets for desiredNits: clamped to 80-480
+// and rounded up to a multiple of 4.
+int quantizeSDRNits(int desiredNits) {
     int nits = desiredNits;
 
-    try {
-        if (nits < 80) {
-            nits = 80;
-        }
+    if (nits < 80) {
+        nits = 80;
+    }
 
-        if (nits > 480) {
-            nits = 480;
-        }
+    if (nits > 480) {
+        nits = 480;
+    }
 
-        if (nits % 4 != 0) {
-            nits += 4 - (nits % 4);
-        }
+    if (nits % 4 != 0) {
+        nits += 4 - (nits % 4);
+    }
+
+    return nits;
+}
 
+boolean setSDRBrightness(DISPLAYCONFIG_PATH_INFO target, int desiredNits) {
+    int nits = quantizeSDRNits(desiredNits);
+
+    try {
         LONG result = pathSetSdrWhite(target, nits);
 
         if (result != ERROR_SUCCESS) {
-            if(!silent) fprintf(stderr, "Error on DisplayConfigSetDeviceInfo for SDR white level\n");
+            fprintf(stderr, "Error on DisplayConfigSetDeviceInfo for SDR white level\n");
             return false;
         }
     } catch (...) {
@@ -124,6 +157,114 @@ boolean setSDRBrightness(DISPLAYCONFIG_PATH_INFO target, int desiredNits, bool s
     return true;
 }
 
+// The GDI device names (\\.\DISPLAY1 and so on) of the outputs DXGI
+// reports in an HDR color space. A new factory is made each time, since one
+// doesn't see display changes made after it was created.
+std::map<std::string, bool> getDXGIOutputsHDR() {
+    std::map<std::string, bool> outputs;
+
+    IDXGIFactory1* factory = nullptr;
+    if (FAILED(CreateDXGIFactory1(__uuidof(IDXGIFactory1), (void**)&factory))) {
+        fprintf(stderr, "Error on CreateDXGIFactory1\n");
+        return outputs;
+    }
+
+    IDXGIAdapter1* adapter = nullptr;
+    for (UINT a = 0; factory->EnumAdapters1(a, &adapter) != DXGI_ERROR_NOT_FOUND; a++) {
+        IDXGIOutput* output = nullptr;
+        for (UINT o = 0; adapter->EnumOutputs(o, &output) != DXGI_ERROR_NOT_FOUND; o++) {
+            IDXGIOutput6* output6 = nullptr;
+            DXGI_OUTPUT_DESC1 desc = {};
+            if (SUCCEEDED(output->QueryInterface(__uuidof(IDXGIOutput6), (void**)&output6))) {
+                if (SUCCEEDED(output6->GetDesc1(&desc))) {
+                    outputs[wcharToString(desc.DeviceName)] =
+                        (desc.ColorSpace == DXGI_COLOR_SPACE_RGB_FULL_G2084_NONE_P2020);
+                }
+                output6->Release();
+            }
+            output->Release();
+        }
+        adapter->Release();
+    }
+
+    factory->Release();
+    return outputs;
+}
+
+// The GDI device name of the source a path shows, to match it to a DXGI
+// output. Empty if it can't be read.
+std::string getSourceDeviceName(const DISPLAYCONFIG_PATH_INFO& path) {
+    DISPLAYCONFIG_SOURCE_DEVICE_NAME sourceName = {};
+    sourceName.header.type = DISPLAYCONFIG_DEVICE_INFO_GET_SOURCE_NAME;
+    sourceName.header.size = sizeof(sourceName);
+    sourceName.header.adapterId = path.sourceInfo.adapterId;
+    sourceName.header.id = path.sourceInfo.id;
+
+    if (DisplayConfigGetDeviceInfo(&sourceName.header) != ERROR_SUCCESS) {
+        return "";
+    }
+    return wcharToString(sourceName.viewGdiDeviceName);
+}
+
+// Whether HDR is active on a display, as last worked out from the legacy
+// advanced color info. Reused for as long as that info reads the same, so
+// enumerating doesn't ask DXGI again.
+struct HDRVerdict {
+    UINT32 advancedColor;
+    DISPLAYCONFIG_COLOR_ENCODING colorEncoding;
+    UINT32 bits;
+    bool hdrActive;
+};
+
+std::mutex hdrVerdictsMutex;
+std::map<std::string, HDRVerdict> hdrVerdicts;
+
+void forgetHDRVerdicts() {
+    std::lock_guard<std::mutex> lock(hdrVerdictsMutex);
+    hdrVerdicts.clear();
+}
+
+// The legacy struct reports advancedColorEnabled both for HDR and for SDR
+// with Auto Color Management, so this reads the output's color space from
+// DXGI: HDR is composed in scRGB and scanned out as BT.2100 PQ. Without
+// DXGI, an enabled display that isn't merely enforcing wide color is
+// counted as HDR. Nothing here writes to the display.
+bool isHDRActive(const std::string& displayPath,
+                 const DISPLAYCONFIG_PATH_INFO& path,
+                 const DISPLAYCONFIG_GET_ADVANCED_COLOR_INFO& info,
+                 std::map<std::string, bool>& dxgiOutputs,
+                 bool& dxgiQueried) {
+    if (!info.advancedColorEnabled) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(hdrVerdictsMutex);
+        auto cached = hdrVerdicts.find(displayPath);
+        if (cached != hdrVerdicts.end() &&
+            cached->second.advancedColor == info.value &&
+            cached->second.colorEncoding == info.colorEncoding &&
+            cached->second.bits == info.bitsPerColorChannel) {
+            return cached->second.hdrActive;
+        }
+    }
+
+    if (!dxgiQueried) {
+        dxgiOutputs = getDXGIOutputsHDR();
+        dxgiQueried = true;
+    }
+
+    bool hdrActive = !info.wideColorEnforced;
+    auto output = dxgiOutputs.find(getSourceDeviceName(path));
+    if (output != dxgiOutputs.end()) {
+        hdrActive = output->second;
+    }
+
+    std::lock_guard<std::mutex> lock(hdrVerdictsMutex);
+    hdrVerdicts[displayPath] = { info.value, info.colorEncoding, info.bitsPerColorChannel, hdrActive };
+    return hdrActive;
+}
+
 std::map<std::string, Display> getDisplays() {
     std::map<std::string, Display> newDisplays;
 
@@ -154,6 +295,9 @@ std::map<std::string, Display> getDisplays() {
       } while (result == ERROR_INSUFFICIENT_BUFFER);
     }
 
+    std::map<std::string, bool> dxgiOutputs;
+    bool dxgiQueried = false;
+
     for (UINT32 i = 0; i < pathCount; i++) {
       DISPLAYCONFIG_PATH_INFO path = paths[i];
 
@@ -170,22 +314,13 @@ std::map<std::string, Display> getDisplays() {
         continue;
       }
 
-      DISPLAYCONFIG_SDR_WHITE_LEVEL displayInfo = {};
-      displayInfo.header.type = (DISPLAYCONFIG_DEVICE_INFO_TYPE)
-          DISPLAYCONFIG_DEVICE_INFO_GET_SDR_WHITE_LEVEL;
-      displayInfo.header.size = sizeof(displayInfo);
-      displayInfo.header.adapterId = path.targetInfo.adapterId;
-      displayInfo.header.id = path.targetInfo.id;
-
-      result = DisplayConfigGetDeviceInfo(&displayInfo.header);
-
-      if (result != ERROR_SUCCESS) {
+      int nits;
+      if (!pathGetSdrWhite(path, nits)) {
         fprintf(stderr,
                 "Error on DisplayConfigGetDeviceInfo for SDR white level\n");
         continue;
       }
 
-      int nits = (int)displayInfo.SDRWhiteLevel * 80 / 1000;
       std::string monitorDevicePath =
           wcharToString(targetName.monitorDevicePath);
 
@@ -234,13 +369,9 @@ std::map<std::string, Display> getDisplays() {
         newDisplay.hdrEnabled = hdrInfo.advancedColorEnabled;
         newDisplay.bits = hdrInfo.bitsPerColorChannel;
 
-        // The legacy struct doesn't report whether HDR is actually active,
-        // so probe by attempting to set the current SDR white level.
-        // Only check for HDR if Windows reports it's on
-        newDisplay.hdrActive = false;
-        if(hdrInfo.advancedColorEnabled) {
-          newDisplay.hdrActive = setSDRBrightness(path, nits, true);
-        }
+        // The legacy struct doesn't report whether HDR is actually active.
+        newDisplay.hdrActive = isHDRActive(newDisplay.path, path, hdrInfo,
+                                           dxgiOutputs, dxgiQueried);
       }
 
       newDisplays.insert({newDisplay.path, newDisplay});
@@ -250,12 +381,409 @@ std::map<std::string, Display> getDisplays() {
 }
 
 
+// The displays from the last enumeration, sorted by path, and where each
+// path is in that list. Writes look their target up here instead of
+// enumerating every display again.
+struct DisplayCache {
+    std::vector<Display> displays;
+    std::unordered_map<std::string, size_t> byPath;
+    // Cleared by display changes and invalidateDisplays().
+    bool valid = false;
+    // Bumped by every enumeration that replaced the table.
+    uint64_t generation = 0;
+    std::chrono::steady_clock::time_point refreshedAt;
+};
+
+std::mutex displayCacheMutex;
+DisplayCache displayCache;
+
+// Bumped whenever the displays may have changed. An enumeration that
+// overlapped a change stores what it found but leaves the cache stale.
+std::atomic<uint64_t> displayChanges{0};
+
+void invalidateDisplayCache() {
+    displayChanges++;
+    forgetHDRVerdicts();
+    std::lock_guard<std::mutex> lock(displayCacheMutex);
+    displayCache.valid = false;
+}
+
+// Enumerates the displays and replaces the cache with them.
+std::vector<Display> refreshDisplayCache() {
+    uint64_t changesBefore = displayChanges.load();
+    std::map<std::string, Display> found = getDisplays();
+
+    std::vector<Display> displays;
+    displays.reserve(found.size());
+    for (auto& display : found) {
+        displays.push_back(display.second);
+    }
+
+    std::lock_guard<std::mutex> lock(displayCacheMutex);
+    displayCache.displays = displays;
+    displayCache.byPath.clear();
+    for (size_t i = 0; i < displays.size(); i++) {
+        displayCache.byPath[displays[i].path] = i;
+    }
+    displayCache.valid = displayChanges.load() == changesBefore;
+    displayCache.generation++;
+    displayCache.refreshedAt = std::chrono::steady_clock::now();
+    return displays;
+}
+
+// Must hold displayCacheMutex.
+Display* findCachedDisplay(const std::string& path) {
+    auto it = displayCache.byPath.find(path);
+    if (it == displayCache.byPath.end()) {
+        return nullptr;
+    }
+    return &displayCache.displays[it->second];
+}
+
+// Finds the display at path, enumerating again only when the cache is stale
+// or doesn't know the path, as happens right after a display is connected.
+bool resolveDisplay(const std::string& path, Display& found) {
+    {
+        std::lock_guard<std::mutex> lock(displayCacheMutex);
+        Display* display = displayCache.valid ? findCachedDisplay(path) : nullptr;
+        if (display != nullptr) {
+            found = *display;
+            return true;
+        }
+    }
+
+    refreshDisplayCache();
+
+    std::lock_guard<std::mutex> lock(displayCacheMutex);
+    Display* display = findCachedDisplay(path);
+    if (display == nullptr) {
+        return false;
+    }
+    found = *display;
+    return true;
+}
+
+// Keeps the cached level in step with a write that went through.
+void noteDisplayNits(const std::string& path, int nits) {
+    std::lock_guard<std::mutex> lock(displayCacheMutex);
+    Display* display = findCachedDisplay(path);
+    if (display != nullptr) {
+        display->nits = nits;
+    }
+}
+
+// Watches for display changes on a hidden window and marks the cache stale
+// on each. Display changes are broadcast to top-level windows only, which
+// rules out HWND_MESSAGE. A popup that is never shown gets them and stays
+// out of the taskbar and Alt+Tab.
+const wchar_t* kDisplayWatcherClassName = L"windows-hdr Display Change Watcher";
+
+std::mutex displayWatcherMutex;
+std::thread displayWatcherThread;
+HWND displayWatcherHwnd = NULL;
+UINT uxdDisplayChange = 0;
+
+LRESULT CALLBACK DisplayWatcherWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    switch (msg) {
+        case WM_DISPLAYCHANGE:
+            invalidateDisplayCache();
+            break;
+
+        case WM_CLOSE:
+            DestroyWindow(hwnd);
+            return 0;
+
+        case WM_DESTROY:
+            PostQuitMessage(0);
+            return 0;
+
+        default:
+            if (msg == uxdDisplayChange && msg != 0) {
+                invalidateDisplayCache();
+                return 0;
+            }
+            break;
+    }
+
+    return DefWindowProcW(hwnd, msg, wParam, lParam);
+}
+
+HINSTANCE getDisplayWatcherModule() {
+    HMODULE module = NULL;
+    GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
+                         GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                       reinterpret_cast<LPCWSTR>(&DisplayWatcherWindowProc),
+                       &module);
+    return module;
+}
+
+void runDisplayWatcher(std::promise<HWND> ready) {
+    HINSTANCE instance = getDisplayWatcherModule();
+
+    WNDCLASSEXW windowClass = {};
+    windowClass.cbSize = sizeof(windowClass);
+    windowClass.lpfnWndProc = DisplayWatcherWindowProc;
+    windowClass.hInstance = instance;
+    windowClass.lpszClassName = kDisplayWatcherClassName;
+    if (RegisterClassExW(&windowClass) == 0 &&
+        GetLastError() != ERROR_CLASS_ALREADY_EXISTS) {
+        ready.set_value(NULL);
+        return;
+    }
+
+    uxdDisplayChange = RegisterWindowMessageW(L"UxdDisplayChangeMessage");
+    HWND hwnd = CreateWindowExW(WS_EX_TOOLWINDOW | WS_EX_NOACTIVATE,
+                                kDisplayWatcherClassName,
+                                kDisplayWatcherClassName,
+                                WS_POPUP,
+                                0, 0, 0, 0,
+                                NULL,
+                                NULL,
+                                instance,
+                                NULL);
+    ready.set_value(hwnd);
+    if (hwnd == NULL) {
+        return;
+    }
+
+    MSG msg;
+    while (GetMessageW(&msg, NULL, 0, 0) > 0) {
+        TranslateMessage(&msg);
+        DispatchMessageW(&msg);
+    }
+}
+
+// Without the watcher the cache can't tell when it goes stale, so it is
+// never trusted and every write enumerates, as before.
+void startDisplayWatcher() {
+    std::lock_guard<std::mutex> lock(displayWatcherMutex);
+    if (displayWatcherThread.joinable()) {
+        return;
+    }
+
+    std::promise<HWND> ready;
+    std::future<HWND> readyHwnd = ready.get_future();
+    displayWatcherThread = std::thread(runDisplayWatcher, std::move(ready));
+    displayWatcherHwnd = readyHwnd.get();
+    if (displayWatcherHwnd == NULL) {
+        displayWatcherThread.join();
+    }
+}
+
+void stopDisplayWatcher(void* arg) {
+    std::lock_guard<std::mutex> lock(displayWatcherMutex);
+    if (displayWatcherHwnd != NULL) {
+        PostMessageW(displayWatcherHwnd, WM_CLOSE, 0, 0);
+    }
+    if (displayWatcherThread.joinable()) {
+        displayWatcherThread.join();
+    }
+    displayWatcherHwnd = NULL;
+}
+
+bool displayWatcherRunning() {
+    std::lock_guard<std::mutex> lock(displayWatcherMutex);
+    return displayWatcherHwnd != NULL;
+}
+
+enum SDRRampCurve {
+    SDR_RAMP_LINEAR,
+    SDR_RAMP_EASE_IN,
+    SDR_RAMP_EASE_OUT,
+    SDR_RAMP_EASE
+};
+
+// A display's SDR white level moving from one level to another. Levels are
+// in nits and kept unquantized so a retargeted ramp carries on from exactly
+// where it was.
+struct SDRRamp {
+    DISPLAYCONFIG_PATH_INFO target;
+    double from;
+    double to;
+    double current;
+    SDRRampCurve curve;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::duration duration;
+    // One refresh of the display, since a level shown for less is never seen.
+    std::chrono::steady_clock::duration stepInterval;
+    std::chrono::steady_clock::time_point nextStep;
+    // The level last written, so steps that round to it are skipped.
+    int written;
+};
+
+// Ramps by path, all run by one thread. Writes happen under the lock, so a
+// write that cancels a ramp can't be overtaken by that ramp's next step.
+std::mutex sdrRampMutex;
+std::condition_variable sdrRampWake;
+std::map<std::string, SDRRamp> sdrRamps;
+std::thread sdrRampThread;
+bool sdrRampStopping = false;
+
+double applySDRRampCurve(SDRRampCurve curve, double t) {
+    switch (curve) {
+        case SDR_RAMP_EASE_IN:
+            return t * t;
+        case SDR_RAMP_EASE_OUT:
+            return t * (2 - t);
+        case SDR_RAMP_EASE:
+            return t * t * (3 - 2 * t);
+        default:
+            return t;
+    }
+}
+
+bool parseSDRRampCurve(const std::string& name, SDRRampCurve& curve) {
+    if (name == "linear") {
+        curve = SDR_RAMP_LINEAR;
+    } else if (name == "ease-in") {
+        curve = SDR_RAMP_EASE_IN;
+    } else if (name == "ease-out") {
+        curve = SDR_RAMP_EASE_OUT;
+    } else if (name == "ease") {
+        curve = SDR_RAMP_EASE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::chrono::steady_clock::duration getRefreshInterval(const DISPLAYCONFIG_PATH_INFO& path) {
+    double hz = 60;
+    const DISPLAYCONFIG_RATIONAL& rate = path.targetInfo.refreshRate;
+    if (rate.Numerator != 0 && rate.Denominator != 0) {
+        hz = (double)rate.Numerator / rate.Denominator;
+    }
+    hz = std::min(std::max(hz, 24.0), 500.0);
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / hz));
+}
+
+// Must hold sdrRampMutex. Moves a due ramp to where it should be now.
+// Returns false once it has reached its target.
+bool stepSDRRamp(const std::string& path, SDRRamp& ramp, std::chrono::steady_clock::time_point now) {
+    double t = 1;
+    if (ramp.duration.count() > 0) {
+        t = std::chrono::duration<double>(now - ramp.start) /
+            std::chrono::duration<double>(ramp.duration);
+        t = std::min(std::max(t, 0.0), 1.0);
+    }
+    ramp.current = ramp.from + (ramp.to - ramp.from) * applySDRRampCurve(ramp.curve, t);
+
+    int nits = quantizeSDRNits((int)lround(ramp.current));
+    // A failed write leaves written alone so the next step tries again.
+    if (nits != ramp.written && setSDRBrightness(ramp.target, nits)) {
+        noteDisplayNits(path, nits);
+        ramp.written = nits;
+    }
+
+    if (t >= 1) {
+        return false;
+    }
+    ramp.nextStep += ramp.stepInterval;
+    if (ramp.nextStep < now) {
+        ramp.nextStep = now + ramp.stepInterval;
+    }
+    return true;
+}
+
+void runSDRRamps() {
+    std::unique_lock<std::mutex> lock(sdrRampMutex);
+    while (!sdrRampStopping) {
+        if (sdrRamps.empty()) {
+            sdrRampWake.wait(lock);
+            continue;
+        }
+
+        auto due = std::chrono::steady_clock::time_point::max();
+        for (auto& ramp : sdrRamps) {
+            due = std::min(due, ramp.second.nextStep);
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now < due) {
+            // Also woken early by a new ramp or a retarget.
+            sdrRampWake.wait_until(lock, due);
+            continue;
+        }
+
+        for (auto it = sdrRamps.begin(); it != sdrRamps.end();) {
+            if (it->second.nextStep <= now && !stepSDRRamp(it->first, it->second, now)) {
+                it = sdrRamps.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+}
+
+// Starts a ramp of the display at path to nits, or retargets the one it
+// has. A retargeted ramp starts from where the old one had got to; a new
+// one starts from the level the display is at now, since the cached level
+// misses changes made in Settings. The first step is written straight away.
+bool startSDRRamp(const std::string& path, int nits, std::chrono::milliseconds duration, SDRRampCurve curve) {
+    Display display;
+    if (!resolveDisplay(path, display)) {
+        return false;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(sdrRampMutex);
+
+    SDRRamp ramp;
+    auto running = sdrRamps.find(path);
+    if (running != sdrRamps.end()) {
+        ramp.current = running->second.current;
+        ramp.written = running->second.written;
+    } else {
+        int current = display.nits;
+        if (pathGetSdrWhite(display.target, current) && current != display.nits) {
+            noteDisplayNits(path, current);
+        }
+        ramp.current = current;
+        ramp.written = current;
+    }
+    ramp.target = display.target;
+    ramp.from = ramp.current;
+    ramp.to = quantizeSDRNits(nits);
+    ramp.curve = curve;
+    ramp.start = now;
+    ramp.duration = duration;
+    ramp.stepInterval = getRefreshInterval(display.target);
+    ramp.nextStep = now;
+    sdrRamps[path] = ramp;
+
+    if (!sdrRampThread.joinable()) {
+        sdrRampThread = std::thread(runSDRRamps);
+    }
+    sdrRampWake.notify_one();
+    return true;
+}
+
+// Stops the display's ramp where it is. False if it had none.
+bool cancelSDRRamp(const std::string& path) {
+    std::lock_guard<std::mutex> lock(sdrRampMutex);
+    return sdrRamps.erase(path) > 0;
+}
+
+void stopSDRRamps(void* arg) {
+    {
+        std::lock_guard<std::mutex> lock(sdrRampMutex);
+        sdrRampStopping = true;
+        sdrRamps.clear();
+    }
+    sdrRampWake.notify_one();
+    if (sdrRampThread.joinable()) {
+        sdrRampThread.join();
+    }
+    std::lock_guard<std::mutex> lock(sdrRampMutex);
+    sdrRampStopping = false;
+}
+
 Napi::Array nodeGetDisplays(const Napi::CallbackInfo& info) {
 
-    std::map<std::string, Display> displays;
+    std::vector<Display> displays;
 
     try {
-        displays = getDisplays();
+        displays = refreshDisplayCache();
     } catch (...) {
         fprintf(stderr, "Error on nodeGetDisplays\n");
     }
@@ -266,13 +794,13 @@ Napi::Array nodeGetDisplays(const Napi::CallbackInfo& info) {
     int i = 0;
     for (auto& display : displays) {
         Napi::Object displayObj = Napi::Object::New(env);
-        displayObj.Set(Napi::String::New(env, "name"), Napi::String::New(env, display.second.name));
-        displayObj.Set(Napi::String::New(env, "path"), Napi::String::New(env, display.second.path));
-        displayObj.Set(Napi::String::New(env, "nits"), Napi::Number::New(env, display.second.nits));
-        displayObj.Set(Napi::String::New(env, "hdrSupported"), Napi::Boolean::New(env, display.second.hdrSupported));
-        displayObj.Set(Napi::String::New(env, "hdrEnabled"), Napi::Boolean::New(env, display.second.hdrEnabled));
-        displayObj.Set(Napi::String::New(env, "hdrActive"), Napi::Boolean::New(env, display.second.hdrActive));
-        displayObj.Set(Napi::String::New(env, "bits"), Napi::Number::New(env, display.second.bits));
+        displayObj.Set(Napi::String::New(env, "name"), Napi::String::New(env, display.name));
+        displayObj.Set(Napi::String::New(env, "path"), Napi::String::New(env, display.path));
+        displayObj.Set(Napi::String::New(env, "nits"), Napi::Number::New(env, display.nits));
+        displayObj.Set(Napi::String::New(env, "hdrSupported"), Napi::Boolean::New(env, display.hdrSupported));
+        displayObj.Set(Napi::String::New(env, "hdrEnabled"), Napi::Boolean::New(env, display.hdrEnabled));
+        displayObj.Set(Napi::String::New(env, "hdrActive"), Napi::Boolean::New(env, display.hdrActive));
+        displayObj.Set(Napi::String::New(env, "bits"), Napi::Number::New(env, display.bits));
         out.Set(i++, displayObj);
     }
 
@@ -284,25 +812,108 @@ Napi::Boolean nodeSetSDRBrightness(const Napi::CallbackInfo& info) {
         fprintf(stderr, "Invalid number of parameters.\n");
         return Napi::Boolean::New(info.Env(), false);
     }
-    Napi::String path = info[0].As<Napi::String>();
-    Napi::Number nits = info[1].As<Napi::Number>();
+    std::string path = info[0].As<Napi::String>();
+    int nits = info[1].As<Napi::Number>();
+
+    if (!displayWatcherRunning()) {
+        invalidateDisplayCache();
+    }
 
-    std::map<std::string, Display> displays = getDisplays();
+    // A write lands where it's told, not where a ramp was headed.
+    cancelSDRRamp(path);
 
+    Display display;
     boolean result = false;
-    for (auto& display : displays) {
-        if(display.second.path == (std::string)path) {
-            result = setSDRBrightness(display.second.target, nits, false);
-            break;
+    if (resolveDisplay(path, display)) {
+        result = setSDRBrightness(display.target, nits);
+        if (result) {
+            noteDisplayNits(path, quantizeSDRNits(nits));
         }
     }
 
     return Napi::Boolean::New(info.Env(), result);
 }
 
+// rampSDRBrightness(path, nits, durationMs = 0, curve = "linear") moves the
+// SDR white level to nits over durationMs, one step per refresh of the
+// display. curve is "linear", "ease-in", "ease-out" or "ease". Calling it
+// again for a display with a ramp running retargets that ramp.
+Napi::Boolean nodeRampSDRBrightness(const Napi::CallbackInfo& info) {
+    if(info.Length() < 2) {
+        fprintf(stderr, "Invalid number of parameters.\n");
+        return Napi::Boolean::New(info.Env(), false);
+    }
+    std::string path = info[0].As<Napi::String>();
+    int nits = info[1].As<Napi::Number>();
+
+    int durationMs = 0;
+    if (info.Length() > 2 && info[2].IsNumber()) {
+        durationMs = std::max((int)info[2].As<Napi::Number>(), 0);
+    }
+
+    SDRRampCurve curve = SDR_RAMP_LINEAR;
+    if (info.Length() > 3 && info[3].IsString() &&
+        !parseSDRRampCurve(info[3].As<Napi::String>(), curve)) {
+        fprintf(stderr, "Unknown SDR ramp curve.\n");
+        return Napi::Boolean::New(info.Env(), false);
+    }
+
+    if (!displayWatcherRunning()) {
+        invalidateDisplayCache();
+    }
+
+    boolean result = startSDRRamp(path, nits, std::chrono::milliseconds(durationMs), curve);
+    return Napi::Boolean::New(info.Env(), result);
+}
+
+// Stops the display's SDR ramp at its current level. False if it had none.
+Napi::Boolean nodeCancelSDRRamp(const Napi::CallbackInfo& info) {
+    if(info.Length() != 1) {
+        fprintf(stderr, "Invalid number of parameters.\n");
+        return Napi::Boolean::New(info.Env(), false);
+    }
+    std::string path = info[0].As<Napi::String>();
+    return Napi::Boolean::New(info.Env(), cancelSDRRamp(path));
+}
+
+// Marks the cached displays stale, for changes the watcher can't see, such
+// as HDR being toggled in Settings. The next write enumerates again.
+Napi::Value nodeInvalidateDisplays(const Napi::CallbackInfo& info) {
+    invalidateDisplayCache();
+    return info.Env().Undefined();
+}
+
+// { generation, ageMs, valid, count, watching } for the cached displays.
+Napi::Object nodeGetDisplayCacheInfo(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Napi::Object out = Napi::Object::New(env);
+    bool watching = displayWatcherRunning();
+
+    std::lock_guard<std::mutex> lock(displayCacheMutex);
+    double age = -1;
+    if (displayCache.generation > 0) {
+        age = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - displayCache.refreshedAt).count();
+    }
+    out.Set(Napi::String::New(env, "generation"), Napi::Number::New(env, (double)displayCache.generation));
+    out.Set(Napi::String::New(env, "ageMs"), Napi::Number::New(env, age));
+    out.Set(Napi::String::New(env, "valid"), Napi::Boolean::New(env, displayCache.valid));
+    out.Set(Napi::String::New(env, "count"), Napi::Number::New(env, (double)displayCache.displays.size()));
+    out.Set(Napi::String::New(env, "watching"), Napi::Boolean::New(env, watching));
+    return out;
+}
+
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
+    startDisplayWatcher();
+    napi_add_env_cleanup_hook(env, stopDisplayWatcher, nullptr);
+    napi_add_env_cleanup_hook(env, stopSDRRamps, nullptr);
+
     exports.Set(Napi::String::New(env, "getDisplays"), Napi::Function::New(env, nodeGetDisplays));
     exports.Set(Napi::String::New(env, "setSDRBrightness"), Napi::Function::New(env, nodeSetSDRBrightness));
+    exports.Set(Napi::String::New(env, "rampSDRBrightness"), Napi::Function::New(env, nodeRampSDRBrightness));
+    exports.Set(Napi::String::New(env, "cancelSDRRamp"), Napi::Function::New(env, nodeCancelSDRRamp));
+    exports.Set(Napi::String::New(env, "invalidateDisplays"), Napi::Function::New(env, nodeInvalidateDisplays));
+    exports.Set(Napi::String::New(env, "getDisplayCacheInfo"), Napi::Function::New(env, nodeGetDisplayCacheInfo));
     return exports;
 }
 
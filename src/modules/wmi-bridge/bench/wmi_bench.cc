@@ -0,0 +1,410 @@
+// Runs the worker, session and brightness code against the WMI simulator and
+// reports how long each export's task takes end to end and how many WMI
+// calls it makes.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../wmi_core.h"
+#include "../wmi_simulator.h"
+
+namespace {
+
+const char* kPanel = "DISPLAY\\BOE0812\\4&2a1b&0&UID8388688_0";
+const char* kSecondPanel = "DISPLAY\\SDC4152\\4&2a1b&0&UID8388689_0";
+const char* kExternal = "DISPLAY\\DELA0F4\\5&1b2c3d4e&0&UID4352_0";
+
+WmiSimulatedMonitor makePanel(const char* instanceName, const char* name, int brightness)
+{
+    WmiSimulatedMonitor monitor;
+    monitor.instanceName = instanceName;
+    monitor.userFriendlyName = name;
+    monitor.manufacturerName = "BOE";
+    monitor.productCode = "0812";
+    monitor.serialNumber = "0";
+    monitor.yearOfManufacture = 2021;
+    monitor.weekOfManufacture = 14;
+    monitor.hasBrightness = true;
+    monitor.brightness = brightness;
+    for (int level = 0; level <= 100; level++) {
+        monitor.levels.push_back(level);
+    }
+    return monitor;
+}
+
+WmiSimulatedMonitor makeExternal()
+{
+    WmiSimulatedMonitor external;
+    external.instanceName = kExternal;
+    external.userFriendlyName = "DELL U2720Q";
+    external.manufacturerName = "DEL";
+    external.productCode = "A0F4";
+    external.serialNumber = "8DK2F93";
+    external.yearOfManufacture = 2020;
+    external.weekOfManufacture = 33;
+    return external;
+}
+
+// A laptop panel and an external monitor, or with dual, two panels.
+std::shared_ptr<WmiSimulator> makeLaptop(const WmiSimulatorOptions& options, bool dual)
+{
+    auto simulator = std::make_shared<WmiSimulator>(options);
+    simulator->addMonitor(makePanel(kPanel, "", 60));
+    if (dual) {
+        simulator->addMonitor(makePanel(kSecondPanel, "", 40));
+    }
+    simulator->addMonitor(makeExternal());
+    return simulator;
+}
+
+// Every scenario gets a fresh worker talking to its own simulator.
+void useSimulator(const std::shared_ptr<WmiSimulator>& simulator)
+{
+    stopWmiWorker();
+    setWmiProviderFactory([simulator]() { return simulator->open(); });
+}
+
+struct Snapshot {
+    uint64_t connections;
+    uint64_t queries;
+    uint64_t enumerations;
+    uint64_t methodCalls;
+    uint64_t resolves;
+    uint64_t timeouts;
+    uint64_t abandonedWorkers;
+};
+
+Snapshot snapshot()
+{
+    Snapshot now;
+    now.connections = wmiStats.connections.load();
+    now.queries = wmiStats.queries.load();
+    now.enumerations = wmiStats.enumerations.load();
+    now.methodCalls = wmiStats.methodCalls.load();
+    now.resolves = wmiStats.brightnessMethodResolves.load();
+    now.timeouts = wmiStats.timeouts.load();
+    now.abandonedWorkers = wmiStats.abandonedWorkers.load();
+    return now;
+}
+
+void fail(const char* what)
+{
+    fprintf(stderr, "wmi_bench: %s\n", what);
+    exit(1);
+}
+
+// Runs body iterations times and reports the mean, the worst and the WMI
+// calls per run. Returns how many runs failed.
+uint32_t measure(const char* name, uint32_t iterations, const std::function<HRESULT(uint32_t)>& body)
+{
+    Snapshot before = snapshot();
+    uint32_t failed = 0;
+    double worst = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        auto callStart = std::chrono::steady_clock::now();
+        if (FAILED(body(i))) {
+            failed++;
+        }
+        std::chrono::duration<double, std::micro> call = std::chrono::steady_clock::now() - callStart;
+        worst = std::max(worst, call.count());
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    Snapshot after = snapshot();
+
+    printf("%-36s %9.2f us/op  %9.0f us max  %5.2f queries/op  %5.2f next/op  %5.2f execMethod/op  "
+           "%4.2f resolves/op  connects %llu  timeouts %llu  abandoned %llu  failed %u\n",
+           name,
+           elapsed.count() / iterations,
+           worst,
+           (double)(after.queries - before.queries) / iterations,
+           (double)(after.enumerations - before.enumerations) / iterations,
+           (double)(after.methodCalls - before.methodCalls) / iterations,
+           (double)(after.resolves - before.resolves) / iterations,
+           (unsigned long long)(after.connections - before.connections),
+           (unsigned long long)(after.timeouts - before.timeouts),
+           (unsigned long long)(after.abandonedWorkers - before.abandonedWorkers),
+           failed);
+    return failed;
+}
+
+HRESULT getBrightness(std::chrono::milliseconds timeout, int* brightness = nullptr)
+{
+    auto reading = std::make_shared<WmiBrightnessReading>();
+    HRESULT hr = runWmiTask([reading](WmiSession& session, const WmiDeadline& deadline) {
+        return session.invoke(deadline, [&](WmiProvider& provider) {
+            return readWMIBrightness(provider, deadline, *reading);
+        });
+    }, timeout);
+    if (brightness != nullptr) {
+        *brightness = reading->brightness;
+    }
+    return hr;
+}
+
+HRESULT getBrightnessAll(std::chrono::milliseconds timeout, size_t expected)
+{
+    auto readings = std::make_shared<std::vector<WmiBrightnessReading>>();
+    HRESULT hr = runWmiTask([readings](WmiSession& session, const WmiDeadline& deadline) {
+        return session.invoke(deadline, [&](WmiProvider& provider) {
+            readings->clear();
+            return readWMIBrightnessAll(provider, deadline, *readings);
+        });
+    }, timeout);
+    if (SUCCEEDED(hr) && readings->size() != expected) {
+        fail("getBrightnessAll missed a panel");
+    }
+    return hr;
+}
+
+HRESULT getMonitors(std::chrono::milliseconds timeout)
+{
+    auto identities = std::make_shared<std::vector<WmiMonitorIdentity>>();
+    return runWmiTask([identities](WmiSession& session, const WmiDeadline& deadline) {
+        HRESULT hr = session.invoke(deadline, [&](WmiProvider& provider) {
+            identities->clear();
+            return provider.enumerateMonitors(deadline, *identities);
+        });
+        if (SUCCEEDED(hr)) {
+            std::vector<std::string> instances;
+            for (const WmiMonitorIdentity& identity : *identities) {
+                instances.push_back(identity.instanceName);
+            }
+            session.noteMonitorInstances(instances);
+        }
+        return hr;
+    }, timeout);
+}
+
+HRESULT setBrightness(std::chrono::milliseconds timeout, const std::string& target, int brightness)
+{
+    return runWmiTask([target, brightness](WmiSession& session, const WmiDeadline& deadline) {
+        return session.invoke(deadline, [&](WmiProvider& provider) {
+            return writeWMIBrightness(provider, deadline, session.brightnessMethods, target, brightness);
+        });
+    }, timeout);
+}
+
+HRESULT syncBrightnessEvents(std::chrono::milliseconds timeout)
+{
+    return runWmiTask([](WmiSession& session, const WmiDeadline& deadline) {
+        return session.invoke(deadline, [&](WmiProvider&) {
+            return session.syncBrightnessEvents(deadline);
+        });
+    }, timeout);
+}
+
+void benchReads(uint32_t iterations, uint32_t latencyMicroseconds)
+{
+    WmiSimulatorOptions options;
+    options.callLatencyMicroseconds = latencyMicroseconds;
+    options.connectLatencyMicroseconds = latencyMicroseconds * 20;
+    auto simulator = makeLaptop(options, true);
+    useSimulator(simulator);
+
+    std::string suffix = latencyMicroseconds ? ", " + std::to_string(latencyMicroseconds) + " us/call" : "";
+    uint32_t failed = measure(("getBrightness" + suffix).c_str(), iterations, [](uint32_t) {
+        int brightness = 0;
+        HRESULT hr = getBrightness(kWmiDefaultTimeout, &brightness);
+        if (hr == S_OK && brightness != 60) {
+            fail("getBrightness read the wrong panel");
+        }
+        return hr;
+    });
+    failed += measure(("getBrightnessAll" + suffix).c_str(), iterations, [](uint32_t) {
+        return getBrightnessAll(kWmiDefaultTimeout, 2);
+    });
+    failed += measure(("getMonitors" + suffix).c_str(), iterations, [](uint32_t) {
+        return getMonitors(kWmiDefaultTimeout);
+    });
+    if (failed != 0) {
+        fail("a read failed without injected faults");
+    }
+}
+
+// Writes alternate between the two panels. Every topologyEvery writes a
+// getMonitors finds the external monitor unplugged or plugged back in,
+// which starts a new generation.
+void benchWrites(const char* name, uint32_t iterations, const WmiSimulatorOptions& options, uint32_t topologyEvery)
+{
+    auto simulator = makeLaptop(options, true);
+    useSimulator(simulator);
+
+    bool unplugged = false;
+    uint32_t failed = measure(name, iterations, [&](uint32_t i) {
+        if (topologyEvery != 0 && i % topologyEvery == 0) {
+            if (unplugged) {
+                simulator->addMonitor(makeExternal());
+            } else {
+                simulator->removeMonitor(kExternal);
+            }
+            unplugged = !unplugged;
+            getMonitors(kWmiDefaultTimeout);
+        }
+
+        const char* target = (i & 1) ? kSecondPanel : kPanel;
+        int level = static_cast<int>(i % 101);
+        HRESULT hr = setBrightness(kWmiDefaultTimeout, monitorIdFromInstanceName(target), level);
+        if (SUCCEEDED(hr) && simulator->brightness(target) != level) {
+            fail("setBrightness wrote the wrong panel");
+        }
+        return hr;
+    });
+
+    if (options.failureRate == 0 && options.disconnectRate == 0 && failed != 0) {
+        fail("a write failed without injected faults");
+    }
+}
+
+// A write to a panel whose driver reloaded: the cached method instance is
+// gone, so the write resolves again and retries once.
+void benchStaleMethod(uint32_t iterations)
+{
+    auto simulator = makeLaptop(WmiSimulatorOptions(), false);
+    useSimulator(simulator);
+
+    uint32_t failed = measure("setBrightness, panel reloaded", iterations, [&](uint32_t i) {
+        simulator->removeMonitor(kPanel);
+        simulator->addMonitor(makePanel(kPanel, "", 50));
+        return setBrightness(kWmiDefaultTimeout, "", static_cast<int>(i % 101));
+    });
+    if (failed != 0) {
+        fail("a write to a reloaded panel failed");
+    }
+}
+
+// Brightness key presses on the panel, each delivered to the listener, and
+// a winmgmt restart, after which the subscription has to come back by itself.
+void benchEvents(uint32_t iterations)
+{
+    auto simulator = makeLaptop(WmiSimulatorOptions(), false);
+    useSimulator(simulator);
+
+    std::atomic<uint64_t> received{0};
+    setBrightnessListener([&received](const WmiBrightnessReading& event) {
+        if (event.instanceName == kPanel) {
+            received++;
+        }
+    });
+    if (FAILED(syncBrightnessEvents(kWmiDefaultTimeout))) {
+        fail("couldn't subscribe to brightness events");
+    }
+
+    measure("brightness event delivery", iterations, [&](uint32_t i) {
+        return simulator->setBrightness(kPanel, static_cast<int>(i % 101)) ? S_OK : E_FAIL;
+    });
+    if (received != iterations) {
+        fail("a brightness event went missing");
+    }
+
+    Snapshot before = snapshot();
+    auto start = std::chrono::steady_clock::now();
+    simulator->restartService();
+    while (simulator->stats().events == iterations) {
+        simulator->setBrightness(kPanel, 50);
+        if (std::chrono::steady_clock::now() - start > std::chrono::seconds(2)) {
+            fail("brightness events didn't come back after a restart");
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    printf("%-36s %9.2f us     %llu reconnects\n",
+           "resubscribe after winmgmt restart",
+           elapsed.count(),
+           (unsigned long long)(snapshot().connections - before.connections));
+
+    setBrightnessListener(nullptr);
+    syncBrightnessEvents(kWmiDefaultTimeout);
+}
+
+// Calls that hang past their deadline. Each timed-out request should come
+// back shortly after its timeout, and a worker stuck beyond the cancel grace
+// gets replaced rather than blocking the requests behind it.
+void benchHangs(uint32_t iterations)
+{
+    WmiSimulatorOptions options;
+    options.hangRate = 0.1;
+    options.hangMilliseconds = 400;
+    auto simulator = makeLaptop(options, false);
+    useSimulator(simulator);
+
+    std::chrono::milliseconds timeout(100);
+    measure("getBrightness, 10% hang 400 ms", iterations, [&](uint32_t) {
+        return getBrightness(timeout);
+    });
+
+    // Let the abandoned workers finish their calls before the simulator goes.
+    std::this_thread::sleep_for(std::chrono::milliseconds(options.hangMilliseconds));
+}
+
+// A worker whose thread setup fails at first. Requests fail fast while it
+// backs off, and the worker serves them once a retry gets through, instead of
+// failing everything until it is restarted.
+void benchAttachRetry()
+{
+    WmiSimulatorOptions options;
+    options.attachFailures = 2;
+    auto simulator = makeLaptop(options, false);
+    useSimulator(simulator);
+
+    uint64_t failuresBefore = wmiStats.attachFailures.load();
+    uint32_t failed = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (FAILED(getBrightness(kWmiDefaultTimeout))) {
+        failed++;
+        if (std::chrono::steady_clock::now() - start > kWmiAttachRetryMin * 8) {
+            fail("the worker didn't recover from a failed attach");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    printf("%-36s %9.2f us     %u failed  %llu attach failures\n",
+           "recover from 2 failed attaches",
+           elapsed.count(),
+           failed,
+           (unsigned long long)(wmiStats.attachFailures.load() - failuresBefore));
+    if (simulator->stats().attaches != 3) {
+        fail("a failed attach wasn't retried exactly once per backoff");
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    uint32_t iterations = argc > 1 ? (uint32_t)atoi(argv[1]) : 20000;
+    if (iterations < 10) {
+        iterations = 10;
+    }
+
+    benchReads(iterations, 0);
+    benchReads(iterations / 100, 500);
+
+    benchWrites("setBrightness", iterations, WmiSimulatorOptions(), 0);
+    benchWrites("setBrightness, topology change/50", iterations, WmiSimulatorOptions(), 50);
+    WmiSimulatorOptions slow;
+    slow.callLatencyMicroseconds = 500;
+    benchWrites("setBrightness, 500 us/call", iterations / 100, slow, 0);
+    WmiSimulatorOptions dropping;
+    dropping.disconnectRate = 0.05;
+    benchWrites("setBrightness, 5% disconnects", iterations, dropping, 0);
+    WmiSimulatorOptions failing;
+    failing.failureRate = 0.05;
+    benchWrites("setBrightness, 5% failures", iterations, failing, 0);
+    benchStaleMethod(iterations);
+
+    benchEvents(iterations);
+    benchHangs(std::max<uint32_t>(iterations / 1000, 10));
+    benchAttachRetry();
+
+    stopWmiWorker();
+    setWmiProviderFactory(nullptr);
+    return 0;
+}
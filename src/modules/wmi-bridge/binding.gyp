@@ -6,7 +6,7 @@
       "cflags_cc!": [ ],
       "conditions": [
         ["OS=='win'", {
-      	  "sources": [ "wmi-bridge.cc" ]
+      	  "sources": [ "wmi-bridge.cc", "wmi_core.cc", "wmi_provider.cc" ]
       	}],
       ],
       "msvs_settings": {
@@ -1,16 +1,30 @@
 const WMIBridgeTest = require("./index");
 
-setInterval(() => {
+const callsSince = (before, after) => {
+    const delta = {}
+    for (const key in after) {
+        delta[key] = after[key] - (before[key] || 0)
+    }
+    return delta
+}
+
+setInterval(async () => {
     console.log("==== TESTING WMIBRIDGE ====")
-    const monitors = WMIBridgeTest.getMonitors();
+    const monitors = await WMIBridgeTest.getMonitors();
     console.log(`getMonitors: ${Object.keys(monitors)}`)
 
-    const brightness = WMIBridgeTest.getBrightness();
+    const brightness = await WMIBridgeTest.getBrightness();
     console.log(`getBrightness:`, brightness)
 
-    const ok = WMIBridgeTest.setBrightness(100);
-    console.log(`setBrightness: ${ok}`)
+    // The first write after a monitor change resolves the method. The ones
+    // after it should only cost one property write and one method call.
+    const before = WMIBridgeTest.getStats()
+    for (let level = 90; level <= 100; level += 5) {
+        const ok = await WMIBridgeTest.setBrightness(level);
+        console.log(`setBrightness(${level}): ${ok}`)
+    }
+    console.log(`WMI calls for 3 writes:`, callsSince(before, WMIBridgeTest.getStats()))
     console.log('===========================')
     console.log(" ")
     console.log(" ")
-}, 500)
\ No newline at end of file
+}, 500)
@@ -2,25 +2,76 @@
 const addon = require("bindings")("wmi_bridge");
 require("os").setPriority(0, require("os").constants.priority.PRIORITY_BELOW_NORMAL)
 
+// Every call runs on the addon's WMI thread and settles within timeout
+// milliseconds (4000 if not given). A call that runs out of time resolves
+// to { failed: true, timedOut: true }, or false for setBrightness.
 class WMIBridge {
     constructor() {}
-    setBrightness = async (level = 50) => {
+    setBrightness = async (level = 50, timeout) => {
         let ok = false
         try {
-            ok = addon.setBrightness(level)
+            ok = await addon.setBrightness(level, timeout)
         } catch(e) { console.log(e) }
         return ok
     }
-    getBrightness = async () => {
+    getBrightness = async (timeout) => {
         let brightness = { failed: true }
         try {
-            brightness = addon.getBrightness()
+            brightness = await addon.getBrightness(timeout)
         } catch (e) { console.log(e) }
         return brightness
     }
-    getMonitors = async () => {
+    // instance is an InstanceName, or the matching "\\?\DISPLAY#..." id
+    // node-ddcci uses.
+    setBrightnessFor = async (instance, level, timeout) => {
+        let ok = false
+        try {
+            ok = await addon.setBrightnessFor(instance, level, timeout)
+        } catch(e) { console.log(e) }
+        return ok
+    }
+    // Every internal panel, keyed by InstanceName, each with MonitorId,
+    // Brightness, Active and its Levels table.
+    getBrightnessAll = async (timeout) => {
+        try {
+            return await addon.getBrightnessAll(timeout)
+        } catch (e) {
+            console.log(e)
+            return { failed: true }
+        }
+    }
+    getMonitors = async (timeout) => {
+        try {
+            return await addon.getMonitors(timeout)
+        } catch(e) {
+            console.log(e)
+            return { failed: true }
+        }
+    }
+    // Calls callback with { InstanceName, Brightness } whenever an internal
+    // panel's level changes, however it was changed. Resolves true once
+    // subscribed. A new callback replaces the previous one.
+    onBrightnessChange = async (callback, timeout) => {
+        try {
+            return await addon.subscribeBrightnessEvents(callback, timeout)
+        } catch(e) {
+            console.log(e)
+            return false
+        }
+    }
+    offBrightnessChange = async (timeout) => {
+        try {
+            return await addon.unsubscribeBrightnessEvents(timeout)
+        } catch(e) {
+            console.log(e)
+            return false
+        }
+    }
+    // Running totals of the WMI calls made so far, for comparing what each
+    // operation costs.
+    getStats = () => {
         try {
-            return addon.getMonitors()
+            return addon.getStats()
         } catch(e) {
             console.log(e)
             return { failed: true }
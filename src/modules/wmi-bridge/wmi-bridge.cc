@@ -1,80 +1,14 @@
-#define _WIN32_DCOM
-
 #include <napi.h>
-#include <windows.h>
 #include <string>
 #include <mutex>
 #include <cmath>
-#include <WbemCli.h>
-#include <comdef.h>
-#include <wrl/client.h>
-#include "oaidl.h"
-#include "oleauto.h"
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "wmi_core.h"
 
-using Microsoft::WRL::ComPtr;
 using namespace std;
 
-#pragma comment(lib, "wbemuuid.lib")
-
-void p(string str)
-{
-    //cout << "Line: " << str << endl;
-}
-
-class ComScope {
-  public:
-    ComScope()
-      : result(CoInitializeEx(NULL, COINIT_MULTITHREADED))
-      , shouldUninitialize(SUCCEEDED(result))
-    {
-    }
-
-    ~ComScope()
-    {
-        if (shouldUninitialize) {
-            CoUninitialize();
-        }
-    }
-
-    bool isUsable() const
-    {
-        // A host may have initialized this thread as STA already. COM remains
-        // usable in that case, but this scope must not uninitialize it.
-        return SUCCEEDED(result) || result == RPC_E_CHANGED_MODE;
-    }
-
-  private:
-    HRESULT result;
-    bool shouldUninitialize;
-};
-
-std::mutex securityInitializationMutex;
-
-bool initializeWmiSecurity()
-{
-    // ComScope can tear down and later reinitialize COM between calls. COM
-    // security must therefore be initialized for the current COM lifetime,
-    // rather than cached for the lifetime of the addon.
-    std::lock_guard<std::mutex> lock(securityInitializationMutex);
-    HRESULT securityResult = CoInitializeSecurity(NULL,
-                                                   -1,
-                                                   NULL,
-                                                   NULL,
-                                                   RPC_C_AUTHN_LEVEL_CONNECT,
-                                                   RPC_C_IMP_LEVEL_IMPERSONATE,
-                                                   NULL,
-                                                   EOAC_NONE,
-                                                   0);
-
-    // Another component may have configured process-wide COM security
-    // before the addon is loaded. That configuration is usable here.
-    if (securityResult == RPC_E_TOO_LATE) {
-        securityResult = S_OK;
-    }
-
-    return SUCCEEDED(securityResult);
-}
-
 Napi::Object makeFailure(const Napi::Env& env)
 {
     Napi::Object failed = Napi::Object::New(env);
@@ -82,370 +16,489 @@ Napi::Object makeFailure(const Napi::Env& env)
     return failed;
 }
 
-std::string bstr_to_str(BSTR bstr)
-{
-    if (bstr == NULL) {
-        return "";
-    }
-
-    int wslen = ::SysStringLen(bstr);
-    if (wslen == 0) {
-        return "";
-    }
-
-    int len = ::WideCharToMultiByte(CP_ACP, 0, bstr, wslen, NULL, 0, NULL, NULL);
-    if (len <= 0) {
-        return "";
-    }
+// Where brightness events go while JS has subscribed to them.
+std::mutex brightnessTsfnMutex;
+Napi::ThreadSafeFunction brightnessTsfn;
+bool hasBrightnessTsfn = false;
 
-    std::string result(len, '\0');
-    if (::WideCharToMultiByte(CP_ACP, 0, bstr, wslen, &result[0], len, NULL, NULL) == 0) {
-        return "";
+// Called from whichever thread the provider delivers events on.
+void postBrightnessListenerEvent(Napi::ThreadSafeFunction listener, const WmiBrightnessReading& event)
+{
+    WmiBrightnessReading* data = new WmiBrightnessReading(event);
+    napi_status status = listener.NonBlockingCall(
+      data, [](Napi::Env env, Napi::Function callback, WmiBrightnessReading* data) {
+          Napi::Object event = Napi::Object::New(env);
+          event.Set("InstanceName", Napi::String::New(env, data->instanceName));
+          event.Set("MonitorId", Napi::String::New(env, monitorIdFromInstanceName(data->instanceName)));
+          event.Set("Brightness", Napi::Number::New(env, data->brightness));
+          delete data;
+          callback.Call({ event });
+      });
+    if (status != napi_ok) {
+        delete data;
     }
-    return result;
 }
 
-// Used to read WMIMonitorID's UINT16 string properties.
-std::string getWMIClassUINTString(HRESULT hr, VARIANT& value)
+std::chrono::milliseconds timeoutArgument(const Napi::CallbackInfo& info, size_t index)
 {
-    std::string output;
-
-    if (SUCCEEDED(hr) && (value.vt & VT_ARRAY) && value.parray != NULL) {
-        long lower = 0;
-        long upper = -1;
-        if (SUCCEEDED(SafeArrayGetLBound(value.parray, 1, &lower))
-            && SUCCEEDED(SafeArrayGetUBound(value.parray, 1, &upper))) {
-            for (long i = lower; i <= upper; i++) {
-                USHORT element = 0;
-                if (SUCCEEDED(SafeArrayGetElement(value.parray, &i, &element))
-                    && element != 0) {
-                    output.push_back(static_cast<char>(element));
-                }
-            }
+    if (info.Length() > index && info[index].IsNumber()) {
+        double timeout = info[index].As<Napi::Number>().DoubleValue();
+        if (std::isfinite(timeout) && timeout > 0) {
+            return std::chrono::milliseconds(static_cast<long long>(timeout));
         }
     }
-
-    VariantClear(&value);
-    return output;
+    return kWmiDefaultTimeout;
 }
 
-bool connectToWmi(ComPtr<IWbemLocator>& locator, ComPtr<IWbemServices>& service)
+Napi::Object ConvertBrightnessReading(Napi::Env env, const WmiBrightnessReading& reading)
 {
-    HRESULT hr = CoCreateInstance(CLSID_WbemLocator,
-                                  NULL,
-                                  CLSCTX_ALL,
-                                  IID_PPV_ARGS(locator.GetAddressOf()));
-    if (FAILED(hr)) {
-        return false;
-    }
-
-    _bstr_t namespacePath(L"ROOT\\WMI");
-    hr = locator->ConnectServer(namespacePath,
-                                NULL,
-                                NULL,
-                                NULL,
-                                WBEM_FLAG_CONNECT_USE_MAX_WAIT,
-                                NULL,
-                                NULL,
-                                service.GetAddressOf());
-    return SUCCEEDED(hr);
+    Napi::Object monitor = Napi::Object::New(env);
+    monitor.Set("InstanceName", Napi::String::New(env, reading.instanceName));
+    monitor.Set("MonitorId", Napi::String::New(env, monitorIdFromInstanceName(reading.instanceName)));
+    monitor.Set("Brightness", Napi::Number::New(env, reading.brightness));
+    monitor.Set("Active", Napi::Boolean::New(env, reading.active));
+    Napi::Array levels = Napi::Array::New(env, reading.levels.size());
+    for (size_t i = 0; i < reading.levels.size(); i++) {
+        levels.Set((uint32_t)i, Napi::Number::New(env, reading.levels[i]));
+    }
+    monitor.Set("Levels", levels);
+    return monitor;
 }
 
-Napi::Object getWMIBrightness(const Napi::CallbackInfo& info)
-{
-    Napi::Env env = info.Env();
-    Napi::Object failed = makeFailure(env);
-    ComScope com;
-    if (!com.isUsable() || !initializeWmiSecurity()) {
-        return failed;
+// Hands a WMI task to the worker and settles a promise on the JS thread
+// when it completes or times out, so no libuv pool thread waits on it.
+// Failures resolve to { failed: true }, with timedOut set when the deadline
+// passed. The task itself only touches state shared with it, since it can
+// outlive the request after a timeout. The request deletes itself once the
+// promise is settled.
+class WmiRequest {
+  public:
+    WmiRequest(Napi::Env env, std::chrono::milliseconds timeout)
+      : env(env)
+      , deferred(Napi::Promise::Deferred::New(env))
+      , timeout(timeout)
+    {
     }
 
-    ComPtr<IWbemLocator> locator;
-    ComPtr<IWbemServices> service;
-    if (!connectToWmi(locator, service)) {
-        return failed;
+    virtual ~WmiRequest() = default;
+
+    Napi::Promise promise()
+    {
+        return deferred.Promise();
     }
 
-    ComPtr<IEnumWbemClassObject> enumerator;
-    HRESULT hr = service->ExecQuery(L"WQL",
-                                    L"SELECT * FROM WmiMonitorBrightness",
-                                    WBEM_FLAG_FORWARD_ONLY,
-                                    NULL,
-                                    enumerator.GetAddressOf());
-    if (FAILED(hr)) {
-        return failed;
+    void Queue()
+    {
+        // Keeps the process alive until the promise is settled, as a queued
+        // AsyncWorker would.
+        completed = Napi::ThreadSafeFunction::New(env, Napi::Function(), "wmiRequest", 0, 1);
+        startWmiTask(task(), timeout, [this](HRESULT hr) {
+            result = hr;
+            Napi::ThreadSafeFunction done = completed;
+            napi_status status = done.NonBlockingCall([this](Napi::Env env, Napi::Function) {
+                settle(env);
+            });
+            if (status != napi_ok) {
+                // The environment is going away and the promise with it.
+                delete this;
+            }
+            done.Release();
+        });
     }
 
-    while (true) {
-        ComPtr<IWbemClassObject> clsObj;
-        ULONG returned = 0;
-        hr = enumerator->Next(500, 1, clsObj.GetAddressOf(), &returned);
-        if (FAILED(hr) || returned == 0 || !clsObj) {
-            break;
-        }
+  protected:
+    virtual WmiTaskFunction task() = 0;
+    // Only called once the task succeeded.
+    virtual Napi::Value resolved(Napi::Env env) = 0;
 
-        VARIANT instanceName;
-        VariantInit(&instanceName);
-        HRESULT instanceResult = clsObj->Get(L"InstanceName", 0, &instanceName, NULL, NULL);
-        if (FAILED(instanceResult) || instanceName.vt != VT_BSTR) {
-            VariantClear(&instanceName);
-            continue;
+    virtual Napi::Value failure(Napi::Env env)
+    {
+        Napi::Object failed = makeFailure(env);
+        if (result == WBEM_E_CALL_CANCELLED) {
+            failed.Set("timedOut", Napi::Boolean::New(env, true));
         }
+        return failed;
+    }
 
-        std::string instance = bstr_to_str(instanceName.bstrVal);
-        VariantClear(&instanceName);
+    HRESULT result = E_FAIL;
 
-        VARIANT brightnessValue;
-        VariantInit(&brightnessValue);
-        HRESULT brightnessResult = clsObj->Get(
-          L"CurrentBrightness", 0, &brightnessValue, NULL, NULL);
-        if (FAILED(brightnessResult)) {
-            VariantClear(&brightnessValue);
-            continue;
-        }
+  private:
+    void settle(Napi::Env env)
+    {
+        deferred.Resolve(SUCCEEDED(result) ? resolved(env) : failure(env));
+        delete this;
+    }
 
-        VARIANT brightnessAsInt;
-        VariantInit(&brightnessAsInt);
-        HRESULT conversionResult = VariantChangeType(
-          &brightnessAsInt, &brightnessValue, 0, VT_I4);
-        VariantClear(&brightnessValue);
-        if (FAILED(conversionResult)) {
-            VariantClear(&brightnessAsInt);
-            continue;
-        }
+    Napi::Env env;
+    Napi::Promise::Deferred deferred;
+    std::chrono::milliseconds timeout;
+    Napi::ThreadSafeFunction completed;
+};
 
-        Napi::Object monitor = Napi::Object::New(env);
-        monitor.Set("InstanceName", Napi::String::New(env, instance));
-        monitor.Set("Brightness", Napi::Number::New(env, brightnessAsInt.lVal));
-        VariantClear(&brightnessAsInt);
+class GetBrightnessRequest : public WmiRequest {
+  public:
+    using WmiRequest::WmiRequest;
 
-        // The public API returns one brightness value. Preserve its existing
-        // first-valid-result behavior rather than relying on WMI enumeration
-        // order to overwrite it with a later entry.
-        return monitor;
+  protected:
+    WmiTaskFunction task() override
+    {
+        std::shared_ptr<WmiBrightnessReading> reading = this->reading;
+        return [reading](WmiSession& session, const WmiDeadline& deadline) {
+            return session.invoke(deadline, [&](WmiProvider& provider) {
+                return readWMIBrightness(provider, deadline, *reading);
+            });
+        };
     }
 
-    return failed;
-}
+    Napi::Value resolved(Napi::Env env) override
+    {
+        if (result != S_OK) {
+            return failure(env);
+        }
 
-Napi::Object getWMIMonitors(const Napi::CallbackInfo& info)
-{
-    Napi::Env env = info.Env();
-    Napi::Object failed = makeFailure(env);
-    ComScope com;
-    if (!com.isUsable() || !initializeWmiSecurity()) {
-        return failed;
+        return ConvertBrightnessReading(env, *reading);
     }
 
-    ComPtr<IWbemLocator> locator;
-    ComPtr<IWbemServices> service;
-    if (!connectToWmi(locator, service)) {
-        return failed;
-    }
+  private:
+    std::shared_ptr<WmiBrightnessReading> reading = std::make_shared<WmiBrightnessReading>();
+};
 
-    ComPtr<IEnumWbemClassObject> enumerator;
-    HRESULT hr = service->ExecQuery(L"WQL",
-                                    L"SELECT * FROM WmiMonitorID",
-                                    WBEM_FLAG_FORWARD_ONLY | WBEM_FLAG_RETURN_IMMEDIATELY,
-                                    NULL,
-                                    enumerator.GetAddressOf());
-    if (FAILED(hr)) {
-        return failed;
+class GetBrightnessAllRequest : public WmiRequest {
+  public:
+    using WmiRequest::WmiRequest;
+
+  protected:
+    WmiTaskFunction task() override
+    {
+        std::shared_ptr<std::vector<WmiBrightnessReading>> readings = this->readings;
+        return [readings](WmiSession& session, const WmiDeadline& deadline) {
+            return session.invoke(deadline, [&](WmiProvider& provider) {
+                readings->clear();
+                return readWMIBrightnessAll(provider, deadline, *readings);
+            });
+        };
     }
 
-    Napi::Object monitors = Napi::Object::New(env);
-    while (true) {
-        ComPtr<IWbemClassObject> clsObj;
-        ULONG returned = 0;
-        hr = enumerator->Next(500, 1, clsObj.GetAddressOf(), &returned);
-        if (FAILED(hr) || returned == 0 || !clsObj) {
-            break;
+    Napi::Value resolved(Napi::Env env) override
+    {
+        Napi::Object monitors = Napi::Object::New(env);
+        for (const WmiBrightnessReading& reading : *readings) {
+            monitors.Set(reading.instanceName, ConvertBrightnessReading(env, reading));
         }
+        return monitors;
+    }
 
-        VARIANT instanceName;
-        VariantInit(&instanceName);
-        HRESULT instanceResult = clsObj->Get(L"InstanceName", 0, &instanceName, NULL, NULL);
-        if (FAILED(instanceResult) || instanceName.vt != VT_BSTR) {
-            VariantClear(&instanceName);
-            continue;
-        }
+  private:
+    std::shared_ptr<std::vector<WmiBrightnessReading>> readings =
+      std::make_shared<std::vector<WmiBrightnessReading>>();
+};
 
-        std::string instance = bstr_to_str(instanceName.bstrVal);
-        VariantClear(&instanceName);
-        if (instance.empty()) {
-            continue;
-        }
+class GetMonitorsRequest : public WmiRequest {
+  public:
+    using WmiRequest::WmiRequest;
 
-        Napi::Object monitor = Napi::Object::New(env);
-        monitor.Set("InstanceName", Napi::String::New(env, instance));
-
-        VARIANT friendlyName;
-        VariantInit(&friendlyName);
-        HRESULT friendlyNameResult = clsObj->Get(
-          L"UserFriendlyName", 0, &friendlyName, NULL, NULL);
-        if (SUCCEEDED(friendlyNameResult)) {
-            monitor.Set("UserFriendlyName",
-                        Napi::String::New(env,
-                                          getWMIClassUINTString(
-                                            friendlyNameResult, friendlyName)));
-        } else {
-            VariantClear(&friendlyName);
-        }
+  protected:
+    WmiTaskFunction task() override
+    {
+        std::shared_ptr<std::vector<WmiMonitorIdentity>> identities = this->identities;
+        return [identities](WmiSession& session, const WmiDeadline& deadline) {
+            HRESULT hr = session.invoke(deadline, [&](WmiProvider& provider) {
+                // A retry after reconnecting starts the list over.
+                identities->clear();
+                return provider.enumerateMonitors(deadline, *identities);
+            });
+            if (SUCCEEDED(hr)) {
+                std::vector<std::string> instances;
+                for (const WmiMonitorIdentity& identity : *identities) {
+                    instances.push_back(identity.instanceName);
+                }
+                session.noteMonitorInstances(instances);
+            }
+            return hr;
+        };
+    }
 
-        monitors.Set(instance, monitor);
+    Napi::Value resolved(Napi::Env env) override
+    {
+        Napi::Object monitors = Napi::Object::New(env);
+        for (const WmiMonitorIdentity& identity : *identities) {
+            Napi::Object monitor = Napi::Object::New(env);
+            monitor.Set("InstanceName", Napi::String::New(env, identity.instanceName));
+            monitor.Set("MonitorId", Napi::String::New(env, monitorIdFromInstanceName(identity.instanceName)));
+            if (identity.hasUserFriendlyName) {
+                monitor.Set("UserFriendlyName", Napi::String::New(env, identity.userFriendlyName));
+            }
+            if (!identity.manufacturerName.empty()) {
+                monitor.Set("ManufacturerName", Napi::String::New(env, identity.manufacturerName));
+            }
+            if (!identity.productCode.empty()) {
+                monitor.Set("ProductCodeID", Napi::String::New(env, identity.productCode));
+            }
+            if (!identity.serialNumber.empty()) {
+                monitor.Set("SerialNumberID", Napi::String::New(env, identity.serialNumber));
+            }
+            if (identity.yearOfManufacture != 0) {
+                monitor.Set("YearOfManufacture", Napi::Number::New(env, identity.yearOfManufacture));
+            }
+            if (identity.weekOfManufacture != 0) {
+                monitor.Set("WeekOfManufacture", Napi::Number::New(env, identity.weekOfManufacture));
+            }
+            monitors.Set(identity.instanceName, monitor);
+        }
+        return monitors;
     }
 
-    return monitors;
-}
+  private:
+    std::shared_ptr<std::vector<WmiMonitorIdentity>> identities =
+      std::make_shared<std::vector<WmiMonitorIdentity>>();
+};
 
-bool setWMIBrightness(int brightness)
-{
-    if (brightness < 0 || brightness > 100) {
-        return false;
+class SetBrightnessRequest : public WmiRequest {
+  public:
+    SetBrightnessRequest(Napi::Env env,
+                         std::chrono::milliseconds timeout,
+                         const std::string& target,
+                         int brightness)
+      : WmiRequest(env, timeout)
+      , target(target)
+      , brightness(brightness)
+    {
     }
 
-    ComScope com;
-    if (!com.isUsable() || !initializeWmiSecurity()) {
-        return false;
+  protected:
+    WmiTaskFunction task() override
+    {
+        std::string target = this->target;
+        int brightness = this->brightness;
+        return [target, brightness](WmiSession& session, const WmiDeadline& deadline) {
+            return session.invoke(deadline, [&](WmiProvider& provider) {
+                return writeWMIBrightness(provider, deadline, session.brightnessMethods, target, brightness);
+            });
+        };
     }
 
-    ComPtr<IWbemLocator> locator;
-    ComPtr<IWbemServices> service;
-    if (!connectToWmi(locator, service)) {
-        return false;
+    Napi::Value resolved(Napi::Env env) override
+    {
+        return Napi::Boolean::New(env, true);
     }
 
-    HRESULT hr = CoSetProxyBlanket(service.Get(),
-                                   RPC_C_AUTHN_WINNT,
-                                   RPC_C_AUTHZ_NONE,
-                                   NULL,
-                                   RPC_C_AUTHN_LEVEL_CALL,
-                                   RPC_C_IMP_LEVEL_IMPERSONATE,
-                                   NULL,
-                                   EOAC_NONE);
-    if (FAILED(hr)) {
-        return false;
+    Napi::Value failure(Napi::Env env) override
+    {
+        return Napi::Boolean::New(env, false);
     }
 
-    ComPtr<IEnumWbemClassObject> enumerator;
-    hr = service->ExecQuery(L"WQL",
-                            L"SELECT * FROM WmiMonitorBrightnessMethods",
-                            WBEM_FLAG_FORWARD_ONLY | WBEM_FLAG_RETURN_IMMEDIATELY,
-                            NULL,
-                            enumerator.GetAddressOf());
-    if (FAILED(hr) || !enumerator) {
-        return false;
-    }
+  private:
+    std::string target;
+    int brightness;
+};
 
-    ComPtr<IWbemClassObject> methodObject;
-    ULONG returned = 0;
-    hr = enumerator->Next(500, 1, methodObject.GetAddressOf(), &returned);
-    if (FAILED(hr) || returned == 0 || !methodObject) {
-        return false;
+// Brings the subscription in line with whether JS is listening.
+class SyncBrightnessEventsRequest : public WmiRequest {
+  public:
+    using WmiRequest::WmiRequest;
+
+  protected:
+    WmiTaskFunction task() override
+    {
+        return [](WmiSession& session, const WmiDeadline& deadline) {
+            return session.invoke(deadline, [&](WmiProvider&) {
+                return session.syncBrightnessEvents(deadline);
+            });
+        };
     }
 
-    ComPtr<IWbemClassObject> methodClass;
-    hr = service->GetObject(L"WmiMonitorBrightnessMethods",
-                            0,
-                            NULL,
-                            methodClass.GetAddressOf(),
-                            NULL);
-    if (FAILED(hr)) {
-        return false;
+    Napi::Value resolved(Napi::Env env) override
+    {
+        return Napi::Boolean::New(env, true);
     }
 
-    ComPtr<IWbemClassObject> inputDefinition;
-    hr = methodClass->GetMethod(L"WmiSetBrightness",
-                                0,
-                                inputDefinition.GetAddressOf(),
-                                NULL);
-    if (FAILED(hr)) {
-        return false;
+    Napi::Value failure(Napi::Env env) override
+    {
+        return Napi::Boolean::New(env, false);
     }
+};
 
-    ComPtr<IWbemClassObject> inputParameters;
-    hr = inputDefinition->SpawnInstance(0, inputParameters.GetAddressOf());
-    if (FAILED(hr)) {
-        return false;
+void releaseBrightnessListener()
+{
+    // Once this returns, the core won't call the old listener again.
+    setBrightnessListener(nullptr);
+
+    std::lock_guard<std::mutex> lock(brightnessTsfnMutex);
+    if (hasBrightnessTsfn) {
+        brightnessTsfn.Release();
+        hasBrightnessTsfn = false;
     }
+}
 
-    _variant_t timeout;
-    timeout.vt = VT_UI1;
-    timeout.bVal = 0;
-    hr = inputParameters->Put(L"Timeout", 0, &timeout, CIM_UINT32);
-    if (FAILED(hr)) {
-        return false;
+// subscribeBrightnessEvents(callback[, timeoutMs]): calls back with
+// { InstanceName, Brightness } on every change to an internal panel's
+// level. Resolves true once WMI accepted the subscription.
+Napi::Value subscribeBrightnessEvents(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsFunction()) {
+        Napi::Promise::Deferred invalid = Napi::Promise::Deferred::New(env);
+        invalid.Resolve(Napi::Boolean::New(env, false));
+        return invalid.Promise();
     }
 
-    _variant_t brightnessValue;
-    brightnessValue.vt = VT_UI1;
-    brightnessValue.bVal = static_cast<BYTE>(brightness);
-    hr = inputParameters->Put(L"Brightness", 0, &brightnessValue, CIM_UINT8);
-    if (FAILED(hr)) {
+    releaseBrightnessListener();
+    {
+        std::lock_guard<std::mutex> lock(brightnessTsfnMutex);
+        brightnessTsfn = Napi::ThreadSafeFunction::New(
+          env, info[0].As<Napi::Function>(), "wmiBrightnessEvents", 0, 1);
+        // Listening shouldn't keep the process alive by itself.
+        brightnessTsfn.Unref(env);
+        hasBrightnessTsfn = true;
+
+        Napi::ThreadSafeFunction listener = brightnessTsfn;
+        setBrightnessListener([listener](const WmiBrightnessReading& event) {
+            postBrightnessListenerEvent(listener, event);
+        });
+    }
+
+    SyncBrightnessEventsRequest* request = new SyncBrightnessEventsRequest(env, timeoutArgument(info, 1));
+    Napi::Promise promise = request->promise();
+    request->Queue();
+    return promise;
+}
+
+// unsubscribeBrightnessEvents([timeoutMs])
+Napi::Value unsubscribeBrightnessEvents(const Napi::CallbackInfo& info)
+{
+    releaseBrightnessListener();
+
+    SyncBrightnessEventsRequest* request = new SyncBrightnessEventsRequest(info.Env(), timeoutArgument(info, 0));
+    Napi::Promise promise = request->promise();
+    request->Queue();
+    return promise;
+}
+
+bool isBrightnessLevel(const Napi::Value& value)
+{
+    if (!value.IsNumber()) {
         return false;
     }
+    double level = value.As<Napi::Number>().DoubleValue();
+    return std::isfinite(level) && level >= 0 && level <= 100 && std::floor(level) == level;
+}
 
-    _variant_t objectPath;
-    hr = methodObject->Get(L"__PATH", 0, &objectPath, NULL, NULL);
-    if (FAILED(hr) || objectPath.vt != VT_BSTR) {
-        return false;
+Napi::Value queueSetBrightness(Napi::Env env,
+                               const std::string& target,
+                               const Napi::Value& level,
+                               std::chrono::milliseconds timeout)
+{
+    if (!isBrightnessLevel(level)) {
+        Napi::Promise::Deferred invalid = Napi::Promise::Deferred::New(env);
+        invalid.Resolve(Napi::Boolean::New(env, false));
+        return invalid.Promise();
     }
 
-    _bstr_t methodName(L"WmiSetBrightness");
-    hr = service->ExecMethod(objectPath.bstrVal,
-                             methodName,
-                             0,
-                             NULL,
-                             inputParameters.Get(),
-                             NULL,
-                             NULL);
-    return SUCCEEDED(hr);
+    int brightness = static_cast<int>(level.As<Napi::Number>().DoubleValue());
+    SetBrightnessRequest* request = new SetBrightnessRequest(env, timeout, target, brightness);
+    Napi::Promise promise = request->promise();
+    request->Queue();
+    return promise;
+}
+
+// setBrightness(level[, timeoutMs]): sets the first internal panel and
+// resolves true once WMI took the level.
+Napi::Value setBrightness(const Napi::CallbackInfo& info)
+{
+    Napi::Value level = info.Length() > 0 ? info[0] : info.Env().Undefined();
+    return queueSetBrightness(info.Env(), "", level, timeoutArgument(info, 1));
 }
 
-Napi::Boolean setBrightness(const Napi::CallbackInfo& info)
+// setBrightnessFor(instance, level[, timeoutMs]): the same for one panel,
+// named by its InstanceName or MonitorId.
+Napi::Value setBrightnessFor(const Napi::CallbackInfo& info)
 {
     Napi::Env env = info.Env();
-    if (info.Length() < 1 || !info[0].IsNumber()) {
-        return Napi::Boolean::New(env, false);
+    if (info.Length() < 2 || !info[0].IsString() || info[0].As<Napi::String>().Utf8Value().empty()) {
+        Napi::Promise::Deferred invalid = Napi::Promise::Deferred::New(env);
+        invalid.Resolve(Napi::Boolean::New(env, false));
+        return invalid.Promise();
     }
+    return queueSetBrightness(env, info[0].As<Napi::String>().Utf8Value(), info[1], timeoutArgument(info, 2));
+}
 
-    double requestedLevel = info[0].As<Napi::Number>().DoubleValue();
-    if (!std::isfinite(requestedLevel)
-        || requestedLevel < 0
-        || requestedLevel > 100
-        || std::floor(requestedLevel) != requestedLevel) {
-        return Napi::Boolean::New(env, false);
-    }
+// getBrightness([timeoutMs]): the first internal panel's level.
+Napi::Value getBrightness(const Napi::CallbackInfo& info)
+{
+    GetBrightnessRequest* request = new GetBrightnessRequest(info.Env(), timeoutArgument(info, 0));
+    Napi::Promise promise = request->promise();
+    request->Queue();
+    return promise;
+}
 
-    return Napi::Boolean::New(env, setWMIBrightness(static_cast<int>(requestedLevel)));
+// getBrightnessAll([timeoutMs]): every internal panel's level and level
+// table, keyed by instance name.
+Napi::Value getBrightnessAll(const Napi::CallbackInfo& info)
+{
+    GetBrightnessAllRequest* request = new GetBrightnessAllRequest(info.Env(), timeoutArgument(info, 0));
+    Napi::Promise promise = request->promise();
+    request->Queue();
+    return promise;
 }
 
-Napi::Object getBrightness(const Napi::CallbackInfo& info)
+// getMonitors([timeoutMs]): WmiMonitorID, keyed by instance name.
+Napi::Value getMonitors(const Napi::CallbackInfo& info)
 {
-    try {
-        return getWMIBrightness(info);
-    } catch (...) {
-        return makeFailure(info.Env());
-    }
+    GetMonitorsRequest* request = new GetMonitorsRequest(info.Env(), timeoutArgument(info, 0));
+    Napi::Promise promise = request->promise();
+    request->Queue();
+    return promise;
 }
 
-Napi::Object getMonitors(const Napi::CallbackInfo& info)
+Napi::Object getStats(const Napi::CallbackInfo& info)
 {
-    try {
-        return getWMIMonitors(info);
-    } catch (...) {
-        return makeFailure(info.Env());
-    }
+    Napi::Env env = info.Env();
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("connections", Napi::Number::New(env, (double)wmiStats.connections.load()));
+    stats.Set("queries", Napi::Number::New(env, (double)wmiStats.queries.load()));
+    stats.Set("enumerations", Napi::Number::New(env, (double)wmiStats.enumerations.load()));
+    stats.Set("objectLookups", Napi::Number::New(env, (double)wmiStats.objectLookups.load()));
+    stats.Set("propertyReads", Napi::Number::New(env, (double)wmiStats.propertyReads.load()));
+    stats.Set("propertyWrites", Napi::Number::New(env, (double)wmiStats.propertyWrites.load()));
+    stats.Set("methodCalls", Napi::Number::New(env, (double)wmiStats.methodCalls.load()));
+    stats.Set("brightnessWrites", Napi::Number::New(env, (double)wmiStats.brightnessWrites.load()));
+    stats.Set("brightnessMethodResolves",
+              Napi::Number::New(env, (double)wmiStats.brightnessMethodResolves.load()));
+    stats.Set("topologyGeneration", Napi::Number::New(env, (double)wmiStats.topologyGeneration.load()));
+    stats.Set("timeouts", Napi::Number::New(env, (double)wmiStats.timeouts.load()));
+    stats.Set("abandonedWorkers", Napi::Number::New(env, (double)wmiStats.abandonedWorkers.load()));
+    stats.Set("attachFailures", Napi::Number::New(env, (double)wmiStats.attachFailures.load()));
+    return stats;
+}
+
+void cleanupWmiBridge(void* arg)
+{
+    releaseBrightnessListener();
+    stopWmiWorker();
 }
 
 Napi::Object Init(Napi::Env env, Napi::Object exports)
 {
+    // Lets the worker release WMI and COM before the environment goes away,
+    // rather than being torn down mid-call at process exit.
+    napi_add_env_cleanup_hook(env, cleanupWmiBridge, nullptr);
+
     exports.Set(Napi::String::New(env, "setBrightness"),
                 Napi::Function::New(env, setBrightness));
+    exports.Set(Napi::String::New(env, "setBrightnessFor"),
+                Napi::Function::New(env, setBrightnessFor));
     exports.Set(Napi::String::New(env, "getBrightness"),
                 Napi::Function::New(env, getBrightness));
+    exports.Set(Napi::String::New(env, "getBrightnessAll"),
+                Napi::Function::New(env, getBrightnessAll));
     exports.Set(Napi::String::New(env, "getMonitors"),
                 Napi::Function::New(env, getMonitors));
+    exports.Set(Napi::String::New(env, "subscribeBrightnessEvents"),
+                Napi::Function::New(env, subscribeBrightnessEvents));
+    exports.Set(Napi::String::New(env, "unsubscribeBrightnessEvents"),
+                Napi::Function::New(env, unsubscribeBrightnessEvents));
+    exports.Set(Napi::String::New(env, "getStats"),
+                Napi::Function::New(env, getStats));
 
     return exports;
 }
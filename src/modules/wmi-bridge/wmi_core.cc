@@ -0,0 +1,575 @@
+#include "wmi_core.h"
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+
+std::string monitorIdFromInstanceName(const std::string& instanceName)
+{
+    std::string id = instanceName;
+    size_t suffix = id.find_last_of('_');
+    if (suffix != std::string::npos && suffix + 1 < id.size()
+        && id.find_first_not_of("0123456789", suffix + 1) == std::string::npos) {
+        id.erase(suffix);
+    }
+    std::replace(id.begin(), id.end(), '\\', '#');
+    return "\\\\?\\" + id;
+}
+
+bool matchesInstance(const std::string& instanceName, const std::string& target)
+{
+    auto sameText = [](const std::string& a, const std::string& b) {
+        return a.size() == b.size()
+            && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+                   return tolower(static_cast<unsigned char>(x)) == tolower(static_cast<unsigned char>(y));
+               });
+    };
+    return sameText(instanceName, target)
+        || sameText(monitorIdFromInstanceName(instanceName), target);
+}
+
+namespace {
+
+std::mutex brightnessListenerMutex;
+WmiBrightnessListener brightnessListener;
+
+}  // namespace
+
+void setBrightnessListener(WmiBrightnessListener listener)
+{
+    std::lock_guard<std::mutex> lock(brightnessListenerMutex);
+    brightnessListener = listener;
+}
+
+bool brightnessEventsWanted()
+{
+    std::lock_guard<std::mutex> lock(brightnessListenerMutex);
+    return static_cast<bool>(brightnessListener);
+}
+
+void postBrightnessEvent(const WmiBrightnessReading& event)
+{
+    std::lock_guard<std::mutex> lock(brightnessListenerMutex);
+    if (brightnessListener) {
+        brightnessListener(event);
+    }
+}
+
+// Defined once the worker exists. Run when WMI ends a subscription itself.
+void resubscribeBrightnessEvents(uint64_t subscription);
+
+WmiSession::WmiSession(std::unique_ptr<WmiProvider> provider)
+  : wmi(std::move(provider))
+{
+}
+
+HRESULT WmiSession::connect(const WmiDeadline& deadline)
+{
+    wmiStats.connections++;
+    HRESULT hr = wmi->connect(deadline);
+    if (FAILED(hr)) {
+        return hr;
+    }
+    connected = true;
+
+    // A new connection has none of the old one's subscriptions.
+    syncBrightnessEvents(deadline);
+    return S_OK;
+}
+
+void WmiSession::disconnect()
+{
+    brightnessMethods.reset();
+    subscribed = false;
+    wmi->disconnect();
+    connected = false;
+}
+
+HRESULT WmiSession::syncBrightnessEvents(const WmiDeadline& deadline)
+{
+    bool wanted = brightnessEventsWanted();
+    if (wanted == subscribed) {
+        return S_OK;
+    }
+    if (!wanted) {
+        wmi->cancelBrightnessEvents();
+        subscribed = false;
+        return S_OK;
+    }
+
+    uint64_t subscription = ++brightnessEventSubscription;
+    WmiBrightnessEventHandlers handlers;
+    handlers.onEvent = postBrightnessEvent;
+    handlers.onEnded = [subscription]() { resubscribeBrightnessEvents(subscription); };
+    HRESULT hr = wmi->subscribeBrightnessEvents(deadline, handlers);
+    if (FAILED(hr)) {
+        return hr;
+    }
+
+    subscribed = true;
+    return S_OK;
+}
+
+void WmiSession::forgetBrightnessEvents(uint64_t subscription)
+{
+    if (subscription == brightnessEventSubscription && subscribed) {
+        wmi->cancelBrightnessEvents();
+        subscribed = false;
+    }
+}
+
+void WmiSession::noteMonitorInstances(const std::vector<std::string>& instances)
+{
+    if (instances == monitorInstances) {
+        return;
+    }
+    monitorInstances = instances;
+    brightnessMethods.reset();
+    wmiStats.topologyGeneration++;
+}
+
+HRESULT readWMIBrightness(WmiProvider& provider,
+                          const WmiDeadline& deadline,
+                          WmiBrightnessReading& reading)
+{
+    bool found = false;
+    HRESULT hr = provider.enumerateBrightness(deadline, [&](const WmiBrightnessReading& next) {
+        // The public API returns one brightness value. Preserve its existing
+        // first-valid-result behavior rather than relying on WMI enumeration
+        // order to overwrite it with a later entry.
+        reading = next;
+        found = true;
+        return false;
+    });
+    if (FAILED(hr)) {
+        return hr;
+    }
+    return found ? S_OK : S_FALSE;
+}
+
+HRESULT readWMIBrightnessAll(WmiProvider& provider,
+                             const WmiDeadline& deadline,
+                             std::vector<WmiBrightnessReading>& readings)
+{
+    return provider.enumerateBrightness(deadline, [&](const WmiBrightnessReading& next) {
+        readings.push_back(next);
+        return true;
+    });
+}
+
+HRESULT resolveBrightnessMethods(WmiProvider& provider,
+                                 const WmiDeadline& deadline,
+                                 WmiBrightnessMethods& methods)
+{
+    methods.reset();
+    wmiStats.brightnessMethodResolves++;
+
+    std::vector<std::string> instances;
+    HRESULT hr = provider.resolveBrightnessMethods(deadline, instances);
+    if (FAILED(hr)) {
+        return hr;
+    }
+    if (instances.empty()) {
+        return WBEM_E_NOT_FOUND;
+    }
+
+    methods.instances = instances;
+    return S_OK;
+}
+
+// With the method resolved, a write is the provider's single call.
+HRESULT writeWMIBrightness(WmiProvider& provider,
+                           const WmiDeadline& deadline,
+                           WmiBrightnessMethods& methods,
+                           const std::string& target,
+                           int brightness)
+{
+    wmiStats.brightnessWrites++;
+
+    HRESULT hr = S_OK;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (!methods.isResolved()) {
+            hr = resolveBrightnessMethods(provider, deadline, methods);
+            if (FAILED(hr)) {
+                methods.reset();
+                return hr;
+            }
+        }
+
+        size_t instance = 0;
+        if (!target.empty()) {
+            instance = methods.instances.size();
+            for (size_t i = 0; i < methods.instances.size(); i++) {
+                if (matchesInstance(methods.instances[i], target)) {
+                    instance = i;
+                    break;
+                }
+            }
+        }
+        if (instance == methods.instances.size()) {
+            // Possibly a panel that appeared since the methods were resolved.
+            hr = WBEM_E_NOT_FOUND;
+            methods.reset();
+            continue;
+        }
+
+        hr = provider.invokeSetBrightness(deadline, instance, brightness);
+        if (!isStaleMethodPath(hr)) {
+            return hr;
+        }
+        methods.reset();
+    }
+    return hr;
+}
+
+namespace {
+
+struct WmiTask {
+    WmiTask(WmiTaskFunction function, std::chrono::milliseconds timeout, WmiTaskCompletion completion)
+      : function(std::move(function))
+      , deadline(timeout)
+      , completion(std::move(completion))
+    {
+    }
+
+    // Whichever of the worker and the watchdog gets here first reports.
+    // False if the other one already had.
+    bool settle(HRESULT hr)
+    {
+        if (settled.exchange(true)) {
+            return false;
+        }
+        if (completion) {
+            completion(hr);
+        }
+        return true;
+    }
+
+    WmiTaskFunction function;
+    WmiDeadline deadline;
+    WmiTaskCompletion completion;
+    std::atomic<bool> settled{false};
+    // Set by the worker once it is done with the task, however it ended.
+    std::atomic<bool> ended{false};
+};
+
+// One long-lived thread that owns the WMI session. Connecting takes tens of
+// milliseconds, far longer than the queries, so every export hands its work
+// to this thread instead of setting up COM and WMI itself.
+class WmiWorker : public std::enable_shared_from_this<WmiWorker> {
+  public:
+    WmiWorker()
+      : exited(exitedPromise.get_future().share())
+    {
+    }
+
+    // The thread keeps the worker alive, so one that is abandoned mid-call
+    // can still finish and clean up after itself.
+    void start()
+    {
+        std::shared_ptr<WmiWorker> self = shared_from_this();
+        std::thread([self]() { self->loop(); }).detach();
+    }
+
+    void submit(const std::shared_ptr<WmiTask>& task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(task);
+        }
+        wake.notify_one();
+    }
+
+    // Stops taking work and hands back whatever hasn't started, so another
+    // worker can run it.
+    std::deque<std::shared_ptr<WmiTask>> abandon()
+    {
+        std::deque<std::shared_ptr<WmiTask>> pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            pending.swap(queue);
+        }
+        wake.notify_one();
+        return pending;
+    }
+
+    // Finishes what is queued, then releases the session and its provider.
+    // Waits at most timeout for that.
+    void stop(std::chrono::milliseconds timeout)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        exited.wait_for(timeout);
+    }
+
+  private:
+    void loop()
+    {
+        WmiSession session(createWmiProvider());
+        HRESULT attachResult = attach(session);
+
+        while (true) {
+            std::shared_ptr<WmiTask> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+                if (queue.empty()) {
+                    break;
+                }
+                task = queue.front();
+                queue.pop_front();
+            }
+
+            if (FAILED(attachResult) && std::chrono::steady_clock::now() >= nextAttach) {
+                attachResult = attach(session);
+            }
+
+            HRESULT hr = attachResult;
+            if (task->deadline.expired()) {
+                hr = WBEM_E_CALL_CANCELLED;
+            } else if (SUCCEEDED(attachResult)) {
+                try {
+                    hr = task->function(session, task->deadline);
+                } catch (...) {
+                    hr = E_FAIL;
+                }
+            }
+            task->ended = true;
+            task->settle(hr);
+        }
+
+        session.disconnect();
+        session.provider().detachThread();
+        exitedPromise.set_value();
+    }
+
+    // Sets up the thread for the provider. A failure, such as COM security
+    // not being ready yet early in a session, is retried on a later task
+    // once a backoff has passed. Until then tasks fail straight away with
+    // the attach's result instead of waiting on it again.
+    HRESULT attach(WmiSession& session)
+    {
+        HRESULT hr = session.provider().attachThread();
+        if (SUCCEEDED(hr)) {
+            attachBackoff = kWmiAttachRetryMin;
+            return hr;
+        }
+
+        wmiStats.attachFailures++;
+        nextAttach = std::chrono::steady_clock::now() + attachBackoff;
+        attachBackoff = std::min(attachBackoff * 2, kWmiAttachRetryMax);
+        return hr;
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::shared_ptr<WmiTask>> queue;
+    bool stopping = false;
+    std::promise<void> exitedPromise;
+    std::shared_future<void> exited;
+    // Only used on the worker thread.
+    std::chrono::milliseconds attachBackoff = kWmiAttachRetryMin;
+    std::chrono::steady_clock::time_point nextAttach;
+};
+
+std::mutex wmiWorkerMutex;
+std::shared_ptr<WmiWorker> wmiWorker;
+
+std::shared_ptr<WmiWorker> currentWmiWorker()
+{
+    std::lock_guard<std::mutex> lock(wmiWorkerMutex);
+    if (!wmiWorker) {
+        wmiWorker = std::make_shared<WmiWorker>();
+        wmiWorker->start();
+    }
+    return wmiWorker;
+}
+
+// Replaces a worker that is stuck in a call it can't be pulled out of, such
+// as a connect to a winmgmt that has hung. The queued tasks move to the new
+// worker. The stuck one exits whenever its call returns.
+void replaceWmiWorker(const std::shared_ptr<WmiWorker>& stuck)
+{
+    std::lock_guard<std::mutex> lock(wmiWorkerMutex);
+    if (wmiWorker != stuck) {
+        return;
+    }
+
+    wmiWorker = std::make_shared<WmiWorker>();
+    wmiWorker->start();
+    for (const std::shared_ptr<WmiTask>& task : stuck->abandon()) {
+        wmiWorker->submit(task);
+    }
+    wmiStats.abandonedWorkers++;
+}
+
+// Times out started tasks, so nobody has to block waiting on one. At a
+// task's deadline it reports the timeout and cancels the call; if the
+// worker still hasn't let go of the task once kWmiCancelGrace has passed,
+// the worker is replaced. One thread watches every task and exits when
+// there are none.
+class WmiWatchdog {
+  public:
+    void watch(const std::shared_ptr<WmiTask>& task, const std::shared_ptr<WmiWorker>& worker)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.push_back({ task, worker, task->deadline.expiry(), false });
+        if (!running) {
+            running = true;
+            std::thread([this]() { loop(); }).detach();
+        }
+        wake.notify_one();
+    }
+
+    // Reports every task still waiting as timed out and waits for the
+    // thread to end.
+    void stop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+        wake.notify_all();
+        wake.wait(lock, [this]() { return !running; });
+        stopping = false;
+    }
+
+  private:
+    struct Entry {
+        std::shared_ptr<WmiTask> task;
+        std::shared_ptr<WmiWorker> worker;
+        std::chrono::steady_clock::time_point due;
+        bool cancelled;
+    };
+
+    void loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            auto now = std::chrono::steady_clock::now();
+            auto next = std::chrono::steady_clock::time_point::max();
+            std::vector<std::shared_ptr<WmiTask>> timedOut;
+            std::vector<std::shared_ptr<WmiWorker>> stuck;
+
+            for (auto it = entries.begin(); it != entries.end();) {
+                if (it->task->ended || (it->cancelled && it->due <= now)) {
+                    if (!it->task->ended) {
+                        stuck.push_back(it->worker);
+                    }
+                    it = entries.erase(it);
+                    continue;
+                }
+                if (!it->cancelled && it->due <= now) {
+                    it->task->deadline.cancel();
+                    it->cancelled = true;
+                    it->due = now + kWmiCancelGrace;
+                    timedOut.push_back(it->task);
+                }
+                next = std::min(next, it->due);
+                it++;
+            }
+
+            if (!timedOut.empty() || !stuck.empty()) {
+                // Completions and replacements take other locks.
+                lock.unlock();
+                for (const std::shared_ptr<WmiTask>& task : timedOut) {
+                    if (task->settle(WBEM_E_CALL_CANCELLED)) {
+                        wmiStats.timeouts++;
+                    }
+                }
+                for (const std::shared_ptr<WmiWorker>& worker : stuck) {
+                    replaceWmiWorker(worker);
+                }
+                lock.lock();
+                continue;
+            }
+
+            if (entries.empty()) {
+                running = false;
+                wake.notify_all();
+                return;
+            }
+            // Tasks that end early are only dropped at their next due time.
+            wake.wait_until(lock, next);
+        }
+
+        std::vector<Entry> remaining;
+        remaining.swap(entries);
+        lock.unlock();
+        for (Entry& entry : remaining) {
+            entry.task->settle(WBEM_E_CALL_CANCELLED);
+        }
+        lock.lock();
+        running = false;
+        wake.notify_all();
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<Entry> entries;
+    bool running = false;
+    bool stopping = false;
+};
+
+// Never destroyed, since its detached thread may outlive static teardown.
+WmiWatchdog& wmiWatchdog = *new WmiWatchdog();
+
+}  // namespace
+
+void startWmiTask(WmiTaskFunction function,
+                  std::chrono::milliseconds timeout,
+                  WmiTaskCompletion completion)
+{
+    std::shared_ptr<WmiTask> task =
+      std::make_shared<WmiTask>(std::move(function), timeout, std::move(completion));
+    std::shared_ptr<WmiWorker> worker = currentWmiWorker();
+    wmiWatchdog.watch(task, worker);
+    worker->submit(task);
+}
+
+HRESULT runWmiTask(WmiTaskFunction function, std::chrono::milliseconds timeout)
+{
+    std::shared_ptr<std::promise<HRESULT>> done = std::make_shared<std::promise<HRESULT>>();
+    std::future<HRESULT> finished = done->get_future();
+    startWmiTask(std::move(function), timeout, [done](HRESULT hr) { done->set_value(hr); });
+    return finished.get();
+}
+
+void postWmiTask(WmiTaskFunction function, std::chrono::milliseconds timeout)
+{
+    currentWmiWorker()->submit(std::make_shared<WmiTask>(std::move(function), timeout, nullptr));
+}
+
+void resubscribeBrightnessEvents(uint64_t subscription)
+{
+    // Also keeps a subscription ended by shutdown from starting a worker.
+    if (!brightnessEventsWanted()) {
+        return;
+    }
+
+    postWmiTask([subscription](WmiSession& session, const WmiDeadline& deadline) {
+        session.forgetBrightnessEvents(subscription);
+        return session.invoke(deadline, [&](WmiProvider&) {
+            return session.syncBrightnessEvents(deadline);
+        });
+    }, kWmiDefaultTimeout);
+}
+
+void stopWmiWorker()
+{
+    std::shared_ptr<WmiWorker> worker;
+    {
+        std::lock_guard<std::mutex> lock(wmiWorkerMutex);
+        worker.swap(wmiWorker);
+    }
+    if (worker) {
+        worker->stop(kWmiStopTimeout);
+    }
+    wmiWatchdog.stop();
+}
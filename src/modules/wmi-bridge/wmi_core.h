@@ -0,0 +1,157 @@
+#ifndef WMI_BRIDGE_CORE_H
+#define WMI_BRIDGE_CORE_H
+
+// The worker thread, session and brightness logic behind the exports,
+// independent of Node. Everything here reaches WMI through a WmiProvider,
+// so it builds and runs against the simulator on any platform.
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "wmi_provider.h"
+
+// Turns a WMI instance name, "DISPLAY\BOE0812\4&2a1b&0&UID8388688_0", into
+// the "\\?\DISPLAY#BOE0812#4&2a1b&0&UID8388688" form that node-ddcci and
+// win32-displayconfig device paths start with.
+std::string monitorIdFromInstanceName(const std::string& instanceName);
+
+// Whether target names this instance, either by its WMI instance name or by
+// its monitor id. Windows isn't consistent about case in either.
+bool matchesInstance(const std::string& instanceName, const std::string& target);
+
+// Where brightness events go while someone is listening for them. Called
+// from whichever thread the provider delivers on. An empty listener stops
+// them; once that returns, the old listener isn't running and won't be.
+typedef std::function<void(const WmiBrightnessReading&)> WmiBrightnessListener;
+void setBrightnessListener(WmiBrightnessListener listener);
+bool brightnessEventsWanted();
+void postBrightnessEvent(const WmiBrightnessReading& event);
+
+// The WmiMonitorBrightnessMethods instances the provider resolved
+// WmiSetBrightness for, in the order it indexes them.
+struct WmiBrightnessMethods {
+    std::vector<std::string> instances;
+
+    bool isResolved() const
+    {
+        return !instances.empty();
+    }
+
+    void reset()
+    {
+        instances.clear();
+    }
+};
+
+// A connection to ROOT\WMI through the worker's provider. It belongs to the
+// worker thread and is only used there.
+class WmiSession {
+  public:
+    explicit WmiSession(std::unique_ptr<WmiProvider> provider);
+
+    WmiProvider& provider()
+    {
+        return *wmi;
+    }
+
+    HRESULT connect(const WmiDeadline& deadline);
+    void disconnect();
+
+    // Subscribes to or cancels brightness events, to match whether anyone is
+    // listening for them.
+    HRESULT syncBrightnessEvents(const WmiDeadline& deadline);
+    // Forgets a subscription WMI has already ended, unless a newer one has
+    // replaced it since.
+    void forgetBrightnessEvents(uint64_t subscription);
+
+    // Starts a new topology generation when the set of monitors WMI reports
+    // has changed, which makes the next write resolve its method again.
+    void noteMonitorInstances(const std::vector<std::string>& instances);
+
+    // Resolved on the first write of a generation and reused until the
+    // monitors or the connection change.
+    WmiBrightnessMethods brightnessMethods;
+
+    // Runs call against the connected provider. If the connection turns out
+    // to have dropped, reconnects and runs it once more.
+    template <typename Call>
+    HRESULT invoke(const WmiDeadline& deadline, Call call)
+    {
+        HRESULT hr = S_OK;
+        for (int attempt = 0; attempt < 2; attempt++) {
+            if (deadline.expired()) {
+                return WBEM_E_CALL_CANCELLED;
+            }
+            if (!connected) {
+                hr = connect(deadline);
+                if (FAILED(hr)) {
+                    return hr;
+                }
+            }
+
+            hr = call(*wmi);
+            if (!isDisconnectError(hr)) {
+                return hr;
+            }
+            disconnect();
+        }
+        return hr;
+    }
+
+  private:
+    std::unique_ptr<WmiProvider> wmi;
+    bool connected = false;
+    std::vector<std::string> monitorInstances;
+    bool subscribed = false;
+    uint64_t brightnessEventSubscription = 0;
+};
+
+// S_FALSE when no instance reports a usable brightness.
+HRESULT readWMIBrightness(WmiProvider& provider,
+                          const WmiDeadline& deadline,
+                          WmiBrightnessReading& reading);
+HRESULT readWMIBrightnessAll(WmiProvider& provider,
+                             const WmiDeadline& deadline,
+                             std::vector<WmiBrightnessReading>& readings);
+// Writes to the instance named by target, or to the first one if target
+// is empty. Resolves the method first if methods doesn't have it.
+HRESULT writeWMIBrightness(WmiProvider& provider,
+                           const WmiDeadline& deadline,
+                           WmiBrightnessMethods& methods,
+                           const std::string& target,
+                           int brightness);
+
+typedef std::function<HRESULT(WmiSession&, const WmiDeadline&)> WmiTaskFunction;
+// Told how a task ended, exactly once, on the WMI thread or the watchdog.
+typedef std::function<void(HRESULT)> WmiTaskCompletion;
+
+// Matches the guards Monitors.js used to put around the synchronous calls.
+const std::chrono::milliseconds kWmiDefaultTimeout(4000);
+// How long a cancelled call gets to notice and unwind before its worker is
+// given up on.
+const std::chrono::milliseconds kWmiCancelGrace(250);
+const std::chrono::milliseconds kWmiStopTimeout(1000);
+// A worker whose thread setup failed tries again after this, doubling the
+// wait after each failure up to the maximum.
+const std::chrono::milliseconds kWmiAttachRetryMin(250);
+const std::chrono::milliseconds kWmiAttachRetryMax(10000);
+
+// Queues function on the WMI thread and calls completion with its result,
+// or with WBEM_E_CALL_CANCELLED once timeout passes, without a thread of
+// the caller's waiting on either.
+void startWmiTask(WmiTaskFunction function,
+                  std::chrono::milliseconds timeout,
+                  WmiTaskCompletion completion);
+// Like startWmiTask, but waits for the result.
+HRESULT runWmiTask(WmiTaskFunction function, std::chrono::milliseconds timeout);
+// Queues function without waiting for it.
+void postWmiTask(WmiTaskFunction function, std::chrono::milliseconds timeout);
+// Finishes what is queued, then releases the session and its provider.
+// The next task starts a new worker.
+void stopWmiWorker();
+
+#endif
@@ -0,0 +1,805 @@
+#ifdef _WIN32
+#define _WIN32_DCOM
+#endif
+
+#include "wmi_provider.h"
+
+#include <mutex>
+
+#ifdef _WIN32
+#include <comdef.h>
+#include <wrl/client.h>
+#include "oaidl.h"
+#include "oleauto.h"
+
+using Microsoft::WRL::ComPtr;
+
+#pragma comment(lib, "wbemuuid.lib")
+#endif
+
+WmiCallStats wmiStats;
+
+bool isDisconnectError(HRESULT hr)
+{
+    return hr == WBEM_E_TRANSPORT_FAILURE
+        || hr == WBEM_E_SHUTTING_DOWN
+        || hr == RPC_E_DISCONNECTED
+        || hr == RPC_E_SERVER_DIED
+        || hr == RPC_E_SERVER_DIED_DNE
+        || hr == HRESULT_FROM_WIN32(RPC_S_SERVER_UNAVAILABLE)
+        || hr == HRESULT_FROM_WIN32(RPC_S_CALL_FAILED);
+}
+
+bool isStaleMethodPath(HRESULT hr)
+{
+    return hr == WBEM_E_NOT_FOUND
+        || hr == WBEM_E_INVALID_OBJECT_PATH
+        || hr == WBEM_E_INVALID_OBJECT;
+}
+
+namespace {
+
+#ifdef _WIN32
+std::mutex securityInitializationMutex;
+
+bool initializeWmiSecurity()
+{
+    // Security is process-wide. The worker sets it up once per COM lifetime
+    // on its thread, which only ends when the worker is stopped.
+    std::lock_guard<std::mutex> lock(securityInitializationMutex);
+    HRESULT securityResult = CoInitializeSecurity(NULL,
+                                                   -1,
+                                                   NULL,
+                                                   NULL,
+                                                   RPC_C_AUTHN_LEVEL_CONNECT,
+                                                   RPC_C_IMP_LEVEL_IMPERSONATE,
+                                                   NULL,
+                                                   EOAC_NONE,
+                                                   0);
+
+    // Another component may have configured process-wide COM security
+    // before the addon is loaded. That configuration is usable here.
+    if (securityResult == RPC_E_TOO_LATE) {
+        securityResult = S_OK;
+    }
+
+    return SUCCEEDED(securityResult);
+}
+
+std::string wide_to_utf8(const wchar_t* text, int length)
+{
+    if (text == NULL || length <= 0) {
+        return "";
+    }
+
+    int len = ::WideCharToMultiByte(CP_UTF8, 0, text, length, NULL, 0, NULL, NULL);
+    if (len <= 0) {
+        return "";
+    }
+
+    std::string result(len, '\0');
+    if (::WideCharToMultiByte(CP_UTF8, 0, text, length, &result[0], len, NULL, NULL) == 0) {
+        return "";
+    }
+    return result;
+}
+
+std::string bstr_to_str(BSTR bstr)
+{
+    if (bstr == NULL) {
+        return "";
+    }
+    return wide_to_utf8(bstr, static_cast<int>(::SysStringLen(bstr)));
+}
+
+// Copies a one-dimensional integer SAFEARRAY out in one pass. WMI marshals
+// uint16 arrays as VT_I4 and uint8 arrays as VT_UI1, so the element type is
+// taken from the variant rather than assumed.
+std::vector<long> getWMIClassIntegerArray(const VARIANT& value)
+{
+    std::vector<long> output;
+    if (!(value.vt & VT_ARRAY) || value.parray == NULL || SafeArrayGetDim(value.parray) != 1) {
+        return output;
+    }
+
+    long lower = 0;
+    long upper = -1;
+    if (FAILED(SafeArrayGetLBound(value.parray, 1, &lower))
+        || FAILED(SafeArrayGetUBound(value.parray, 1, &upper))
+        || upper < lower) {
+        return output;
+    }
+    size_t count = static_cast<size_t>(upper - lower) + 1;
+
+    void* data = NULL;
+    if (FAILED(SafeArrayAccessData(value.parray, &data))) {
+        return output;
+    }
+
+    output.reserve(count);
+    switch (value.vt & VT_TYPEMASK) {
+    case VT_UI1:
+        output.assign(static_cast<BYTE*>(data), static_cast<BYTE*>(data) + count);
+        break;
+    case VT_I2:
+        output.assign(static_cast<SHORT*>(data), static_cast<SHORT*>(data) + count);
+        break;
+    case VT_UI2:
+        output.assign(static_cast<USHORT*>(data), static_cast<USHORT*>(data) + count);
+        break;
+    case VT_I4:
+        output.assign(static_cast<LONG*>(data), static_cast<LONG*>(data) + count);
+        break;
+    case VT_UI4:
+        output.assign(static_cast<ULONG*>(data), static_cast<ULONG*>(data) + count);
+        break;
+    }
+
+    SafeArrayUnaccessData(value.parray);
+    return output;
+}
+
+// Used to read WMIMonitorID's string properties, which are arrays of UTF-16
+// code units padded with zeros.
+std::string getWMIClassUINTString(HRESULT hr, VARIANT& value)
+{
+    std::wstring text;
+    if (SUCCEEDED(hr)) {
+        std::vector<long> units = getWMIClassIntegerArray(value);
+        text.reserve(units.size());
+        for (long unit : units) {
+            if (unit == 0) {
+                break;
+            }
+            text.push_back(static_cast<wchar_t>(unit));
+        }
+    }
+
+    VariantClear(&value);
+    return wide_to_utf8(text.c_str(), static_cast<int>(text.size()));
+}
+
+std::string readWMIClassUINTString(IWbemClassObject* clsObj, const wchar_t* name)
+{
+    VARIANT value;
+    VariantInit(&value);
+    wmiStats.propertyReads++;
+    HRESULT hr = clsObj->Get(name, 0, &value, NULL, NULL);
+    return getWMIClassUINTString(hr, value);
+}
+
+// 0 when the property is missing or null.
+int readWMIClassInteger(IWbemClassObject* clsObj, const wchar_t* name)
+{
+    VARIANT value;
+    VariantInit(&value);
+    wmiStats.propertyReads++;
+    int result = 0;
+    if (SUCCEEDED(clsObj->Get(name, 0, &value, NULL, NULL))
+        && value.vt != VT_NULL
+        && SUCCEEDED(VariantChangeType(&value, &value, 0, VT_I4))) {
+        result = value.lVal;
+    }
+    VariantClear(&value);
+    return result;
+}
+
+// Next() on a semisynchronous enumerator, in slices, so a provider that
+// stops answering is given up on at the deadline. S_FALSE at the end.
+HRESULT nextWithin(IEnumWbemClassObject* enumerator,
+                   const WmiDeadline& deadline,
+                   ComPtr<IWbemClassObject>& object)
+{
+    wmiStats.enumerations++;
+    while (true) {
+        if (deadline.expired()) {
+            return WBEM_E_CALL_CANCELLED;
+        }
+
+        ULONG returned = 0;
+        HRESULT hr = enumerator->Next(deadline.slice(), 1, object.ReleaseAndGetAddressOf(), &returned);
+        if (hr == WBEM_S_TIMEDOUT) {
+            continue;
+        }
+        if (FAILED(hr)) {
+            return hr;
+        }
+        return (returned == 0 || !object) ? S_FALSE : S_OK;
+    }
+}
+
+// Waits on a semisynchronous call the same way. Returns the call's result.
+HRESULT waitWithin(IWbemCallResult* callResult, const WmiDeadline& deadline)
+{
+    while (true) {
+        if (deadline.expired()) {
+            return WBEM_E_CALL_CANCELLED;
+        }
+
+        LONG status = WBEM_S_NO_ERROR;
+        HRESULT hr = callResult->GetCallStatus(deadline.slice(), &status);
+        if (hr == WBEM_S_TIMEDOUT) {
+            continue;
+        }
+        if (FAILED(hr)) {
+            return hr;
+        }
+        return status;
+    }
+}
+
+// Fills reading from one WmiMonitorBrightness object. False if it has no
+// usable instance name or level.
+bool readBrightnessObject(IWbemClassObject* clsObj, WmiBrightnessReading& reading)
+{
+    VARIANT instanceName;
+    VariantInit(&instanceName);
+    wmiStats.propertyReads++;
+    HRESULT instanceResult = clsObj->Get(L"InstanceName", 0, &instanceName, NULL, NULL);
+    if (FAILED(instanceResult) || instanceName.vt != VT_BSTR) {
+        VariantClear(&instanceName);
+        return false;
+    }
+
+    std::string instance = bstr_to_str(instanceName.bstrVal);
+    VariantClear(&instanceName);
+
+    VARIANT brightnessValue;
+    VariantInit(&brightnessValue);
+    wmiStats.propertyReads++;
+    HRESULT brightnessResult = clsObj->Get(
+      L"CurrentBrightness", 0, &brightnessValue, NULL, NULL);
+    if (FAILED(brightnessResult)) {
+        VariantClear(&brightnessValue);
+        return false;
+    }
+
+    VARIANT brightnessAsInt;
+    VariantInit(&brightnessAsInt);
+    HRESULT conversionResult = VariantChangeType(
+      &brightnessAsInt, &brightnessValue, 0, VT_I4);
+    VariantClear(&brightnessValue);
+    if (FAILED(conversionResult)) {
+        VariantClear(&brightnessAsInt);
+        return false;
+    }
+
+    reading.instanceName = instance;
+    reading.brightness = brightnessAsInt.lVal;
+    VariantClear(&brightnessAsInt);
+
+    VARIANT active;
+    VariantInit(&active);
+    wmiStats.propertyReads++;
+    if (SUCCEEDED(clsObj->Get(L"Active", 0, &active, NULL, NULL)) && active.vt == VT_BOOL) {
+        reading.active = active.boolVal != VARIANT_FALSE;
+    }
+    VariantClear(&active);
+
+    VARIANT levels;
+    VariantInit(&levels);
+    wmiStats.propertyReads++;
+    if (SUCCEEDED(clsObj->Get(L"Level", 0, &levels, NULL, NULL))) {
+        std::vector<long> table = getWMIClassIntegerArray(levels);
+        reading.levels.assign(table.begin(), table.end());
+    }
+    VariantClear(&levels);
+    return true;
+}
+
+// Receives WmiMonitorBrightnessEvent, which the panel's driver raises for
+// every level change, whether it came from keys, battery saver or adaptive
+// brightness.
+class BrightnessEventSink final : public IWbemObjectSink {
+  public:
+    explicit BrightnessEventSink(const WmiBrightnessEventHandlers& handlers)
+      : handlers(handlers)
+    {
+    }
+
+    ULONG STDMETHODCALLTYPE AddRef() override
+    {
+        return ++references;
+    }
+
+    ULONG STDMETHODCALLTYPE Release() override
+    {
+        ULONG left = --references;
+        if (left == 0) {
+            delete this;
+        }
+        return left;
+    }
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+    {
+        if (riid == IID_IUnknown || riid == IID_IWbemObjectSink) {
+            *object = static_cast<IWbemObjectSink*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *object = NULL;
+        return E_NOINTERFACE;
+    }
+
+    HRESULT STDMETHODCALLTYPE Indicate(LONG count, IWbemClassObject** events) override
+    {
+        for (LONG i = 0; i < count; i++) {
+            _variant_t instanceName;
+            _variant_t brightness;
+            if (FAILED(events[i]->Get(L"InstanceName", 0, &instanceName, NULL, NULL))
+                || instanceName.vt != VT_BSTR
+                || FAILED(events[i]->Get(L"Brightness", 0, &brightness, NULL, NULL))) {
+                continue;
+            }
+
+            _variant_t brightnessAsInt;
+            if (FAILED(VariantChangeType(&brightnessAsInt, &brightness, 0, VT_I4))) {
+                continue;
+            }
+
+            WmiBrightnessReading event;
+            event.instanceName = bstr_to_str(instanceName.bstrVal);
+            event.brightness = brightnessAsInt.lVal;
+            handlers.onEvent(event);
+        }
+        return WBEM_S_NO_ERROR;
+    }
+
+    HRESULT STDMETHODCALLTYPE SetStatus(LONG flags,
+                                        HRESULT result,
+                                        BSTR message,
+                                        IWbemClassObject* status) override
+    {
+        // A subscription only completes when it is cancelled, or when WMI
+        // drops it, as it does when winmgmt restarts.
+        if (flags == WBEM_STATUS_COMPLETE && result != WBEM_E_CALL_CANCELLED) {
+            handlers.onEnded();
+        }
+        return WBEM_S_NO_ERROR;
+    }
+
+  private:
+    std::atomic<ULONG> references{1};
+    WmiBrightnessEventHandlers handlers;
+};
+
+// A connection to ROOT\WMI through winmgmt.
+class WmiSystemProvider : public WmiProvider {
+  public:
+    HRESULT attachThread() override
+    {
+        // The thread is new, so COM can't have been set up as STA on it. A
+        // retry after security setup failed keeps the apartment it has.
+        if (!comInitialized) {
+            HRESULT comResult = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+            if (FAILED(comResult)) {
+                return comResult;
+            }
+            comInitialized = true;
+        }
+        return initializeWmiSecurity() ? S_OK : E_FAIL;
+    }
+
+    void detachThread() override
+    {
+        if (comInitialized) {
+            CoUninitialize();
+            comInitialized = false;
+        }
+    }
+
+    HRESULT connect(const WmiDeadline& deadline) override
+    {
+        ComPtr<IWbemLocator> locator;
+        HRESULT hr = CoCreateInstance(CLSID_WbemLocator,
+                                      NULL,
+                                      CLSCTX_ALL,
+                                      IID_PPV_ARGS(locator.GetAddressOf()));
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        ComPtr<IWbemServices> connected;
+        _bstr_t namespacePath(L"ROOT\\WMI");
+        hr = locator->ConnectServer(namespacePath,
+                                    NULL,
+                                    NULL,
+                                    NULL,
+                                    WBEM_FLAG_CONNECT_USE_MAX_WAIT,
+                                    NULL,
+                                    NULL,
+                                    connected.GetAddressOf());
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        hr = CoSetProxyBlanket(connected.Get(),
+                               RPC_C_AUTHN_WINNT,
+                               RPC_C_AUTHZ_NONE,
+                               NULL,
+                               RPC_C_AUTHN_LEVEL_CALL,
+                               RPC_C_IMP_LEVEL_IMPERSONATE,
+                               NULL,
+                               EOAC_NONE);
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        service = connected;
+        return S_OK;
+    }
+
+    void disconnect() override
+    {
+        inputParameters.Reset();
+        methodPaths.clear();
+        cancelBrightnessEvents();
+        service.Reset();
+    }
+
+    HRESULT enumerateBrightness(const WmiDeadline& deadline, const WmiBrightnessCallback& onReading) override
+    {
+        ComPtr<IEnumWbemClassObject> enumerator;
+        wmiStats.queries++;
+        HRESULT hr = service->ExecQuery(L"WQL",
+                                        L"SELECT InstanceName, CurrentBrightness, Active, Level FROM WmiMonitorBrightness",
+                                        WBEM_FLAG_FORWARD_ONLY | WBEM_FLAG_RETURN_IMMEDIATELY,
+                                        NULL,
+                                        enumerator.GetAddressOf());
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        while (true) {
+            ComPtr<IWbemClassObject> clsObj;
+            hr = nextWithin(enumerator.Get(), deadline, clsObj);
+            if (FAILED(hr)) {
+                return hr;
+            }
+            if (hr == S_FALSE) {
+                return S_OK;
+            }
+
+            WmiBrightnessReading reading;
+            if (readBrightnessObject(clsObj.Get(), reading) && !onReading(reading)) {
+                return S_OK;
+            }
+        }
+    }
+
+    HRESULT enumerateMonitors(const WmiDeadline& deadline, std::vector<WmiMonitorIdentity>& monitors) override
+    {
+        ComPtr<IEnumWbemClassObject> enumerator;
+        wmiStats.queries++;
+        HRESULT hr = service->ExecQuery(L"WQL",
+                                        L"SELECT InstanceName, UserFriendlyName, ManufacturerName, ProductCodeID, "
+                                        L"SerialNumberID, YearOfManufacture, WeekOfManufacture FROM WmiMonitorID",
+                                        WBEM_FLAG_FORWARD_ONLY | WBEM_FLAG_RETURN_IMMEDIATELY,
+                                        NULL,
+                                        enumerator.GetAddressOf());
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        while (true) {
+            ComPtr<IWbemClassObject> clsObj;
+            hr = nextWithin(enumerator.Get(), deadline, clsObj);
+            if (hr == WBEM_E_CALL_CANCELLED || isDisconnectError(hr)) {
+                return hr;
+            }
+            // Any other failure ends the list with what was read so far.
+            if (FAILED(hr) || hr == S_FALSE) {
+                break;
+            }
+
+            VARIANT instanceName;
+            VariantInit(&instanceName);
+            wmiStats.propertyReads++;
+            HRESULT instanceResult = clsObj->Get(L"InstanceName", 0, &instanceName, NULL, NULL);
+            if (FAILED(instanceResult) || instanceName.vt != VT_BSTR) {
+                VariantClear(&instanceName);
+                continue;
+            }
+
+            WmiMonitorIdentity monitor;
+            monitor.instanceName = bstr_to_str(instanceName.bstrVal);
+            VariantClear(&instanceName);
+            if (monitor.instanceName.empty()) {
+                continue;
+            }
+
+            VARIANT friendlyName;
+            VariantInit(&friendlyName);
+            wmiStats.propertyReads++;
+            HRESULT friendlyNameResult = clsObj->Get(
+              L"UserFriendlyName", 0, &friendlyName, NULL, NULL);
+            if (SUCCEEDED(friendlyNameResult)) {
+                monitor.hasUserFriendlyName = true;
+                monitor.userFriendlyName = getWMIClassUINTString(friendlyNameResult, friendlyName);
+            } else {
+                VariantClear(&friendlyName);
+            }
+
+            monitor.manufacturerName = readWMIClassUINTString(clsObj.Get(), L"ManufacturerName");
+            monitor.productCode = readWMIClassUINTString(clsObj.Get(), L"ProductCodeID");
+            monitor.serialNumber = readWMIClassUINTString(clsObj.Get(), L"SerialNumberID");
+            monitor.yearOfManufacture = readWMIClassInteger(clsObj.Get(), L"YearOfManufacture");
+            monitor.weekOfManufacture = readWMIClassInteger(clsObj.Get(), L"WeekOfManufacture");
+
+            monitors.push_back(monitor);
+        }
+
+        return S_OK;
+    }
+
+    // Costs a query, an enumeration step per instance, three object lookups
+    // and a property write, which is why writes keep the result.
+    HRESULT resolveBrightnessMethods(const WmiDeadline& deadline, std::vector<std::string>& instances) override
+    {
+        inputParameters.Reset();
+        methodPaths.clear();
+
+        ComPtr<IEnumWbemClassObject> enumerator;
+        wmiStats.queries++;
+        HRESULT hr = service->ExecQuery(L"WQL",
+                                        L"SELECT InstanceName FROM WmiMonitorBrightnessMethods",
+                                        WBEM_FLAG_FORWARD_ONLY | WBEM_FLAG_RETURN_IMMEDIATELY,
+                                        NULL,
+                                        enumerator.GetAddressOf());
+        if (FAILED(hr)) {
+            return hr;
+        }
+        if (!enumerator) {
+            return E_FAIL;
+        }
+
+        std::vector<_bstr_t> paths;
+        std::vector<std::string> names;
+        while (true) {
+            ComPtr<IWbemClassObject> methodObject;
+            hr = nextWithin(enumerator.Get(), deadline, methodObject);
+            if (FAILED(hr)) {
+                return hr;
+            }
+            if (hr == S_FALSE) {
+                break;
+            }
+
+            _variant_t objectPath;
+            wmiStats.propertyReads++;
+            hr = methodObject->Get(L"__PATH", 0, &objectPath, NULL, NULL);
+            if (FAILED(hr) || objectPath.vt != VT_BSTR) {
+                continue;
+            }
+
+            _variant_t instanceName;
+            wmiStats.propertyReads++;
+            hr = methodObject->Get(L"InstanceName", 0, &instanceName, NULL, NULL);
+
+            paths.push_back(objectPath.bstrVal);
+            names.push_back(SUCCEEDED(hr) && instanceName.vt == VT_BSTR ? bstr_to_str(instanceName.bstrVal) : "");
+        }
+        if (paths.empty()) {
+            return WBEM_E_NOT_FOUND;
+        }
+
+        ComPtr<IWbemCallResult> classCall;
+        wmiStats.objectLookups++;
+        hr = service->GetObject(_bstr_t(L"WmiMonitorBrightnessMethods"),
+                                WBEM_FLAG_RETURN_IMMEDIATELY,
+                                NULL,
+                                NULL,
+                                classCall.GetAddressOf());
+        if (FAILED(hr)) {
+            return hr;
+        }
+        hr = waitWithin(classCall.Get(), deadline);
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        ComPtr<IWbemClassObject> methodClass;
+        hr = classCall->GetResultObject(0, methodClass.GetAddressOf());
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        ComPtr<IWbemClassObject> inputDefinition;
+        wmiStats.objectLookups++;
+        hr = methodClass->GetMethod(L"WmiSetBrightness",
+                                    0,
+                                    inputDefinition.GetAddressOf(),
+                                    NULL);
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        ComPtr<IWbemClassObject> spawned;
+        wmiStats.objectLookups++;
+        hr = inputDefinition->SpawnInstance(0, spawned.GetAddressOf());
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        _variant_t timeout;
+        timeout.vt = VT_UI1;
+        timeout.bVal = 0;
+        wmiStats.propertyWrites++;
+        hr = spawned->Put(L"Timeout", 0, &timeout, CIM_UINT32);
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        inputParameters = spawned;
+        methodPaths = paths;
+        instances = names;
+        return S_OK;
+    }
+
+    // One property write and one method call.
+    HRESULT invokeSetBrightness(const WmiDeadline& deadline, size_t instance, int brightness) override
+    {
+        if (!inputParameters || instance >= methodPaths.size()) {
+            return WBEM_E_NOT_FOUND;
+        }
+
+        _variant_t brightnessValue;
+        brightnessValue.vt = VT_UI1;
+        brightnessValue.bVal = static_cast<BYTE>(brightness);
+        wmiStats.propertyWrites++;
+        HRESULT hr = inputParameters->Put(L"Brightness", 0, &brightnessValue, CIM_UINT8);
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        _bstr_t methodName(L"WmiSetBrightness");
+        ComPtr<IWbemCallResult> call;
+        wmiStats.methodCalls++;
+        hr = service->ExecMethod(methodPaths[instance],
+                                 methodName,
+                                 WBEM_FLAG_RETURN_IMMEDIATELY,
+                                 NULL,
+                                 inputParameters.Get(),
+                                 NULL,
+                                 call.GetAddressOf());
+        if (SUCCEEDED(hr)) {
+            hr = waitWithin(call.Get(), deadline);
+        }
+        return hr;
+    }
+
+    HRESULT subscribeBrightnessEvents(const WmiDeadline& deadline, const WmiBrightnessEventHandlers& handlers) override
+    {
+        cancelBrightnessEvents();
+
+        // Events are delivered by calls from winmgmt into this process. An
+        // unsecured apartment stub accepts them whatever COM security the
+        // host process settled on.
+        ComPtr<IUnsecuredApartment> apartment;
+        HRESULT hr = CoCreateInstance(CLSID_UnsecuredApartment,
+                                      NULL,
+                                      CLSCTX_LOCAL_SERVER,
+                                      IID_PPV_ARGS(apartment.GetAddressOf()));
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        BrightnessEventSink* sink = new BrightnessEventSink(handlers);
+        ComPtr<IUnknown> stubUnknown;
+        hr = apartment->CreateObjectStub(sink, stubUnknown.GetAddressOf());
+        sink->Release();
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        ComPtr<IWbemObjectSink> stub;
+        hr = stubUnknown.As(&stub);
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        wmiStats.queries++;
+        hr = service->ExecNotificationQueryAsync(_bstr_t(L"WQL"),
+                                                 _bstr_t(L"SELECT InstanceName, Brightness FROM WmiMonitorBrightnessEvent"),
+                                                 WBEM_FLAG_SEND_STATUS,
+                                                 NULL,
+                                                 stub.Get());
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        brightnessEventStub = stub;
+        return S_OK;
+    }
+
+    void cancelBrightnessEvents() override
+    {
+        if (!brightnessEventStub) {
+            return;
+        }
+        if (service) {
+            service->CancelAsyncCall(brightnessEventStub.Get());
+        }
+        brightnessEventStub.Reset();
+    }
+
+  private:
+    bool comInitialized = false;
+    ComPtr<IWbemServices> service;
+    // Input parameters spawned from the method definition with Timeout
+    // already set, and the path of each WmiMonitorBrightnessMethods instance.
+    ComPtr<IWbemClassObject> inputParameters;
+    std::vector<_bstr_t> methodPaths;
+    ComPtr<IWbemObjectSink> brightnessEventStub;
+};
+
+typedef WmiSystemProvider WmiDefaultProvider;
+#else
+class WmiUnsupportedProvider : public WmiProvider {
+  public:
+    HRESULT connect(const WmiDeadline&) override
+    {
+        return E_NOTIMPL;
+    }
+
+    void disconnect() override
+    {
+    }
+
+    HRESULT enumerateBrightness(const WmiDeadline&, const WmiBrightnessCallback&) override
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT enumerateMonitors(const WmiDeadline&, std::vector<WmiMonitorIdentity>&) override
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT resolveBrightnessMethods(const WmiDeadline&, std::vector<std::string>&) override
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT invokeSetBrightness(const WmiDeadline&, size_t, int) override
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT subscribeBrightnessEvents(const WmiDeadline&, const WmiBrightnessEventHandlers&) override
+    {
+        return E_NOTIMPL;
+    }
+
+    void cancelBrightnessEvents() override
+    {
+    }
+};
+
+typedef WmiUnsupportedProvider WmiDefaultProvider;
+#endif
+
+std::mutex providerFactoryMutex;
+WmiProviderFactory providerFactory;
+
+}  // namespace
+
+std::unique_ptr<WmiProvider> createWmiProvider()
+{
+    WmiProviderFactory factory;
+    {
+        std::lock_guard<std::mutex> lock(providerFactoryMutex);
+        factory = providerFactory;
+    }
+    if (factory) {
+        return factory();
+    }
+    return std::unique_ptr<WmiProvider>(new WmiDefaultProvider());
+}
+
+void setWmiProviderFactory(WmiProviderFactory factory)
+{
+    std::lock_guard<std::mutex> lock(providerFactoryMutex);
+    providerFactory = factory;
+}
@@ -0,0 +1,178 @@
+#ifndef WMI_BRIDGE_PROVIDER_H
+#define WMI_BRIDGE_PROVIDER_H
+
+#ifdef _WIN32
+#include <windows.h>
+#include <WbemCli.h>
+#else
+#include "wmi_win32_types.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Counts the WMI calls the addon makes, so what each export costs can be
+// read from JS with getStats().
+struct WmiCallStats {
+    std::atomic<uint64_t> connections{0};
+    std::atomic<uint64_t> queries{0};
+    std::atomic<uint64_t> enumerations{0};
+    // GetObject, GetMethod and SpawnInstance.
+    std::atomic<uint64_t> objectLookups{0};
+    std::atomic<uint64_t> propertyReads{0};
+    std::atomic<uint64_t> propertyWrites{0};
+    std::atomic<uint64_t> methodCalls{0};
+    std::atomic<uint64_t> brightnessWrites{0};
+    std::atomic<uint64_t> brightnessMethodResolves{0};
+    std::atomic<uint64_t> topologyGeneration{0};
+    std::atomic<uint64_t> timeouts{0};
+    // Workers given up on because a call wouldn't return after being cancelled.
+    std::atomic<uint64_t> abandonedWorkers{0};
+    // Failed attempts to set up a worker thread, retries included.
+    std::atomic<uint64_t> attachFailures{0};
+};
+
+extern WmiCallStats wmiStats;
+
+// Errors that mean the connection to winmgmt is gone, usually because the
+// service restarted. Anything else is an answer from WMI and is passed on.
+bool isDisconnectError(HRESULT hr);
+
+// Errors ExecMethod gives when the instance a cached path names is gone,
+// as it is after the panel's driver reloads.
+bool isStaleMethodPath(HRESULT hr);
+
+// How often a wait on a semisynchronous call stops to check its deadline.
+const long kWmiPollSliceMs = 50;
+
+// How long a request may take. The WMI thread checks it between the short
+// waits it makes on semisynchronous calls, and the caller cancels it once
+// it stops waiting for the answer.
+class WmiDeadline {
+  public:
+    explicit WmiDeadline(std::chrono::milliseconds timeout)
+      : at(std::chrono::steady_clock::now() + timeout)
+    {
+    }
+
+    std::chrono::steady_clock::time_point expiry() const
+    {
+        return at;
+    }
+
+    void cancel()
+    {
+        cancelled = true;
+    }
+
+    bool expired() const
+    {
+        return cancelled || std::chrono::steady_clock::now() >= at;
+    }
+
+    // A WMI timeout in milliseconds, short enough that a cancellation is
+    // noticed promptly.
+    long slice() const
+    {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          at - std::chrono::steady_clock::now()).count();
+        if (left <= 0) {
+            return 0;
+        }
+        return static_cast<long>(std::min<long long>(left, kWmiPollSliceMs));
+    }
+
+  private:
+    std::chrono::steady_clock::time_point at;
+    std::atomic<bool> cancelled{false};
+};
+
+struct WmiBrightnessReading {
+    std::string instanceName;
+    int brightness = 0;
+    bool active = true;
+    // The levels the panel supports, from WmiMonitorBrightness.Level.
+    std::vector<int> levels;
+};
+
+struct WmiMonitorIdentity {
+    std::string instanceName;
+    bool hasUserFriendlyName = false;
+    std::string userFriendlyName;
+    // From the EDID. Empty or 0 when the monitor doesn't report them.
+    std::string manufacturerName;
+    std::string productCode;
+    std::string serialNumber;
+    int yearOfManufacture = 0;
+    int weekOfManufacture = 0;
+};
+
+// Returns false to stop the enumeration.
+typedef std::function<bool(const WmiBrightnessReading&)> WmiBrightnessCallback;
+
+struct WmiBrightnessEventHandlers {
+    // A WmiMonitorBrightnessEvent. Only InstanceName and Brightness are set.
+    std::function<void(const WmiBrightnessReading&)> onEvent;
+    // WMI ended the subscription without being asked to, as it does when
+    // winmgmt restarts.
+    std::function<void()> onEnded;
+};
+
+// Everything the bridge asks of WMI, at the level of the ROOT\WMI classes it
+// uses rather than of COM. Each worker thread gets its own provider and only
+// uses it from that thread. The system provider talks to winmgmt; the
+// simulator stands in for it where there is no WMI.
+class WmiProvider {
+  public:
+    virtual ~WmiProvider() {}
+
+    // Per-thread setup and teardown, run on the worker thread around
+    // everything else. A failed attach fails the tasks on that thread until
+    // a retry succeeds, so attachThread may run again after a failure.
+    virtual HRESULT attachThread()
+    {
+        return S_OK;
+    }
+
+    virtual void detachThread()
+    {
+    }
+
+    virtual HRESULT connect(const WmiDeadline& deadline) = 0;
+    // Drops the connection, the resolved method and any subscription.
+    virtual void disconnect() = 0;
+
+    // Every WmiMonitorBrightness instance with a usable level, in one pass.
+    virtual HRESULT enumerateBrightness(const WmiDeadline& deadline, const WmiBrightnessCallback& onReading) = 0;
+    // Every WmiMonitorID instance with an instance name.
+    virtual HRESULT enumerateMonitors(const WmiDeadline& deadline, std::vector<WmiMonitorIdentity>& monitors) = 0;
+
+    // Looks up WmiSetBrightness and every WmiMonitorBrightnessMethods
+    // instance it can be called on, and keeps what calling it takes.
+    // instances gets their names, in the order invokeSetBrightness indexes
+    // them. WBEM_E_NOT_FOUND when there are none.
+    virtual HRESULT resolveBrightnessMethods(const WmiDeadline& deadline, std::vector<std::string>& instances) = 0;
+    // Calls WmiSetBrightness on one of the instances from the last resolve.
+    virtual HRESULT invokeSetBrightness(const WmiDeadline& deadline, size_t instance, int brightness) = 0;
+
+    virtual HRESULT subscribeBrightnessEvents(const WmiDeadline& deadline, const WmiBrightnessEventHandlers& handlers) = 0;
+    // Ends the subscription, if there is one. Harmless if WMI already has.
+    virtual void cancelBrightnessEvents() = 0;
+};
+
+typedef std::function<std::unique_ptr<WmiProvider>()> WmiProviderFactory;
+
+// A provider for a new worker thread. On Windows this is the system provider
+// until another factory is installed; elsewhere every call fails with
+// E_NOTIMPL until one is. Workers that are already running keep theirs.
+std::unique_ptr<WmiProvider> createWmiProvider();
+// An empty factory restores the default.
+void setWmiProviderFactory(WmiProviderFactory factory);
+
+#endif
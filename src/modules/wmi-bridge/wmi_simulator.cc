@@ -0,0 +1,449 @@
+#include "wmi_simulator.h"
+
+#include <algorithm>
+#include <thread>
+
+// A connection to a WmiSimulator. Like a real IWbemServices, it stops
+// working once the service restarts, and has to be connected again.
+class WmiSimulatedProvider : public WmiProvider {
+  public:
+    explicit WmiSimulatedProvider(std::shared_ptr<WmiSimulator> simulator)
+      : simulator(std::move(simulator))
+    {
+    }
+
+    ~WmiSimulatedProvider() override
+    {
+        cancelBrightnessEvents();
+    }
+
+    HRESULT attachThread() override
+    {
+        return simulator->attach();
+    }
+
+    HRESULT connect(const WmiDeadline& deadline) override
+    {
+        HRESULT hr = simulator->enter(deadline, 0, true);
+        if (FAILED(hr)) {
+            return hr;
+        }
+        generation = simulator->currentGeneration();
+        return S_OK;
+    }
+
+    void disconnect() override
+    {
+        methodPaths.clear();
+        methodInstances.clear();
+        cancelBrightnessEvents();
+        generation = 0;
+    }
+
+    HRESULT enumerateBrightness(const WmiDeadline& deadline, const WmiBrightnessCallback& onReading) override
+    {
+        wmiStats.queries++;
+        HRESULT hr = call(deadline);
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        for (const WmiSimulator::Instance& instance : simulator->snapshot()) {
+            const WmiSimulatedMonitor& monitor = instance.monitor;
+            if (!monitor.hasBrightness) {
+                continue;
+            }
+            hr = next(deadline);
+            if (FAILED(hr)) {
+                return hr;
+            }
+
+            WmiBrightnessReading reading;
+            reading.instanceName = monitor.instanceName;
+            reading.brightness = monitor.brightness;
+            reading.active = monitor.active;
+            reading.levels = monitor.levels;
+            wmiStats.propertyReads += 4;
+            if (!onReading(reading)) {
+                return S_OK;
+            }
+        }
+        return next(deadline);
+    }
+
+    HRESULT enumerateMonitors(const WmiDeadline& deadline, std::vector<WmiMonitorIdentity>& monitors) override
+    {
+        wmiStats.queries++;
+        HRESULT hr = call(deadline);
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        for (const WmiSimulator::Instance& instance : simulator->snapshot()) {
+            const WmiSimulatedMonitor& monitor = instance.monitor;
+            hr = next(deadline);
+            if (FAILED(hr)) {
+                return hr;
+            }
+
+            WmiMonitorIdentity identity;
+            identity.instanceName = monitor.instanceName;
+            identity.hasUserFriendlyName = true;
+            identity.userFriendlyName = monitor.userFriendlyName;
+            identity.manufacturerName = monitor.manufacturerName;
+            identity.productCode = monitor.productCode;
+            identity.serialNumber = monitor.serialNumber;
+            identity.yearOfManufacture = monitor.yearOfManufacture;
+            identity.weekOfManufacture = monitor.weekOfManufacture;
+            wmiStats.propertyReads += 7;
+            monitors.push_back(identity);
+        }
+        return next(deadline);
+    }
+
+    HRESULT resolveBrightnessMethods(const WmiDeadline& deadline, std::vector<std::string>& instances) override
+    {
+        methodPaths.clear();
+        methodInstances.clear();
+
+        wmiStats.queries++;
+        HRESULT hr = call(deadline);
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        std::vector<uint64_t> paths;
+        std::vector<std::string> names;
+        for (const WmiSimulator::Instance& instance : simulator->snapshot()) {
+            if (!instance.monitor.hasBrightness) {
+                continue;
+            }
+            hr = next(deadline);
+            if (FAILED(hr)) {
+                return hr;
+            }
+            wmiStats.propertyReads += 2;
+            paths.push_back(instance.path);
+            names.push_back(instance.monitor.instanceName);
+        }
+        hr = next(deadline);
+        if (FAILED(hr)) {
+            return hr;
+        }
+        if (names.empty()) {
+            return WBEM_E_NOT_FOUND;
+        }
+
+        // GetObject goes to winmgmt. GetMethod, SpawnInstance and the Put
+        // of Timeout are local to the class object it returns.
+        wmiStats.objectLookups++;
+        hr = call(deadline);
+        if (FAILED(hr)) {
+            return hr;
+        }
+        wmiStats.objectLookups += 2;
+        wmiStats.propertyWrites++;
+
+        methodPaths = paths;
+        methodInstances = names;
+        instances = names;
+        return S_OK;
+    }
+
+    HRESULT invokeSetBrightness(const WmiDeadline& deadline, size_t instance, int brightness) override
+    {
+        if (instance >= methodInstances.size()) {
+            return WBEM_E_NOT_FOUND;
+        }
+
+        wmiStats.propertyWrites++;
+        wmiStats.methodCalls++;
+        HRESULT hr = call(deadline);
+        if (FAILED(hr)) {
+            return hr;
+        }
+        {
+            std::lock_guard<std::mutex> lock(simulator->mutex);
+            simulator->counters.methodCalls++;
+        }
+
+        // Gone since the method was resolved: the path no longer names an
+        // instance.
+        if (!simulator->applyBrightness(methodPaths[instance], methodInstances[instance], brightness)) {
+            return WBEM_E_NOT_FOUND;
+        }
+        return S_OK;
+    }
+
+    HRESULT subscribeBrightnessEvents(const WmiDeadline& deadline, const WmiBrightnessEventHandlers& handlers) override
+    {
+        cancelBrightnessEvents();
+
+        wmiStats.queries++;
+        HRESULT hr = call(deadline);
+        if (FAILED(hr)) {
+            return hr;
+        }
+
+        subscription = simulator->addSubscription(generation, handlers);
+        if (subscription == 0) {
+            generation = 0;
+            return RPC_E_DISCONNECTED;
+        }
+        return S_OK;
+    }
+
+    void cancelBrightnessEvents() override
+    {
+        if (subscription != 0) {
+            simulator->removeSubscription(subscription);
+            subscription = 0;
+        }
+    }
+
+  private:
+    HRESULT call(const WmiDeadline& deadline)
+    {
+        HRESULT hr = simulator->enter(deadline, generation, false);
+        if (isDisconnectError(hr)) {
+            generation = 0;
+        }
+        return hr;
+    }
+
+    // One Next() on a semisynchronous enumerator.
+    HRESULT next(const WmiDeadline& deadline)
+    {
+        wmiStats.enumerations++;
+        return call(deadline);
+    }
+
+    std::shared_ptr<WmiSimulator> simulator;
+    // The service generation this connection was made in, or 0 if it isn't
+    // connected.
+    uint64_t generation = 0;
+    std::vector<uint64_t> methodPaths;
+    std::vector<std::string> methodInstances;
+    uint64_t subscription = 0;
+};
+
+WmiSimulator::WmiSimulator(const WmiSimulatorOptions& options)
+  : options(options)
+  , rng(options.seed)
+{
+}
+
+std::unique_ptr<WmiProvider> WmiSimulator::open()
+{
+    return std::unique_ptr<WmiProvider>(new WmiSimulatedProvider(shared_from_this()));
+}
+
+void WmiSimulator::addMonitor(const WmiSimulatedMonitor& monitor)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Instance instance;
+    instance.path = ++nextPath;
+    instance.monitor = monitor;
+    instances.push_back(instance);
+}
+
+void WmiSimulator::removeMonitor(const std::string& instanceName)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    instances.erase(std::remove_if(instances.begin(),
+                                   instances.end(),
+                                   [&](const Instance& instance) {
+                                       return instance.monitor.instanceName == instanceName;
+                                   }),
+                    instances.end());
+}
+
+bool WmiSimulator::setBrightness(const std::string& instanceName, int brightness)
+{
+    return applyBrightness(0, instanceName, brightness);
+}
+
+int WmiSimulator::brightness(const std::string& instanceName)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Instance* instance = findInstance(instanceName);
+    if (instance == nullptr || !instance->monitor.hasBrightness) {
+        return -1;
+    }
+    return instance->monitor.brightness;
+}
+
+bool WmiSimulator::applyBrightness(uint64_t path, const std::string& instanceName, int brightness)
+{
+    WmiBrightnessReading event;
+    std::vector<WmiBrightnessEventHandlers> listeners;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Instance* instance = findInstance(instanceName);
+        if (instance == nullptr || !instance->monitor.hasBrightness || (path != 0 && instance->path != path)) {
+            return false;
+        }
+        WmiSimulatedMonitor* monitor = &instance->monitor;
+        monitor->brightness = std::max(0, std::min(100, brightness));
+
+        event.instanceName = monitor->instanceName;
+        event.brightness = monitor->brightness;
+        for (const Subscription& subscription : subscriptions) {
+            listeners.push_back(subscription.handlers);
+        }
+        counters.events += listeners.size();
+    }
+
+    // Outside the lock, since a listener may well call back in.
+    for (const WmiBrightnessEventHandlers& handlers : listeners) {
+        handlers.onEvent(event);
+    }
+    return true;
+}
+
+void WmiSimulator::restartService()
+{
+    std::vector<Subscription> ended;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        serviceGeneration++;
+        ended.swap(subscriptions);
+    }
+
+    for (const Subscription& subscription : ended) {
+        subscription.handlers.onEnded();
+    }
+}
+
+WmiSimulatorStats WmiSimulator::stats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+void WmiSimulator::resetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    counters = WmiSimulatorStats();
+}
+
+HRESULT WmiSimulator::enter(const WmiDeadline& deadline, uint64_t connectionGeneration, bool connecting)
+{
+    bool hang = false;
+    bool drop = false;
+    bool fail = false;
+    uint32_t latency = 0;
+    uint32_t hangMilliseconds = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (connecting) {
+            counters.connects++;
+        } else {
+            counters.calls++;
+        }
+        hang = roll(options.hangRate);
+        drop = !connecting && roll(options.disconnectRate);
+        fail = roll(options.failureRate);
+        latency = connecting ? options.connectLatencyMicroseconds : options.callLatencyMicroseconds;
+        hangMilliseconds = options.hangMilliseconds;
+        if (hang) {
+            counters.hangs++;
+        }
+    }
+
+    if (hang) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(hangMilliseconds));
+    } else if (latency > 0) {
+        auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(latency);
+        while (true) {
+            if (deadline.expired()) {
+                std::lock_guard<std::mutex> lock(mutex);
+                counters.cancelledCalls++;
+                return WBEM_E_CALL_CANCELLED;
+            }
+            auto now = std::chrono::steady_clock::now();
+            if (now >= until) {
+                break;
+            }
+            std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+              until - now, std::chrono::milliseconds(kWmiPollSliceMs)));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!connecting && connectionGeneration != serviceGeneration) {
+        return RPC_E_DISCONNECTED;
+    }
+    if (drop) {
+        counters.injectedDisconnects++;
+        return RPC_E_DISCONNECTED;
+    }
+    if (fail) {
+        counters.injectedFailures++;
+        return WBEM_E_FAILED;
+    }
+    return S_OK;
+}
+
+uint64_t WmiSimulator::currentGeneration()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return serviceGeneration;
+}
+
+std::vector<WmiSimulator::Instance> WmiSimulator::snapshot()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return instances;
+}
+
+HRESULT WmiSimulator::attach()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.attaches++;
+    if (counters.failedAttaches < options.attachFailures) {
+        counters.failedAttaches++;
+        return E_FAIL;
+    }
+    return S_OK;
+}
+
+bool WmiSimulator::roll(double rate)
+{
+    if (rate <= 0) {
+        return false;
+    }
+    return std::uniform_real_distribution<double>(0, 1)(rng) < rate;
+}
+
+WmiSimulator::Instance* WmiSimulator::findInstance(const std::string& instanceName)
+{
+    for (Instance& instance : instances) {
+        if (instance.monitor.instanceName == instanceName) {
+            return &instance;
+        }
+    }
+    return nullptr;
+}
+
+uint64_t WmiSimulator::addSubscription(uint64_t connectionGeneration, const WmiBrightnessEventHandlers& handlers)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (connectionGeneration != serviceGeneration) {
+        return 0;
+    }
+    Subscription subscription;
+    subscription.id = ++nextSubscription;
+    subscription.handlers = handlers;
+    subscriptions.push_back(subscription);
+    return subscription.id;
+}
+
+void WmiSimulator::removeSubscription(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    subscriptions.erase(std::remove_if(subscriptions.begin(),
+                                       subscriptions.end(),
+                                       [id](const Subscription& subscription) { return subscription.id == id; }),
+                        subscriptions.end());
+}
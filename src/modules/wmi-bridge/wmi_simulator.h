@@ -0,0 +1,133 @@
+#ifndef WMI_BRIDGE_SIMULATOR_H
+#define WMI_BRIDGE_SIMULATOR_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "wmi_provider.h"
+
+// One monitor as ROOT\WMI describes it. Every monitor has a WmiMonitorID
+// instance; internal panels also have WmiMonitorBrightness and
+// WmiMonitorBrightnessMethods instances.
+struct WmiSimulatedMonitor {
+    std::string instanceName;
+    std::string userFriendlyName;
+    std::string manufacturerName;
+    std::string productCode;
+    std::string serialNumber;
+    int yearOfManufacture = 0;
+    int weekOfManufacture = 0;
+    bool hasBrightness = false;
+    int brightness = 0;
+    bool active = true;
+    std::vector<int> levels;
+};
+
+struct WmiSimulatorOptions {
+    // Added to every call, standing in for the round trip to winmgmt. The
+    // wait gives up at the call's deadline, as a semisynchronous call does.
+    uint32_t callLatencyMicroseconds = 0;
+    // Added to connect, which is much slower than the calls on Windows.
+    uint32_t connectLatencyMicroseconds = 0;
+    // Chance that a call fails with WBEM_E_FAILED.
+    double failureRate = 0;
+    // Chance that a call finds the connection gone, as it does when winmgmt
+    // restarts, so the session has to reconnect.
+    double disconnectRate = 0;
+    // Chance that a call hangs for hangMilliseconds without regard for its
+    // deadline, the way a connect to a stuck winmgmt does.
+    double hangRate = 0;
+    uint32_t hangMilliseconds = 1000;
+    // How many thread setups fail before one succeeds, as they do while COM
+    // security can't be set up yet.
+    uint32_t attachFailures = 0;
+    uint32_t seed = 1;
+};
+
+struct WmiSimulatorStats {
+    uint64_t connects = 0;
+    uint64_t calls = 0;
+    uint64_t methodCalls = 0;
+    uint64_t injectedFailures = 0;
+    uint64_t injectedDisconnects = 0;
+    uint64_t hangs = 0;
+    // Calls whose deadline passed during the simulated latency.
+    uint64_t cancelledCalls = 0;
+    uint64_t events = 0;
+    uint64_t attaches = 0;
+    uint64_t failedAttaches = 0;
+};
+
+// An in-memory ROOT\WMI with the brightness classes the bridge uses. Every
+// provider it opens is a connection to it, so changes made here show up in
+// all of them, and events reach every subscription. WmiSetBrightness raises
+// WmiMonitorBrightnessEvent, as the panel drivers do. Each query, each step
+// of an enumeration, GetObject, ExecMethod and connect counts as a call.
+class WmiSimulator : public std::enable_shared_from_this<WmiSimulator> {
+  public:
+    explicit WmiSimulator(const WmiSimulatorOptions& options = WmiSimulatorOptions());
+
+    // Returns a provider for setWmiProviderFactory.
+    std::unique_ptr<WmiProvider> open();
+
+    void addMonitor(const WmiSimulatedMonitor& monitor);
+    void removeMonitor(const std::string& instanceName);
+    // A change that didn't come through WMI, such as a brightness key.
+    // Raises an event like any other change. False if there is no such panel.
+    bool setBrightness(const std::string& instanceName, int brightness);
+    // -1 if there is no such panel.
+    int brightness(const std::string& instanceName);
+    // Drops every connection and ends every subscription, as restarting
+    // winmgmt does.
+    void restartService();
+
+    WmiSimulatorStats stats();
+    void resetStats();
+
+  private:
+    friend class WmiSimulatedProvider;
+
+    // A monitor and the path its instances have until it is removed. A
+    // monitor added back under the same name gets a new one, as a panel
+    // does when its driver reloads.
+    struct Instance {
+        uint64_t path;
+        WmiSimulatedMonitor monitor;
+    };
+
+    struct Subscription {
+        uint64_t id;
+        WmiBrightnessEventHandlers handlers;
+    };
+
+    // Applies the options to one call on a connection made in
+    // connectionGeneration. S_OK if the call goes ahead.
+    HRESULT enter(const WmiDeadline& deadline, uint64_t connectionGeneration, bool connecting);
+    // Applies attachFailures to one thread setup.
+    HRESULT attach();
+    uint64_t currentGeneration();
+    std::vector<Instance> snapshot();
+    bool roll(double rate);
+    Instance* findInstance(const std::string& instanceName);
+    // WmiSetBrightness on the instance at path. False if it is gone.
+    bool applyBrightness(uint64_t path, const std::string& instanceName, int brightness);
+    // 0 if the connection is from before a restart.
+    uint64_t addSubscription(uint64_t connectionGeneration, const WmiBrightnessEventHandlers& handlers);
+    void removeSubscription(uint64_t id);
+
+    std::mutex mutex;
+    WmiSimulatorOptions options;
+    std::mt19937 rng;
+    std::vector<Instance> instances;
+    uint64_t nextPath = 0;
+    uint64_t serviceGeneration = 1;
+    std::vector<Subscription> subscriptions;
+    uint64_t nextSubscription = 0;
+    WmiSimulatorStats counters;
+};
+
+#endif
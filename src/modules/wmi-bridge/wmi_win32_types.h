@@ -0,0 +1,40 @@
+#ifndef WMI_BRIDGE_WIN32_TYPES_H
+#define WMI_BRIDGE_WIN32_TYPES_H
+
+// The HRESULTs the provider-independent WMI code checks for, so that it and
+// the simulated provider build where there is no Windows SDK. Names and
+// values follow <winerror.h> and <WbemCli.h>.
+
+#include <cstdint>
+
+typedef int32_t HRESULT;
+
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+#define S_OK ((HRESULT)0L)
+#define S_FALSE ((HRESULT)1L)
+#define E_NOTIMPL ((HRESULT)0x80004001L)
+#define E_FAIL ((HRESULT)0x80004005L)
+
+#define FACILITY_WIN32 7
+#define HRESULT_FROM_WIN32(x) \
+    ((HRESULT)(x) <= 0 ? ((HRESULT)(x)) : ((HRESULT)(((x) & 0x0000FFFF) | (FACILITY_WIN32 << 16) | 0x80000000)))
+
+#define RPC_S_SERVER_UNAVAILABLE 1722L
+#define RPC_S_CALL_FAILED 1726L
+
+#define RPC_E_SERVER_DIED ((HRESULT)0x80010007L)
+#define RPC_E_SERVER_DIED_DNE ((HRESULT)0x80010012L)
+#define RPC_E_DISCONNECTED ((HRESULT)0x80010108L)
+
+#define WBEM_S_NO_ERROR ((HRESULT)0L)
+#define WBEM_E_FAILED ((HRESULT)0x80041001L)
+#define WBEM_E_NOT_FOUND ((HRESULT)0x80041002L)
+#define WBEM_E_INVALID_OBJECT ((HRESULT)0x8004100FL)
+#define WBEM_E_TRANSPORT_FAILURE ((HRESULT)0x80041015L)
+#define WBEM_E_CALL_CANCELLED ((HRESULT)0x80041032L)
+#define WBEM_E_SHUTTING_DOWN ((HRESULT)0x80041033L)
+#define WBEM_E_INVALID_OBJECT_PATH ((HRESULT)0x8004103AL)
+
+#endif